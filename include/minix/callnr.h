@@ -47,6 +47,7 @@
 #define IOCTL		  54
 #define FCNTL		  55
 #define	SYMLINK		  57
+#define VFORK		  58
 #define EXEC		  59
 #define UMASK		  60 
 #define CHROOT		  61 
@@ -61,12 +61,15 @@
 #	define DL_PACK_SEND	0x01
 #	define DL_PACK_RECV	0x02
 #	define DL_READ_IP	0x04
+#	define DL_PACK_BATCH	0x08	/* DL_COUNT is a number of packets */
 
 /* Bits in 'DL_MODE' field of DL requests. */
 #	define DL_NOMODE	0x0
 #	define DL_PROMISC_REQ	0x2
 #	define DL_MULTI_REQ	0x4
 #	define DL_BROAD_REQ	0x8
+#	define DL_BATCH_REQ	0x10	/* DL_READV: fill several packets */
+#	define DL_STRIDE_SHIFT	8	/* DL_MODE >> this: iovecs per packet */
 
 #	define NW_OPEN		DEV_OPEN
 #	define NW_CLOSE		DEV_CLOSE
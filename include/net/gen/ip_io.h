@@ -52,4 +52,59 @@ typedef struct nwio_ipopt
 #	define NWIO_RWDATONLY	0x00001000l
 #	define NWIO_RWDATALL	0x10000000l
 
+/* Buffer statistics, see NWIOGIPBUFSTAT. */
+#define NWBS_POOL_NR	3	/* buffer pools */
+#define NWBS_CLNT_NR	8	/* clients of the buffer pool */
+#define NWBS_HIST_NR	8	/* buffers held less than 4^i ticks */
+
+typedef struct nwio_bufpool
+{
+	u32_t nwbp_size;	/* bytes in a buffer */
+	u32_t nwbp_nr;		/* buffers in the pool */
+	u32_t nwbp_free;	/* buffers free now */
+	u32_t nwbp_minfree;	/* lowest number free */
+	u32_t nwbp_alloc;	/* buffers handed out */
+	u32_t nwbp_fallback;	/* ... because a better fit was not free */
+	u32_t nwbp_held[NWBS_HIST_NR];
+} nwio_bufpool_t;
+
+typedef struct nwio_bufclnt
+{
+	char nwbc_name[8];
+	u32_t nwbc_acc;		/* accessors held now */
+	u32_t nwbc_bytes;	/* bytes held now */
+	u32_t nwbc_maxacc;	/* most accessors held when asked */
+	u32_t nwbc_maxbytes;	/* most bytes held when asked */
+	u32_t nwbc_freereq;	/* times asked to free buffers */
+	u32_t nwbc_freed;	/* bytes freed when asked */
+} nwio_bufclnt_t;
+
+typedef struct nwio_bufstat
+{
+	u32_t nwbs_acc_nr;	/* accessors */
+	u32_t nwbs_acc_inuse;	/* accessors in use now */
+	u32_t nwbs_acc_maxinuse;	/* most accessors ever in use */
+	u32_t nwbs_pack_copies;	/* bf_pack() calls that had to copy */
+	u32_t nwbs_pack_bytes;	/* bytes they copied */
+	u32_t nwbs_pool_nr;
+	u32_t nwbs_clnt_nr;
+	nwio_bufpool_t nwbs_pool[NWBS_POOL_NR];
+	nwio_bufclnt_t nwbs_clnt[NWBS_CLNT_NR];
+} nwio_bufstat_t;
+
+/* IP statistics, see NWIOGIPSTAT. */
+typedef struct nwio_ipstat
+{
+	u32_t nwis_ass_nr;	/* datagrams reassembled at the same time */
+	u32_t nwis_ass_inuse;	/* datagrams being reassembled now */
+	u32_t nwis_ass_max;	/* bytes that may be held for reassembly */
+	u32_t nwis_ass_bytes;	/* bytes held now */
+	u32_t nwis_ass_frags;	/* fragments received */
+	u32_t nwis_ass_ok;	/* datagrams reassembled */
+	u32_t nwis_ass_timeout;	/* datagrams that timed out */
+	u32_t nwis_ass_evict;	/* datagrams given up to make room */
+	u32_t nwis_ass_overlap;	/* fragments overlapping earlier ones */
+	u32_t nwis_ass_bad;	/* bad fragments or datagrams */
+} nwio_ipstat_t;
+
 #endif /* __SERVER__IP__GEN__IP_IO_H__ */
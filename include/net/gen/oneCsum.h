@@ -6,5 +6,7 @@ server/ip/gen/oneCsum.h
 #define __SERVER__IP__GEN__ONECSUM_H__
 
 u16_t oneC_sum _ARGS(( U16_t prev, void *data, size_t data_len ));
+u16_t oneC_copysum _ARGS(( U16_t prev, void *dst, void *src,
+							size_t data_len ));
 
 #endif /* __SERVER__IP__GEN__ONECSUM_H__ */
@@ -8,11 +8,19 @@ server/ip/gen/psip_io.h
 typedef struct nwio_psipopt
 {
 	unsigned long nwpo_flags;
+	unsigned long nwpo_delay;	/* clock ticks written packets wait */
+	unsigned long nwpo_drop;	/* written packets lost, per 1000 */
 } nwio_psipopt_t;
 
 #define NWPO_PROMISC_MASK	0x0001L
 #define		NWPO_EN_PROMISC		0x00000001L
 #define		NWUO_DI_PROMISC		0x00010000L
+#define NWPO_DELAY_MASK		0x0002L
+#define		NWPO_EN_DELAY		0x00000002L
+#define		NWPO_DI_DELAY		0x00020000L
+#define NWPO_DROP_MASK		0x0004L
+#define		NWPO_EN_DROP		0x00000004L
+#define		NWPO_DI_DROP		0x00040000L
 
 #endif /* __SERVER__IP__GEN__PSIP_IO_H__ */
 
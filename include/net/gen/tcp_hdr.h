@@ -37,6 +37,10 @@ typedef struct tcp_hdropt
 #define TCP_OPT_EOL	0
 #define TCP_OPT_NOP	1
 #define TCP_OPT_MSS	2
+#define TCP_OPT_WSOPT	3
+#define TCP_OPT_SACKPERM	4
+#define TCP_OPT_SACK	5
+#define TCP_OPT_TS	8
 
 #endif /* __SERVER__IP__GEN__TCP_HDR_H__ */
 
@@ -12,6 +12,8 @@ typedef struct nwio_tcpconf
 	ipaddr_t nwtc_remaddr;
 	tcpport_t nwtc_locport;
 	tcpport_t nwtc_remport;
+	u32_t nwtc_sndbuf;
+	u32_t nwtc_rcvbuf;
 } nwio_tcpconf_t;
 
 #define NWTC_NOFLAGS	0x0000L
@@ -29,6 +31,9 @@ typedef struct nwio_tcpconf
 #define NWTC_REMPORT_MASK	0x0200L
 #	define NWTC_SET_RP	0x00000200L
 #	define NWTC_UNSET_RP	0x02000000L
+#define NWTC_BUFSIZ_MASK	0x0400L
+#	define NWTC_SET_BUFSIZ	0x00000400L
+#	define NWTC_UNSET_BUFSIZ	0x04000000L
 
 typedef struct nwio_tcpcl
 {
@@ -17,6 +17,8 @@
 #define NWIOGIPCONF	_IOR('n', 33, struct nwio_ipconf)
 #define NWIOSIPOPT	_IOW('n', 34, struct nwio_ipopt)
 #define NWIOGIPOPT	_IOR('n', 35, struct nwio_ipopt)
+#define NWIOGIPBUFSTAT	_IOR('n', 36, struct nwio_bufstat)
+#define NWIOGIPSTAT	_IOR('n', 37, struct nwio_ipstat)
 
 #define NWIOGIPOROUTE	_IORW('n', 40, struct nwio_route)
 #define NWIOSIPOROUTE	_IOW ('n', 41, struct nwio_route)
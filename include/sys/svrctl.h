@@ -26,6 +26,7 @@ Created:	Feb 15, 1994 by Philip Homburg <philip@cs.vu.nl>
 /* Kernel controls. */
 #define SYSSIGNON	_IOR('S',  2, struct systaskinfo)
 #define SYSGETENV	_IOW('S',  5, struct sysgetenv)
+#define SYSGETPROC	_IORW('S', 6, struct sysgetproc)
 
 struct mmswapon {
 	u32_t		offset;		/* Starting offset within file. */
@@ -51,6 +52,28 @@ struct sysgetenv {
 	size_t		vallen;		/* Size of return data buffer. */
 };
 
+/* Reasons for a process to be blocked, as counted by SYSGETPROC. */
+#define BLK_FS		0	/* waiting for the file system */
+#define BLK_MM		1	/* waiting for the memory manager */
+#define BLK_TASK	2	/* waiting for a kernel task */
+#define BLK_OTHER	3	/* waiting for ANY, or another server */
+#define NR_BLK		4
+
+struct sysgetproc {
+	int		proc_nr;	/* Process slot to report on. */
+	pid_t		pid;		/* Process id, 0 for tasks and servers. */
+	clock_t		utime;		/* User time in ticks. */
+	clock_t		stime;		/* System time in ticks. */
+	u32_t		msgsent;	/* Messages sent. */
+	u32_t		msgrecv;	/* Messages received. */
+	u32_t		nvcsw;		/* Voluntary context switches. */
+	u32_t		nivcsw;		/* Involuntary context switches. */
+	u32_t		nflips;		/* Shadow flips (Atari), else 0. */
+	u32_t		nswapin;	/* Times swapped in by MM. */
+	u32_t		nswapout;	/* Times swapped out by MM. */
+	clock_t		blktime[NR_BLK];/* Ticks spent blocked, by reason. */
+};
+
 _PROTOTYPE( int svrctl, (int _request, void *_data)			);
 
 #endif /* _SYS__SVRCTL_H */
@@ -147,6 +147,7 @@ _PROTOTYPE( int getdomainname, (char *_domain, size_t _len)		);
 _PROTOTYPE( int ttyslot, (void)						);
 _PROTOTYPE( int fttyslot, (int _fd)					);
 _PROTOTYPE( char *crypt, (const char *_key, const char *_salt)		);
+_PROTOTYPE( pid_t vfork, (void)						);
 #endif
 
 #endif /* _UNISTD_H */
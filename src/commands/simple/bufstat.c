@@ -0,0 +1,158 @@
+/*
+bufstat.c
+
+Print the buffer pool statistics of the network server.
+*/
+
+#define _POSIX_C_SOURCE 2
+
+#include <sys/types.h>
+#include <sys/ioctl.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <net/netlib.h>
+#include <net/gen/in.h>
+#include <net/gen/ip_io.h>
+
+char *prog_name;
+
+static void print_pools(nwio_bufstat_t *bufstat);
+static void print_clients(nwio_bufstat_t *bufstat);
+static void usage(void);
+
+int main(int argc, char *argv[])
+{
+	nwio_bufstat_t bufstat;
+	int ip_fd;
+	int c;
+	char *ip_device;
+	char *I_arg;
+
+	prog_name= argv[0];
+
+	I_arg= NULL;
+	while ((c =getopt(argc, argv, "?I:")) != -1)
+	{
+		switch(c)
+		{
+		case '?':
+			usage();
+		case 'I':
+			if (I_arg)
+				usage();
+			I_arg= optarg;
+			break;
+		default:
+			fprintf(stderr, "%s: getopt failed: '%c'\n",
+				prog_name, c);
+			exit(1);
+		}
+	}
+	if (optind != argc)
+		usage();
+
+	ip_device= I_arg;
+	if (ip_device == NULL)
+		ip_device= getenv("IP_DEVICE");
+	if (ip_device == NULL)
+		ip_device= IP_DEVICE;
+
+	ip_fd= open(ip_device, O_RDONLY);
+	if (ip_fd == -1)
+	{
+		fprintf(stderr, "%s: unable to open %s: %s\n", prog_name,
+			ip_device, strerror(errno));
+		exit(1);
+	}
+
+	if (ioctl(ip_fd, NWIOGIPBUFSTAT, &bufstat) == -1)
+	{
+		fprintf(stderr, "%s: unable to NWIOGIPBUFSTAT: %s\n",
+			prog_name, strerror(errno));
+		exit(1);
+	}
+
+	print_pools(&bufstat);
+	printf("\n");
+	print_clients(&bufstat);
+	exit(0);
+}
+
+static void print_pools(nwio_bufstat_t *bufstat)
+{
+	int i, h;
+	nwio_bufpool_t *bp;
+
+	printf("%6s %5s %5s %7s %10s %9s\n",
+		"size", "total", "free", "minfree", "allocated", "fallback");
+	for (i= 0; i<bufstat->nwbs_pool_nr; i++)
+	{
+		bp= &bufstat->nwbs_pool[i];
+		printf("%6lu %5lu %5lu %7lu %10lu %9lu\n",
+			(unsigned long) bp->nwbp_size,
+			(unsigned long) bp->nwbp_nr,
+			(unsigned long) bp->nwbp_free,
+			(unsigned long) bp->nwbp_minfree,
+			(unsigned long) bp->nwbp_alloc,
+			(unsigned long) bp->nwbp_fallback);
+	}
+
+	printf("\nfreed after less than n ticks:\n%6s", "");
+	for (h= 0; h<NWBS_HIST_NR; h++)
+	{
+		if (h == NWBS_HIST_NR-1)
+			printf(" %8s", "more");
+		else
+			printf(" %8lu", 1UL << (2*h));
+	}
+	printf("\n");
+	for (i= 0; i<bufstat->nwbs_pool_nr; i++)
+	{
+		bp= &bufstat->nwbs_pool[i];
+		printf("%6lu", (unsigned long) bp->nwbp_size);
+		for (h= 0; h<NWBS_HIST_NR; h++)
+			printf(" %8lu", (unsigned long) bp->nwbp_held[h]);
+		printf("\n");
+	}
+
+	printf("\naccessors: %lu of %lu in use, at most %lu\n",
+		(unsigned long) bufstat->nwbs_acc_inuse,
+		(unsigned long) bufstat->nwbs_acc_nr,
+		(unsigned long) bufstat->nwbs_acc_maxinuse);
+	printf("packed: %lu times, %lu bytes copied\n",
+		(unsigned long) bufstat->nwbs_pack_copies,
+		(unsigned long) bufstat->nwbs_pack_bytes);
+}
+
+static void print_clients(nwio_bufstat_t *bufstat)
+{
+	int i;
+	nwio_bufclnt_t *bc;
+
+	printf("%-8s %6s %8s %6s %8s %7s %8s\n",
+		"client", "accs", "bytes", "maxacc", "maxbytes",
+		"freereq", "freed");
+	for (i= 0; i<bufstat->nwbs_clnt_nr; i++)
+	{
+		bc= &bufstat->nwbs_clnt[i];
+		printf("%-8.8s %6lu %8lu %6lu %8lu %7lu %8lu\n",
+			bc->nwbc_name,
+			(unsigned long) bc->nwbc_acc,
+			(unsigned long) bc->nwbc_bytes,
+			(unsigned long) bc->nwbc_maxacc,
+			(unsigned long) bc->nwbc_maxbytes,
+			(unsigned long) bc->nwbc_freereq,
+			(unsigned long) bc->nwbc_freed);
+	}
+}
+
+static void usage(void)
+{
+	fprintf(stderr, "Usage: %s [ -I <ip-device> ]\n", prog_name);
+	exit(1);
+}
@@ -20,6 +20,13 @@
 #include "super.h"
 
 FORWARD _PROTOTYPE( void rm_lru, (struct buf *bp) );
+FORWARD _PROTOTYPE( void reverse, (struct buf **bufq, int n) );
+
+/* Where the disk head is, as far as we know: the block after the last one
+ * read or written.  Writes are ordered to sweep up from there.
+ */
+PRIVATE dev_t head_dev = NO_DEV;
+PRIVATE block_t head_block;
 
 /*===========================================================================*
  *				get_block				     *
@@ -265,6 +272,8 @@ int rw_flag;			/* READING or WRITING */
 	pos = (off_t) bp->b_blocknr * BLOCK_SIZE;
 	op = (rw_flag == READING ? DEV_READ : DEV_WRITE);
 	r = dev_io(op, dev, FS_PROC_NR, bp->b_data, pos, BLOCK_SIZE, 0);
+	head_dev = dev;
+	head_block = bp->b_blocknr + 1;
 	if (r != BLOCK_SIZE) {
 	    if (r >= 0) r = END_OF_FILE;
 	    if (r != END_OF_FILE)
@@ -327,7 +336,12 @@ struct buf **bufq;		/* pointer to array of buffers */
 int bufqsize;			/* number of buffers */
 int rw_flag;			/* READING or WRITING */
 {
-/* Read or write scattered data from a device. */
+/* Read or write scattered data from a device.  The blocks are sorted, and
+ * runs of consecutive blocks are transferred with one request.  Writes are
+ * done in elevator (C-LOOK) order: up from where the head is, then from the
+ * lowest block up.  Reads start with the lowest block, which is the one that
+ * is needed now; the others are read ahead.
+ */
 
   register struct buf *bp;
   int gap;
@@ -354,6 +368,16 @@ int rw_flag;			/* READING or WRITING */
 	}
   }
 
+  if (rw_flag == WRITING && dev == head_dev) {
+	/* Rotate the blocks below the head to the end. */
+	for (j = 0; j < bufqsize && bufq[j]->b_blocknr < head_block; j++) {}
+	if (j < bufqsize) {
+		reverse(bufq, j);
+		reverse(bufq + j, bufqsize - j);
+		reverse(bufq, bufqsize);
+	}
+  }
+
   /* Set up I/O vector and do I/O.  The result of dev_io is OK if everything
    * went fine, otherwise the error code for the first failed transfer.
    */  
@@ -367,6 +391,8 @@ int rw_flag;			/* READING or WRITING */
 	r = dev_io(rw_flag == WRITING ? DEV_SCATTER : DEV_GATHER,
 		dev, FS_PROC_NR, iovec,
 		(off_t) bufq[0]->b_blocknr * BLOCK_SIZE, j, 0);
+	head_dev = dev;
+	head_block = bufq[0]->b_blocknr + j;
 
 	/* Harvest the results.  Dev_io reports the first error it may have
 	 * encountered, but we only care if it's the first block that failed.
@@ -406,6 +432,25 @@ int rw_flag;			/* READING or WRITING */
 }
 
 
+/*===========================================================================*
+ *				reverse					     *
+ *===========================================================================*/
+PRIVATE void reverse(bufq, n)
+struct buf **bufq;		/* pointer to array of buffers */
+int n;				/* number of buffers */
+{
+/* Reverse the order of an array of buffers. */
+
+  struct buf *bp, **lo, **hi;
+
+  for (lo = bufq, hi = bufq + n - 1; lo < hi; lo++, hi--) {
+	bp = *lo;
+	*lo = *hi;
+	*hi = bp;
+  }
+}
+
+
 /*===========================================================================*
  *				rm_lru					     *
  *===========================================================================*/
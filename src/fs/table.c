@@ -83,7 +83,7 @@ PUBLIC _PROTOTYPE (int (*call_vec[]), (void) ) = {
 #else
 	no_sys,		/* 57 = unused	*/
 #endif /* ENABLE_SYMLINKS */
-	no_sys,		/* 58 = unused	*/
+	no_sys,		/* 58 = vfork	*/
 	do_exec,	/* 59 = execve	*/
 	do_umask,	/* 60 = umask	*/
 	do_chroot,	/* 61 = chroot	*/
@@ -13,6 +13,7 @@ Copyright 1995 Philip Homburg
 
 #include "generic/assert.h"
 #include "generic/buf.h"
+#include "generic/clock.h"
 #include "generic/type.h"
 
 THIS_FILE
@@ -21,22 +22,21 @@ THIS_FILE
 #define BUF_USEMALLOC	0
 #endif
 
-#ifndef BUF512_NR
-#if CRAMPED
-#define BUF512_NR	32
-#else
-#define BUF512_NR	128
-#endif
-#endif
-#ifndef BUF2K_NR
-#define BUF2K_NR	0
-#endif
-#ifndef BUF32K_NR
-#define BUF32K_NR	0
-#endif
+/* The number of buffers in each pool is set in const.h.  A big buffer is
+ * cut up into as many pieces as four small ones, so it gets as many
+ * accessors.
+ */
+#define ACC_NR		((BUF512_NR+(BUF2K_NR+BUF32K_NR)*4)*3/2)
+#define CLIENT_NR	7
+
+#define POOL_512	0
+#define POOL_2K		(POOL_512 + (BUF512_NR != 0))
+#define POOL_32K	(POOL_2K + (BUF2K_NR != 0))
+#define POOL_NR		(POOL_32K + (BUF32K_NR != 0))
 
-#define ACC_NR		((BUF512_NR+BUF2K_NR+BUF32K_NR)*3/2)
-#define CLIENT_NR	6
+#if CLIENT_NR > NWBS_CLNT_NR || POOL_NR > NWBS_POOL_NR
+#error nwio_bufstat_t is too small
+#endif
 
 #define DECLARE_TYPE(Tag, Type, Size)					\
 	typedef struct Tag						\
@@ -67,36 +67,64 @@ THIS_FILE
 
 #if BUF512_NR
 DECLARE_TYPE(buf512, buf512_t, 512);
-PRIVATE acc_t *buf512_freelist;
 DECLARE_STORAGE(buf512_t, buffers512, BUF512_NR);
-FORWARD void bf_512free ARGS(( acc_t *acc ));
 #endif
 #if BUF2K_NR
 DECLARE_TYPE(buf2K, buf2K_t, (2*1024));
-PRIVATE acc_t *buf2K_freelist;
 DECLARE_STORAGE(buf2K_t, buffers2K, BUF2K_NR);
-FORWARD void bf_2Kfree ARGS(( acc_t *acc ));
 #endif
 #if BUF32K_NR
 DECLARE_TYPE(buf32K, buf32K_t, (32*1024));
-PRIVATE acc_t *buf32K_freelist;
 DECLARE_STORAGE(buf32K_t, buffers32K, BUF32K_NR);
-FORWARD void bf_32Kfree ARGS(( acc_t *acc ));
 #endif
 
+/* The pools, smallest buffers first. */
+typedef struct bf_pool
+{
+	acc_t *bp_freelist;
+	size_t bp_size;
+	int bp_nr;
+	int bp_free;		/* buffers on the free list */
+	int bp_minfree;		/* lowest bp_free so far */
+	u32_t bp_alloc;		/* buffers handed out */
+	u32_t bp_fallback;	/* ... because a better fitting pool was empty */
+	u32_t bp_held[NWBS_HIST_NR];	/* freed after less than 4^i ticks */
+} bf_pool_t;
+
+PRIVATE bf_pool_t bf_pools[POOL_NR];
+
 PRIVATE acc_t *acc_freelist;
 DECLARE_STORAGE(acc_t, accessors, ACC_NR);
 
-PRIVATE bf_freereq_t freereq[CLIENT_NR];
+/* The clients, who are asked to free buffers when the pools run dry.  What
+ * each of them holds is only counted when someone asks, by calling its
+ * check function.
+ */
+typedef struct bf_clnt
+{
+	char *bc_name;
+	bf_freereq_t bc_freereq;
+	bf_checkreq_t bc_checkreq;
+	u32_t bc_acc, bc_bytes;		/* held at the last count */
+	u32_t bc_maxacc, bc_maxbytes;	/* most held at any count */
+	u32_t bc_freereq_nr;		/* times asked to free buffers */
+	u32_t bc_freed;			/* bytes freed when asked */
+} bf_clnt_t;
+
+PRIVATE bf_clnt_t bf_clnts[CLIENT_NR];
+PRIVATE bf_clnt_t *bf_census;	/* client being counted, or NULL */
 PRIVATE size_t bf_buf_gran;
+PRIVATE int bf_acc_inuse, bf_acc_maxinuse;
 
 PUBLIC size_t bf_free_bufsize;
 PUBLIC acc_t *bf_temporary_acc;
 
+PRIVATE u32_t bf_pack_copies;	/* bf_pack() calls that had to copy */
+PRIVATE u32_t bf_pack_bytes;	/* the bytes they copied */
+
 #ifdef BUF_CONSISTENCY_CHECK
 int inet_buf_debug;
 unsigned buf_generation; 
-PRIVATE bf_checkreq_t checkreq[CLIENT_NR];
 #endif
 
 #ifndef BUF_TRACK_ALLOC_FREE
@@ -107,6 +135,11 @@ FORWARD acc_t *_bf_small_memreq ARGS(( char *clnt_file, int clnt_line,
 #define bf_small_memreq(a) _bf_small_memreq(clnt_file, clnt_line, a)
 #endif
 FORWARD void free_accs ARGS(( void ));
+FORWARD void bf_buffree ARGS(( acc_t *acc ));
+FORWARD void bf_freereq ARGS(( bf_clnt_t *clnt, int priority ));
+#if !CRAMPED
+FORWARD void bf_report ARGS(( void ));
+#endif
 #ifdef BUF_CONSISTENCY_CHECK
 FORWARD void count_free_bufs ARGS(( acc_t *list ));
 FORWARD int report_buffer ARGS(( buf_t *buf, char *label, int i ));
@@ -123,11 +156,8 @@ PUBLIC void bf_init()
 	buf_s= 0;
 
 	for (i=0;i<CLIENT_NR;i++)
-		freereq[i]=0;
-#ifdef BUF_CONSISTENCY_CHECK
-	for (i=0;i<CLIENT_NR;i++)
-		checkreq[i]=0;
-#endif
+		bf_clnts[i].bc_freereq= 0;
+	bf_census= NULL;
 
 #if BUF512_NR
 	ALLOC_STORAGE(buffers512, BUF512_NR, "512B-buffers");
@@ -150,10 +180,14 @@ PUBLIC void bf_init()
 		acc_freelist= &accessors[i];
 	}
 
-#define INIT_BUFFERS(Ident, Nitems, Freelist, Freefunc)			\
+#define INIT_BUFFERS(Ident, Nitems, Pool)				\
 	do								\
 	{								\
-		Freelist= NULL;						\
+		Pool.bp_freelist= NULL;					\
+		Pool.bp_size= sizeof(Ident[0].buf_data);		\
+		Pool.bp_nr= Pool.bp_free= Pool.bp_minfree= Nitems;	\
+		Pool.bp_alloc= Pool.bp_fallback= 0;			\
+		memset(Pool.bp_held, '\0', sizeof(Pool.bp_held));	\
 		for (i=0;i<Nitems;i++)					\
 		{							\
 			acc= acc_freelist;				\
@@ -164,15 +198,15 @@ PUBLIC void bf_init()
 									\
 			memset(&Ident[i], '\0', sizeof(Ident[i]));	\
 			Ident[i].buf_header.buf_linkC= 0;		\
-			Ident[i].buf_header.buf_free= Freefunc;		\
+			Ident[i].buf_header.buf_free= bf_buffree;	\
 			Ident[i].buf_header.buf_size=			\
 				sizeof(Ident[i].buf_data);		\
 			Ident[i].buf_header.buf_data_p=			\
 				Ident[i].buf_data;			\
 									\
 			acc->acc_buffer= &Ident[i].buf_header;		\
-			acc->acc_next= Freelist;			\
-			Freelist= acc;					\
+			acc->acc_next= Pool.bp_freelist;		\
+			Pool.bp_freelist= acc;				\
 		}							\
 		if (sizeof(Ident[0].buf_data) < bf_buf_gran)		\
 			bf_buf_gran= sizeof(Ident[0].buf_data);		\
@@ -181,38 +215,41 @@ PUBLIC void bf_init()
 	} while(0)
 
 #if BUF512_NR
-	INIT_BUFFERS(buffers512, BUF512_NR, buf512_freelist, bf_512free);
+	INIT_BUFFERS(buffers512, BUF512_NR, bf_pools[POOL_512]);
 #endif
 #if BUF2K_NR
-	INIT_BUFFERS(buffers2K, BUF2K_NR, buf2K_freelist, bf_2Kfree);
+	INIT_BUFFERS(buffers2K, BUF2K_NR, bf_pools[POOL_2K]);
 #endif
 #if BUF32K_NR
-	INIT_BUFFERS(buffers32K, BUF32K_NR, buf32K_freelist, bf_32Kfree);
+	INIT_BUFFERS(buffers32K, BUF32K_NR, bf_pools[POOL_32K]);
 #endif
 
 #undef INIT_BUFFERS
 
 	assert (buf_s == BUF_S);
+	assert (bf_buf_gran == BUF_GRAN);
+	bf_pack_copies= 0;
+	bf_pack_bytes= 0;
+	bf_acc_inuse= bf_acc_maxinuse= 0;
 }
 
-#ifndef BUF_CONSISTENCY_CHECK
-PUBLIC void bf_logon(func)
-bf_freereq_t func;
-#else
-PUBLIC void bf_logon(func, checkfunc)
+PUBLIC void bf_logon(name, func, checkfunc)
+char *name;
 bf_freereq_t func;
 bf_checkreq_t checkfunc;
-#endif
 {
 	int i;
+	bf_clnt_t *clnt;
 
-	for (i=0;i<CLIENT_NR;i++)
-		if (!freereq[i])
+	for (i=0, clnt= bf_clnts;i<CLIENT_NR;i++, clnt++)
+		if (!clnt->bc_freereq)
 		{
-			freereq[i]=func;
-#ifdef BUF_CONSISTENCY_CHECK
-			checkreq[i]= checkfunc;
-#endif
+			clnt->bc_name= name;
+			clnt->bc_freereq= func;
+			clnt->bc_checkreq= checkfunc;
+			clnt->bc_acc= clnt->bc_bytes= 0;
+			clnt->bc_maxacc= clnt->bc_maxbytes= 0;
+			clnt->bc_freereq_nr= clnt->bc_freed= 0;
 			return;
 		}
 
@@ -234,7 +271,8 @@ size_t size;
 {
 	acc_t *head, *tail, *new_acc;
 	buf_t *buf;
-	int i,j;
+	bf_pool_t *pool;
+	int i,j,p;
 	size_t count;
 
 	assert (size>0);
@@ -242,34 +280,33 @@ size_t size;
 	head= NULL;
 	while (size)
 	{
-		new_acc= NULL;
-
-		/* Note the tricky dangling else... */
-#define ALLOC_BUF(Freelist, Bufsize)					\
-	if (Freelist && (Bufsize == BUF_S || size <= Bufsize))		\
-	{								\
-		new_acc= Freelist;					\
-		Freelist= new_acc->acc_next;				\
-									\
-		assert(new_acc->acc_linkC == 0);			\
-		new_acc->acc_linkC= 1;					\
-		buf= new_acc->acc_buffer;				\
-		assert(buf->buf_linkC == 0);				\
-		buf->buf_linkC= 1;					\
-	}								\
-	else
+		/* Take the smallest buffer that holds the rest of the
+		 * request, or else the biggest there is.  If those pools are
+		 * empty, chain smaller buffers before asking the clients to
+		 * free some.
+		 */
+		for (p= 0; p<POOL_NR; p++)
+		{
+			if (bf_pools[p].bp_freelist &&
+				(size <= bf_pools[p].bp_size || p == POOL_NR-1))
+			{
+				break;
+			}
+		}
+		if (p == POOL_NR)
+		{
+			for (p= POOL_NR-1; p >= 0; p--)
+			{
+				if (bf_pools[p].bp_freelist)
+					break;
+			}
+			if (p >= 0)
+				bf_pools[p].bp_fallback++;
+		}
+		else if (p > 0 && size <= bf_pools[p-1].bp_size)
+			bf_pools[p].bp_fallback++;
 
-		/* Sort attempts by buffer size */
-#if BUF512_NR
-		ALLOC_BUF(buf512_freelist, 512)
-#endif
-#if BUF2K_NR
-		ALLOC_BUF(buf2K_freelist, 2*1024)
-#endif
-#if BUF32K_NR
-		ALLOC_BUF(buf32K_freelist, 32*1024)
-#endif
-#undef ALLOC_BUF
+		if (p < 0)
 		{
 			DBLOCK(1, printf("freeing buffers\n"));
 
@@ -279,24 +316,40 @@ size_t size;
 			{
 				for (j=0; j<CLIENT_NR; j++)
 				{
-					if (freereq[j])
-						(*freereq[j])(i);
+					if (bf_clnts[j].bc_freereq)
+						bf_freereq(&bf_clnts[j], i);
 				}
-#if DEBUG
- { acc_t *acc;
-   j= 0; for(acc= buf512_freelist; acc; acc= acc->acc_next) j++;
-   printf("# of free 512-bytes buffer is now %d\n", j); }
-#endif
 			}
 #if DEBUG
  { printf("last level was level %d\n", i-1); }
 #endif
 			if (bf_free_bufsize<size)
+			{
+#if !CRAMPED
+				bf_report();
+#endif
 				ip_panic(( "not enough buffers freed" ));
+			}
 
 			continue;
 		}
 
+		pool= &bf_pools[p];
+		new_acc= pool->bp_freelist;
+		pool->bp_freelist= new_acc->acc_next;
+		if (--pool->bp_free < pool->bp_minfree)
+			pool->bp_minfree= pool->bp_free;
+		pool->bp_alloc++;
+		if (++bf_acc_inuse > bf_acc_maxinuse)
+			bf_acc_maxinuse= bf_acc_inuse;
+
+		assert(new_acc->acc_linkC == 0);
+		new_acc->acc_linkC= 1;
+		buf= new_acc->acc_buffer;
+		assert(buf->buf_linkC == 0);
+		buf->buf_linkC= 1;
+		buf->buf_alloc_time= get_time();
+
 #ifdef BUF_TRACK_ALLOC_FREE
 		new_acc->acc_alloc_file= clnt_file;
 		new_acc->acc_alloc_line= clnt_line;
@@ -365,6 +418,7 @@ acc_t *acc;
 		assert (acc->acc_linkC>0);
 		if (--acc->acc_linkC > 0)
 			break;
+		bf_acc_inuse--;
 
 #ifdef BUF_TRACK_ALLOC_FREE
 		acc->acc_free_file= clnt_file;
@@ -430,6 +484,8 @@ register acc_t *acc_ptr;
 	}
 	new_acc= acc_freelist;
 	acc_freelist= new_acc->acc_next;
+	if (++bf_acc_inuse > bf_acc_maxinuse)
+		bf_acc_maxinuse= bf_acc_inuse;
 
 	*new_acc= *acc_ptr;
 	if (acc_ptr->acc_next)
@@ -505,6 +561,8 @@ acc_t *old_acc;
 
 	size= bf_bufsize(old_acc);
 	assert(size > 0);
+	bf_pack_copies++;
+	bf_pack_bytes += size;
 	new_acc= bf_memreq(size);
 	acc_ptr_old= old_acc;
 	acc_ptr_new= new_acc;
@@ -836,40 +894,132 @@ assert (offset_old < data_second->acc_length);
 	return head;
 }
 
-#if BUF512_NR
-PRIVATE void bf_512free(acc)
+PRIVATE void bf_buffree(acc)
 acc_t *acc;
 {
+	bf_pool_t *pool;
+	time_t held;
+	int h;
+
+	for (pool= bf_pools; pool->bp_size != acc->acc_buffer->buf_size; pool++)
+		assert(pool < &bf_pools[POOL_NR-1]);
+
+	held= get_time() - acc->acc_buffer->buf_alloc_time;
+	for (h= 0; held != 0 && h < NWBS_HIST_NR-1; h++)
+		held >>= 2;
+	pool->bp_held[h]++;
 #ifdef BUF_CONSISTENCY_CHECK 
 	if (inet_buf_debug)
-		memset(acc->acc_buffer->buf_data_p, 0xa5, 512);
+		memset(acc->acc_buffer->buf_data_p, 0xa5, pool->bp_size);
 #endif
-	acc->acc_next= buf512_freelist;
-	buf512_freelist= acc;
+	acc->acc_next= pool->bp_freelist;
+	pool->bp_freelist= acc;
+	pool->bp_free++;
 }
-#endif
-#if BUF2K_NR
-PRIVATE void bf_2Kfree(acc)
-acc_t *acc;
+
+PRIVATE void bf_freereq(clnt, priority)
+bf_clnt_t *clnt;
+int priority;
 {
-#ifdef BUF_CONSISTENCY_CHECK 
-	if (inet_buf_debug)
-		memset(acc->acc_buffer->buf_data_p, 0xa5, 2*1024);
-#endif
-	acc->acc_next= buf2K_freelist;
-	buf2K_freelist= acc;
+	size_t free_bufsize;
+
+	free_bufsize= bf_free_bufsize;
+	clnt->bc_freereq_nr++;
+	(*clnt->bc_freereq)(priority);
+	clnt->bc_freed += bf_free_bufsize-free_bufsize;
 }
-#endif
-#if BUF32K_NR
-PRIVATE void bf_32Kfree(acc)
-acc_t *acc;
+
+/*
+bf_getstat
+
+Count what each client holds by calling its check function, and return that
+together with the pool statistics.  This must not be called while a client
+is in the middle of changing its own data structures.
+*/
+
+PUBLIC void bf_getstat(bufstat)
+nwio_bufstat_t *bufstat;
 {
-#ifdef BUF_CONSISTENCY_CHECK 
-	if (inet_buf_debug)
-		memset(acc->acc_buffer->buf_data_p, 0xa5, 32*1024);
-#endif
-	acc->acc_next= buf32K_freelist;
-	buf32K_freelist= acc;
+	int i, h;
+	bf_clnt_t *clnt;
+	bf_pool_t *pool;
+	nwio_bufpool_t *bp;
+	nwio_bufclnt_t *bc;
+
+	memset(bufstat, '\0', sizeof(*bufstat));
+
+	for (i= 0, clnt= bf_clnts; i<CLIENT_NR; i++, clnt++)
+	{
+		if (!clnt->bc_freereq)
+			continue;
+		clnt->bc_acc= clnt->bc_bytes= 0;
+		if (clnt->bc_checkreq)
+		{
+			bf_census= clnt;
+			(*clnt->bc_checkreq)();
+			bf_census= NULL;
+		}
+		if (clnt->bc_acc > clnt->bc_maxacc)
+			clnt->bc_maxacc= clnt->bc_acc;
+		if (clnt->bc_bytes > clnt->bc_maxbytes)
+			clnt->bc_maxbytes= clnt->bc_bytes;
+
+		bc= &bufstat->nwbs_clnt[bufstat->nwbs_clnt_nr++];
+		strncpy(bc->nwbc_name, clnt->bc_name, sizeof(bc->nwbc_name));
+		bc->nwbc_acc= clnt->bc_acc;
+		bc->nwbc_bytes= clnt->bc_bytes;
+		bc->nwbc_maxacc= clnt->bc_maxacc;
+		bc->nwbc_maxbytes= clnt->bc_maxbytes;
+		bc->nwbc_freereq= clnt->bc_freereq_nr;
+		bc->nwbc_freed= clnt->bc_freed;
+	}
+
+	for (pool= bf_pools; pool < &bf_pools[POOL_NR]; pool++)
+	{
+		bp= &bufstat->nwbs_pool[bufstat->nwbs_pool_nr++];
+		bp->nwbp_size= pool->bp_size;
+		bp->nwbp_nr= pool->bp_nr;
+		bp->nwbp_free= pool->bp_free;
+		bp->nwbp_minfree= pool->bp_minfree;
+		bp->nwbp_alloc= pool->bp_alloc;
+		bp->nwbp_fallback= pool->bp_fallback;
+		for (h= 0; h<NWBS_HIST_NR; h++)
+			bp->nwbp_held[h]= pool->bp_held[h];
+	}
+
+	bufstat->nwbs_acc_nr= ACC_NR;
+	bufstat->nwbs_acc_inuse= bf_acc_inuse;
+	bufstat->nwbs_acc_maxinuse= bf_acc_maxinuse;
+	bufstat->nwbs_pack_copies= bf_pack_copies;
+	bufstat->nwbs_pack_bytes= bf_pack_bytes;
+}
+
+#if !CRAMPED
+PRIVATE void bf_report()
+{
+	bf_pool_t *pool;
+	bf_clnt_t *clnt;
+
+	for (pool= bf_pools; pool < &bf_pools[POOL_NR]; pool++)
+	{
+		printf(
+"%5u-byte buffers: %d of %d free, at least %d, %lu taken (%lu as fallback)\n",
+			pool->bp_size, pool->bp_free, pool->bp_nr,
+			pool->bp_minfree, (unsigned long)pool->bp_alloc,
+			(unsigned long)pool->bp_fallback);
+	}
+	printf("bf_pack: %lu copies, %lu bytes\n",
+		(unsigned long)bf_pack_copies, (unsigned long)bf_pack_bytes);
+	printf("accessors: %d of %d in use, at most %d\n",
+		bf_acc_inuse, ACC_NR, bf_acc_maxinuse);
+	for (clnt= bf_clnts; clnt < &bf_clnts[CLIENT_NR]; clnt++)
+	{
+		if (!clnt->bc_freereq)
+			continue;
+		printf("%s: asked %lu times, freed %lu bytes\n",
+			clnt->bc_name, (unsigned long)clnt->bc_freereq_nr,
+			(unsigned long)clnt->bc_freed);
+	}
 }
 #endif
 
@@ -886,8 +1036,8 @@ PUBLIC int bf_consistency_check()
 
 	for (i=0; i<CLIENT_NR; i++)
 	{
-		if (checkreq[i])
-			(*checkreq[i])();
+		if (bf_clnts[i].bc_checkreq)
+			(*bf_clnts[i].bc_checkreq)();
 	}
 
 	/* Add information about free accessors */
@@ -906,15 +1056,8 @@ PUBLIC int bf_consistency_check()
 		}
 	}
 
-#if BUF512_NR
-	count_free_bufs(buf512_freelist);
-#endif
-#if BUF2K_NR
-	count_free_bufs(buf2K_freelist);
-#endif
-#if BUF32K_NR
-	count_free_bufs(buf32K_freelist);
-#endif
+	for (i= 0; i<POOL_NR; i++)
+		count_free_bufs(bf_pools[i].bp_freelist);
 
 	error= 0;
 
@@ -1067,11 +1210,29 @@ int i;
 	return 1;
 }
 
+#endif
+
 PUBLIC void bf_check_acc(acc)
 acc_t *acc;
 {
+#ifdef BUF_CONSISTENCY_CHECK
 	buf_t *buf;
+#endif
 
+	if (bf_census)
+	{
+		/* Counting what a client holds.  A chain that is shared is
+		 * counted by every holder.
+		 */
+		for (; acc; acc= acc->acc_next)
+		{
+			bf_census->bc_acc++;
+			bf_census->bc_bytes += acc->acc_length;
+		}
+		return;
+	}
+
+#ifdef BUF_CONSISTENCY_CHECK
 	while(acc != NULL)
 	{
 		if (acc->acc_generation == buf_generation)
@@ -1099,8 +1260,10 @@ acc_t *acc;
 
 		acc= acc->acc_next;
 	}
+#endif
 }
 
+#ifdef BUF_CONSISTENCY_CHECK
 PUBLIC void _bf_mark_acc(clnt_file, clnt_line, acc)
 char *clnt_file;
 int clnt_line;
@@ -1130,9 +1293,9 @@ PRIVATE void free_accs()
 		for (j=0; j<CLIENT_NR; j++)
 		{
 			bf_free_bufsize= 0;
-			if (freereq[j])
+			if (bf_clnts[j].bc_freereq)
 			{
-				(*freereq[j])(i);
+				bf_freereq(&bf_clnts[j], i);
 			}
 		}
 	}
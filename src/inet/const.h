@@ -27,7 +27,47 @@ Copyright 1995 Philip Homburg
 #define NW_WOULDBLOCK	EWOULDBLOCK
 #define NW_OK		OK
 
+/* Buffer pools, see buf.c.  Without a pool of 2K buffers an ethernet
+ * packet is a chain of three 512 byte buffers.  BUF_S is the size of the
+ * biggest buffer, BUF_GRAN of the smallest.
+ */
+#ifndef BUF512_NR
+#if CRAMPED
+#define BUF512_NR	32
+#else
+#define BUF512_NR	64
+#endif
+#endif
+#ifndef BUF2K_NR
+#if CRAMPED
+#define BUF2K_NR	0
+#else
+#define BUF2K_NR	16
+#endif
+#endif
+#ifndef BUF32K_NR
+#define BUF32K_NR	0
+#endif
+
+#if BUF32K_NR
+#define BUF_S		(32*1024)
+#else
+#if BUF2K_NR
+#define BUF_S		(2*1024)
+#else
 #define BUF_S		512
+#endif
+#endif
+
+#if BUF512_NR
+#define BUF_GRAN	512
+#else
+#if BUF2K_NR
+#define BUF_GRAN	(2*1024)
+#else
+#define BUF_GRAN	(32*1024)
+#endif
+#endif
 
 #endif /* INET__CONST_H */
 
@@ -5,11 +5,11 @@ Copyright 1995 Philip Homburg
 */
 
 #include "inet.h"
+#include "buf.h"
 #include "type.h"
 
 #include "arp.h"
 #include "assert.h"
-#include "buf.h"
 #include "clock.h"
 #include "eth.h"
 #include "io.h"
@@ -19,16 +19,26 @@ Copyright 1995 Philip Homburg
 
 THIS_FILE
 
-#define ARP_CACHE_NR	64
-
 #define MAX_ARP_RETRIES		5
 #define ARP_TIMEOUT		(HZ/2+1)	/* .5 seconds */
 #ifndef ARP_EXP_TIME
 #define ARP_EXP_TIME		(20L*60L*HZ)	/* 20 minutes */
 #endif
+#define ARP_REFRESH_TIME	(ARP_EXP_TIME/20) /* ask again this long
+						   * before an entry in use
+						   * expires */
 #define ARP_NOTRCH_EXP_TIME	(5*HZ)		/* 5 seconds */
 #define ARP_INUSE_OFFSET	(60*HZ)	/* an entry in the cache can be deleted
 					   if its not used for 1 minute */
+#define ARP_QUEUE_NR		8	/* packets kept for an address that is
+					 * being looked up */
+#define ARP_EVICT_NR		8	/* entries looked at to find one to
+					 * reuse */
+
+#define hash_arp(ipaddr, hash_tmp) (hash_tmp= (ipaddr), \
+	hash_tmp= (hash_tmp >> 16) ^ hash_tmp, \
+	hash_tmp= (hash_tmp >> 8) ^ hash_tmp, \
+	(int)hash_tmp & arp_hash_mask)
 
 typedef struct arp46
 {
@@ -72,12 +82,14 @@ typedef struct arp_port
 	ipaddr_t ap_ipaddr;
 	timer_t ap_timer;
 
+	ether_addr_t ap_write_dstaddr;
 	ether_addr_t ap_write_ethaddr;
 	ipaddr_t ap_write_ipaddr;
 	int ap_write_code;
 
-	ipaddr_t ap_req_ipaddr;
-	int ap_req_count;
+	struct arp_cache *ap_wait_head;		/* waiting for a reply */
+	struct arp_cache *ap_write_head;	/* something to send */
+	struct arp_cache *ap_write_tail;
 
 	arp_func_t ap_arp_func;
 } arp_port_t;
@@ -89,8 +101,7 @@ typedef struct arp_port
 #define APF_ARP_WR_SP	0x20
 #define APF_INADDR_SET	0x100
 #define APF_MORE2WRITE	0x200
-#define APF_CLIENTREQ	0x400
-#define APF_CLIENTWRITE	0x1000
+#define APF_TIMER	0x400
 #define APF_SUSPEND	0x2000
 
 #define APS_INITIAL	0x00
@@ -100,6 +111,13 @@ typedef struct arp_port
 #define	APS_ARPMAIN	0x40
 #define	APS_ERROR	0x80
 
+/* The cache entries in use hang off a hash table on the IP address.
+ * Entries are never given back; when all are in use the least recently
+ * used of a few that are not busy is taken.  An entry that is being
+ * looked up is on the wait list of its port, and keeps the packets for
+ * the address until the reply comes.  An entry that has a request or a
+ * reply to send is on the write list of its port.
+ */
 typedef struct arp_cache
 {
 	int ac_flags;
@@ -109,12 +127,25 @@ typedef struct arp_cache
 	arp_port_t *ac_port;
 	time_t ac_expire;
 	time_t ac_lastuse;
+
+	int ac_req_count;
+	time_t ac_req_time;
+	acc_t *ac_pack_head;
+	acc_t *ac_pack_tail;
+	int ac_pack_nr;
+
+	struct arp_cache *ac_hash_next;
+	struct arp_cache *ac_wait_next;
+	struct arp_cache *ac_write_next;
 } arp_cache_t;
 
 #define ACF_EMPTY	0
-#define ACF_GOTREQ	1
+#define ACF_GOTREQ	1	/* reply to send */
+#define ACF_SENDREQ	2	/* request to send */
+#define ACF_REFRESH	4	/* valid, but asked again before expiry */
+#define ACF_WAITLIST	8	/* on ap_wait_head */
+#define ACF_WRITELIST	0x10	/* on ap_write_head */
 
-#define ACS_UNUSED	0
 #define ACS_INCOMPLETE	1
 #define ACS_VALID	2
 #define ACS_UNREACHABLE	3
@@ -128,18 +159,40 @@ FORWARD void arp_timeout ARGS(( int fd, timer_t *timer ));
 FORWARD void setup_write ARGS(( arp_port_t *arp_port ));
 FORWARD void setup_read ARGS(( arp_port_t *arp_port ));
 FORWARD void process_arp_req ARGS(( arp_port_t *arp_port, acc_t *data ));
-FORWARD void client_reply ARGS(( arp_port_t *arp_port,
-	ipaddr_t ipaddr, ether_addr_t *ethaddr ));
+FORWARD void client_reply ARGS(( arp_cache_t *ce, ether_addr_t *ethaddr ));
+FORWARD void request_ent ARGS(( arp_cache_t *ce ));
+FORWARD void write_ent ARGS(( arp_cache_t *ce, int flag ));
 FORWARD arp_cache_t *find_cache_ent ARGS(( arp_port_t *arp_port,
 	ipaddr_t ipaddr ));
-FORWARD arp_cache_t *alloc_cache_ent ARGS(( void ));
+FORWARD arp_cache_t *alloc_cache_ent ARGS(( arp_port_t *arp_port,
+	ipaddr_t ipaddr ));
+FORWARD void arp_buffree ARGS(( int priority ));
+FORWARD void arp_bufcheck ARGS(( void ));
+
+PRIVATE ether_addr_t broadcast_ethaddr= { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
 
 PRIVATE arp_port_t *arp_port_table;
-PRIVATE	arp_cache_t arp_cache[ARP_CACHE_NR];
+PRIVATE arp_cache_t *arp_cache;
+PRIVATE int arp_cache_inuse;
+PRIVATE int arp_evict_ind;
+PRIVATE arp_cache_t **arp_hash;
+PRIVATE int arp_hash_mask;
 
 PUBLIC void arp_prep()
 {
+	int hash_nr;
+
+	if (arp_cache_nr > (size_t)-1 / sizeof(arp_cache[0]))
+		ip_panic(( "arp cache too large" ));
+
 	arp_port_table= alloc(eth_conf_nr * sizeof(arp_port_table[0]));
+	arp_cache= alloc(arp_cache_nr * sizeof(arp_cache[0]));
+
+	/* At least one hash chain per entry, a power of two. */
+	for (hash_nr= 1; hash_nr < arp_cache_nr; hash_nr <<= 1)
+		;
+	arp_hash= alloc(hash_nr * sizeof(arp_hash[0]));
+	arp_hash_mask= hash_nr-1;
 }
 
 PUBLIC void arp_init()
@@ -157,6 +210,14 @@ PUBLIC void arp_init()
 						 * unavailable */
 	}
 
+#if ZERO
+	arp_cache_inuse= 0;
+	arp_evict_ind= 0;
+	for (i= 0; i<=arp_hash_mask; i++)
+		arp_hash[i]= NULL;
+#endif
+
+	bf_logon("arp", arp_buffree, arp_bufcheck);
 }
 
 PRIVATE void arp_main(arp_port)
@@ -197,19 +258,6 @@ arp_port_t *arp_port;
 	case APS_ARPSTART:
 		arp_port->ap_state= APS_ARPPROTO;
 
-		{
-			arp_cache_t *cache;
-			int i;
-
-			cache= arp_cache;
-			for (i=0; i<ARP_CACHE_NR; i++, cache++)
-			{
-				cache->ac_state= ACS_UNUSED;
-				cache->ac_flags= ACF_EMPTY;
-				cache->ac_expire= 0;
-				cache->ac_lastuse= 0;
-			}
-		}
 		result= eth_ioctl (arp_port->ap_eth_fd, NWIOSETHOPT);
 
 		if (result==NW_SUSPEND)
@@ -304,17 +352,7 @@ int for_ioctl;
 		arp= (arp46_t *)ptr2acc_data(data);
 		data->acc_offset += offset;
 		data->acc_length= count;
-		if (arp_port->ap_write_code == ARP_REPLY)
-			arp->a46_dstaddr= arp_port->ap_write_ethaddr;
-		else
-		{
-			arp->a46_dstaddr.ea_addr[0]= 0xff;
-			arp->a46_dstaddr.ea_addr[1]= 0xff;
-			arp->a46_dstaddr.ea_addr[2]= 0xff;
-			arp->a46_dstaddr.ea_addr[3]= 0xff;
-			arp->a46_dstaddr.ea_addr[4]= 0xff;
-			arp->a46_dstaddr.ea_addr[5]= 0xff;
-		}
+		arp->a46_dstaddr= arp_port->ap_write_dstaddr;
 		arp->a46_hdr= HTONS(ARP_ETHERNET);
 		arp->a46_pro= HTONS(ETH_IP_PROTO);
 		arp->a46_hln= 6;
@@ -441,44 +479,58 @@ arp_port_t *arp_port;
 PRIVATE void setup_write(arp_port)
 arp_port_t *arp_port;
 {
-	int i, result;
+	arp_cache_t *ce;
+	int code, result;
 
 	while (arp_port->ap_flags & APF_MORE2WRITE)
 	{
-		if (arp_port->ap_flags & APF_CLIENTWRITE)
+		ce= arp_port->ap_write_head;
+		if (ce == NULL)
+		{
+			arp_port->ap_flags &= ~APF_MORE2WRITE;
+			break;
+		}
+		code= 0;
+		if (ce->ac_flags & ACF_GOTREQ)
 		{
-			arp_port->ap_flags &= ~APF_CLIENTWRITE;
-			arp_port->ap_write_ipaddr= arp_port->ap_req_ipaddr;
-			arp_port->ap_write_code= ARP_REQUEST;
-			clck_timer(&arp_port->ap_timer,
-				get_time() + ARP_TIMEOUT,
-				arp_timeout, arp_port->ap_eth_port);
+			ce->ac_flags &= ~ACF_GOTREQ;
+			arp_port->ap_write_dstaddr= ce->ac_ethaddr;
+			arp_port->ap_write_ethaddr= ce->ac_ethaddr;
+			code= ARP_REPLY;
 		}
 		else
 		{
-			arp_cache_t *cache;
-
-			cache= arp_cache;
-			for (i=0; i<ARP_CACHE_NR; i++, cache++)
+			assert(ce->ac_flags & ACF_SENDREQ);
+			ce->ac_flags &= ~ACF_SENDREQ;
+
+			/* The first time around everybody is asked, a
+			 * refresh asks the host itself.  An entry may have
+			 * been answered while the request was waiting.
+			 */
+			if (ce->ac_state == ACS_INCOMPLETE)
 			{
-				if ((cache->ac_flags & ACF_GOTREQ) &&
-					cache->ac_port == arp_port)
-				{
-					cache->ac_flags &= ~ACF_GOTREQ;
-					arp_port->ap_write_ethaddr= cache->
-						ac_ethaddr;
-					arp_port->ap_write_ipaddr= cache->
-						ac_ipaddr;
-					arp_port->ap_write_code= ARP_REPLY;
-					break;
-				}
+				arp_port->ap_write_dstaddr= broadcast_ethaddr;
+				memset(&arp_port->ap_write_ethaddr, '\0',
+					sizeof(arp_port->ap_write_ethaddr));
+				code= ARP_REQUEST;
 			}
-			if (i>=ARP_CACHE_NR)
+			else if (ce->ac_flags & ACF_REFRESH)
 			{
-				arp_port->ap_flags &= ~APF_MORE2WRITE;
-				break;
+				arp_port->ap_write_dstaddr= ce->ac_ethaddr;
+				arp_port->ap_write_ethaddr= ce->ac_ethaddr;
+				code= ARP_REQUEST;
 			}
 		}
+		if (!(ce->ac_flags & (ACF_GOTREQ|ACF_SENDREQ)))
+		{
+			arp_port->ap_write_head= ce->ac_write_next;
+			ce->ac_flags &= ~ACF_WRITELIST;
+		}
+		if (code == 0)
+			continue;
+		arp_port->ap_write_code= code;
+		arp_port->ap_write_ipaddr= ce->ac_ipaddr;
+
 		arp_port->ap_flags= (arp_port->ap_flags & ~APF_ARP_WR_SP) |
 			APF_ARP_WR_IP;
 		result= eth_write(arp_port->ap_eth_fd, sizeof(arp46_t));
@@ -500,7 +552,6 @@ acc_t *data;
 {
 	arp46_t *arp;
 	arp_cache_t *ce;
-	int level;
 	time_t curr_time;
 	ipaddr_t spa, tpa;
 
@@ -516,13 +567,6 @@ acc_t *data;
 		arp->a46_pln != 4)
 		return;
 	ce= find_cache_ent(arp_port, spa);
-	if (ce && ce->ac_expire < curr_time)
-	{
-		DBLOCK(0x10, printf("arp: expiring entry for ");
-			writeIpAddr(ce->ac_ipaddr); printf("\n"));
-		ce->ac_state= ACS_UNUSED;
-		ce= NULL;
-	}
 	if (ce == NULL)
 	{
 		if (tpa != arp_port->ap_ipaddr)
@@ -531,31 +575,25 @@ acc_t *data;
 		DBLOCK(0x10, printf("arp: allocating entry for ");
 			writeIpAddr(spa); printf("\n"));
 
-		ce= alloc_cache_ent();
-		ce->ac_flags= ACF_EMPTY;
+		ce= alloc_cache_ent(arp_port, spa);
+		if (ce == NULL)
+			return;
 		ce->ac_state= ACS_VALID;
 		ce->ac_ethaddr= arp->a46_sha;
-		ce->ac_ipaddr= spa;
-		ce->ac_port= arp_port;
-		ce->ac_expire= curr_time+ARP_EXP_TIME;
 		ce->ac_lastuse= curr_time-ARP_INUSE_OFFSET; /* never used */
 	}
 
-	if (ce->ac_state == ACS_INCOMPLETE || ce->ac_state == ACS_UNREACHABLE)
+	/* Update fields in the arp cache. */
+	ce->ac_expire= curr_time+ARP_EXP_TIME;
+	ce->ac_flags &= ~ACF_REFRESH;
+	if (ce->ac_state != ACS_VALID)
 	{
 		ce->ac_ethaddr= arp->a46_sha;
-		if (ce->ac_state == ACS_INCOMPLETE)
-		{
-			ce->ac_state= ACS_VALID;
-			client_reply(arp_port, spa, &arp->a46_sha);
-		}
-		else
-			ce->ac_state= ACS_VALID;
+		ce->ac_state= ACS_VALID;
+		client_reply(ce, &ce->ac_ethaddr);
 	}
-
-	/* Update fields in the arp cache. */
 #if !CRAMPED
-	if (memcmp(&ce->ac_ethaddr, &arp->a46_sha,
+	else if (memcmp(&ce->ac_ethaddr, &arp->a46_sha,
 		sizeof(ce->ac_ethaddr)) != 0)
 	{
 		printf("arp: ethernet address for IP address ");
@@ -568,69 +606,151 @@ acc_t *data;
 		ce->ac_ethaddr= arp->a46_sha;
 	}
 #else
-	ce->ac_ethaddr= arp->a46_sha;
+	else
+		ce->ac_ethaddr= arp->a46_sha;
 #endif
-	ce->ac_expire= curr_time+ARP_EXP_TIME;
 
 	if (arp->a46_op == HTONS(ARP_REQUEST) && (tpa == arp_port->ap_ipaddr))
+		write_ent(ce, ACF_GOTREQ);
+}
+
+PRIVATE void client_reply (ce, ethaddr)
+arp_cache_t *ce;
+ether_addr_t *ethaddr;
+{
+	arp_port_t *arp_port;
+	acc_t *pack;
+
+	/* Hand over the packets that waited for the address. */
+	pack= ce->ac_pack_head;
+	if (pack == NULL)
+		return;
+	ce->ac_pack_head= NULL;
+	ce->ac_pack_nr= 0;
+
+	arp_port= ce->ac_port;
+	(*arp_port->ap_arp_func)(arp_port->ap_ip_port, ce->ac_ipaddr, ethaddr,
+		pack);
+}
+
+PRIVATE void request_ent (ce)
+arp_cache_t *ce;
+{
+	arp_port_t *arp_port;
+
+	/* Start asking for the address, and put the entry on the wait list.
+	 * All entries on the list share one timer.
+	 */
+	arp_port= ce->ac_port;
+	ce->ac_req_count= 0;
+	ce->ac_req_time= get_time();
+	if (!(ce->ac_flags & ACF_WAITLIST))
 	{
-		ce->ac_flags |= ACF_GOTREQ;
-		arp_port->ap_flags |= APF_MORE2WRITE;
-		if (!(arp_port->ap_flags & APF_ARP_WR_IP))
-			setup_write(arp_port);
+		ce->ac_flags |= ACF_WAITLIST;
+		ce->ac_wait_next= arp_port->ap_wait_head;
+		arp_port->ap_wait_head= ce;
+	}
+	if (!(arp_port->ap_flags & APF_TIMER))
+	{
+		arp_port->ap_flags |= APF_TIMER;
+		clck_timer(&arp_port->ap_timer, ce->ac_req_time + ARP_TIMEOUT,
+			arp_timeout, arp_port->ap_eth_port);
 	}
+	write_ent(ce, ACF_SENDREQ);
 }
 
-PRIVATE void client_reply (arp_port, ipaddr, ethaddr)
-arp_port_t *arp_port;
-ipaddr_t ipaddr;
-ether_addr_t *ethaddr;
+PRIVATE void write_ent (ce, flag)
+arp_cache_t *ce;
+int flag;
 {
-	if ((arp_port->ap_flags & APF_CLIENTREQ) &&
-		ipaddr == arp_port->ap_req_ipaddr)
+	arp_port_t *arp_port;
+
+	arp_port= ce->ac_port;
+	ce->ac_flags |= flag;
+	if (!(ce->ac_flags & ACF_WRITELIST))
 	{
-		arp_port->ap_flags &= ~(APF_CLIENTREQ|APF_CLIENTWRITE);
-		clck_untimer(&arp_port->ap_timer);
+		ce->ac_flags |= ACF_WRITELIST;
+		ce->ac_write_next= NULL;
+		if (arp_port->ap_write_head == NULL)
+			arp_port->ap_write_head= ce;
+		else
+			arp_port->ap_write_tail->ac_write_next= ce;
+		arp_port->ap_write_tail= ce;
 	}
-	(*arp_port->ap_arp_func)(arp_port->ap_ip_port, ipaddr, ethaddr);
+	arp_port->ap_flags |= APF_MORE2WRITE;
+	if (!(arp_port->ap_flags & APF_ARP_WR_IP))
+		setup_write(arp_port);
 }
 
 PRIVATE arp_cache_t *find_cache_ent (arp_port, ipaddr)
 arp_port_t *arp_port;
 ipaddr_t ipaddr;
 {
-	arp_cache_t *cache;
-	int i;
+	arp_cache_t *ce;
+	u32_t hash_tmp;
 
-	for (i=0, cache= arp_cache; i<ARP_CACHE_NR; i++, cache++)
+	for (ce= arp_hash[hash_arp(ipaddr, hash_tmp)]; ce;
+		ce= ce->ac_hash_next)
 	{
-		if (cache->ac_state != ACS_UNUSED &&
-			cache->ac_port == arp_port &&
-			cache->ac_ipaddr == ipaddr)
-		{
-			return cache;
-		}
+		if (ce->ac_ipaddr == ipaddr && ce->ac_port == arp_port)
+			return ce;
 	}
 	return NULL;
 }
 
-PRIVATE arp_cache_t *alloc_cache_ent()
+PRIVATE arp_cache_t *alloc_cache_ent(arp_port, ipaddr)
+arp_port_t *arp_port;
+ipaddr_t ipaddr;
 {
-	arp_cache_t *cache, *old;
-	int i;
+	arp_cache_t *ce, *old, **cep;
+	int i, n;
+	u32_t hash_tmp;
 
-	old= NULL;
-	for (i=0, cache= arp_cache; i<ARP_CACHE_NR; i++, cache++)
+	if (arp_cache_inuse < arp_cache_nr)
+		ce= &arp_cache[arp_cache_inuse++];
+	else
 	{
-		if (cache->ac_state == ACS_UNUSED)
-			return cache;
-		if (cache->ac_state == ACS_INCOMPLETE)
-			continue;
-		if (!old || cache->ac_lastuse < old->ac_lastuse)
-			old= cache;
+		/* Take the least recently used of the next few entries
+		 * that are not being looked up or written.
+		 */
+		old= NULL;
+		for (i= 0, n= 0; i<arp_cache_nr && n<ARP_EVICT_NR; i++)
+		{
+			ce= &arp_cache[arp_evict_ind];
+			if (++arp_evict_ind == arp_cache_nr)
+				arp_evict_ind= 0;
+			if (ce->ac_state == ACS_INCOMPLETE ||
+				(ce->ac_flags & (ACF_WAITLIST|ACF_WRITELIST)))
+			{
+				continue;
+			}
+			n++;
+			if (!old || ce->ac_lastuse < old->ac_lastuse)
+				old= ce;
+		}
+		if (old == NULL)
+			return NULL;
+		ce= old;
+		assert(ce->ac_pack_head == NULL);
+
+		for (cep= &arp_hash[hash_arp(ce->ac_ipaddr, hash_tmp)];
+			*cep != ce; cep= &(*cep)->ac_hash_next)
+		{
+			assert(*cep != NULL);
+		}
+		*cep= ce->ac_hash_next;
 	}
-	assert(old);
-	return old;
+
+	ce->ac_flags= ACF_EMPTY;
+	ce->ac_ipaddr= ipaddr;
+	ce->ac_port= arp_port;
+	ce->ac_pack_head= NULL;
+	ce->ac_pack_nr= 0;
+
+	cep= &arp_hash[hash_arp(ipaddr, hash_tmp)];
+	ce->ac_hash_next= *cep;
+	*cep= ce;
+	return ce;
 }
 
 PUBLIC void arp_set_ipaddr (eth_port, ipaddr)
@@ -638,7 +758,6 @@ int eth_port;
 ipaddr_t ipaddr;
 {
 	arp_port_t *arp_port;
-	int i;
 
 	if (eth_port < 0 || eth_port >= eth_conf_nr)
 		return;
@@ -657,7 +776,6 @@ int ip_port;
 arp_func_t arp_func;
 {
 	arp_port_t *arp_port;
-	int i;
 
 	assert(eth_port >= 0);
 	if (eth_port >= eth_conf_nr)
@@ -669,20 +787,23 @@ arp_func_t arp_func;
 	arp_port->ap_state= APS_INITIAL;
 	arp_port->ap_flags= APF_EMPTY;
 	arp_port->ap_arp_func= arp_func;
+	arp_port->ap_wait_head= NULL;
+	arp_port->ap_write_head= NULL;
 
 	arp_main(arp_port);
 
 	return NW_OK;
 }
 
-PUBLIC int arp_ip_eth (eth_port, ipaddr, ethaddr)
+PUBLIC int arp_ip_eth (eth_port, ipaddr, pack, ethaddr)
 int eth_port;
 ipaddr_t ipaddr;
+acc_t *pack;
 ether_addr_t *ethaddr;
 {
 	arp_port_t *arp_port;
-	int i;
 	arp_cache_t *ce;
+	acc_t *old_pack;
 	time_t curr_time;
 
 	assert(eth_port >= 0 && eth_port < eth_conf_nr);
@@ -693,48 +814,67 @@ ether_addr_t *ethaddr;
 	curr_time= get_time();
 
 	ce= find_cache_ent (arp_port, ipaddr);
-	if (ce && ce->ac_expire < curr_time)
+	if (ce == NULL)
+	{
+		ce= alloc_cache_ent(arp_port, ipaddr);
+		if (ce == NULL)
+		{
+			/* Every entry is busy, no room to wait for
+			 * another address.
+			 */
+			DBLOCK(1, printf("arp: cache full\n"));
+			return EDSTNOTRCH;
+		}
+		ce->ac_state= ACS_INCOMPLETE;
+		ce->ac_expire= curr_time+ARP_EXP_TIME;
+		request_ent(ce);
+	}
+	else if (ce->ac_expire < curr_time && ce->ac_state != ACS_INCOMPLETE)
 	{
-		ce->ac_state= ACS_UNUSED;
-		ce= NULL;
+		DBLOCK(0x10, printf("arp: expiring entry for ");
+			writeIpAddr(ce->ac_ipaddr); printf("\n"));
+		ce->ac_state= ACS_INCOMPLETE;
+		ce->ac_flags &= ~ACF_REFRESH;
+		ce->ac_expire= curr_time+ARP_EXP_TIME;
+		request_ent(ce);
 	}
-	if (ce)
+	ce->ac_lastuse= curr_time;
+
+	if (ce->ac_state == ACS_VALID)
 	{
-		/* Found an entry. This entry should be valid, unreachable
-		 * or incomplete.
+		/* An entry in use is refreshed before it expires, meanwhile
+		 * the old address is used.
 		 */
-		ce->ac_lastuse= curr_time;
-		if (ce->ac_state == ACS_VALID)
+		if (!(ce->ac_flags & ACF_REFRESH) &&
+			ce->ac_expire - ARP_REFRESH_TIME < curr_time)
 		{
-			*ethaddr= ce->ac_ethaddr;
-			return NW_OK;
+			ce->ac_flags |= ACF_REFRESH;
+			request_ent(ce);
 		}
-		if (ce->ac_state == ACS_UNREACHABLE)
-			return EDSTNOTRCH;
-		assert(ce->ac_state == ACS_INCOMPLETE);
-		return NW_SUSPEND;
+		*ethaddr= ce->ac_ethaddr;
+		return NW_OK;
 	}
-
-	if (arp_port->ap_flags & APF_CLIENTREQ)
+	if (ce->ac_state == ACS_UNREACHABLE)
+		return EDSTNOTRCH;
+	assert(ce->ac_state == ACS_INCOMPLETE);
+
+	/* Keep the packet until the reply comes, the oldest one is dropped
+	 * if there are too many.
+	 */
+	if (ce->ac_pack_nr == ARP_QUEUE_NR)
 	{
-		/* We should implement something to be able to do
-		 * multiple arp lookups at the same time. At the moment
-		 * we just return SUSPEND.
-		 */
-		return NW_SUSPEND;
+		old_pack= ce->ac_pack_head;
+		ce->ac_pack_head= old_pack->acc_ext_link;
+		ce->ac_pack_nr--;
+		bf_afree(old_pack);
 	}
-	ce= alloc_cache_ent();
-	ce->ac_flags= 0;
-	ce->ac_state= ACS_INCOMPLETE;
-	ce->ac_ipaddr= ipaddr;
-	ce->ac_port= arp_port;
-	ce->ac_expire= curr_time+ARP_EXP_TIME;
-	ce->ac_lastuse= curr_time;
-	arp_port->ap_flags |= APF_CLIENTREQ|APF_MORE2WRITE | APF_CLIENTWRITE;
-	arp_port->ap_req_ipaddr= ipaddr;
-	arp_port->ap_req_count= 0;
-	if (!(arp_port->ap_flags & APF_ARP_WR_IP))
-		setup_write(arp_port);
+	pack->acc_ext_link= NULL;
+	if (ce->ac_pack_head == NULL)
+		ce->ac_pack_head= pack;
+	else
+		ce->ac_pack_tail->acc_ext_link= pack;
+	ce->ac_pack_tail= pack;
+	ce->ac_pack_nr++;
 	return NW_SUSPEND;
 }
 
@@ -743,32 +883,111 @@ int fd;
 timer_t *timer;
 {
 	arp_port_t *arp_port;
-	arp_cache_t *ce;
-	int level;
-	time_t curr_time;
+	arp_cache_t *ce, **cep;
+	time_t curr_time, next_time;
 
 	arp_port= &arp_port_table[fd];
 
 	assert (timer == &arp_port->ap_timer);
+	arp_port->ap_flags &= ~APF_TIMER;
 
-	if (++arp_port->ap_req_count < MAX_ARP_RETRIES)
+	curr_time= get_time();
+	next_time= 0;
+	cep= &arp_port->ap_wait_head;
+	while ((ce= *cep) != NULL)
 	{
-		arp_port->ap_flags |= APF_CLIENTWRITE|APF_MORE2WRITE;
-		if (!(arp_port->ap_flags & APF_ARP_WR_IP))
-			setup_write(arp_port);
+		assert(ce->ac_flags & ACF_WAITLIST);
+		if (ce->ac_state != ACS_INCOMPLETE &&
+			!(ce->ac_flags & ACF_REFRESH))
+		{
+			/* Answered */
+			*cep= ce->ac_wait_next;
+			ce->ac_flags &= ~ACF_WAITLIST;
+			continue;
+		}
+		if (ce->ac_req_time + ARP_TIMEOUT <= curr_time &&
+			++ce->ac_req_count < MAX_ARP_RETRIES)
+		{
+			ce->ac_req_time= curr_time;
+			write_ent(ce, ACF_SENDREQ);
+		}
+		if (ce->ac_req_time + ARP_TIMEOUT > curr_time)
+		{
+			if (next_time == 0 ||
+				ce->ac_req_time + ARP_TIMEOUT < next_time)
+			{
+				next_time= ce->ac_req_time + ARP_TIMEOUT;
+			}
+			cep= &ce->ac_wait_next;
+			continue;
+		}
+
+		/* No answer */
+		*cep= ce->ac_wait_next;
+		ce->ac_flags &= ~ACF_WAITLIST;
+		if (ce->ac_flags & ACF_REFRESH)
+		{
+			/* Keep using the old address until it expires. */
+			ce->ac_flags &= ~ACF_REFRESH;
+			continue;
+		}
+		ce->ac_state= ACS_UNREACHABLE;
+		ce->ac_expire= curr_time+ ARP_NOTRCH_EXP_TIME;
+		ce->ac_lastuse= curr_time;
+
+		client_reply(ce, NULL);
 	}
-	else
+	if (next_time != 0)
+	{
+		arp_port->ap_flags |= APF_TIMER;
+		clck_timer(&arp_port->ap_timer, next_time, arp_timeout,
+			arp_port->ap_eth_port);
+	}
+}
+
+PRIVATE void arp_buffree(priority)
+int priority;
+{
+	int i;
+	arp_port_t *arp_port;
+	arp_cache_t *ce;
+	acc_t *pack;
+
+	if (priority != ARP_PRI_QUEUE)
+		return;
+
+	/* Packets wait only in entries that are being looked up. */
+	for (i= 0, arp_port= arp_port_table; i<eth_conf_nr; i++, arp_port++)
 	{
-		ce= find_cache_ent(arp_port, arp_port->ap_req_ipaddr);
-		if (ce) {
-			assert(ce->ac_state == ACS_INCOMPLETE ||
-				(printf("ce->ac_state= %d\n", ce->ac_state),0));
-			curr_time= get_time();
-			ce->ac_state= ACS_UNREACHABLE;
-			ce->ac_expire= curr_time+ ARP_NOTRCH_EXP_TIME;
-			ce->ac_lastuse= curr_time;
-
-			client_reply(arp_port, ce->ac_ipaddr, NULL);
+		for (ce= arp_port->ap_wait_head; ce; ce= ce->ac_wait_next)
+		{
+			while (ce->ac_pack_head != NULL)
+			{
+				pack= ce->ac_pack_head;
+				ce->ac_pack_head= pack->acc_ext_link;
+				bf_afree(pack);
+			}
+			ce->ac_pack_nr= 0;
+		}
+	}
+}
+
+PRIVATE void arp_bufcheck()
+{
+	int i;
+	arp_port_t *arp_port;
+	arp_cache_t *ce;
+	acc_t *pack;
+
+	for (i= 0, arp_port= arp_port_table; i<eth_conf_nr; i++, arp_port++)
+	{
+		for (ce= arp_port->ap_wait_head; ce; ce= ce->ac_wait_next)
+		{
+			for (pack= ce->ac_pack_head; pack;
+				pack= pack->acc_ext_link)
+			{
+				bf_check_acc(pack);
+			}
 		}
 	}
 }
@@ -13,14 +13,19 @@ Copyright 1995 Philip Homburg
 #define ARP_REPLY	2
 
 /* Prototypes */
+
+/* Called with the packets that waited for 'ipaddr', linked through
+ * acc_ext_link, and its ethernet address, or NULL if it is unreachable.
+ */
 typedef void (*arp_func_t) ARGS(( int fd, ipaddr_t ipaddr,
-	ether_addr_t *ethaddr ));
+	ether_addr_t *ethaddr, acc_t *pack ));
 
 void arp_prep ARGS(( void ));
 void arp_init ARGS(( void ));
 void arp_set_ipaddr ARGS(( int eth_port, ipaddr_t ipaddr ));
 int arp_set_cb ARGS(( int eth_port, int ip_port, arp_func_t arp_func ));
-int arp_ip_eth ARGS(( int eth_port, ipaddr_t ipaddr, ether_addr_t *ethaddr ));
+int arp_ip_eth ARGS(( int eth_port, ipaddr_t ipaddr, acc_t *pack,
+	ether_addr_t *ethaddr ));
 
 #endif /* ARP_H */
 
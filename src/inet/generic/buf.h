@@ -15,6 +15,8 @@ Copyright 1995 Philip Homburg
 #define ETH_PRI_FDBUFS_EXTRA	5
 #define ETH_PRI_FDBUFS		6
 
+#define ARP_PRI_QUEUE		3
+
 #define IP_PRI_PORTBUFS		3
 #define IP_PRI_ASSBUFS		4
 #define IP_PRI_FDBUFS_EXTRA	5
@@ -36,9 +38,7 @@ struct acc;
 typedef void (*buffree_t) ARGS(( struct acc *acc ));
 typedef void (*bf_freereq_t) ARGS(( int priority ));
 
-#ifdef BUF_CONSISTENCY_CHECK
 typedef void (*bf_checkreq_t) ARGS(( void ));
-#endif
 
 typedef struct buf
 {
@@ -46,6 +46,7 @@ typedef struct buf
 	buffree_t buf_free;
 	size_t buf_size;
 	char *buf_data_p;
+	time_t buf_alloc_time;
 
 #ifdef BUF_TRACK_ALLOC_FREE
 	char *buf_alloc_file;
@@ -119,11 +120,9 @@ extern acc_t *bf_temporary_acc;
 /* Prototypes */
 
 void bf_init ARGS(( void ));
-#ifndef BUF_CONSISTENCY_CHECK
-void bf_logon ARGS(( bf_freereq_t func ));
-#else
-void bf_logon ARGS(( bf_freereq_t func, bf_checkreq_t checkfunc ));
-#endif
+void bf_logon ARGS(( char *name, bf_freereq_t func,
+						bf_checkreq_t checkfunc ));
+/* checkfunc must call bf_check_acc() for every packet the client holds */
 
 #ifndef BUF_TRACK_ALLOC_FREE
 acc_t *bf_memreq ARGS(( unsigned size));
@@ -222,9 +221,10 @@ acc_t *_bf_align ARGS(( char *clnt_file, int clnt_line,
 	compare((buf)->acc_buffer, !=, 0), \
 	compare((buf)->acc_buffer->buf_linkC,>,0)) : 0)
 
+void bf_check_acc ARGS(( acc_t *acc ));
+void bf_getstat ARGS(( nwio_bufstat_t *bufstat ));
 #ifdef BUF_CONSISTENCY_CHECK
 int bf_consistency_check ARGS(( void ));
-void bf_check_acc ARGS(( acc_t *acc ));
 void _bf_mark_acc ARGS(( char *clnt_file, int clnt_line, acc_t *acc ));
 #endif
 
@@ -53,9 +53,7 @@ FORWARD int eth_checkopt ARGS(( eth_fd_t *eth_fd ));
 FORWARD void hash_fd ARGS(( eth_fd_t *eth_fd ));
 FORWARD void unhash_fd ARGS(( eth_fd_t *eth_fd ));
 FORWARD void eth_buffree ARGS(( int priority ));
-#ifdef BUF_CONSISTENCY_CHECK
 FORWARD void eth_bufcheck ARGS(( void ));
-#endif
 FORWARD void packet2user ARGS(( eth_fd_t *fd, acc_t *pack, time_t exp_time ));
 FORWARD void reply_thr_get ARGS(( eth_fd_t *eth_fd,
 	size_t result, int for_ioctl ));
@@ -95,11 +93,7 @@ PUBLIC void eth_init()
 	}
 #endif
 
-#ifndef BUF_CONSISTENCY_CHECK
-	bf_logon(eth_buffree);
-#else
-	bf_logon(eth_buffree, eth_bufcheck);
-#endif
+	bf_logon("eth", eth_buffree, eth_bufcheck);
 
 	osdep_eth_init();
 }
@@ -902,7 +896,6 @@ int priority;
 	}
 }
 
-#ifdef BUF_CONSISTENCY_CHECK
 PRIVATE void eth_bufcheck()
 {
 	int i;
@@ -911,7 +904,11 @@ PRIVATE void eth_bufcheck()
 
 	for (i= 0; i<eth_conf_nr; i++)
 	{
-		bf_check_acc(eth_port_table[i].etp_rd_pack);
+		for (pack= eth_port_table[i].etp_rd_pack; pack;
+			pack= pack->acc_ext_link)
+		{
+			bf_check_acc(pack);
+		}
 		bf_check_acc(eth_port_table[i].etp_wr_pack);
 	}
 	for (i= 0, eth_fd= eth_fd_table; i<ETH_FD_NR; i++, eth_fd++)
@@ -923,7 +920,6 @@ PRIVATE void eth_bufcheck()
 		}
 	}
 }
-#endif
 
 PRIVATE u32_t compute_rec_conf(eth_port)
 eth_port_t *eth_port;
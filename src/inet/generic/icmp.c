@@ -42,6 +42,8 @@ typedef struct icmp_port
 #define ICPS_MAIN	2
 #define ICPS_ERROR	3
 
+#define ICMP_HDR_LEN	8	/* Type, code, checksum and the ih_hun word */
+
 PRIVATE icmp_port_t *icmp_port_table;
 
 FORWARD void icmp_main ARGS(( icmp_port_t *icmp_port ));
@@ -74,9 +76,7 @@ FORWARD void enqueue_pack ARGS(( icmp_port_t *icmp_port,
 FORWARD void icmp_write ARGS(( icmp_port_t *icmp_port ));
 FORWARD void icmp_buffree ARGS(( int priority ));
 FORWARD acc_t *icmp_err_pack ARGS(( acc_t *pack, icmp_hdr_t **icmp_hdr ));
-#ifdef BUF_CONSISTENCY_CHECK
 FORWARD void icmp_bufcheck ARGS(( void ));
-#endif
 
 PUBLIC void icmp_prep()
 {
@@ -99,11 +99,7 @@ PUBLIC void icmp_init()
 		icmp_port->icp_ipport= i;
 	}
 
-#ifndef BUF_CONSISTENCY_CHECK
-	bf_logon(icmp_buffree);
-#else
-	bf_logon(icmp_buffree, icmp_bufcheck);
-#endif
+	bf_logon("icmp", icmp_buffree, icmp_bufcheck);
 
 	for (i= 0, icmp_port= icmp_port_table; i<ip_conf_nr; i++, icmp_port++)
 	{
@@ -361,8 +357,10 @@ acc_t *data;
 	int ip_hdr_len;
 	size_t pack_len;
 
-	/* Align entire packet */
-	data= bf_align(data, BUF_S, 4);
+	/* Align the IP and ICMP headers.  The rest of the packet may stay
+	 * chained, the handlers cut out what they need.
+	 */
+	data= bf_align(data, IP_MAX_HDR_SIZE + ICMP_HDR_LEN, 4);
 
 	data= bf_packIffLess(data, IP_MIN_HDR_SIZE);
 	ip_hdr= (ip_hdr_t *)ptr2acc_data(data);
@@ -387,7 +385,7 @@ acc_t *data;
 
 	icmp_data= bf_cut(data, ip_hdr_len, pack_len);
 
-	icmp_data= bf_packIffLess (icmp_data, ICMP_MIN_HDR_LEN);
+	icmp_data= bf_packIffLess (icmp_data, ICMP_HDR_LEN);
 	icmp_hdr= (icmp_hdr_t *)ptr2acc_data(icmp_data);
 
 	if ((u16_t)~icmp_pack_oneCsum(icmp_data))
@@ -646,7 +644,6 @@ int priority;
 	}
 }
 
-#ifdef BUF_CONSISTENCY_CHECK
 PRIVATE void icmp_bufcheck()
 {
 	int i;
@@ -663,7 +660,6 @@ PRIVATE void icmp_bufcheck()
 		bf_check_acc(icmp_port->icp_write_pack);
 	}
 }
-#endif
 
 PRIVATE void icmp_dst_unreach(icmp_port, ip_pack, ip_hdr_len, ip_hdr, icmp_pack,
 	icmp_len, icmp_hdr)
@@ -787,6 +783,7 @@ icmp_hdr_t *icmp_hdr;
 	int entry_size;
 	u16_t lifetime;
 	int i;
+	acc_t *entry;
 	char *bufp;
 
 	if (icmp_len < 8)
@@ -836,12 +833,18 @@ icmp_hdr_t *icmp_hdr;
 			lifetime));
 		return;
 	}
-	for (i= 0, bufp= (char *)&icmp_hdr->ih_dun.uhd_data[0]; i< entries; i++,
-		bufp += entry_size)
+	for (i= 0; i< entries; i++)
 	{
+		/* The packet is only aligned up to the ICMP header, so cut
+		 * out each entry.
+		 */
+		entry= bf_cut(icmp_pack, 8 + i*entry_size, 8);
+		entry= bf_align(entry, 8, 4);
+		bufp= ptr2acc_data(entry);
 		ipr_add_oroute(icmp_port->icp_ipport, HTONL(0L), HTONL(0L), 
 			*(ipaddr_t *)bufp, lifetime * HZ, 1, 0, 
 			ntohl(*(i32_t *)(bufp+4)), NULL);
+		bf_afree(entry);
 	}
 }
 		
@@ -27,25 +27,23 @@ FORWARD void ip_close ARGS(( int fd ));
 FORWARD int ip_cancel ARGS(( int fd, int which_operation ));
 
 FORWARD void ip_buffree ARGS(( int priority ));
-#ifdef BUF_CONSISTENCY_CHECK
 FORWARD void ip_bufcheck ARGS(( void ));
-#endif
 FORWARD void ip_bad_callback ARGS(( struct ip_port *ip_port ));
 
 PUBLIC ip_port_t *ip_port_table;
 PUBLIC ip_fd_t ip_fd_table[IP_FD_NR];
-PUBLIC ip_ass_t ip_ass_table[IP_ASS_NR];
 
 PUBLIC void ip_prep()
 {
 	ip_port_table= alloc(ip_conf_nr * sizeof(ip_port_table[0]));
+	ip_ass_prep();
 	icmp_prep();
+	ipr_prep();
 }
 
 PUBLIC void ip_init()
 {
 	int i, j, result;
-	ip_ass_t *ip_ass;
 	ip_fd_t *ip_fd;
 	ip_port_t *ip_port;
 	struct ip_conf *icp;
@@ -55,14 +53,9 @@ PUBLIC void ip_init()
 	assert (BUF_S >= sizeof(nwio_ipopt_t));
 	assert (BUF_S >= sizeof(nwio_route_t));
 
-#if ZERO
-	for (i=0, ip_ass= ip_ass_table; i<IP_ASS_NR; i++, ip_ass++)
-	{
-		ip_ass->ia_frags= 0;
-		ip_ass->ia_first_time= 0;
-		ip_ass->ia_port= 0;
-	}
+	ip_ass_init();
 
+#if ZERO
 	for (i=0, ip_fd= ip_fd_table; i<IP_FD_NR; i++, ip_fd++)
 	{
 		ip_fd->if_flags= IFF_EMPTY;
@@ -122,11 +115,7 @@ PUBLIC void ip_init()
 #endif
 	}
 
-#ifndef BUF_CONSISTENCY_CHECK
-	bf_logon(ip_buffree);
-#else
-	bf_logon(ip_buffree, ip_bufcheck);
-#endif
+	bf_logon("ip", ip_buffree, ip_bufcheck);
 
 	icmp_init();
 	ipr_init();
@@ -261,7 +250,6 @@ int priority;
 	int i;
 	ip_port_t *ip_port;
 	ip_fd_t *ip_fd;
-	ip_ass_t *ip_ass;
 	acc_t *pack, *next_pack;
 
 	for (i= 0, ip_port= ip_port_table; i<ip_conf_nr; i++, ip_port++)
@@ -273,15 +261,6 @@ int priority;
 			 */
 			if (priority == IP_PRI_PORTBUFS)
 			{
-				next_pack= ip_port->ip_dl.dl_eth.de_arp_head;
-				while(next_pack != NULL)
-				{
-					pack= next_pack;
-					next_pack= pack->acc_ext_link;
-					bf_afree(pack);
-				}
-				ip_port->ip_dl.dl_eth.de_arp_head= next_pack;
-
 				next_pack= ip_port->ip_dl.dl_eth.de_q_head;
 				while(next_pack != NULL)
 				{
@@ -359,28 +338,14 @@ int priority;
 		}
 	}
 	if (priority == IP_PRI_ASSBUFS)
-	{
-		for (i= 0, ip_ass= ip_ass_table; i<IP_ASS_NR; i++, ip_ass++)
-		{
-			next_pack= ip_ass->ia_frags;
-			while(ip_ass->ia_frags != NULL)
-			{
-				pack= ip_ass->ia_frags;
-				ip_ass->ia_frags= pack->acc_ext_link;
-				bf_afree(pack);
-			}
-			ip_ass->ia_first_time= 0;
-		}
-	}
+		ip_ass_buffree();
 }
 
-#ifdef BUF_CONSISTENCY_CHECK
 PRIVATE void ip_bufcheck()
 {
 	int i;
 	ip_port_t *ip_port;
 	ip_fd_t *ip_fd;
-	ip_ass_t *ip_ass;
 	acc_t *pack;
 
 	for (i= 0, ip_port= ip_port_table; i<ip_conf_nr; i++, ip_port++)
@@ -393,11 +358,6 @@ PRIVATE void ip_bufcheck()
 			{
 				bf_check_acc(pack);
 			}
-			for (pack= ip_port->ip_dl.dl_eth.de_arp_head; pack;
-				pack= pack->acc_ext_link)
-			{
-				bf_check_acc(pack);
-			}
 		}
 		else if (ip_port->ip_dl_type == IPDL_PSIP)
 		{
@@ -421,13 +381,8 @@ PRIVATE void ip_bufcheck()
 			bf_check_acc(pack);
 		}
 	}
-	for (i= 0, ip_ass= ip_ass_table; i<IP_ASS_NR; i++, ip_ass++)
-	{
-		for (pack= ip_ass->ia_frags; pack; pack= pack->acc_ext_link)
-			bf_check_acc(pack);
-	}
+	ip_ass_bufcheck();
 }
-#endif /* BUF_CONSISTENCY_CHECK */
 
 PRIVATE void ip_bad_callback(ip_port)
 struct ip_port *ip_port;
@@ -9,10 +9,10 @@ Copyright 1995 Philip Homburg
 */
 
 #include "inet.h"
+#include "buf.h"
 #include "type.h"
 #include "arp.h"
 #include "assert.h"
-#include "buf.h"
 #include "clock.h"
 #include "eth.h"
 #include "event.h"
@@ -43,7 +43,7 @@ FORWARD void ipeth_restart_send ARGS(( ip_port_t *ip_port ));
 FORWARD int ipeth_send ARGS(( struct ip_port *ip_port, ipaddr_t dest, 
 	acc_t *pack, int broadcast ));
 FORWARD void ipeth_arp_reply ARGS(( int ip_port_nr, ipaddr_t ipaddr,
-	ether_addr_t *dst_ether_ptr ));
+	ether_addr_t *dst_ether_ptr, acc_t *pack ));
 FORWARD int ipeth_update_ttl ARGS(( time_t enq_time, time_t now,
 	acc_t *eth_pack ));
 FORWARD void ip_eth_arrived ARGS(( int port, acc_t *pack,
@@ -68,8 +68,6 @@ ip_port_t *ip_port;
 	ip_port->ip_dl.dl_eth.de_flags= IEF_EMPTY;
 	ip_port->ip_dl.dl_eth.de_q_head= NULL;
 	ip_port->ip_dl.dl_eth.de_q_tail= NULL;
-	ip_port->ip_dl.dl_eth.de_arp_head= NULL;
-	ip_port->ip_dl.dl_eth.de_arp_tail= NULL;
 	ip_port->ip_dev_main= ipeth_main;
 	ip_port->ip_dev_set_ipaddr= ipeth_set_ipaddr;
 	ip_port->ip_dev_send= ipeth_send;
@@ -325,28 +323,17 @@ int broadcast;
 		assert(hostpart != 0);
 		assert(dest != ip_port->ip_ipaddr);
 
+		/* The arp may take some time, in which case it keeps the
+		 * packet. Use the ethernet header to store the next hop
+		 * ip address and the current time.
+		 */
+		xmit_hdr= (xmit_hdr_t *)eth_hdr;
+		xmit_hdr->xh_time= get_time();
+		xmit_hdr->xh_ipaddr= dest;
 		r= arp_ip_eth(ip_port->ip_dl.dl_eth.de_port,
-			dest, &eth_hdr->eh_dst);
+			dest, eth_pack, &eth_hdr->eh_dst);
 		if (r == NW_SUSPEND)
-		{
-			/* Unfortunately, the arp takes some time, use
-			 * the ethernet header to store the next hop
-			 * ip address and the current time.
-			 */
-			xmit_hdr= (xmit_hdr_t *)eth_hdr;
-			xmit_hdr->xh_time= get_time();
-			xmit_hdr->xh_ipaddr= dest;
-			eth_pack->acc_ext_link= NULL;
-			if (ip_port->ip_dl.dl_eth.de_arp_head == NULL)
-				ip_port->ip_dl.dl_eth.de_arp_head= eth_pack;
-			else
-			{
-				ip_port->ip_dl.dl_eth.de_arp_tail->
-					acc_ext_link= eth_pack;
-			}
-			ip_port->ip_dl.dl_eth.de_arp_tail= eth_pack;
 			return NW_OK;
-		}
 		if (r == EDSTNOTRCH)
 		{
 			bf_afree(eth_pack);
@@ -498,51 +485,25 @@ ip_port_t *ip_port;
 }
 
 
-PRIVATE void ipeth_arp_reply(ip_port_nr, ipaddr, eth_addr)
+PRIVATE void ipeth_arp_reply(ip_port_nr, ipaddr, eth_addr, pack)
 int ip_port_nr;
 ipaddr_t ipaddr;
 ether_addr_t *eth_addr;
+acc_t *pack;
 {
-	acc_t *prev, *eth_pack;
-	int r;
+	acc_t *eth_pack;
 	xmit_hdr_t *xmit_hdr;
 	ip_port_t *ip_port;
 	time_t t;
 	eth_hdr_t *eth_hdr;
-	ether_addr_t tmp_eth_addr;
 
 	assert (ip_port_nr >= 0 && ip_port_nr < ip_conf_nr);
 	ip_port= &ip_port_table[ip_port_nr];
 
-	for (;;)
+	while (pack != NULL)
 	{
-		for (prev= 0, eth_pack= ip_port->ip_dl.dl_eth.de_arp_head;
-			eth_pack;
-			prev= eth_pack, eth_pack= eth_pack->acc_ext_link)
-		{
-			xmit_hdr= (xmit_hdr_t *)ptr2acc_data(eth_pack);
-			if (xmit_hdr->xh_ipaddr == ipaddr)
-				break;
-		}
-
-		if (eth_pack == NULL)
-		{
-			/* No packet found. */
-			break;
-		}
-
-		/* Delete packet from the queue. */
-		if (prev == NULL)
-		{
-			ip_port->ip_dl.dl_eth.de_arp_head=
-				eth_pack->acc_ext_link;
-		}
-		else
-		{
-			prev->acc_ext_link= eth_pack->acc_ext_link;
-			if (prev->acc_ext_link == NULL)
-				ip_port->ip_dl.dl_eth.de_arp_tail= prev;
-		}
+		eth_pack= pack;
+		pack= pack->acc_ext_link;
 
 		if (eth_addr == NULL)
 		{
@@ -554,48 +515,11 @@ ether_addr_t *eth_addr;
 		/* Fill in the ethernet address and put the packet on the 
 		 * transmit queue.
 		 */
-		t= xmit_hdr->xh_time;
-		eth_hdr= (eth_hdr_t *)ptr2acc_data(eth_pack);
-		eth_hdr->eh_dst= *eth_addr;
-		memcpy(&eth_hdr->eh_src, &t, sizeof(t));
-
-		eth_pack->acc_ext_link= NULL;
-		if (ip_port->ip_dl.dl_eth.de_q_head == NULL)
-			ip_port->ip_dl.dl_eth.de_q_head= eth_pack;
-		else
-		{
-			ip_port->ip_dl.dl_eth.de_q_tail->acc_ext_link=
-				eth_pack;
-		}
-		ip_port->ip_dl.dl_eth.de_q_tail= eth_pack;
-	}
-
-	/* Try to get some more ARPs in progress. */
-	while (ip_port->ip_dl.dl_eth.de_arp_head)
-	{
-		eth_pack= ip_port->ip_dl.dl_eth.de_arp_head;
 		xmit_hdr= (xmit_hdr_t *)ptr2acc_data(eth_pack);
-		r= arp_ip_eth(ip_port->ip_dl.dl_eth.de_port,
-			xmit_hdr->xh_ipaddr, &tmp_eth_addr);
-		if (r == NW_SUSPEND)
-			break;				/* Normal case */
-
-		/* Dequeue the packet */
-		ip_port->ip_dl.dl_eth.de_arp_head= eth_pack->acc_ext_link;
-
-		if (r == EDSTNOTRCH)
-		{
-			bf_afree(eth_pack);
-			continue;
-		}
-		assert(r == NW_OK);
-
-		/* Fill in the ethernet address and put the packet on the 
-		 * transmit queue.
-		 */
+		assert(xmit_hdr->xh_ipaddr == ipaddr);
 		t= xmit_hdr->xh_time;
 		eth_hdr= (eth_hdr_t *)ptr2acc_data(eth_pack);
-		eth_hdr->eh_dst= tmp_eth_addr;
+		eth_hdr->eh_dst= *eth_addr;
 		memcpy(&eth_hdr->eh_src, &t, sizeof(t));
 
 		eth_pack->acc_ext_link= NULL;
@@ -8,7 +8,8 @@ Copyright 1995 Philip Homburg
 #define INET_IP_INT_H
 
 #define IP_FD_NR	(8*IP_PORT_MAX)
-#define IP_ASS_NR	3
+#define IP_ASS_HOLE_NR	8	/* holes in a datagram being reassembled */
+#define IP_ASS_TIME	(60L*HZ)	/* time to reassemble a datagram */
 
 #define IP_42BSD_BCAST		1	/* hostnumber 0 is also network
 					   broadcast */
@@ -36,8 +37,6 @@ typedef struct ip_port
 			acc_t *de_frame;
 			acc_t *de_q_head;
 			acc_t *de_q_tail;
-			acc_t *de_arp_head;
-			acc_t *de_arp_tail;
 		} dl_eth;
 		struct
 		{
@@ -81,16 +80,31 @@ typedef struct ip_port
 #define IPDL_ETH	NETTYPE_ETH
 #define IPDL_PSIP	NETTYPE_PSIP
 
+typedef struct ip_ass_hole
+{
+	u16_t iah_first, iah_last;	/* data bytes missing, inclusive */
+} ip_ass_hole_t;
+
 typedef struct ip_ass
 {
-	acc_t *ia_frags;
-	int ia_min_ttl;
+	struct ip_ass *ia_hash_next;
+	struct ip_ass *ia_age_prev, *ia_age_next;
+	acc_t *ia_frags;		/* sorted by offset */
+	acc_t *ia_frags_tail;
 	ip_port_t *ia_port;
-	time_t ia_first_time;
+	time_t ia_exp_time;
 	ipaddr_t ia_srcaddr, ia_dstaddr;
 	int ia_proto, ia_id;
+	int ia_flags;
+	u16_t ia_end;			/* end of the data received so far */
+	u32_t ia_size;			/* bytes held in ia_frags */
+	int ia_hole_nr;
+	ip_ass_hole_t ia_hole[IP_ASS_HOLE_NR];
 } ip_ass_t;
 
+#define IAF_EMPTY	0x0
+#define IAF_LAST	0x1	/* got the last fragment, ia_end is final */
+
 typedef struct ip_fd
 {
 	int if_flags;
@@ -153,6 +167,11 @@ void ip_port_arrive ARGS(( ip_port_t *port, acc_t *pack, ip_hdr_t *ip_hdr ));
 void ip_arrived ARGS(( ip_port_t *port, acc_t *pack ));
 void ip_arrived_broadcast ARGS(( ip_port_t *port, acc_t *pack ));
 void ip_process_loopb ARGS(( event_t *ev, ev_arg_t arg ));
+void ip_ass_prep ARGS(( void ));
+void ip_ass_init ARGS(( void ));
+void ip_ass_buffree ARGS(( void ));
+void ip_ass_bufcheck ARGS(( void ));
+void ip_getstat ARGS(( nwio_ipstat_t *ipstat ));
 
 /* ip_write.c */
 void dll_eth_write_frame ARGS(( ip_port_t *port ));
@@ -163,7 +182,6 @@ void ip_hdr_chksum ARGS(( ip_hdr_t *ip_hdr, int ip_hdr_len ));
 
 extern ip_fd_t ip_fd_table[IP_FD_NR];
 extern ip_port_t *ip_port_table;
-extern ip_ass_t ip_ass_table[IP_ASS_NR];
 
 #define NWIO_DEFAULT    (NWIO_EN_LOC | NWIO_EN_BROAD | NWIO_REMANY | \
 	NWIO_RWDATALL | NWIO_HDR_O_SPEC)
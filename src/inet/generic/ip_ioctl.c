@@ -229,6 +229,22 @@ ioreq_t req;
 									TRUE);
 		return (*ip_fd->if_put_userdata)(ip_fd->if_srfd, result, 
 							(acc_t *)0, TRUE);
+
+	case NWIOGIPBUFSTAT:
+		data= bf_memreq(sizeof(nwio_bufstat_t));
+		bf_getstat((nwio_bufstat_t *)ptr2acc_data(data));
+		result= (*ip_fd->if_put_userdata)(ip_fd->if_srfd, 0, data, 
+									TRUE);
+		return (*ip_fd->if_put_userdata)(ip_fd->if_srfd, result, 
+							(acc_t *)0, TRUE);
+
+	case NWIOGIPSTAT:
+		data= bf_memreq(sizeof(nwio_ipstat_t));
+		ip_getstat((nwio_ipstat_t *)ptr2acc_data(data));
+		result= (*ip_fd->if_put_userdata)(ip_fd->if_srfd, 0, data, 
+									TRUE);
+		return (*ip_fd->if_put_userdata)(ip_fd->if_srfd, result, 
+							(acc_t *)0, TRUE);
 	
 	case NWIOGIPIROUTE:
 		data= (*ip_fd->if_get_userdata)(ip_fd->if_srfd,
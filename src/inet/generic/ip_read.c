@@ -21,7 +21,9 @@ THIS_FILE
 
 FORWARD ip_ass_t *find_ass_ent ARGS(( ip_port_t *ip_port, U16_t id,
 	int proto, ipaddr_t src, ipaddr_t dst ));
-FORWARD acc_t *merge_frags ARGS(( acc_t *first, acc_t *second ));
+FORWARD acc_t *join_frags ARGS(( acc_t *frags ));
+FORWARD void ass_drop ARGS(( ip_ass_t *ass_ent ));
+FORWARD void ass_timeout ARGS(( int fd, timer_t *timer ));
 FORWARD int ip_frag_chk ARGS(( acc_t *pack ));
 FORWARD acc_t *reassemble ARGS(( ip_port_t *ip_port, acc_t *pack, 
 	ip_hdr_t *ip_hdr ));
@@ -64,237 +66,468 @@ size_t count;
 	return NW_SUSPEND;
 }
 
+/* Reassembly.  A datagram being reassembled is found through a hash on its
+ * source, destination and id.  Its fragments are kept sorted by offset, and
+ * a list of the holes still to be filled, as in RFC 815, tells when it is
+ * complete.  Only then are the fragments joined, in one pass.  Datagrams
+ * are kept on a list in order of arrival, which is the order in which they
+ * time out and the order in which they are given up when there is no room
+ * for another datagram or fragment.
+ */
+PRIVATE ip_ass_t *ip_ass_table;
+PRIVATE ip_ass_t **ip_ass_hash;
+PRIVATE int ip_ass_hash_mask;
+PRIVATE ip_ass_t *ip_ass_free;
+PRIVATE ip_ass_t *ip_ass_head, *ip_ass_tail;
+PRIVATE timer_t ip_ass_timer;
+PRIVATE u32_t ip_ass_max;
+PRIVATE u32_t ip_ass_bytes, ip_ass_inuse;
+PRIVATE u32_t ip_ass_frags, ip_ass_ok, ip_ass_timeout, ip_ass_evict,
+	ip_ass_overlap, ip_ass_bad;
+
+#define hash_ass(src, dst, id, hash_tmp) (hash_tmp= (src) ^ (dst) ^ (id), \
+	hash_tmp= (hash_tmp >> 16) ^ hash_tmp, \
+	hash_tmp= (hash_tmp >> 8) ^ hash_tmp, \
+	(int)hash_tmp & ip_ass_hash_mask)
+
+#define frag_offset(pack) ((ntohs(((ip_hdr_t *)ptr2acc_data(pack))-> \
+	ih_flags_fragoff) & IH_FRAGOFF_MASK) * 8)
+
+PUBLIC void ip_ass_prep()
+{
+	int hash_nr;
+
+	if (ip_ass_nr > (size_t)-1 / sizeof(ip_ass_table[0]))
+		ip_panic(( "reassembly table too large" ));
+
+	ip_ass_table= alloc(ip_ass_nr * sizeof(ip_ass_table[0]));
+
+	/* At least one hash chain per entry, a power of two. */
+	for (hash_nr= 1; hash_nr < ip_ass_nr; hash_nr <<= 1)
+		;
+	ip_ass_hash= alloc(hash_nr * sizeof(ip_ass_hash[0]));
+	ip_ass_hash_mask= hash_nr-1;
+}
+
+PUBLIC void ip_ass_init()
+{
+	int i;
+
+	ip_ass_free= NULL;
+	for (i= ip_ass_nr-1; i >= 0; i--)
+	{
+		ip_ass_table[i].ia_hash_next= ip_ass_free;
+		ip_ass_free= &ip_ass_table[i];
+	}
+	ip_ass_max= ip_ass_kb * 1024L;
+}
+
 PRIVATE acc_t *reassemble (ip_port, pack, pack_hdr)
 ip_port_t *ip_port;
 acc_t *pack;
 ip_hdr_t *pack_hdr;
 {
-	ip_ass_t *ass_ent;
-	size_t pack_hdr_len, pack_data_len, pack_offset, tmp_offset;
-	u16_t pack_flags_fragoff;
-	acc_t *prev_acc, *curr_acc, *next_acc, *head_acc, *tmp_acc;
-	ip_hdr_t *tmp_hdr;
-	time_t first_time;
+	ip_ass_t *ass_ent, *next_ent;
+	ip_ass_hole_t *hole;
+	size_t pack_size, pack_data_len, filled;
+	u16_t pack_flags_fragoff, first, last, hole_first, hole_last;
+	acc_t *prev_acc, *next_acc;
+	int more, i;
 
-	ass_ent= find_ass_ent (ip_port, pack_hdr->ih_id,
-		pack_hdr->ih_proto, pack_hdr->ih_src, pack_hdr->ih_dst);
+	ip_ass_frags++;
 
 	pack_flags_fragoff= ntohs(pack_hdr->ih_flags_fragoff);
-	pack_hdr_len= (pack_hdr->ih_vers_ihl & IH_IHL_MASK) * 4;
-	pack_data_len= ntohs(pack_hdr->ih_length)-pack_hdr_len;
-	pack_offset= (pack_flags_fragoff & IH_FRAGOFF_MASK)*8;
-	pack->acc_ext_link= NULL;
+	pack_size= ntohs(pack_hdr->ih_length);
+	pack_data_len= pack_size - (pack_hdr->ih_vers_ihl & IH_IHL_MASK) * 4;
+	first= (pack_flags_fragoff & IH_FRAGOFF_MASK)*8;
+	more= (pack_flags_fragoff & IH_MORE_FRAGS) != 0;
 
-	head_acc= ass_ent->ia_frags;
-	ass_ent->ia_frags= NULL;
-	if (head_acc == NULL)
+	/* All fragments but the last carry a multiple of 8 bytes, and none
+	 * may reach past the largest possible datagram.
+	 */
+	if (pack_data_len == 0 || (more && (pack_data_len & 7)) ||
+		(u32_t)first + pack_data_len > 0xFFFFL - IP_MIN_HDR_SIZE)
 	{
-		ass_ent->ia_frags= pack;
+		DBLOCK(1, printf("bad fragment\n"));
+		ip_ass_bad++;
+		bf_afree(pack);
 		return NULL;
 	}
+	last= first + pack_data_len - 1;
 
-	prev_acc= NULL;
-	curr_acc= NULL;
-	next_acc= head_acc;
+	ass_ent= find_ass_ent (ip_port, pack_hdr->ih_id,
+		pack_hdr->ih_proto, pack_hdr->ih_src, pack_hdr->ih_dst);
 
-	while(next_acc)
+	/* The fragments must agree on where the datagram ends. */
+	if ((ass_ent->ia_flags & IAF_LAST) ? last >= ass_ent->ia_end ||
+		(!more && last+1 != ass_ent->ia_end) :
+		(!more && last+1 < ass_ent->ia_end))
 	{
-		tmp_hdr= (ip_hdr_t *)ptr2acc_data(next_acc);
-		tmp_offset= (ntohs(tmp_hdr->ih_flags_fragoff) &
-			IH_FRAGOFF_MASK)*8;
+		DBLOCK(1, printf("fragments disagree on the length\n"));
+		ip_ass_bad++;
+		bf_afree(pack);
+		ass_drop(ass_ent);
+		return NULL;
+	}
 
-		if (pack_offset < tmp_offset)
-			break;
+	/* Take the fragment out of the holes it overlaps, leaving what is
+	 * left of a hole on either side of it (RFC 815).
+	 */
+	filled= 0;
+	for (i= 0; i<ass_ent->ia_hole_nr;)
+	{
+		hole= &ass_ent->ia_hole[i];
+		if (first > hole->iah_last || last < hole->iah_first)
+		{
+			i++;
+			continue;
+		}
+		hole_first= hole->iah_first;
+		hole_last= hole->iah_last;
+		filled += (last < hole_last ? last : hole_last) -
+			(first > hole_first ? first : hole_first) + 1;
+
+		*hole= ass_ent->ia_hole[--ass_ent->ia_hole_nr];
+		if (first > hole_first)
+		{
+			if (ass_ent->ia_hole_nr == IP_ASS_HOLE_NR)
+				break;
+			hole= &ass_ent->ia_hole[ass_ent->ia_hole_nr++];
+			hole->iah_first= hole_first;
+			hole->iah_last= first-1;
+		}
+		if (last < hole_last && more)
+		{
+			if (ass_ent->ia_hole_nr == IP_ASS_HOLE_NR)
+				break;
+			hole= &ass_ent->ia_hole[ass_ent->ia_hole_nr++];
+			hole->iah_first= last+1;
+			hole->iah_last= hole_last;
+		}
+	}
+	if (i < ass_ent->ia_hole_nr)
+	{
+		/* Ran out of hole descriptors. */
+		DBLOCK(1, printf("too many holes in datagram\n"));
+		ip_ass_bad++;
+		bf_afree(pack);
+		ass_drop(ass_ent);
+		return NULL;
+	}
+	if (filled < pack_data_len)
+	{
+		ip_ass_overlap++;
+		if (filled == 0)
+		{
+			/* Nothing new. */
+			bf_afree(pack);
+			return NULL;
+		}
+	}
+	if (!more)
+		ass_ent->ia_flags |= IAF_LAST;
+	if (last >= ass_ent->ia_end)
+		ass_ent->ia_end= last+1;
 
-		prev_acc= curr_acc;
-		curr_acc= next_acc;
-		next_acc= next_acc->acc_ext_link;
+	/* Make room, by giving up on older datagrams if necessary. */
+	if (ass_ent->ia_size + pack_size > ip_ass_max)
+	{
+		ip_ass_evict++;
+		bf_afree(pack);
+		ass_drop(ass_ent);
+		return NULL;
 	}
-	if (curr_acc == NULL)
+	while (ip_ass_bytes + pack_size > ip_ass_max)
 	{
-		assert(prev_acc == NULL);
-		assert(next_acc != NULL);
+		next_ent= ip_ass_head;
+		if (next_ent == ass_ent)
+			next_ent= next_ent->ia_age_next;
+		assert(next_ent != NULL);
+		ip_ass_evict++;
+		ass_drop(next_ent);
+	}
+	ass_ent->ia_size += pack_size;
+	ip_ass_bytes += pack_size;
 
-		curr_acc= merge_frags(pack, next_acc);
-		head_acc= curr_acc;
+	/* Fragments mostly arrive in order. */
+	pack->acc_ext_link= NULL;
+	if (ass_ent->ia_frags == NULL)
+		ass_ent->ia_frags= ass_ent->ia_frags_tail= pack;
+	else if (frag_offset(ass_ent->ia_frags_tail) <= first)
+	{
+		ass_ent->ia_frags_tail->acc_ext_link= pack;
+		ass_ent->ia_frags_tail= pack;
 	}
 	else
 	{
-		curr_acc= merge_frags(curr_acc, pack);
-		if (next_acc != NULL)
-			curr_acc= merge_frags(curr_acc, next_acc);
-		if (prev_acc != NULL)
-			prev_acc->acc_ext_link= curr_acc;
+		prev_acc= NULL;
+		for (next_acc= ass_ent->ia_frags;
+			frag_offset(next_acc) <= first;
+			next_acc= next_acc->acc_ext_link)
+		{
+			prev_acc= next_acc;
+		}
+		pack->acc_ext_link= next_acc;
+		if (prev_acc == NULL)
+			ass_ent->ia_frags= pack;
 		else
-			head_acc= curr_acc;
+			prev_acc->acc_ext_link= pack;
 	}
-	ass_ent->ia_frags= head_acc;
 
+	if (ass_ent->ia_hole_nr != 0)
+		return NULL;
+
+	/* It's now a complete packet. */
 	pack= ass_ent->ia_frags;
-	pack_hdr= (ip_hdr_t *)ptr2acc_data(pack);
-	pack_flags_fragoff= ntohs(pack_hdr->ih_flags_fragoff);
+	ass_ent->ia_frags= NULL;
+	ass_drop(ass_ent);
+	pack= join_frags(pack);
+	if (pack != NULL)
+		ip_ass_ok++;
+	return pack;
+}
 
-	if (!(pack_flags_fragoff & (IH_FRAGOFF_MASK|IH_MORE_FRAGS)))
-		/* it's now a complete packet */
+PRIVATE acc_t *join_frags (frags)
+acc_t *frags;
+{
+/* Turn the sorted fragments of a complete datagram into one packet.
+ * Where fragments overlap, the one with the lower offset is used.
+ */
+	acc_t *pack, *frag;
+	ip_hdr_t *ip_hdr;
+	size_t hdr_len, frag_hdr_len, frag_data_len, offset, end;
+
+	pack= frags;
+	frags= pack->acc_ext_link;
+	pack->acc_ext_link= NULL;
+
+	ip_hdr= (ip_hdr_t *)ptr2acc_data(pack);
+	hdr_len= (ip_hdr->ih_vers_ihl & IH_IHL_MASK) * 4;
+	end= ntohs(ip_hdr->ih_length) - hdr_len;
+	assert(frag_offset(pack) == 0);
+
+	while (frags != NULL)
 	{
-		first_time= ass_ent->ia_first_time;
+		frag= frags;
+		frags= frag->acc_ext_link;
+		frag->acc_ext_link= NULL;
 
-		ass_ent->ia_frags= 0;
-		ass_ent->ia_first_time= 0;
+		ip_hdr= (ip_hdr_t *)ptr2acc_data(frag);
+		offset= (ntohs(ip_hdr->ih_flags_fragoff) & IH_FRAGOFF_MASK) * 8;
+		frag_hdr_len= (ip_hdr->ih_vers_ihl & IH_IHL_MASK) * 4;
+		frag_data_len= ntohs(ip_hdr->ih_length) - frag_hdr_len;
+		assert(offset <= end);
 
-		while (pack->acc_ext_link)
+		if (offset + frag_data_len <= end)
 		{
-			tmp_acc= pack->acc_ext_link;
-			pack->acc_ext_link= tmp_acc->acc_ext_link;
-			bf_afree(tmp_acc);
+			bf_afree(frag);
+			continue;
 		}
-		if ((ass_ent->ia_min_ttl) * HZ + first_time <
-			get_time())
-			icmp_snd_time_exceeded(ip_port->ip_port, pack,
-				ICMP_FRAG_REASSEM);
-		else
-			return pack;
+		frag= bf_delhead(frag, frag_hdr_len + end - offset);
+		pack= bf_append(pack, frag);
+		end= offset + frag_data_len;
 	}
-	return NULL;
-}
 
-PRIVATE acc_t *merge_frags (first, second)
-acc_t *first, *second;
-{
-	ip_hdr_t *first_hdr, *second_hdr;
-	size_t first_hdr_size, second_hdr_size, first_datasize, second_datasize,
-		first_offset, second_offset;
-	acc_t *cut_second, *tmp_acc;
-
-	if (!second)
+	if ((u32_t)hdr_len + end > 0xFFFF)
 	{
-		first->acc_ext_link= NULL;
-		return first;
+		DBLOCK(1, printf("reassembled datagram too large\n"));
+		ip_ass_bad++;
+		bf_afree(pack);
+		return NULL;
 	}
+	pack= bf_packIffLess(pack, hdr_len);
+	ip_hdr= (ip_hdr_t *)ptr2acc_data(pack);
+	ip_hdr->ih_length= htons(hdr_len + end);
+	ip_hdr->ih_flags_fragoff &= ~HTONS(IH_FRAGOFF_MASK|IH_MORE_FRAGS);
+	ip_hdr_chksum(ip_hdr, hdr_len);
 
-assert (first->acc_length >= IP_MIN_HDR_SIZE);
-assert (second->acc_length >= IP_MIN_HDR_SIZE);
-
-	first_hdr= (ip_hdr_t *)ptr2acc_data(first);
-	first_offset= (ntohs(first_hdr->ih_flags_fragoff) &
-		IH_FRAGOFF_MASK) * 8;
-	first_hdr_size= (first_hdr->ih_vers_ihl & IH_IHL_MASK) * 4;
-	first_datasize= ntohs(first_hdr->ih_length) - first_hdr_size;
-
-	second_hdr= (ip_hdr_t *)ptr2acc_data(second);
-	second_offset= (ntohs(second_hdr->ih_flags_fragoff) &
-		IH_FRAGOFF_MASK) * 8;
-	second_hdr_size= (second_hdr->ih_vers_ihl & IH_IHL_MASK) * 4;
-	second_datasize= ntohs(second_hdr->ih_length) - second_hdr_size;
+	return pack;
+}
 
-	assert (first_hdr_size + first_datasize == bf_bufsize(first));
-	assert (second_hdr_size + second_datasize == bf_bufsize(second));
-	assert (second_offset >= first_offset);
+PRIVATE ip_ass_t *find_ass_ent (ip_port, id, proto, src, dst)
+ip_port_t *ip_port;
+u16_t id;
+ipproto_t proto;
+ipaddr_t src;
+ipaddr_t dst;
+{
+	ip_ass_t *ass_ent, **hash_ent;
+	u32_t hash_tmp;
 
-	if (second_offset > first_offset+first_datasize)
+	hash_ent= &ip_ass_hash[hash_ass(src, dst, id, hash_tmp)];
+	for (ass_ent= *hash_ent; ass_ent; ass_ent= ass_ent->ia_hash_next)
 	{
-		DBLOCK(1, printf("ip fragments out of order\n"));
-		first->acc_ext_link= second;
-		return first;
+		if ((ass_ent->ia_srcaddr == src) &&
+			(ass_ent->ia_dstaddr == dst) &&
+			(ass_ent->ia_proto == proto) &&
+			(ass_ent->ia_id == id) &&
+			(ass_ent->ia_port == ip_port))
+		{
+			return ass_ent;
+		}
 	}
 
-	if (second_offset + second_datasize <= first_offset +
-		first_datasize)
+	if (ip_ass_free == NULL)
 	{
-		/* May cause problems if we try to merge. */
-		bf_afree(first);
-		return second;
+		/* Give up on the oldest datagram. */
+		DBLOCK(1, printf("old frags id= %u, proto= %u, src= ",
+			ntohs(ip_ass_head->ia_id),
+			ntohs(ip_ass_head->ia_proto));
+			writeIpAddr(ip_ass_head->ia_srcaddr); printf(" dst= ");
+			writeIpAddr(ip_ass_head->ia_dstaddr); printf(": ");
+			ip_print_frags(ip_ass_head->ia_frags); printf("\n"));
+		ip_ass_evict++;
+		ass_drop(ip_ass_head);
 	}
+	ass_ent= ip_ass_free;
+	ip_ass_free= ass_ent->ia_hash_next;
+	ip_ass_inuse++;
+
+	ass_ent->ia_hash_next= *hash_ent;
+	*hash_ent= ass_ent;
+	ass_ent->ia_age_prev= ip_ass_tail;
+	ass_ent->ia_age_next= NULL;
+	if (ip_ass_tail == NULL)
+		ip_ass_head= ass_ent;
+	else
+		ip_ass_tail->ia_age_next= ass_ent;
+	ip_ass_tail= ass_ent;
 
-	if (!(second_hdr->ih_flags_fragoff & HTONS(IH_MORE_FRAGS)))
-		first_hdr->ih_flags_fragoff &= ~HTONS(IH_MORE_FRAGS);
+	ass_ent->ia_frags= NULL;
+	ass_ent->ia_port= ip_port;
+	ass_ent->ia_exp_time= get_time() + IP_ASS_TIME;
+	ass_ent->ia_srcaddr= src;
+	ass_ent->ia_dstaddr= dst;
+	ass_ent->ia_proto= proto;
+	ass_ent->ia_id= id;
+	ass_ent->ia_flags= IAF_EMPTY;
+	ass_ent->ia_end= 0;
+	ass_ent->ia_size= 0;
+	ass_ent->ia_hole_nr= 1;
+	ass_ent->ia_hole[0].iah_first= 0;
+	ass_ent->ia_hole[0].iah_last= 0xFFFF;
+
+	if (ass_ent == ip_ass_head)
+	{
+		clck_timer(&ip_ass_timer, ass_ent->ia_exp_time, ass_timeout,
+			0);
+	}
+	return ass_ent;
+}
 
-	second_datasize= second_offset+second_datasize-(first_offset+
-		first_datasize);
-	cut_second= bf_cut(second, second_hdr_size + first_offset+
-		first_datasize-second_offset, second_datasize);
-	tmp_acc= second->acc_ext_link;
-	bf_afree(second);
-	second= tmp_acc;
+PRIVATE void ass_drop (ass_ent)
+ip_ass_t *ass_ent;
+{
+/* Free the fragments of a datagram and the entry itself. */
+	ip_ass_t **hash_ent;
+	acc_t *pack;
+	u32_t hash_tmp;
 
-	first_datasize += second_datasize;
-	first_hdr->ih_length= htons(first_hdr_size + first_datasize);
+	while (ass_ent->ia_frags != NULL)
+	{
+		pack= ass_ent->ia_frags;
+		ass_ent->ia_frags= pack->acc_ext_link;
+		bf_afree(pack);
+	}
+	ip_ass_bytes -= ass_ent->ia_size;
 
-	first= bf_append (first, cut_second);
-	first->acc_ext_link= second;
+	for (hash_ent= &ip_ass_hash[hash_ass(ass_ent->ia_srcaddr,
+		ass_ent->ia_dstaddr, ass_ent->ia_id, hash_tmp)];
+		*hash_ent != ass_ent; hash_ent= &(*hash_ent)->ia_hash_next)
+	{
+		assert(*hash_ent != NULL);
+	}
+	*hash_ent= ass_ent->ia_hash_next;
 
-assert (first_hdr_size + first_datasize == bf_bufsize(first));
+	if (ass_ent->ia_age_prev == NULL)
+		ip_ass_head= ass_ent->ia_age_next;
+	else
+		ass_ent->ia_age_prev->ia_age_next= ass_ent->ia_age_next;
+	if (ass_ent->ia_age_next == NULL)
+		ip_ass_tail= ass_ent->ia_age_prev;
+	else
+		ass_ent->ia_age_next->ia_age_prev= ass_ent->ia_age_prev;
 
-	return first;
+	ass_ent->ia_hash_next= ip_ass_free;
+	ip_ass_free= ass_ent;
+	ip_ass_inuse--;
 }
 
-PRIVATE ip_ass_t *find_ass_ent (ip_port, id, proto, src, dst)
-ip_port_t *ip_port;
-u16_t id;
-ipproto_t proto;
-ipaddr_t src;
-ipaddr_t dst;
+PRIVATE void ass_timeout (fd, timer)
+int fd;
+timer_t *timer;
 {
-	ip_ass_t *new_ass_ent, *tmp_ass_ent;
-	int i;
-	acc_t *tmp_acc, *curr_acc;
+	ip_ass_t *ass_ent;
+	acc_t *pack;
+	time_t curr_time;
+	int port_nr;
 
-	new_ass_ent= 0;
+	assert(timer == &ip_ass_timer);
 
-	for (i=0, tmp_ass_ent= ip_ass_table; i<IP_ASS_NR; i++,
-		tmp_ass_ent++)
+	curr_time= get_time();
+	while (ip_ass_head != NULL && ip_ass_head->ia_exp_time <= curr_time)
 	{
-		if (!tmp_ass_ent->ia_frags && tmp_ass_ent->ia_first_time)
-		{
-			DBLOCK(1,
-		printf("strange ip_ass entry (can be a race condition)\n"));
-			continue;
-		}
+		ass_ent= ip_ass_head;
+		ip_ass_timeout++;
 
-		if ((tmp_ass_ent->ia_srcaddr == src) &&
-			(tmp_ass_ent->ia_dstaddr == dst) &&
-			(tmp_ass_ent->ia_proto == proto) &&
-			(tmp_ass_ent->ia_id == id) &&
-			(tmp_ass_ent->ia_port == ip_port))
+		/* Tell the sender, if we have the first fragment. */
+		pack= ass_ent->ia_frags;
+		if (pack != NULL && frag_offset(pack) == 0)
 		{
-			return tmp_ass_ent;
+			ass_ent->ia_frags= pack->acc_ext_link;
+			pack->acc_ext_link= NULL;
 		}
-		if (!new_ass_ent || tmp_ass_ent->ia_first_time <
-			new_ass_ent->ia_first_time)
+		else
+			pack= NULL;
+		port_nr= ass_ent->ia_port->ip_port;
+		ass_drop(ass_ent);
+		if (pack != NULL)
 		{
-			new_ass_ent= tmp_ass_ent;
+			icmp_snd_time_exceeded(port_nr, pack,
+				ICMP_FRAG_REASSEM);
 		}
 	}
+	if (ip_ass_head != NULL)
+	{
+		clck_timer(&ip_ass_timer, ip_ass_head->ia_exp_time,
+			ass_timeout, 0);
+	}
+}
 
-	if (new_ass_ent->ia_frags)
+PUBLIC void ip_ass_buffree()
+{
+	while (ip_ass_head != NULL)
 	{
-		DBLOCK(1, printf("old frags id= %u, proto= %u, src= ",
-			ntohs(new_ass_ent->ia_id),
-			ntohs(new_ass_ent->ia_proto));
-			writeIpAddr(new_ass_ent->ia_srcaddr); printf(" dst= ");
-			writeIpAddr(new_ass_ent->ia_dstaddr); printf(": ");
-			ip_print_frags(new_ass_ent->ia_frags); printf("\n"));
-		curr_acc= new_ass_ent->ia_frags->acc_ext_link;
-		while (curr_acc)
-		{
-			tmp_acc= curr_acc->acc_ext_link;
-			bf_afree(curr_acc);
-			curr_acc= tmp_acc;
-		}
-		curr_acc= new_ass_ent->ia_frags;
-		new_ass_ent->ia_frags= 0;
-		icmp_snd_time_exceeded(ip_port->ip_port, curr_acc,
-			ICMP_FRAG_REASSEM);
-	}
-	new_ass_ent->ia_min_ttl= IP_MAX_TTL;
-	new_ass_ent->ia_port= ip_port;
-	new_ass_ent->ia_first_time= get_time();
-	new_ass_ent->ia_srcaddr= src;
-	new_ass_ent->ia_dstaddr= dst;
-	new_ass_ent->ia_proto= proto;
-	new_ass_ent->ia_id= id;
-
-	return new_ass_ent;
+		ip_ass_evict++;
+		ass_drop(ip_ass_head);
+	}
+}
+
+PUBLIC void ip_ass_bufcheck()
+{
+	ip_ass_t *ass_ent;
+	acc_t *pack;
+
+	for (ass_ent= ip_ass_head; ass_ent; ass_ent= ass_ent->ia_age_next)
+	{
+		for (pack= ass_ent->ia_frags; pack; pack= pack->acc_ext_link)
+			bf_check_acc(pack);
+	}
+}
+
+PUBLIC void ip_getstat(ipstat)
+nwio_ipstat_t *ipstat;
+{
+	ipstat->nwis_ass_nr= ip_ass_nr;
+	ipstat->nwis_ass_inuse= ip_ass_inuse;
+	ipstat->nwis_ass_max= ip_ass_max;
+	ipstat->nwis_ass_bytes= ip_ass_bytes;
+	ipstat->nwis_ass_frags= ip_ass_frags;
+	ipstat->nwis_ass_ok= ip_ass_ok;
+	ipstat->nwis_ass_timeout= ip_ass_timeout;
+	ipstat->nwis_ass_evict= ip_ass_evict;
+	ipstat->nwis_ass_overlap= ip_ass_overlap;
+	ipstat->nwis_ass_bad= ip_ass_bad;
 }
 
 PRIVATE int ip_frag_chk(pack)
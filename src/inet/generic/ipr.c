@@ -17,8 +17,7 @@ Copyright 1995 Philip Homburg
 
 THIS_FILE
 
-#define OROUTE_NR		32
-#define OROUTE_STATIC_NR	16
+#define OROUTE_STATIC_NR	(oroute_nr/2)
 #define OROUTE_HASH_ASS_NR	 4
 #define OROUTE_HASH_NR		32
 #define OROUTE_HASH_MASK	(OROUTE_HASH_NR-1)
@@ -35,12 +34,11 @@ typedef struct oroute_hash
 	oroute_t *orh_route;
 } oroute_hash_t;
 
-PRIVATE oroute_t oroute_table[OROUTE_NR];
-PRIVATE oroute_t *oroute_head;
+PRIVATE oroute_t *oroute_table;
+PRIVATE oroute_t *oroute_freelist;
 PRIVATE int static_oroute_nr;
 PRIVATE oroute_hash_t oroute_hash_table[OROUTE_HASH_NR][OROUTE_HASH_ASS_NR];
 
-#define IROUTE_NR		(sizeof(int) == 2 ? 64 : 512)
 #define IROUTE_HASH_ASS_NR	 4
 #define IROUTE_HASH_NR		32
 #define IROUTE_HASH_MASK	(IROUTE_HASH_NR-1)
@@ -57,34 +55,101 @@ typedef struct iroute_hash
 	iroute_t *irh_route;
 } iroute_hash_t;
 
-PRIVATE iroute_t iroute_table[IROUTE_NR];
+PRIVATE iroute_t *iroute_table;
+PRIVATE iroute_t *iroute_freelist;
 PRIVATE iroute_hash_t iroute_hash_table[IROUTE_HASH_NR][IROUTE_HASH_ASS_NR];
 
+/* Behind the caches, routes hang off a binary trie of network prefixes.
+ * There is a node for every network that has a route, and a node where
+ * the paths to two networks part.  A lookup follows the bits of the
+ * destination down from the root; the last node passed that has a route
+ * is the longest match.  Keys are in host byte order.  Every route adds
+ * at most two nodes, so the node table is sized from the route tables.
+ */
+typedef struct rtnode
+{
+	u32_t rn_key;
+	int rn_len;
+	struct rtnode *rn_parent;
+	struct rtnode *rn_child[2];
+	iroute_t *rn_iroute;
+	oroute_t *rn_oroute;
+} rtnode_t;
+
+#define rt_mask(len)		((len) == 0 ? (u32_t)0 : (u32_t)-1 << (32-(len)))
+#define rt_bit(key, len)	((int)((key) >> (31-(len))) & 1)
+
+PRIVATE rtnode_t *rtnode_table;
+PRIVATE rtnode_t *rtnode_freelist;
+PRIVATE int rtnode_nr;
+PRIVATE rtnode_t *rt_root;
+
 FORWARD oroute_t *oroute_find_ent ARGS(( int port_nr, ipaddr_t dest ));
 FORWARD void oroute_del ARGS(( oroute_t *oroute ));
+FORWARD void oroute_expire ARGS(( oroute_t *oroute ));
 FORWARD oroute_t *sort_dists ARGS(( oroute_t *oroute ));
 FORWARD oroute_t *sort_gws ARGS(( oroute_t *oroute ));
 FORWARD	oroute_uncache_nw ARGS(( ipaddr_t dest, ipaddr_t netmask ));
 FORWARD	iroute_uncache_nw ARGS(( ipaddr_t dest, ipaddr_t netmask ));
+FORWARD int rt_masklen ARGS(( ipaddr_t netmask ));
+FORWARD rtnode_t *rt_node ARGS(( ipaddr_t dest, int len, int create ));
+FORWARD rtnode_t *rt_alloc ARGS(( u32_t key, int len ));
+FORWARD void rt_prune ARGS(( rtnode_t *node ));
+
+PUBLIC void ipr_prep()
+{
+	if (iroute_nr > (size_t)-1 / sizeof(iroute_table[0]) ||
+		oroute_nr > (size_t)-1 / sizeof(oroute_table[0]) ||
+		iroute_nr + oroute_nr > (size_t)-1 / 2 / sizeof(rtnode_table[0]))
+	{
+		ip_panic(( "too many routes" ));
+	}
+
+	oroute_table= alloc(oroute_nr * sizeof(oroute_table[0]));
+	iroute_table= alloc(iroute_nr * sizeof(iroute_table[0]));
+	rtnode_nr= 2 * (iroute_nr + oroute_nr);
+	rtnode_table= alloc(rtnode_nr * sizeof(rtnode_table[0]));
+}
 
 PUBLIC void ipr_init()
 {
 	int i;
 	oroute_t *oroute;
 	iroute_t *iroute;
+	rtnode_t *rtnode;
 
 #if ZERO
-	for (i= 0, oroute= oroute_table; i<OROUTE_NR; i++, oroute++)
+	for (i= 0, oroute= oroute_table; i<oroute_nr; i++, oroute++)
 		oroute->ort_flags= ORTF_EMPTY;
 	static_oroute_nr= 0;
 #endif
 	assert(OROUTE_HASH_ASS_NR == 4);
 
 #if ZERO
-	for (i= 0, iroute= iroute_table; i<IROUTE_NR; i++, iroute++)
+	for (i= 0, iroute= iroute_table; i<iroute_nr; i++, iroute++)
 		iroute->irt_flags= IRTF_EMPTY;
+	rt_root= NULL;
 #endif
 	assert(IROUTE_HASH_ASS_NR == 4);
+
+	/* Hand out the entries in table order. */
+	for (i= oroute_nr-1; i >= 0; i--)
+	{
+		oroute= &oroute_table[i];
+		oroute->ort_nextnw= oroute_freelist;
+		oroute_freelist= oroute;
+	}
+	for (i= iroute_nr-1; i >= 0; i--)
+	{
+		iroute= &iroute_table[i];
+		iroute->irt_next= iroute_freelist;
+		iroute_freelist= iroute;
+	}
+	for (i= 0, rtnode= rtnode_table; i<rtnode_nr; i++, rtnode++)
+	{
+		rtnode->rn_child[0]= rtnode_freelist;
+		rtnode_freelist= rtnode;
+	}
 }
 
 
@@ -92,10 +157,12 @@ PUBLIC iroute_t *iroute_frag(port_nr, dest)
 int port_nr;
 ipaddr_t dest;
 {
-	int hash, i, r_hash_ind;
+	int hash, r_hash_ind;
 	iroute_hash_t *iroute_hash;
 	iroute_hash_t tmp_hash;
 	iroute_t *iroute, *bestroute;
+	rtnode_t *node, *bestnode;
+	u32_t key;
 	time_t currtim;
 	unsigned long hash_tmp;
 
@@ -134,30 +201,30 @@ ipaddr_t dest;
 	if (iroute)
 		return iroute;
 
+	/* All routes of the longest matching network have the same mask. */
+	bestnode= NULL;
+	key= ntohl(dest);
+	for (node= rt_root; node; node= node->rn_child[rt_bit(key, node->rn_len)])
+	{
+		if (((key ^ node->rn_key) & rt_mask(node->rn_len)) != 0)
+			break;
+		if (node->rn_iroute != NULL)
+			bestnode= node;
+		if (node->rn_len == 32)
+			break;
+	}
+	if (bestnode == NULL)
+		return NULL;
+
 	bestroute= NULL;
-	for (i= 0, iroute= iroute_table; i < IROUTE_NR; i++, iroute++)
+	for (iroute= bestnode->rn_iroute; iroute; iroute= iroute->irt_next)
 	{
-		if (!(iroute->irt_flags & IRTF_INUSE))
-			continue;
-		if (((dest ^ iroute->irt_dest) & iroute->irt_subnetmask) != 0)
-			continue;
 		if (!bestroute)
 		{
 			bestroute= iroute;
 			continue;
 		}
 
-		/* More specific netmasks are better */
-		if (iroute->irt_subnetmask != bestroute->irt_subnetmask)
-		{
-			if (ntohl(iroute->irt_subnetmask) > 
-				ntohl(bestroute->irt_subnetmask))
-			{
-				bestroute= iroute;
-			}
-			continue;
-		}
-			
 		/* Dynamic routes override static routes */
 		if ((iroute->irt_flags & IRTF_STATIC) != 
 			(bestroute->irt_flags & IRTF_STATIC))
@@ -218,10 +285,11 @@ int static_route;
 i32_t preference;
 oroute_t **oroute_p;
 {
-	int i;
+	int i, len;
 	ip_port_t *ip_port;
 	oroute_t *oroute, *oldest_route, *prev, *nw_route, *gw_route, 
 		*prev_route;
+	rtnode_t *node;
 	time_t currtim;
 
 	oldest_route= 0;
@@ -243,6 +311,13 @@ oroute_t **oroute_p;
 		return EINVAL;
 	}
 
+	len= rt_masklen(subnetmask);
+	if (len == -1)
+	{
+		DBLOCK(2, printf("ipr_add_oroute: invalid netmask: "); writeIpAddr(subnetmask); printf("\n"));
+		return EINVAL;
+	}
+
 	if (static_route)
 	{
 		if (static_oroute_nr >= OROUTE_STATIC_NR)
@@ -252,7 +327,9 @@ oroute_t **oroute_p;
 	else
 	{
 		/* Try to track down any old routes. */
-		for(oroute= oroute_head; oroute; oroute= oroute->ort_nextnw)
+		node= rt_node(dest, len, FALSE);
+		oroute= (node != NULL) ? node->rn_oroute : NULL;
+		for(; oroute; oroute= oroute->ort_nextnw)
 		{
 			if (oroute->ort_port != port_nr)
 				continue;
@@ -297,13 +374,16 @@ oroute_t **oroute_p;
 		}
 	}
 
+	if (oldest_route == NULL && oroute_freelist != NULL)
+	{
+		oldest_route= oroute_freelist;
+		oroute_freelist= oldest_route->ort_nextnw;
+	}
 	if (oldest_route == NULL)
 	{
-		/* Look for an unused entry, or remove an existing one */
-		for (i= 0, oroute= oroute_table; i<OROUTE_NR; i++, oroute++)
+		/* All entries are in use, remove an existing one */
+		for (i= 0, oroute= oroute_table; i<oroute_nr; i++, oroute++)
 		{
-			if ((oroute->ort_flags & ORTF_INUSE) == 0)
-				break;
 			if (oroute->ort_exp_tim && oroute->ort_exp_tim < 
 				currtim)
 			{
@@ -328,7 +408,7 @@ oroute_t **oroute_p;
 				oldest_route= oroute;
 			}
 		}
-		if (i < OROUTE_NR)
+		if (i < oroute_nr)
 			oldest_route= oroute;
 		else
 		{
@@ -354,9 +434,11 @@ oroute_t **oroute_p;
 		oldest_route->ort_flags |= ORTF_STATIC;
 	
 	/* Insert the route by tearing apart the routing table, 
-	 * and insert the entry during the reconstruction.
+	 * and insert the entry during the reconstruction.  Removing
+	 * routes above may have taken the network out of the trie.
 	 */
-	for (prev= 0, nw_route= oroute_head; nw_route; 
+	node= rt_node(dest, len, TRUE);
+	for (prev= 0, nw_route= node->rn_oroute; nw_route; 
 				prev= nw_route, nw_route= nw_route->ort_nextnw)
 	{
 		if (nw_route->ort_port != port_nr)
@@ -367,7 +449,7 @@ oroute_t **oroute_p;
 			if (prev)
 				prev->ort_nextnw= nw_route->ort_nextnw;
 			else
-				oroute_head= nw_route->ort_nextnw;
+				node->rn_oroute= nw_route->ort_nextnw;
 			break;
 		}
 	}
@@ -390,8 +472,8 @@ oroute_t **oroute_p;
 	gw_route->ort_nextgw= nw_route;
 	nw_route= gw_route;
 	nw_route= sort_gws(nw_route);
-	nw_route->ort_nextnw= oroute_head;
-	oroute_head= nw_route;
+	nw_route->ort_nextnw= node->rn_oroute;
+	node->rn_oroute= nw_route;
 	if (nw_route != prev_route)
 		oroute_uncache_nw(nw_route->ort_dest, nw_route->ort_subnetmask);
 	if (oroute_p != NULL)
@@ -411,7 +493,7 @@ time_t timeout;
 	int result;
 
 	currtim= get_time();
-	for (i= 0, route_ind= oroute_table; i<OROUTE_NR; i++, route_ind++)
+	for (i= 0, route_ind= oroute_table; i<oroute_nr; i++, route_ind++)
 	{
 		if (!(route_ind->ort_flags & ORTF_INUSE))
 			continue;
@@ -547,19 +629,18 @@ nwio_route_t *route_ent;
 {
 	oroute_t *oroute;
 
-	if (ent_no<0 || ent_no>= OROUTE_NR)
+	if (ent_no<0 || ent_no>= oroute_nr)
 		return ENOENT;
 
 	oroute= &oroute_table[ent_no];
 	if ((oroute->ort_flags & ORTF_INUSE) && oroute->ort_exp_tim &&
 					oroute->ort_exp_tim < get_time())
 	{
-		oroute_del(oroute);
-		oroute->ort_flags &= ~ORTF_INUSE;
+		oroute_expire(oroute);
 	}
 
 	route_ent->nwr_ent_no= ent_no;
-	route_ent->nwr_ent_count= OROUTE_NR;
+	route_ent->nwr_ent_count= oroute_nr;
 	route_ent->nwr_dest= oroute->ort_dest;
 	route_ent->nwr_netmask= oroute->ort_subnetmask;
 	route_ent->nwr_gateway= oroute->ort_gateway;
@@ -585,6 +666,8 @@ ipaddr_t dest;
 	oroute_hash_t *oroute_hash;
 	oroute_hash_t tmp_hash;
 	oroute_t *oroute, *bestroute;
+	rtnode_t *node;
+	u32_t key;
 	time_t currtim;
 	unsigned long hash_tmp;
 
@@ -624,33 +707,30 @@ ipaddr_t dest;
 	{
 		assert(oroute->ort_port == port_nr);
 		if (oroute->ort_exp_tim && oroute->ort_exp_tim<currtim)
-		{
-			oroute_del(oroute);
-			oroute->ort_flags &= ~ORTF_INUSE;
-		}
+			oroute_expire(oroute);
 		else
 			return oroute;
 	}
 
+	/* The first route of a network is the best one, look for the
+	 * longest matching network with a route on this port.
+	 */
 	bestroute= NULL;
-	for (oroute= oroute_head; oroute; oroute= oroute->ort_nextnw)
+	key= ntohl(dest);
+	for (node= rt_root; node; node= node->rn_child[rt_bit(key, node->rn_len)])
 	{
-		if (((dest ^ oroute->ort_dest) & oroute->ort_subnetmask) != 0)
-			continue;
-		if (oroute->ort_port != port_nr)
-			continue;
-		if (!bestroute)
-		{
-			bestroute= oroute;
-			continue;
-		}
-		assert(oroute->ort_dest != bestroute->ort_dest);
-		if (ntohl(oroute->ort_subnetmask) > 
-			ntohl(bestroute->ort_subnetmask))
+		if (((key ^ node->rn_key) & rt_mask(node->rn_len)) != 0)
+			break;
+		for (oroute= node->rn_oroute; oroute; oroute= oroute->ort_nextnw)
 		{
-			bestroute= oroute;
-			continue;
+			if (oroute->ort_port == port_nr)
+			{
+				bestroute= oroute;
+				break;
+			}
 		}
+		if (node->rn_len == 32)
+			break;
 	}
 	if (bestroute == NULL)
 		return NULL;
@@ -669,8 +749,12 @@ PRIVATE void oroute_del(oroute)
 oroute_t *oroute;
 {
 	oroute_t *prev, *nw_route, *gw_route, *dist_route, *prev_route;
+	rtnode_t *node;
 
-	for (prev= NULL, nw_route= oroute_head; nw_route; 
+	node= rt_node(oroute->ort_dest, rt_masklen(oroute->ort_subnetmask),
+		FALSE);
+	assert(node);
+	for (prev= NULL, nw_route= node->rn_oroute; nw_route; 
 				prev= nw_route, nw_route= nw_route->ort_nextnw)
 	{
 		if (oroute->ort_port == nw_route->ort_port &&
@@ -684,7 +768,7 @@ oroute_t *oroute;
 	if (prev)
 		prev->ort_nextnw= nw_route->ort_nextnw;
 	else
-		oroute_head= nw_route->ort_nextnw;
+		node->rn_oroute= nw_route->ort_nextnw;
 	prev_route= nw_route;
 	for (prev= NULL, gw_route= nw_route; gw_route; 
 				prev= gw_route, gw_route= gw_route->ort_nextgw)
@@ -717,14 +801,25 @@ oroute_t *oroute;
 	nw_route= sort_gws(nw_route);
 	if (nw_route != NULL)
 	{
-		nw_route->ort_nextnw= oroute_head;
-		oroute_head= nw_route;
+		nw_route->ort_nextnw= node->rn_oroute;
+		node->rn_oroute= nw_route;
 	}
 	if (nw_route != prev_route)
 	{
 		oroute_uncache_nw(prev_route->ort_dest, 
 			prev_route->ort_subnetmask);
 	}
+	rt_prune(node);
+}
+
+
+PRIVATE void oroute_expire(oroute)
+oroute_t *oroute;
+{
+	oroute_del(oroute);
+	oroute->ort_flags= ORTF_EMPTY;
+	oroute->ort_nextnw= oroute_freelist;
+	oroute_freelist= oroute;
 }
 
 
@@ -844,12 +939,12 @@ nwio_route_t *route_ent;
 {
 	iroute_t *iroute;
 
-	if (ent_no<0 || ent_no>= IROUTE_NR)
+	if (ent_no<0 || ent_no>= iroute_nr)
 		return ENOENT;
 
 	iroute= &iroute_table[ent_no];
 
-	route_ent->nwr_ent_count= IROUTE_NR;
+	route_ent->nwr_ent_count= iroute_nr;
 	route_ent->nwr_dest= iroute->irt_dest;
 	route_ent->nwr_netmask= iroute->irt_subnetmask;
 	route_ent->nwr_gateway= iroute->irt_gateway;
@@ -879,53 +974,47 @@ int dist;
 int static_route;
 iroute_t **iroute_p;
 {
-	int i;
-	iroute_t *iroute, *unused_route;
+	int len;
+	iroute_t *iroute;
+	rtnode_t *node;
 
-	unused_route= NULL;
-	if (static_route)
-	{
-		/* Static routes are not reused automatically, so we look 
-		 * for an unused entry.
-		 */
-		for(i= 0, iroute= iroute_table; i<IROUTE_NR; i++, iroute++)
-		{
-			if ((iroute->irt_flags & IRTF_INUSE) == 0)
-				break;
-		}
-		if (i != IROUTE_NR)
-			unused_route= iroute;
-	}
-	else
+	len= rt_masklen(subnetmask);
+	if (len == -1)
+		return EINVAL;
+
+	iroute= NULL;
+	if (!static_route)
 	{
-		/* Try to track down any old routes, and look for an
-		 * unused one.
-		 */
-		for(i= 0, iroute= iroute_table; i<IROUTE_NR; i++, iroute++)
+		/* Try to track down an old route. */
+		node= rt_node(dest, len, FALSE);
+		iroute= (node != NULL) ? node->rn_iroute : NULL;
+		for(; iroute; iroute= iroute->irt_next)
 		{
-			if ((iroute->irt_flags & IRTF_INUSE) == 0)
-			{
-				unused_route= iroute;
-				continue;
-			}
 			if ((iroute->irt_flags & IRTF_STATIC) != 0)
 				continue;
 			if (iroute->irt_port != port_nr ||
 				iroute->irt_dest != dest ||
-				iroute->irt_subnetmask != subnetmask ||
 				iroute->irt_gateway != gateway)
 			{
 				continue;
 			}
 			break;
 		}
-		if (i != IROUTE_NR)
-			unused_route= iroute;
 	}
+	if (iroute == NULL)
+	{
+		/* Static routes are not reused automatically, so they
+		 * always get an unused entry.
+		 */
+		iroute= iroute_freelist;
+		if (iroute == NULL)
+			return ENOMEM;
+		iroute_freelist= iroute->irt_next;
 
-	if (unused_route == NULL)
-		return ENOMEM;
-	iroute= unused_route;
+		node= rt_node(dest, len, TRUE);
+		iroute->irt_next= node->rn_iroute;
+		node->rn_iroute= iroute;
+	}
 
 	iroute->irt_port= port_nr;
 	iroute->irt_dest= dest;
@@ -952,19 +1041,22 @@ ipaddr_t gateway;
 int dist;
 int static_route;
 {
-	int i;
-	iroute_t *iroute;
+	int len;
+	iroute_t *iroute, *prev;
+	rtnode_t *node;
 
-	/* Try to track down any old routes, and look for an
-	 * unused one.
-	 */
-	for(i= 0, iroute= iroute_table; i<IROUTE_NR; i++, iroute++)
+	len= rt_masklen(subnetmask);
+	if (len == -1)
+		return ESRCH;
+	node= rt_node(dest, len, FALSE);
+	if (node == NULL)
+		return ESRCH;
+
+	for(prev= NULL, iroute= node->rn_iroute; iroute; 
+				prev= iroute, iroute= iroute->irt_next)
 	{
-		if ((iroute->irt_flags & IRTF_INUSE) == 0)
-			continue;
 		if (iroute->irt_port != port_nr ||
 			iroute->irt_dest != dest ||
-			iroute->irt_subnetmask != subnetmask ||
 			iroute->irt_gateway != gateway)
 		{
 			continue;
@@ -974,11 +1066,18 @@ int static_route;
 		break;
 	}
 
-	if (i == IROUTE_NR)
+	if (iroute == NULL)
 		return ESRCH;
 
+	if (prev)
+		prev->irt_next= iroute->irt_next;
+	else
+		node->rn_iroute= iroute->irt_next;
 	iroute_uncache_nw(iroute->irt_dest, iroute->irt_subnetmask);
 	iroute->irt_flags= IRTF_EMPTY;
+	iroute->irt_next= iroute_freelist;
+	iroute_freelist= iroute;
+	rt_prune(node);
 	return NW_OK;
 }
 
@@ -1006,6 +1105,150 @@ ipaddr_t netmask;
 }
 
 
+/*
+ * Route trie
+ */
+
+PRIVATE int rt_masklen(netmask)
+ipaddr_t netmask;
+{
+	u32_t mask, bits;
+	int len;
+
+	/* Only masks of contiguous ones from the left make a prefix. */
+	mask= ntohl(netmask);
+	bits= ~mask;
+	if (bits & (bits+1))
+		return -1;
+	for (len= 0; mask != 0; len++)
+		mask <<= 1;
+	return len;
+}
+
+
+PRIVATE rtnode_t *rt_node(dest, len, create)
+ipaddr_t dest;
+int len;
+int create;
+{
+	rtnode_t *node, *parent, *new_node, *glue;
+	rtnode_t **nodep;
+	u32_t key, diff;
+	int i;
+
+	key= ntohl(dest) & rt_mask(len);
+	parent= NULL;
+	nodep= &rt_root;
+	while ((node= *nodep) != NULL)
+	{
+		if (node->rn_len > len ||
+			((key ^ node->rn_key) & rt_mask(node->rn_len)) != 0)
+		{
+			break;
+		}
+		if (node->rn_len == len)
+			return node;
+		parent= node;
+		nodep= &node->rn_child[rt_bit(key, node->rn_len)];
+	}
+	if (!create)
+		return NULL;
+
+	new_node= rt_alloc(key, len);
+	if (node == NULL)
+	{
+		new_node->rn_parent= parent;
+		*nodep= new_node;
+		return new_node;
+	}
+
+	/* Something else is in the way, find where the paths part. */
+	diff= key ^ node->rn_key;
+	for (i= 0; i<len && i<node->rn_len; i++)
+	{
+		if (rt_bit(diff, i))
+			break;
+	}
+	if (i == len)
+	{
+		/* The new network contains the one in the way. */
+		new_node->rn_child[rt_bit(node->rn_key, len)]= node;
+		node->rn_parent= new_node;
+		new_node->rn_parent= parent;
+		*nodep= new_node;
+		return new_node;
+	}
+	glue= rt_alloc(key & rt_mask(i), i);
+	glue->rn_child[rt_bit(key, i)]= new_node;
+	glue->rn_child[rt_bit(node->rn_key, i)]= node;
+	new_node->rn_parent= glue;
+	node->rn_parent= glue;
+	glue->rn_parent= parent;
+	*nodep= glue;
+	return new_node;
+}
+
+
+PRIVATE rtnode_t *rt_alloc(key, len)
+u32_t key;
+int len;
+{
+	rtnode_t *node;
+
+	node= rtnode_freelist;
+	if (node == NULL)
+		ip_panic(( "out of route trie nodes" ));
+	rtnode_freelist= node->rn_child[0];
+
+	node->rn_key= key;
+	node->rn_len= len;
+	node->rn_parent= NULL;
+	node->rn_child[0]= NULL;
+	node->rn_child[1]= NULL;
+	node->rn_iroute= NULL;
+	node->rn_oroute= NULL;
+	return node;
+}
+
+
+PRIVATE void rt_prune(node)
+rtnode_t *node;
+{
+	rtnode_t *parent, *child;
+	rtnode_t **nodep;
+
+	/* Remove nodes without routes that no longer split the trie,
+	 * working up from 'node'.
+	 */
+	while (node != NULL && node->rn_iroute == NULL &&
+		node->rn_oroute == NULL)
+	{
+		if (node->rn_child[0] != NULL && node->rn_child[1] != NULL)
+			break;
+		child= node->rn_child[0];
+		if (child == NULL)
+			child= node->rn_child[1];
+		parent= node->rn_parent;
+		if (parent == NULL)
+			nodep= &rt_root;
+		else if (parent->rn_child[0] == node)
+			nodep= &parent->rn_child[0];
+		else
+			nodep= &parent->rn_child[1];
+		*nodep= child;
+		if (child != NULL)
+			child->rn_parent= parent;
+
+		node->rn_child[0]= rtnode_freelist;
+		rtnode_freelist= node;
+
+		/* The parent still splits if the child took our place. */
+		if (child != NULL)
+			break;
+		node= parent;
+	}
+}
+
 
 /*
  * Debugging, management
@@ -38,6 +38,8 @@ typedef struct iroute
 	int irt_dist;
 	int irt_port;
 	int irt_flags;
+
+	struct iroute *irt_next;
 } iroute_t;
 
 #define IRTD_UNREACHABLE	512
@@ -56,6 +58,7 @@ typedef struct iroute
 iroute_t *iroute_frag ARGS(( int port_nr, ipaddr_t dest ));
 int oroute_frag ARGS(( int port_nr, ipaddr_t dest, int ttl, 
 							ipaddr_t *nexthop ));
+void ipr_prep ARGS(( void ));
 void ipr_init ARGS(( void ));
 int ipr_get_iroute ARGS(( int ent_no, nwio_route_t *route_ent ));
 int ipr_add_iroute ARGS(( int port_nr, ipaddr_t dest, ipaddr_t subnetmask, 
@@ -11,6 +11,7 @@ Copyright 1995 Philip Homburg
 #include "inet.h"
 #include "assert.h"
 #include "buf.h"
+#include "clock.h"
 #include "event.h"
 #include "type.h"
 #include "ip_int.h"
@@ -30,6 +31,9 @@ typedef struct psip_port
 	struct psip_fd *pp_rd_tail;
 	acc_t *pp_promisc_head;
 	acc_t *pp_promisc_tail;
+	acc_t *pp_delay_head;
+	acc_t *pp_delay_tail;
+	struct timer pp_delay_timer;
 } psip_port_t;
 
 #define PPF_EMPTY	0
@@ -69,10 +73,12 @@ FORWARD void psip_close ARGS(( int fd ));
 FORWARD int psip_cancel ARGS(( int fd, int which_operation ));
 FORWARD void promisc_restart_read ARGS(( psip_port_t *psip_port ));
 FORWARD int psip_setopt ARGS(( psip_fd_t *psip_fd, nwio_psipopt_t *newoptp ));
+FORWARD void psip_delay ARGS(( psip_port_t *psip_port, acc_t *pack,
+	time_t delay ));
+FORWARD void psip_delay_timeout ARGS(( int port_nr, struct timer *timer ));
+FORWARD int psip_drop ARGS(( unsigned long drop ));
 FORWARD void psip_buffree ARGS(( int priority ));
-#ifdef BUF_CONSISTENCY_CHECK
 FORWARD void psip_bufcheck ARGS(( void ));
-#endif
 FORWARD void reply_thr_put ARGS(( psip_fd_t *psip_fd, int reply,
 	int for_ioctl ));
 FORWARD void reply_thr_get ARGS(( psip_fd_t *psip_fd, int reply,
@@ -104,14 +110,11 @@ PUBLIC void psip_init()
 		psip_port->pp_opencnt= 0;
 		psip_port->pp_rd_head= NULL;
 		psip_port->pp_promisc_head= NULL;
+		psip_port->pp_delay_head= NULL;
 #endif
 	}
 
-#ifndef BUF_CONSISTENCY_CHECK
-	bf_logon(psip_buffree);
-#else
-	bf_logon(psip_buffree, psip_bufcheck);
-#endif
+	bf_logon("psip", psip_buffree, psip_bufcheck);
 }
 
 PUBLIC int psip_enable(port_nr, ip_port_nr)
@@ -260,6 +263,9 @@ put_pkt_t put_pkt;
 	psip_fd->pf_port= psip_port;
 	psip_fd->pf_get_userdata= get_userdata;
 	psip_fd->pf_put_userdata= put_userdata;
+	psip_fd->pf_psipopt.nwpo_flags= 0;
+	psip_fd->pf_psipopt.nwpo_delay= 0;
+	psip_fd->pf_psipopt.nwpo_drop= 0;
 	psip_port->pp_opencnt++;
 
 	return i;
@@ -400,7 +406,19 @@ size_t count;
 				promisc_restart_read(psip_port);
 		}
 	}
-	ipps_put(psip_port->pp_ipdev, pack);
+	if ((psip_fd->pf_psipopt.nwpo_flags & NWPO_EN_DROP) &&
+		psip_drop(psip_fd->pf_psipopt.nwpo_drop))
+	{
+		bf_afree(pack);
+	}
+	else if ((psip_fd->pf_psipopt.nwpo_flags & NWPO_EN_DELAY) &&
+		psip_fd->pf_psipopt.nwpo_delay != 0)
+	{
+		psip_delay(psip_port, pack,
+			(time_t)psip_fd->pf_psipopt.nwpo_delay);
+	}
+	else
+		ipps_put(psip_port->pp_ipdev, pack);
 	pack= (*psip_fd->pf_get_userdata)(psip_fd->pf_srfd, (size_t)count,
 		(size_t)0, FALSE);
 	assert(pack == NULL);
@@ -592,6 +610,28 @@ nwio_psipopt_t *newoptp;
 		new_di_flags |= (old_di_flags & NWPO_PROMISC_MASK);
 	}
 
+	/* NWPO_DELAY_MASK */
+	if (!((new_en_flags | new_di_flags) & NWPO_DELAY_MASK))
+	{
+		new_en_flags |= (old_en_flags & NWPO_DELAY_MASK);
+		new_di_flags |= (old_di_flags & NWPO_DELAY_MASK);
+		newoptp->nwpo_delay= oldopt.nwpo_delay;
+	}
+	else if (new_di_flags & NWPO_DELAY_MASK)
+		newoptp->nwpo_delay= 0;
+
+	/* NWPO_DROP_MASK */
+	if (!((new_en_flags | new_di_flags) & NWPO_DROP_MASK))
+	{
+		new_en_flags |= (old_en_flags & NWPO_DROP_MASK);
+		new_di_flags |= (old_di_flags & NWPO_DROP_MASK);
+		newoptp->nwpo_drop= oldopt.nwpo_drop;
+	}
+	else if (new_di_flags & NWPO_DROP_MASK)
+		newoptp->nwpo_drop= 0;
+	else if (newoptp->nwpo_drop > 1000)
+		return EBADMODE;
+
 	new_flags= ((unsigned long)new_di_flags << 16) | new_en_flags;
 
 	psip_fd->pf_psipopt= *newoptp;
@@ -600,6 +640,83 @@ nwio_psipopt_t *newoptp;
 	return NW_OK;
 }
 
+/*
+psip_delay
+
+Hold a packet written by the user for 'delay' ticks before IP gets it.
+Together with a process that sends the packets back, this gives a link
+with a round trip time that can be set for testing.
+*/
+
+PRIVATE void psip_delay(psip_port, pack, delay)
+psip_port_t *psip_port;
+acc_t *pack;
+time_t delay;
+{
+	acc_t *hdr_pack;
+	time_t due;
+
+	due= get_time() + delay;
+	hdr_pack= bf_memreq(sizeof(due));
+	*(time_t *)ptr2acc_data(hdr_pack)= due;
+	hdr_pack->acc_next= pack;
+	hdr_pack->acc_ext_link= NULL;
+	if (psip_port->pp_delay_head == NULL)
+	{
+		psip_port->pp_delay_head= hdr_pack;
+		clck_timer(&psip_port->pp_delay_timer, due,
+			psip_delay_timeout,
+			(int)(psip_port-psip_port_table));
+	}
+	else
+		psip_port->pp_delay_tail->acc_ext_link= hdr_pack;
+	psip_port->pp_delay_tail= hdr_pack;
+}
+
+PRIVATE void psip_delay_timeout(port_nr, timer)
+int port_nr;
+struct timer *timer;
+{
+	psip_port_t *psip_port;
+	acc_t *hdr_pack, *pack;
+	time_t curr_time, due;
+
+	assert(port_nr >= 0 && port_nr < psip_conf_nr);
+	psip_port= &psip_port_table[port_nr];
+	assert(timer == &psip_port->pp_delay_timer);
+
+	curr_time= get_time();
+	while ((hdr_pack= psip_port->pp_delay_head) != NULL)
+	{
+		due= *(time_t *)ptr2acc_data(hdr_pack);
+		if (due > curr_time)
+		{
+			clck_timer(&psip_port->pp_delay_timer, due,
+				psip_delay_timeout, port_nr);
+			return;
+		}
+		psip_port->pp_delay_head= hdr_pack->acc_ext_link;
+		pack= bf_delhead(hdr_pack, sizeof(due));
+		ipps_put(psip_port->pp_ipdev, pack);
+	}
+}
+
+/*
+psip_drop
+
+Decide whether a written packet gets lost, 'drop' times in 1000.  The
+generator only has to be cheap and spread the losses, not be unpredictable.
+*/
+
+PRIVATE int psip_drop(drop)
+unsigned long drop;
+{
+	static u32_t seed= 1;
+
+	seed= seed * 1103515245L + 12345;
+	return ((seed >> 16) & 0x7fff) % 1000 < drop;
+}
+
 PRIVATE void psip_buffree (priority)
 int priority;
 {
@@ -625,11 +742,22 @@ int priority;
 				}
 				psip_port->pp_promisc_head= NULL;
 			}
+			if (psip_port->pp_delay_head)
+			{
+				clck_untimer(&psip_port->pp_delay_timer);
+				tmp_acc= psip_port->pp_delay_head;
+				while(tmp_acc)
+				{
+					next_acc= tmp_acc->acc_ext_link;
+					bf_afree(tmp_acc);
+					tmp_acc= next_acc;
+				}
+				psip_port->pp_delay_head= NULL;
+			}
 		}
 	}
 }
 
-#ifdef BUF_CONSISTENCY_CHECK
 PRIVATE void psip_bufcheck()
 {
 	int i;
@@ -644,9 +772,13 @@ PRIVATE void psip_bufcheck()
 		{
 			bf_check_acc(tmp_acc);
 		}
+		for (tmp_acc= psip_port->pp_delay_head; tmp_acc; 
+			tmp_acc= tmp_acc->acc_ext_link)
+		{
+			bf_check_acc(tmp_acc);
+		}
 	}
 }
-#endif
 
 /*
 reply_thr_put
@@ -28,6 +28,7 @@ typedef int (*sr_write_t) ARGS(( int fd, size_t count ));
 typedef int  (*sr_ioctl_t) ARGS(( int fd, ioreq_t req ));
 typedef int  (*sr_cancel_t) ARGS(( int fd, int which_operation ));
 
+void sr_prep ARGS(( void ));
 void sr_init ARGS(( void  ));
 void sr_add_minor ARGS(( int minor, int port, sr_open_t openf,
 	sr_close_t closef, sr_read_t sr_read, sr_write_t sr_write,
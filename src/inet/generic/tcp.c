@@ -22,8 +22,13 @@ Copyright 1995 Philip Homburg
 THIS_FILE
 
 PUBLIC tcp_port_t *tcp_port_table;
-PUBLIC tcp_fd_t tcp_fd_table[TCP_FD_NR];
-PUBLIC tcp_conn_t tcp_conn_table[TCP_CONN_NR];
+PUBLIC tcp_fd_t *tcp_fd_table;
+PUBLIC tcp_conn_t *tcp_conn_table;
+
+/* Connections are found by a hash of their addresses and ports. */
+PRIVATE tcp_conn_t **tcp_conn_hash;
+PRIVATE int tcp_conn_hash_nr;		/* A power of 2 */
+PRIVATE u16_t tcp_next_port;		/* where find_unused_port goes on */
 
 FORWARD void tcp_main ARGS(( tcp_port_t *port ));
 FORWARD acc_t *tcp_get_data ARGS(( int fd, size_t offset,
@@ -45,6 +50,8 @@ FORWARD void reply_thr_get ARGS(( tcp_fd_t *tcp_fd, int reply,
 FORWARD tcp_conn_t *find_conn_entry ARGS(( Tcpport_t locport,
 	ipaddr_t locaddr, Tcpport_t remport, ipaddr_t readaddr ));
 FORWARD tcp_conn_t *find_empty_conn ARGS(( void ));
+FORWARD int conn_hash ARGS(( ipaddr_t locaddr, Tcpport_t locport,
+	ipaddr_t remaddr, Tcpport_t remport ));
 FORWARD tcp_conn_t *find_best_conn ARGS(( ip_hdr_t *ip_hdr, 
 	tcp_hdr_t *tcp_hdr ));
 FORWARD int maybe_listen ARGS(( ipaddr_t locaddr, Tcpport_t locport,
@@ -52,19 +59,29 @@ FORWARD int maybe_listen ARGS(( ipaddr_t locaddr, Tcpport_t locport,
 FORWARD int conn_right4fd ARGS(( tcp_conn_t *tcp_conn, tcp_fd_t *tcp_fd ));
 FORWARD int tcp_su4connect ARGS(( tcp_fd_t *tcp_fd ));
 FORWARD void tcp_buffree ARGS(( int priority ));
-#ifdef BUF_CONSISTENCY_CHECK
 FORWARD void tcp_bufcheck ARGS(( void ));
-#endif
 FORWARD void tcp_setup_conn ARGS(( tcp_conn_t *tcp_conn ));
+FORWARD void tcp_set_bufsiz ARGS(( tcp_conn_t *tcp_conn, tcp_fd_t *tcp_fd ));
 
 PUBLIC void tcp_prep()
 {
+	if (tcp_conn_nr > (size_t)-1 / sizeof(tcp_conn_table[0]))
+		ip_panic(( "too many TCP connections" ));
+
 	tcp_port_table= alloc(ip_conf_nr * sizeof(tcp_port_table[0]));
+	tcp_fd_table= alloc(tcp_fd_nr * sizeof(tcp_fd_table[0]));
+	tcp_conn_table= alloc(tcp_conn_nr * sizeof(tcp_conn_table[0]));
+
+	/* About one connection per hash chain. */
+	tcp_conn_hash_nr= 1;
+	while (tcp_conn_hash_nr < tcp_conn_nr)
+		tcp_conn_hash_nr <<= 1;
+	tcp_conn_hash= alloc(tcp_conn_hash_nr * sizeof(tcp_conn_hash[0]));
 }
 
 PUBLIC void tcp_init()
 {
-	int i, j, k;
+	int i;
 	tcp_fd_t *tcp_fd;
 	tcp_port_t *tcp_port;
 	tcp_conn_t *tcp_conn;
@@ -75,24 +92,23 @@ PUBLIC void tcp_init()
 	assert (BUF_S >= IP_MAX_HDR_SIZE + TCP_MAX_HDR_SIZE);
 
 #if ZERO
-	for (i=0, tcp_fd= tcp_fd_table; i<TCP_FD_NR; i++, tcp_fd++)
+	for (i=0, tcp_fd= tcp_fd_table; i<tcp_fd_nr; i++, tcp_fd++)
 	{
 		tcp_fd->tf_flags= TFF_EMPTY;
 	}
 
-	for (i=0, tcp_conn= tcp_conn_table; i<TCP_CONN_NR; i++,
+	for (i=0, tcp_conn= tcp_conn_table; i<tcp_conn_nr; i++,
 		tcp_fd++)
 	{
 		tcp_conn->tc_flags= TCF_EMPTY;
 		tcp_conn->tc_busy= 0;
+		tcp_conn->tc_hash_prev= NULL;
 	}
+	for (i= 0; i<tcp_conn_hash_nr; i++)
+		tcp_conn_hash[i]= NULL;
 #endif
 
-#ifndef BUF_CONSISTENCY_CHECK
-	bf_logon(tcp_buffree);
-#else
-	bf_logon(tcp_buffree, tcp_bufcheck);
-#endif
+	bf_logon("tcp", tcp_buffree, tcp_bufcheck);
 
 	for (i=0, tcp_port= tcp_port_table; i<ip_conf_nr; i++, tcp_port++)
 	{
@@ -105,14 +121,6 @@ PUBLIC void tcp_init()
 		tcp_port->tp_snd_tail= NULL;
 		ev_init(&tcp_port->tp_snd_event);
 #endif
-		for (j= 0; j<TCP_CONN_HASH_NR; j++)
-		{
-			for (k= 0; k<4; k++)
-			{
-				tcp_port->tp_conn_hash[j][k]=
-					&tcp_conn_table[0];
-			}
-		}
 
 		sr_add_minor(if2minor(ip_conf[i].ic_ifno, TCP_DEV_OFF),
 			i, tcp_open, tcp_close, tcp_read,
@@ -125,7 +133,7 @@ PUBLIC void tcp_init()
 PRIVATE void tcp_main(tcp_port)
 tcp_port_t *tcp_port;
 {
-	int result, i;
+	int result, i, j;
 	tcp_conn_t *tcp_conn;
 	tcp_fd_t *tcp_fd;
 
@@ -195,7 +203,10 @@ tcp_port_t *tcp_port;
 		tcp_conn->tc_RCV_UP= tcp_conn->tc_IRS;
 		tcp_conn->tc_port= tcp_port;
 		tcp_conn->tc_rcvd_data= NULL;
-		tcp_conn->tc_adv_data= NULL;
+		for (j= 0; j<TCP_ADV_NR; j++)
+			tcp_conn->tc_adv_data[j]= NULL;
+		tcp_conn->tc_adv_nr= 0;
+		tcp_conn->tc_sack_nr= 0;
 		tcp_conn->tc_send_data= 0;
 		tcp_conn->tc_remipopt= NULL;
 		tcp_conn->tc_tcpopt= NULL;
@@ -210,14 +221,21 @@ tcp_port_t *tcp_port;
 		tcp_conn->tc_mss= TCP_DEF_MSS;
 		tcp_conn->tc_error= NW_OK;
 		tcp_conn->tc_snd_wnd= TCP_MAX_SND_WND_SIZE;
-		tcp_conn->tc_snd_cinc=
-			(long)TCP_DEF_MSS*TCP_DEF_MSS/TCP_MAX_SND_WND_SIZE+1;
+		tcp_conn->tc_cwnd= 0;
+		tcp_conn->tc_dupacks= 0;
+		tcp_conn->tc_cc= tcp_cc_default;
+		tcp_conn->tc_snd_wscale= 0;
+		tcp_conn->tc_rcv_wscale= 0;
 
 		tcp_conn->tc_rt_time= 0;
 		tcp_conn->tc_rt_seq= 0;
 		tcp_conn->tc_rt_threshold= tcp_conn->tc_ISS;
+		tcp_conn->tc_srtt= 0;
+		tcp_conn->tc_rttvar= 0;
+		tcp_conn->tc_ts_recent= 0;
+		tcp_conn->tc_ts_ecr= 0;
 
-		for (i=0, tcp_fd= tcp_fd_table; i<TCP_FD_NR; i++,
+		for (i=0, tcp_fd= tcp_fd_table; i<tcp_fd_nr; i++,
 			tcp_fd++)
 		{
 			if (!(tcp_fd->tf_flags & TFF_INUSE))
@@ -415,20 +433,15 @@ int fd;
 acc_t *data;
 size_t datalen;
 {
-	tcp_port_t *tcp_port;
 	tcp_conn_t *tcp_conn, **conn_p;
 	ip_hdr_t *ip_hdr;
 	tcp_hdr_t *tcp_hdr;
 	acc_t *ip_pack, *tcp_pack;
 	size_t ip_datalen, tcp_datalen, ip_hdr_len, tcp_hdr_len;
 	u16_t sum;
-	u32_t bits;
-	int hash;
 	ipaddr_t srcaddr, dstaddr;
 	tcpport_t srcport, dstport;
 
-	tcp_port= &tcp_port_table[fd];
-
 	/* Extract the IP header. */
 	ip_hdr= (ip_hdr_t *)ptr2acc_data(data);
 	ip_hdr_len= (ip_hdr->ih_vers_ihl & IH_IHL_MASK) << 2;
@@ -505,55 +518,27 @@ size_t datalen;
 	dstaddr= ip_hdr->ih_dst;
 	srcport= tcp_hdr->th_srcport;
 	dstport= tcp_hdr->th_dstport;
-	bits= srcaddr ^ dstaddr ^ srcport ^ dstport;
-	bits= (bits >> 16) ^ bits;
-	bits= (bits >> 8) ^ bits;
-	hash= ((bits >> TCP_CONN_HASH_SHIFT) ^ bits) & (TCP_CONN_HASH_NR-1);
-	conn_p= tcp_port->tp_conn_hash[hash];
-	if (conn_p[0]->tc_locport == dstport &&
-		conn_p[0]->tc_remport == srcport &&
-		conn_p[0]->tc_remaddr == srcaddr &&
-		conn_p[0]->tc_locaddr == dstaddr)
-	{
-		tcp_conn= conn_p[0];
-	}
-	else if (conn_p[1]->tc_locport == dstport &&
-		conn_p[1]->tc_remport == srcport &&
-		conn_p[1]->tc_remaddr == srcaddr &&
-		conn_p[1]->tc_locaddr == dstaddr)
-	{
-		tcp_conn= conn_p[1];
-		conn_p[1]= conn_p[0];
-		conn_p[0]= tcp_conn;
-	}
-	else if (conn_p[2]->tc_locport == dstport &&
-		conn_p[2]->tc_remport == srcport &&
-		conn_p[2]->tc_remaddr == srcaddr &&
-		conn_p[2]->tc_locaddr == dstaddr)
-	{
-		tcp_conn= conn_p[2];
-		conn_p[2]= conn_p[1];
-		conn_p[1]= conn_p[0];
-		conn_p[0]= tcp_conn;
-	}
-	else if (conn_p[3]->tc_locport == dstport &&
-		conn_p[3]->tc_remport == srcport &&
-		conn_p[3]->tc_remaddr == srcaddr &&
-		conn_p[3]->tc_locaddr == dstaddr)
-	{
-		tcp_conn= conn_p[3];
-		conn_p[3]= conn_p[2];
-		conn_p[2]= conn_p[1];
-		conn_p[1]= conn_p[0];
-		conn_p[0]= tcp_conn;
+	conn_p= &tcp_conn_hash[conn_hash(dstaddr, dstport, srcaddr, srcport)];
+	for (tcp_conn= *conn_p; tcp_conn; tcp_conn= tcp_conn->tc_hash_next)
+	{
+		if (tcp_conn->tc_locport == dstport &&
+			tcp_conn->tc_remport == srcport &&
+			tcp_conn->tc_remaddr == srcaddr &&
+			tcp_conn->tc_locaddr == dstaddr &&
+			tcp_conn->tc_state != TCS_CLOSED)
+		{
+			break;
+		}
 	}
-	else
-		tcp_conn= NULL;
-	if (tcp_conn != NULL && tcp_conn->tc_state == TCS_CLOSED ||
-		(tcp_hdr->th_flags & THF_SYN))
+	if (tcp_conn != NULL && tcp_conn != *conn_p)
 	{
-		tcp_conn= NULL;
+		/* Move it to the front, the next packet is probably for
+		 * the same connection.
+		 */
+		tcp_hash_conn(tcp_conn);
 	}
+	if (tcp_hdr->th_flags & THF_SYN)
+		tcp_conn= NULL;
 
 	if (tcp_conn == NULL)
 	{
@@ -566,13 +551,6 @@ size_t datalen;
 			bf_afree(data);
 			return;
 		}
-		if (tcp_conn->tc_state != TCS_CLOSED)
-		{
-			conn_p[3]= conn_p[2];
-			conn_p[2]= conn_p[1];
-			conn_p[1]= conn_p[0];
-			conn_p[0]= tcp_conn;
-		}
 	}
 	assert(tcp_conn->tc_busy == 0);
 	tcp_conn->tc_busy++;
@@ -593,9 +571,9 @@ put_pkt_t put_pkt;
 	int i;
 	tcp_fd_t *tcp_fd;
 
-	for (i=0; i<TCP_FD_NR && (tcp_fd_table[i].tf_flags & TFF_INUSE);
+	for (i=0; i<tcp_fd_nr && (tcp_fd_table[i].tf_flags & TFF_INUSE);
 		i++);
-	if (i>=TCP_FD_NR)
+	if (i>=tcp_fd_nr)
 	{
 		return EAGAIN;
 	}
@@ -610,6 +588,8 @@ put_pkt_t put_pkt;
 	tcp_fd->tf_tcpconf.nwtc_flags= TCP_DEF_CONF;
 	tcp_fd->tf_tcpconf.nwtc_remaddr= 0;
 	tcp_fd->tf_tcpconf.nwtc_remport= 0;
+	tcp_fd->tf_tcpconf.nwtc_sndbuf= 0;
+	tcp_fd->tf_tcpconf.nwtc_rcvbuf= 0;
 	tcp_fd->tf_tcpopt.nwto_flags= TCP_DEF_OPT;
 	tcp_fd->tf_get_userdata= get_userdata;
 	tcp_fd->tf_put_userdata= put_userdata;
@@ -670,7 +650,13 @@ assert (conf_acc->acc_length == sizeof(*tcp_conf));
 			tcp_conf->nwtc_locport= tcp_conn->tc_locport;
 			tcp_conf->nwtc_remaddr= tcp_conn->tc_remaddr;
 			tcp_conf->nwtc_remport= tcp_conn->tc_remport;
+			tcp_conf->nwtc_sndbuf= tcp_conn->tc_snd_wnd;
+			tcp_conf->nwtc_rcvbuf= tcp_conn->tc_rcv_wnd;
 		}
+		if (!tcp_conf->nwtc_sndbuf)
+			tcp_conf->nwtc_sndbuf= TCP_MAX_SND_WND_SIZE;
+		if (!tcp_conf->nwtc_rcvbuf)
+			tcp_conf->nwtc_rcvbuf= TCP_MAX_RCV_WND_SIZE;
 		tcp_conf->nwtc_locaddr= tcp_fd->tf_port->tp_ipaddr;
 		result= (*tcp_fd->tf_put_userdata)(tcp_fd->tf_srfd,
 			0, conf_acc, TRUE);
@@ -885,6 +871,36 @@ assert (new_di_flags & NWTC_REMPORT_MASK);
 		newconf.nwtc_remport= 0;
 	}
 
+	/* NWTC_BUFSIZ_MASK, a size of 0 selects the default */
+	if (!((new_en_flags | new_di_flags) & NWTC_BUFSIZ_MASK))
+	{
+		new_en_flags |= (old_en_flags & NWTC_BUFSIZ_MASK);
+		new_di_flags |= (old_di_flags & NWTC_BUFSIZ_MASK);
+		newconf.nwtc_sndbuf= oldconf.nwtc_sndbuf;
+		newconf.nwtc_rcvbuf= oldconf.nwtc_rcvbuf;
+	}
+	else if (new_en_flags & NWTC_SET_BUFSIZ)
+	{
+		if ((newconf.nwtc_sndbuf != 0 &&
+			(newconf.nwtc_sndbuf < TCP_MIN_RCV_WND_SIZE ||
+			newconf.nwtc_sndbuf > TCP_MAX_BUF_SIZE)) ||
+			(newconf.nwtc_rcvbuf != 0 &&
+			(newconf.nwtc_rcvbuf < TCP_MIN_RCV_WND_SIZE ||
+			newconf.nwtc_rcvbuf > TCP_MAX_BUF_SIZE)))
+		{
+			tcp_fd->tf_flags &= ~TFF_IOCTL_IP;
+			reply_thr_get(tcp_fd, EBADMODE, TRUE);
+			bf_afree(data);
+			return NW_OK;
+		}
+	}
+	else
+	{
+assert (new_di_flags & NWTC_BUFSIZ_MASK);
+		newconf.nwtc_sndbuf= 0;
+		newconf.nwtc_rcvbuf= 0;
+	}
+
 	newconf.nwtc_flags= ((unsigned long)new_di_flags
 		<< 16) | new_en_flags;
 	all_flags= new_en_flags | new_di_flags;
@@ -892,7 +908,7 @@ assert (new_di_flags & NWTC_REMPORT_MASK);
 	/* check the access modes */
 	if ((all_flags & NWTC_LOCPORT_MASK) != NWTC_LP_UNSET)
 	{
-		for (i=0, fd_ptr= tcp_fd_table; i<TCP_FD_NR; i++, fd_ptr++)
+		for (i=0, fd_ptr= tcp_fd_table; i<tcp_fd_nr; i++, fd_ptr++)
 		{
 			if (fd_ptr == tcp_fd)
 				continue;
@@ -1076,9 +1092,15 @@ int fd;
 	if (is_unused_port(nw_port))
 		return nw_port;
 
-	for (port= 0xC000+TCP_FD_NR; port < 0xFFFF; port++)
+	/* Go on where the last search ended, the ports before it are
+	 * probably still held by old connections.
+	 */
+	for (port= 0xC000+tcp_fd_nr; port < 0xFFFF; port++)
 	{
-		nw_port= htons(port);
+		if (tcp_next_port < 0xC000+tcp_fd_nr || tcp_next_port == 0xFFFF)
+			tcp_next_port= 0xC000+tcp_fd_nr;
+		nw_port= htons(tcp_next_port);
+		tcp_next_port++;
 		if (is_unused_port(nw_port))
 			return nw_port;
 	}
@@ -1095,7 +1117,7 @@ tcpport_t port;
 	tcp_fd_t *tcp_fd;
 	tcp_conn_t *tcp_conn;
 
-	for (i= 0, tcp_fd= tcp_fd_table; i<TCP_FD_NR; i++,
+	for (i= 0, tcp_fd= tcp_fd_table; i<tcp_fd_nr; i++,
 		tcp_fd++)
 	{
 		if (!(tcp_fd->tf_flags & TFF_CONF_SET))
@@ -1104,7 +1126,7 @@ tcpport_t port;
 			return FALSE;
 	}
 	for (i= ip_conf_nr, tcp_conn= tcp_conn_table+i;
-		i<TCP_CONN_NR; i++, tcp_conn++)
+		i<tcp_conn_nr; i++, tcp_conn++)
 		/* the first ip_conf_nr ports are special */
 	{
 		if (!(tcp_conn->tc_flags & TCF_INUSE))
@@ -1155,8 +1177,10 @@ tcp_fd_t *tcp_fd;
 		tcp_conn->tc_remaddr= tcp_fd->tf_tcpconf.nwtc_remaddr;
 	else
 		tcp_conn->tc_remaddr= 0;
+	tcp_hash_conn(tcp_conn);
 
 	tcp_setup_conn(tcp_conn);
+	tcp_set_bufsiz(tcp_conn, tcp_fd);
 	tcp_conn->tc_port= tcp_fd->tf_port;
 	tcp_conn->tc_fd= tcp_fd;
 	tcp_conn->tc_connInprogress= 1;
@@ -1181,7 +1205,7 @@ PRIVATE tcp_conn_t *find_empty_conn()
 	int state;
 
 	for (i=ip_conf_nr, tcp_conn= tcp_conn_table+i;
-		i<TCP_CONN_NR; i++, tcp_conn++)
+		i<tcp_conn_nr; i++, tcp_conn++)
 		/* the first ip_conf_nr connections are reserved for
 		 * RSTs
 		 */
@@ -1222,14 +1246,13 @@ tcpport_t remport;
 ipaddr_t remaddr;
 {
 	tcp_conn_t *tcp_conn;
-	int i, state;
+	int state;
 
 	assert(remport);
 	assert(remaddr);
-	for (i=ip_conf_nr, tcp_conn= tcp_conn_table+i; i<TCP_CONN_NR;
-		i++, tcp_conn++)
-		/* the first ip_conf_nr connections are reserved for
-			RSTs */
+	for (tcp_conn= tcp_conn_hash[conn_hash(locaddr, locport,
+		remaddr, remport)]; tcp_conn; tcp_conn= tcp_conn->tc_hash_next)
+		/* the connections reserved for RSTs are not hashed */
 	{
 		if (tcp_conn->tc_flags == TCF_EMPTY)
 			continue;
@@ -1250,6 +1273,55 @@ ipaddr_t remaddr;
 	return NULL;
 }
 
+/*
+conn_hash
+*/
+
+PRIVATE int conn_hash(locaddr, locport, remaddr, remport)
+ipaddr_t locaddr;
+tcpport_t locport;
+ipaddr_t remaddr;
+tcpport_t remport;
+{
+	u32_t bits;
+
+	bits= locaddr ^ remaddr ^ ((u32_t)locport << 16) ^ remport;
+	bits ^= bits >> 16;
+	bits ^= bits >> 8;
+	return (int)(bits & (tcp_conn_hash_nr-1));
+}
+
+/*
+tcp_hash_conn
+
+Put a connection on the hash chain for its current addresses and ports, at
+the front.  This must be called whenever they change.
+*/
+
+PUBLIC void tcp_hash_conn(tcp_conn)
+tcp_conn_t *tcp_conn;
+{
+	tcp_conn_t **conn_p;
+
+	if (tcp_conn->tc_hash_prev)
+	{
+		*tcp_conn->tc_hash_prev= tcp_conn->tc_hash_next;
+		if (tcp_conn->tc_hash_next)
+		{
+			tcp_conn->tc_hash_next->tc_hash_prev=
+				tcp_conn->tc_hash_prev;
+		}
+	}
+	conn_p= &tcp_conn_hash[conn_hash(tcp_conn->tc_locaddr,
+		tcp_conn->tc_locport, tcp_conn->tc_remaddr,
+		tcp_conn->tc_remport)];
+	tcp_conn->tc_hash_next= *conn_p;
+	if (*conn_p)
+		(*conn_p)->tc_hash_prev= &tcp_conn->tc_hash_next;
+	tcp_conn->tc_hash_prev= conn_p;
+	*conn_p= tcp_conn;
+}
+
 PRIVATE void read_ip_packets(tcp_port)
 tcp_port_t *tcp_port;
 {
@@ -1300,7 +1372,7 @@ tcp_hdr_t *tcp_hdr;
 	best_conn= NULL;
 	listen_conn= NULL;
 	for (i= ip_conf_nr, tcp_conn= tcp_conn_table+i;
-		i<TCP_CONN_NR; i++, tcp_conn++)
+		i<tcp_conn_nr; i++, tcp_conn++)
 		/* the first ip_conf_nr connections are reserved for
 			RSTs */
 	{
@@ -1435,7 +1507,7 @@ tcpport_t remport;
 	tcp_fd_t *fd;
 
 	for (i= ip_conf_nr, tcp_conn= tcp_conn_table+i;
-		i<TCP_CONN_NR; i++, tcp_conn++)
+		i<tcp_conn_nr; i++, tcp_conn++)
 	{
 		if (!(tcp_conn->tc_flags & TCF_INUSE))
 			continue;
@@ -1813,8 +1885,10 @@ tcp_fd_t *tcp_fd;
 	assert (tcp_fd->tf_tcpconf.nwtc_flags & NWTC_SET_RA);
 	tcp_conn->tc_remport= tcp_fd->tf_tcpconf.nwtc_remport;
 	tcp_conn->tc_remaddr= tcp_fd->tf_tcpconf.nwtc_remaddr;
+	tcp_hash_conn(tcp_conn);
 
 	tcp_setup_conn(tcp_conn);
+	tcp_set_bufsiz(tcp_conn, tcp_fd);
 
 	tcp_conn->tc_fd= tcp_fd;
 	tcp_conn->tc_port= tcp_fd->tf_port;
@@ -1923,7 +1997,7 @@ int priority;
 
 	if (priority == TCP_PRI_FRAG2SEND)
 	{
-		for (i=0, tcp_conn= tcp_conn_table; i<TCP_CONN_NR; i++,
+		for (i=0, tcp_conn= tcp_conn_table; i<tcp_conn_nr; i++,
 			tcp_conn++)
 		{
 			if (!(tcp_conn->tc_flags & TCF_INUSE))
@@ -1939,24 +2013,20 @@ int priority;
 
 	if (priority == TCP_PRI_CONN_EXTRA)
 	{
-		for (i=0, tcp_conn= tcp_conn_table; i<TCP_CONN_NR; i++,
+		for (i=0, tcp_conn= tcp_conn_table; i<tcp_conn_nr; i++,
 			tcp_conn++)
 		{
 			if (!(tcp_conn->tc_flags & TCF_INUSE))
 				continue;
 			if (tcp_conn->tc_busy)
 				continue;
-			if (tcp_conn->tc_adv_data)
-			{
-				bf_afree(tcp_conn->tc_adv_data);
-				tcp_conn->tc_adv_data= NULL;
-			}
+			tcp_free_adv(tcp_conn);
 		}
 	}
 
 	if (priority == TCP_PRI_CONNwoUSER)
 	{
-		for (i=0, tcp_conn= tcp_conn_table; i<TCP_CONN_NR; i++,
+		for (i=0, tcp_conn= tcp_conn_table; i<tcp_conn_nr; i++,
 			tcp_conn++)
 		{
 			if (!(tcp_conn->tc_flags & TCF_INUSE))
@@ -1978,7 +2048,7 @@ int priority;
 
 	if (priority == TCP_PRI_CONN_INUSE)
 	{
-		for (i=0, tcp_conn= tcp_conn_table; i<TCP_CONN_NR; i++,
+		for (i=0, tcp_conn= tcp_conn_table; i<tcp_conn_nr; i++,
 			tcp_conn++)
 		{
 			if (!(tcp_conn->tc_flags & TCF_INUSE))
@@ -1997,10 +2067,9 @@ int priority;
 	}
 }
 
-#ifdef BUF_CONSISTENCY_CHECK
 PRIVATE void tcp_bufcheck()
 {
-	int i;
+	int i, j;
 	tcp_conn_t *tcp_conn;
 	tcp_port_t *tcp_port;
 
@@ -2009,13 +2078,13 @@ PRIVATE void tcp_bufcheck()
 		if (tcp_port->tp_pack)
 			bf_check_acc(tcp_port->tp_pack);
 	}
-	for (i= 0, tcp_conn= tcp_conn_table; i<TCP_CONN_NR; i++, tcp_conn++)
+	for (i= 0, tcp_conn= tcp_conn_table; i<tcp_conn_nr; i++, tcp_conn++)
 	{
 		assert(!tcp_conn->tc_busy);
 		if (tcp_conn->tc_rcvd_data)
 			bf_check_acc(tcp_conn->tc_rcvd_data);
-		if (tcp_conn->tc_adv_data)
-			bf_check_acc(tcp_conn->tc_adv_data);
+		for (j= 0; j<tcp_conn->tc_adv_nr; j++)
+			bf_check_acc(tcp_conn->tc_adv_data[j]);
 		if (tcp_conn->tc_send_data)
 			bf_check_acc(tcp_conn->tc_send_data);
 		if (tcp_conn->tc_remipopt)
@@ -2026,7 +2095,6 @@ PRIVATE void tcp_bufcheck()
 			bf_check_acc(tcp_conn->tc_frag2send);
 	}
 }
-#endif
 
 PUBLIC void tcp_notreach(tcp_conn)
 tcp_conn_t *tcp_conn;
@@ -2095,7 +2163,7 @@ tcp_conn_t *tcp_conn;
 	tcp_conn->tc_RCV_UP= tcp_conn->tc_IRS;
 
 	assert(tcp_conn->tc_rcvd_data == NULL);
-	assert(tcp_conn->tc_adv_data == NULL);
+	assert(tcp_conn->tc_adv_nr == 0);
 	assert(tcp_conn->tc_send_data == NULL);
 	tcp_conn->tc_remipopt= NULL;
 	tcp_conn->tc_tcpopt= NULL;
@@ -2110,18 +2178,59 @@ tcp_conn_t *tcp_conn;
 	tcp_conn->tc_error= NW_OK;
 	tcp_conn->tc_snd_cwnd= tcp_conn->tc_SND_UNA + 2*tcp_conn->tc_mss;
 	tcp_conn->tc_snd_cthresh= TCP_MAX_SND_WND_SIZE;
-	tcp_conn->tc_snd_cinc=
-		(long)TCP_DEF_MSS*TCP_DEF_MSS/TCP_MAX_SND_WND_SIZE+1;
 	tcp_conn->tc_snd_wnd= TCP_MAX_SND_WND_SIZE;
+	tcp_conn->tc_dupacks= 0;
+	tcp_conn->tc_recover= tcp_conn->tc_ISS;
+	tcp_conn->tc_sack_nr= 0;
+	tcp_conn->tc_rxt_nxt= tcp_conn->tc_ISS;
+	tcp_conn->tc_cc= tcp_cc_default;
+	(*tcp_conn->tc_cc->tcc_init)(tcp_conn);
+	tcp_conn->tc_snd_wscale= 0;
+	tcp_conn->tc_rcv_wscale= 0;
 	tcp_conn->tc_rt_time= 0;
 	tcp_conn->tc_rt_seq= 0;
 	tcp_conn->tc_rt_threshold= tcp_conn->tc_ISS;
-	tcp_conn->tc_flags= TCF_INUSE;
+	tcp_conn->tc_srtt= 0;
+	tcp_conn->tc_rttvar= 0;
+	tcp_conn->tc_ts_recent= 0;
+	tcp_conn->tc_ts_ecr= 0;
+
+	/* Offer window scaling, timestamps and selective acks. For a
+	 * passive open, the SYN from the other side decides.
+	 */
+	tcp_conn->tc_flags= TCF_INUSE | TCF_WSCALE | TCF_TS | TCF_SACK;
 
 	clck_untimer(&tcp_conn->tc_transmit_timer);
 	tcp_conn->tc_transmit_seq= 0;
 }
 
+/*
+tcp_set_bufsiz
+
+Size the send queue and the receive window of a new connection after the
+buffer sizes set with NWIOSTCPCONF.
+*/
+
+PRIVATE void tcp_set_bufsiz(tcp_conn, tcp_fd)
+tcp_conn_t *tcp_conn;
+tcp_fd_t *tcp_fd;
+{
+	u32_t sndbuf, rcvbuf;
+
+	sndbuf= TCP_MAX_SND_WND_SIZE;
+	rcvbuf= TCP_MAX_RCV_WND_SIZE;
+	if (tcp_fd->tf_tcpconf.nwtc_flags & NWTC_SET_BUFSIZ)
+	{
+		if (tcp_fd->tf_tcpconf.nwtc_sndbuf)
+			sndbuf= tcp_fd->tf_tcpconf.nwtc_sndbuf;
+		if (tcp_fd->tf_tcpconf.nwtc_rcvbuf)
+			rcvbuf= tcp_fd->tf_tcpconf.nwtc_rcvbuf;
+	}
+	tcp_conn->tc_snd_wnd= sndbuf;
+	tcp_conn->tc_rcv_wnd= rcvbuf;
+	tcp_conn->tc_snd_cthresh= sndbuf;
+}
+
 /*
  * $PchId: tcp.c,v 1.14.2.2 1999/11/17 22:05:27 philip Exp $
  */
@@ -22,6 +22,19 @@ Copyright 1995 Philip Homburg
 #define TCP_MAX_RCV_WND_SIZE	((CRAMPED ? 4 : 8) * 1024)
 #endif
 
+/* Upper limit for the buffer sizes set with NWIOSTCPCONF.  Buffer sizes are
+ * kept in a size_t here and there, so 16-bit builds stay below 64K.
+ */
+#ifndef TCP_MAX_BUF_SIZE
+#if _EM_WSIZE == 2
+#define TCP_MAX_BUF_SIZE	(60 * 1024L)
+#else
+#define TCP_MAX_BUF_SIZE	((CRAMPED ? 32 : 256) * 1024L)
+#endif
+#endif
+
+#define TCP_MAX_WSCALE		14	/* largest window shift, RFC 1323 */
+
 #define TCP_DEF_TOS		0
 #define TCP_DEF_TTL		5	/* hops/seconds */
 #define TCP_DEF_TTL_NEXT	30	/* hops/seconds */
@@ -51,6 +64,12 @@ Copyright 1995 Philip Homburg
 					 * is TCP_RTT_MAX ticks
 					 */
 
+#define TCP_DUPACK_THRESH	3	/* duplicate acks that start a fast
+					 * retransmit
+					 */
+#define TCP_ADV_NR		4	/* ranges of out of order data kept */
+#define TCP_SACK_NR		4	/* ranges in the SACK scoreboard */
+
 #ifndef TCP_DEF_MSS
 #define TCP_DEF_MSS		1400
 #endif
@@ -0,0 +1,94 @@
+/*
+tcp_cc.c
+
+Congestion control.  The loss recovery in tcp_send.c (duplicate acks, fast
+retransmit, NewReno fast recovery) asks the module of a connection how to
+open the congestion window on new acks and where to put the slow start
+threshold after a loss.  Another algorithm is another tcp_cc_t here;
+tcp_cc_default selects the one new connections get.
+*/
+
+#include "inet.h"
+#include "buf.h"
+#include "clock.h"
+#include "event.h"
+#include "type.h"
+
+#include "assert.h"
+#include "io.h"
+#include "tcp.h"
+#include "tcp_int.h"
+
+THIS_FILE
+
+FORWARD void newreno_init ARGS(( tcp_conn_t *tcp_conn ));
+FORWARD void newreno_ack ARGS(( tcp_conn_t *tcp_conn, u32_t acked ));
+FORWARD u32_t newreno_ssthresh ARGS(( tcp_conn_t *tcp_conn,
+	u32_t flight ));
+
+PRIVATE tcp_cc_t tcp_cc_newreno=
+{
+	"newreno",
+	newreno_init,
+	newreno_ack,
+	newreno_ssthresh,
+};
+
+PUBLIC tcp_cc_t *tcp_cc_default= &tcp_cc_newreno;
+
+/*
+newreno_init
+*/
+
+PRIVATE void newreno_init(tcp_conn)
+tcp_conn_t *tcp_conn;
+{
+	tcp_conn->tc_cwnd= 2*tcp_conn->tc_mss;
+}
+
+/*
+newreno_ack
+
+Slow start below the threshold, one mss per round trip above it (RFC 5681).
+*/
+
+PRIVATE void newreno_ack(tcp_conn, acked)
+tcp_conn_t *tcp_conn;
+u32_t acked;
+{
+	u32_t cwnd, inc;
+	u16_t mss;
+
+	mss= tcp_conn->tc_mss;
+	cwnd= tcp_conn->tc_cwnd;
+	if (cwnd < tcp_conn->tc_snd_cthresh)
+		inc= acked < mss ? acked : mss;
+	else
+	{
+		inc= (u32_t)mss*mss/cwnd;
+		if (inc == 0)
+			inc= 1;
+	}
+	cwnd += inc;
+
+	/* There is never more in flight than the send queue holds. */
+	if (cwnd > tcp_conn->tc_snd_wnd)
+		cwnd= tcp_conn->tc_snd_wnd;
+	tcp_conn->tc_cwnd= cwnd;
+}
+
+/*
+newreno_ssthresh
+*/
+
+PRIVATE u32_t newreno_ssthresh(tcp_conn, flight)
+tcp_conn_t *tcp_conn;
+u32_t flight;
+{
+	u32_t thresh;
+
+	thresh= flight/2;
+	if (thresh < 2*tcp_conn->tc_mss)
+		thresh= 2*tcp_conn->tc_mss;
+	return thresh;
+}
@@ -7,9 +7,6 @@ Copyright 1995 Philip Homburg
 #ifndef TCP_INT_H
 #define TCP_INT_H
 
-#define TCP_CONN_HASH_SHIFT	4
-#define TCP_CONN_HASH_NR	(1 << TCP_CONN_HASH_SHIFT)
-
 typedef struct tcp_port
 {
 	int tp_ipdev;
@@ -21,7 +18,6 @@ typedef struct tcp_port
 	struct tcp_conn *tp_snd_head;
 	struct tcp_conn *tp_snd_tail;
 	event_t tp_snd_event;
-	struct tcp_conn *tp_conn_hash[TCP_CONN_HASH_NR][4];
 } tcp_port_t;
 
 #define TPF_EMPTY	0x0
@@ -83,6 +79,10 @@ typedef struct tcp_conn
 	ipaddr_t tc_locaddr;
 	tcpport_t tc_remport;
 	ipaddr_t tc_remaddr;
+	struct tcp_conn *tc_hash_next;	/* next with the same hash */
+	struct tcp_conn **tc_hash_prev;	/* what points to us, or NULL if
+					 * not hashed
+					 */
 
 #if 1
 	int tc_connInprogress;
@@ -102,14 +102,27 @@ typedef struct tcp_conn
 
 	u32_t tc_snd_cwnd;	/* highest sequence number to be sent */
 	u32_t tc_snd_cthresh;	/* threshold for send window */
-	u32_t tc_snd_cinc;	/* increment for send window threshold */
-	u16_t tc_snd_wnd;	/* max send queue size */
+	u32_t tc_cwnd;		/* congestion window */
+	u32_t tc_recover;	/* end of the data sent before recovery */
+	int tc_dupacks;		/* duplicate acks in a row */
+	struct tcp_cc *tc_cc;	/* congestion control module */
+	u32_t tc_sack_lo[TCP_SACK_NR];	/* selectively acked ranges, */
+	u32_t tc_sack_hi[TCP_SACK_NR];	/* sorted */
+	int tc_sack_nr;
+	u32_t tc_rxt_nxt;	/* next hole to resend during recovery */
+	u32_t tc_snd_wnd;	/* max send queue size */
+	u8_t tc_snd_wscale;	/* shift for windows we receive */
+	u8_t tc_rcv_wscale;	/* shift for windows we advertise */
 
 	/* round trip calculation. */
 	time_t tc_rt_time;
 	u32_t tc_rt_seq;
 	u32_t tc_rt_threshold;
-	time_t tc_rtt;
+	time_t tc_rtt;		/* retransmission timeout */
+	time_t tc_srtt;		/* smoothed round trip time, times 8 */
+	time_t tc_rttvar;	/* round trip time variation, times 4 */
+	u32_t tc_ts_recent;	/* timestamp to echo to the peer */
+	u32_t tc_ts_ecr;	/* timestamp echoed by the last segment */
 
 	acc_t *tc_send_data;
 	acc_t *tc_frag2send;
@@ -122,10 +135,12 @@ typedef struct tcp_conn
 	u32_t tc_RCV_HI;
 	u32_t tc_RCV_UP;
 
-	u16_t tc_rcv_wnd;
+	u32_t tc_rcv_wnd;
 	acc_t *tc_rcvd_data;
-	acc_t *tc_adv_data;
-	u32_t tc_adv_seq;
+	acc_t *tc_adv_data[TCP_ADV_NR];	/* out of order data, sorted */
+	u32_t tc_adv_seq[TCP_ADV_NR];
+	int tc_adv_nr;
+	u32_t tc_adv_last;	/* last out of order segment */
 
 	acc_t *tc_remipopt;
 	acc_t *tc_tcpopt;
@@ -151,11 +166,27 @@ typedef struct tcp_conn
 #define TCF_SEND_ACK		0x10
 #define TCF_FIN_SENT		0x20
 #define TCF_BSD_URG		0x40
+#define TCF_WSCALE		0x80	/* window scaling in use */
+#define TCF_TS			0x100	/* timestamps in use */
+#define TCF_RECOVERY		0x200	/* in fast recovery */
+#define TCF_FAST_RXT		0x400	/* resend the first lost segment */
+#define TCF_SACK		0x800	/* selective acks in use */
 
 #if DEBUG & 0x200
 #define TCF_DEBUG		0x1000
 #endif
 
+/* A congestion control module. The window itself is tc_cwnd, the slow
+ * start threshold tc_snd_cthresh.
+ */
+typedef struct tcp_cc
+{
+	char *tcc_name;
+	void (*tcc_init) ARGS(( tcp_conn_t *tcp_conn ));
+	void (*tcc_ack) ARGS(( tcp_conn_t *tcp_conn, u32_t acked ));
+	u32_t (*tcc_ssthresh) ARGS(( tcp_conn_t *tcp_conn, u32_t flight ));
+} tcp_cc_t;
+
 #define TCS_CLOSED		0
 #define TCS_LISTEN		1
 #define TCS_SYN_RECEIVED	2
@@ -167,11 +198,15 @@ typedef struct tcp_conn
 void tcp_frag2conn ARGS(( tcp_conn_t *tcp_conn, ip_hdr_t *ip_hdr,
 	tcp_hdr_t *tcp_hdr, acc_t *tcp_data, size_t data_len ));
 void tcp_fd_read ARGS(( tcp_conn_t *tcp_conn, int enq ));
+void tcp_free_adv ARGS(( tcp_conn_t *tcp_conn ));
 
 /* tcp_send.c */
 void tcp_conn_write ARGS(( tcp_conn_t *tcp_conn, int enq ));
 void tcp_release_retrans ARGS(( tcp_conn_t *tcp_conn, u32_t seg_ack,
-	U16_t new_win ));
+	u32_t new_win ));
+void tcp_rtt_sample ARGS(( tcp_conn_t *tcp_conn, time_t sample ));
+void tcp_dup_ack ARGS(( tcp_conn_t *tcp_conn, u32_t new_win ));
+void tcp_sack_mark ARGS(( tcp_conn_t *tcp_conn, u32_t lo, u32_t hi ));
 void tcp_set_send_timer ARGS(( tcp_conn_t *tcp_conn ));
 void tcp_fd_write ARGS(( tcp_conn_t *tcp_conn ));
 void tcp_close_connection ARGS(( tcp_conn_t *tcp_conn,
@@ -179,6 +214,9 @@ void tcp_close_connection ARGS(( tcp_conn_t *tcp_conn,
 void tcp_port_write ARGS(( tcp_port_t *tcp_port ));
 void tcp_shutdown ARGS(( tcp_conn_t *tcp_conn ));
 
+/* tcp_cc.c */
+extern tcp_cc_t *tcp_cc_default;
+
 /* tcp_lib.c */
 void tcp_extract_ipopt ARGS(( tcp_conn_t *tcp_conn,
 	ip_hdr_t *ip_hdr ));
@@ -188,6 +226,7 @@ void tcp_get_ipopt ARGS(( tcp_conn_t *tcp_conn, ip_hdropt_t
 	*ip_hdropt ));
 void tcp_get_tcpopt ARGS(( tcp_conn_t *tcp_conn, tcp_hdropt_t
 	*tcp_hdropt ));
+u16_t tcp_adv_window ARGS(( tcp_conn_t *tcp_conn, u32_t window ));
 acc_t *tcp_make_header ARGS(( tcp_conn_t *tcp_conn,
 	ip_hdr_t **ref_ip_hdr, tcp_hdr_t **ref_tcp_hdr, acc_t *data ));
 u16_t tcp_pack_oneCsum ARGS(( ip_hdr_t *ip_hdr, acc_t *tcp_pack ));
@@ -207,13 +246,11 @@ void tcp_reply_ioctl ARGS(( tcp_fd_t *tcp_fd, int reply ));
 void tcp_reply_write ARGS(( tcp_fd_t *tcp_fd, size_t reply ));
 void tcp_reply_read ARGS(( tcp_fd_t *tcp_fd, size_t reply ));
 void tcp_notreach ARGS(( tcp_conn_t *tcp_conn ));
-
-#define TCP_FD_NR	(10*IP_PORT_MAX)
-#define TCP_CONN_NR	(2*TCP_FD_NR)
+void tcp_hash_conn ARGS(( tcp_conn_t *tcp_conn ));
 
 EXTERN tcp_port_t *tcp_port_table;
-EXTERN tcp_conn_t tcp_conn_table[TCP_CONN_NR];
-EXTERN tcp_fd_t tcp_fd_table[TCP_FD_NR];
+EXTERN tcp_conn_t *tcp_conn_table;
+EXTERN tcp_fd_t *tcp_fd_table;
 
 #define tcp_Lmod4G(n1,n2)	(!!(((u32_t)(n1)-(u32_t)(n2)) & 0x80000000L))
 #define tcp_GEmod4G(n1,n2)	(!(((u32_t)(n1)-(u32_t)(n2)) & 0x80000000L))
@@ -12,10 +12,13 @@ Copyright 1995 Philip Homburg
 #include "type.h"
 
 #include "assert.h"
+#include "tcp.h"
 #include "tcp_int.h"
 
 THIS_FILE
 
+FORWARD u8_t *sack_block ARGS(( tcp_conn_t *tcp_conn, int i, u8_t *opt ));
+
 #if you_want_to_be_complete
 
 #undef tcp_LEmod4G
@@ -64,17 +67,116 @@ ip_hdr_t *ip_hdr;
 	DBLOCK(1, printf("ip_hdr options NOT supported (yet?)\n"));
 }
 
+/*
+tcp_extract_tcpopt
+
+Options are contiguous after the header (see tcp_put_pkt).  Window scaling
+and timestamps are in use only if both sides ask for them in their SYN, so
+a SYN clears both flags and sets the ones the peer asks for.
+*/
+
 PUBLIC void tcp_extract_tcpopt(tcp_conn, tcp_hdr)
 tcp_conn_t *tcp_conn;
 tcp_hdr_t *tcp_hdr;
 {
-	int tcp_hdr_len;
+	int tcp_hdr_len, syn, i, j, len;
+	u8_t *opt;
+	u32_t mss, seg_seq, ts_val, lo, hi;
+
+	syn= (tcp_hdr->th_flags & THF_SYN);
+	if (syn)
+		tcp_conn->tc_flags &= ~(TCF_WSCALE|TCF_TS|TCF_SACK);
 
 	tcp_hdr_len= (tcp_hdr->th_data_off & TH_DO_MASK) >> 2;
 	if (tcp_hdr_len == TCP_MIN_HDR_SIZE)
 		return;
 
-	DBLOCK(2, printf("tcp_hdr options NOT supported (yet?)\n"));
+	opt= (u8_t *)tcp_hdr + TCP_MIN_HDR_SIZE;
+	tcp_hdr_len -= TCP_MIN_HDR_SIZE;
+	for (i= 0; i<tcp_hdr_len; i += len)
+	{
+		if (opt[i] == TCP_OPT_EOL)
+			break;
+		if (opt[i] == TCP_OPT_NOP)
+		{
+			len= 1;
+			continue;
+		}
+		if (i+1 >= tcp_hdr_len)
+			break;
+		len= opt[i+1];
+		if (len < 2 || i+len > tcp_hdr_len)
+		{
+			DBLOCK(1, printf("tcp_extract_tcpopt: bad option\n"));
+			break;
+		}
+		switch(opt[i])
+		{
+		case TCP_OPT_MSS:
+			if (!syn || len != 4)
+				break;
+			mss= (opt[i+2] << 8) | opt[i+3];
+			mss += IP_MIN_HDR_SIZE+TCP_MIN_HDR_SIZE;
+			if (mss < tcp_conn->tc_mss)
+				tcp_conn->tc_mss= mss;
+			break;
+		case TCP_OPT_WSOPT:
+			if (!syn || len != 3)
+				break;
+			tcp_conn->tc_snd_wscale= opt[i+2];
+			if (tcp_conn->tc_snd_wscale > TCP_MAX_WSCALE)
+				tcp_conn->tc_snd_wscale= TCP_MAX_WSCALE;
+			tcp_conn->tc_flags |= TCF_WSCALE;
+			break;
+		case TCP_OPT_SACKPERM:
+			if (!syn || len != 2)
+				break;
+			tcp_conn->tc_flags |= TCF_SACK;
+			break;
+		case TCP_OPT_SACK:
+			if (syn || !(tcp_conn->tc_flags & TCF_SACK) ||
+				(len-2) % 8 != 0)
+			{
+				break;
+			}
+			for (j= i+2; j<i+len; j += 8)
+			{
+				lo= ((u32_t)opt[j] << 24) |
+					((u32_t)opt[j+1] << 16) |
+					((u32_t)opt[j+2] << 8) | opt[j+3];
+				hi= ((u32_t)opt[j+4] << 24) |
+					((u32_t)opt[j+5] << 16) |
+					((u32_t)opt[j+6] << 8) | opt[j+7];
+				tcp_sack_mark(tcp_conn, lo, hi);
+			}
+			break;
+		case TCP_OPT_TS:
+			if (len != 10)
+				break;
+			if (syn)
+				tcp_conn->tc_flags |= TCF_TS;
+			if (!(tcp_conn->tc_flags & TCF_TS))
+				break;
+			ts_val= ((u32_t)opt[i+2] << 24) |
+				((u32_t)opt[i+3] << 16) |
+				((u32_t)opt[i+4] << 8) | opt[i+5];
+			tcp_conn->tc_ts_ecr= ((u32_t)opt[i+6] << 24) |
+				((u32_t)opt[i+7] << 16) |
+				((u32_t)opt[i+8] << 8) | opt[i+9];
+
+			/* Remember the newest timestamp of a segment that
+			 * does not lie beyond what we are about to ack.
+			 */
+			seg_seq= ntohl(tcp_hdr->th_seq_nr);
+			if (syn || (tcp_GEmod4G(ts_val,
+				tcp_conn->tc_ts_recent) &&
+				tcp_LEmod4G(seg_seq, tcp_conn->tc_RCV_NXT)))
+			{
+				tcp_conn->tc_ts_recent= ts_val;
+			}
+			break;
+		}
+	}
 }
 
 PUBLIC u16_t tcp_pack_oneCsum(ip_hdr, tcp_pack)
@@ -141,17 +243,78 @@ PUBLIC void tcp_get_tcpopt(tcp_conn, tcp_hdropt)
 tcp_conn_t *tcp_conn;
 tcp_hdropt_t *tcp_hdropt;
 {
-	int optsiz;
+	int optsiz, i, first, nblk;
+	u8_t *opt;
+	u32_t ts_val, lo, hi;
 
-	if (!tcp_conn->tc_tcpopt)
+	optsiz= 0;
+	if (tcp_conn->tc_tcpopt)
+	{
+		tcp_conn->tc_tcpopt= bf_pack(tcp_conn->tc_tcpopt);
+		optsiz= bf_bufsize(tcp_conn->tc_tcpopt);
+		memcpy(tcp_hdropt->tho_data,
+			ptr2acc_data(tcp_conn->tc_tcpopt), optsiz);
+	}
+	if (tcp_conn->tc_flags & TCF_TS)
+	{
+		/* NOP, NOP, timestamp option. */
+		opt= &tcp_hdropt->tho_data[optsiz];
+		ts_val= get_time();
+		opt[0]= TCP_OPT_NOP;
+		opt[1]= TCP_OPT_NOP;
+		opt[2]= TCP_OPT_TS;
+		opt[3]= 10;
+		opt[4]= ts_val >> 24;
+		opt[5]= ts_val >> 16;
+		opt[6]= ts_val >> 8;
+		opt[7]= ts_val;
+		opt[8]= tcp_conn->tc_ts_recent >> 24;
+		opt[9]= tcp_conn->tc_ts_recent >> 16;
+		opt[10]= tcp_conn->tc_ts_recent >> 8;
+		opt[11]= tcp_conn->tc_ts_recent;
+		optsiz += 12;
+	}
+	if ((tcp_conn->tc_flags & TCF_SACK) && tcp_conn->tc_adv_nr != 0)
+	{
+		/* NOP, NOP, SACK option with the ranges of out of order
+		 * data. The range that holds the latest segment comes
+		 * first (RFC 2018), the others follow as far as they fit.
+		 */
+		nblk= ((int)sizeof(tcp_hdropt->tho_data)-optsiz-4)/8;
+		if (nblk > tcp_conn->tc_adv_nr)
+			nblk= tcp_conn->tc_adv_nr;
+		first= 0;
+		for (i= 0; i<tcp_conn->tc_adv_nr; i++)
+		{
+			lo= tcp_conn->tc_adv_seq[i];
+			hi= lo+bf_bufsize(tcp_conn->tc_adv_data[i]);
+			if (tcp_GEmod4G(tcp_conn->tc_adv_last, lo) &&
+				tcp_Lmod4G(tcp_conn->tc_adv_last, hi))
+			{
+				first= i;
+				break;
+			}
+		}
+		opt= &tcp_hdropt->tho_data[optsiz];
+		opt[0]= TCP_OPT_NOP;
+		opt[1]= TCP_OPT_NOP;
+		opt[2]= TCP_OPT_SACK;
+		opt[3]= 2+8*nblk;
+		optsiz += 4+8*nblk;
+		opt= sack_block(tcp_conn, first, opt+4);
+		for (i= 0, nblk--; nblk > 0; i++)
+		{
+			if (i == first)
+				continue;
+			opt= sack_block(tcp_conn, i, opt);
+			nblk--;
+		}
+	}
+	if (optsiz == 0)
 	{
 		tcp_hdropt->tho_opt_siz= 0;
 		return;
 	}
-	tcp_conn->tc_tcpopt= bf_pack(tcp_conn->tc_tcpopt);
-	optsiz= bf_bufsize(tcp_conn->tc_tcpopt);
-	memcpy(tcp_hdropt->tho_data, ptr2acc_data(tcp_conn->tc_tcpopt),
-		optsiz);
 	if ((optsiz & 3) != 0)
 	{
 		tcp_hdropt->tho_data[optsiz]= TCP_OPT_EOL;
@@ -162,6 +325,49 @@ tcp_hdropt_t *tcp_hdropt;
 	return;
 }
 
+/*
+sack_block
+
+Put the edges of out of order range 'i' in a SACK option.
+*/
+
+PRIVATE u8_t *sack_block(tcp_conn, i, opt)
+tcp_conn_t *tcp_conn;
+int i;
+u8_t *opt;
+{
+	u32_t lo, hi;
+
+	lo= tcp_conn->tc_adv_seq[i];
+	hi= lo+bf_bufsize(tcp_conn->tc_adv_data[i]);
+	opt[0]= lo >> 24;
+	opt[1]= lo >> 16;
+	opt[2]= lo >> 8;
+	opt[3]= lo;
+	opt[4]= hi >> 24;
+	opt[5]= hi >> 16;
+	opt[6]= hi >> 8;
+	opt[7]= hi;
+	return opt+8;
+}
+
+/*
+tcp_adv_window
+
+The window field for 'window' bytes, scaled if the peer agreed to that.
+*/
+
+PUBLIC u16_t tcp_adv_window(tcp_conn, window)
+tcp_conn_t *tcp_conn;
+u32_t window;
+{
+	if (tcp_conn->tc_flags & TCF_WSCALE)
+		window >>= tcp_conn->tc_rcv_wscale;
+	if (window > 0xffff)
+		window= 0xffff;
+	return window;
+}
+
 PUBLIC acc_t *tcp_make_header(tcp_conn, ref_ip_hdr, ref_tcp_hdr, data)
 tcp_conn_t *tcp_conn;
 ip_hdr_t **ref_ip_hdr;
@@ -178,7 +384,8 @@ acc_t *data;
 
 	closed_connection= (tcp_conn->tc_state == TCS_CLOSED);
 
-	if (tcp_conn->tc_remipopt || tcp_conn->tc_tcpopt)
+	if (tcp_conn->tc_remipopt || tcp_conn->tc_tcpopt ||
+		(tcp_conn->tc_flags & TCF_TS) || tcp_conn->tc_adv_nr != 0)
 	{
 		tcp_get_ipopt (tcp_conn, &ip_hdropt);
 		tcp_get_tcpopt (tcp_conn, &tcp_hdropt);
@@ -244,7 +451,8 @@ acc_t *data;
 	tcp_hdr->th_dstport= tcp_conn->tc_remport;
 	tcp_hdr->th_seq_nr= tcp_conn->tc_RCV_NXT;
 	tcp_hdr->th_flags= 0;
-	tcp_hdr->th_window= htons(tcp_conn->tc_RCV_HI-tcp_conn->tc_RCV_LO);
+	tcp_hdr->th_window= htons(tcp_adv_window(tcp_conn,
+		tcp_conn->tc_RCV_HI-tcp_conn->tc_RCV_LO));
 	tcp_hdr->th_chksum= 0;
 	*ref_ip_hdr= ip_hdr;
 	*ref_tcp_hdr= tcp_hdr;
@@ -280,7 +488,7 @@ tcp_conn_t *tcp_conn;
 {
 	int allright;
 	u32_t lo_queue, hi_queue;
-	int size;
+	i32_t size;
 
 	allright= TRUE;
 	if (tcp_conn->tc_inconsistent)
@@ -314,7 +522,7 @@ tcp_conn_t *tcp_conn;
 			tcp_conn->tc_SND_NXT, tcp_conn->tc_SND_UNA);
 		printf("lo_queue= 0x%x, hi_queue= 0x%x\n", 
 			lo_queue, hi_queue);
-		printf("size= %d\n", size);
+		printf("size= %ld\n", size);
 #endif
 		allright= FALSE;
 	}
@@ -385,7 +593,7 @@ tcp_conn_t *tcp_conn;
 		printf("SND_ISS= 0x%x, SND_UNA= 0x%x, SND_NXT= 0x%x\n",
 			tcp_conn->tc_ISS, tcp_conn->tc_SND_UNA,
 			tcp_conn->tc_SND_NXT);
-		printf("hi_queue= 0x%x, lo_queue= 0x%x, size= %d\n",
+		printf("hi_queue= 0x%x, lo_queue= 0x%x, size= %ld\n",
 			hi_queue, lo_queue, size);
 #endif
 		allright= FALSE;
@@ -11,8 +11,8 @@ Copyright 1995 Philip Homburg
 #include "type.h"
 
 #include "io.h"
-#include "tcp_int.h"
 #include "tcp.h"
+#include "tcp_int.h"
 #include "assert.h"
 
 THIS_FILE
@@ -23,6 +23,7 @@ FORWARD void process_data ARGS(( tcp_conn_t *tcp_conn,
 	tcp_hdr_t *tcp_hdr, acc_t *tcp_data, int data_len ));
 FORWARD void process_advanced_data ARGS(( tcp_conn_t *tcp_conn,
 	tcp_hdr_t *tcp_hdr, acc_t *tcp_data, int data_len ));
+FORWARD void del_adv ARGS(( tcp_conn_t *tcp_conn, int i ));
 
 PUBLIC void tcp_frag2conn(tcp_conn, ip_hdr, tcp_hdr, tcp_data, data_len)
 tcp_conn_t *tcp_conn;
@@ -34,8 +35,7 @@ size_t data_len;
 	tcp_fd_t *connuser;
 	int tcp_hdr_flags;
 	int ip_hdr_len, tcp_hdr_len;
-	u32_t seg_ack, seg_seq, rcv_hi;
-	u16_t seg_wnd;
+	u32_t seg_ack, seg_seq, rcv_hi, seg_wnd;
 	int acceptable_ACK, segm_acceptable;
 
 	ip_hdr_len= (ip_hdr->ih_vers_ihl & IH_IHL_MASK) << 2;
@@ -45,6 +45,8 @@ size_t data_len;
 	seg_ack= ntohl(tcp_hdr->th_ack_nr);
 	seg_seq= ntohl(tcp_hdr->th_seq_nr);
 	seg_wnd= ntohs(tcp_hdr->th_window);
+	if ((tcp_conn->tc_flags & TCF_WSCALE) && !(tcp_hdr_flags & THF_SYN))
+		seg_wnd <<= tcp_conn->tc_snd_wscale;
 
 	switch (tcp_conn->tc_state)
 	{
@@ -124,6 +126,7 @@ LISTEN:
 			tcp_conn->tc_locport= tcp_hdr->th_dstport;
 			tcp_conn->tc_remaddr= ip_hdr->ih_src;
 			tcp_conn->tc_remport= tcp_hdr->th_srcport;
+			tcp_hash_conn(tcp_conn);
 			tcp_conn_write(tcp_conn, 1);
 
 			DIFBLOCK(0x10, seg_seq == 0,
@@ -219,6 +222,8 @@ SYN-SENT:
 		}
 		if (tcp_hdr_flags & THF_SYN)
 		{
+			tcp_extract_ipopt(tcp_conn, ip_hdr);
+			tcp_extract_tcpopt(tcp_conn, tcp_hdr);
 			tcp_conn->tc_RCV_LO= seg_seq+1;
 			tcp_conn->tc_RCV_NXT= seg_seq+1;
 			tcp_conn->tc_RCV_HI= tcp_conn->tc_RCV_LO +
@@ -561,6 +566,12 @@ TIME-WAIT:
 		if (!(tcp_hdr_flags & THF_ACK))
 			break;
 
+		/* Options first, the ack processing below uses the
+		 * timestamp echoed by this segment.
+		 */
+		tcp_extract_ipopt(tcp_conn, ip_hdr);
+		tcp_extract_tcpopt(tcp_conn, tcp_hdr);
+
 /*
 	SND.UNA < SEG.ACK <= SND.NXT ?
 		SND.UNA= SEG.ACK
@@ -612,6 +623,15 @@ TIME-WAIT:
 					tcp_conn->tc_SND_UNA+seg_wnd;
 				tcp_conn_write(tcp_conn, 1);
 			}
+			else if (seg_wnd != 0 && data_len == 0 &&
+				!(tcp_hdr_flags & (THF_SYN|THF_FIN)) &&
+				tcp_conn->tc_SND_TRM != tcp_conn->tc_SND_UNA)
+			{
+				/* A duplicate ack, something we sent
+				 * may have been lost.
+				 */
+				tcp_dup_ack(tcp_conn, seg_wnd);
+			}
 			if (seg_wnd == 0)
 			{
 				tcp_conn->tc_snd_cwnd= tcp_conn->tc_SND_TRM=
@@ -641,9 +661,6 @@ TIME-WAIT:
 /*
 	process data...
 */
-		tcp_extract_ipopt(tcp_conn, ip_hdr);
-		tcp_extract_tcpopt(tcp_conn, tcp_hdr);
-
 		if (data_len)
 		{
 			if (tcp_LEmod4G(seg_seq, tcp_conn->tc_RCV_NXT))
@@ -716,12 +733,11 @@ tcp_hdr_t *tcp_hdr;
 acc_t *tcp_data;
 int data_len;
 {
-	u32_t lo_seq, hi_seq, urg_seq, seq_nr, adv_seq, nxt;
+	u32_t lo_seq, hi_seq, urg_seq, seq_nr;
 	u16_t urgptr;
 	int tcp_hdr_flags;
 	unsigned int offset;
-	acc_t *tmp_data, *rcvd_data, *adv_data;
-	int len_diff;
+	acc_t *tmp_data, *rcvd_data;
 
 	assert(tcp_conn->tc_busy);
 
@@ -833,7 +849,7 @@ int data_len;
 		printf("conn[[%d] full receive buffer\n", 
 		(int)(tcp_conn-tcp_conn_table)));
 
-	if (tcp_conn->tc_adv_data == NULL)
+	if (tcp_conn->tc_adv_nr == 0)
 		return;
 	if (tcp_hdr_flags & THF_FIN)
 	{
@@ -841,91 +857,51 @@ int data_len;
 		printf("conn[%d]: advanced data after FIN\n",
 			(int)(tcp_conn-tcp_conn_table));
 #endif
-		tcp_data= tcp_conn->tc_adv_data;
-		tcp_conn->tc_adv_data= NULL;
-		bf_afree(tcp_data);
+		tcp_free_adv(tcp_conn);
 		return;
 	}
 
-	lo_seq= tcp_conn->tc_adv_seq;
-	if (tcp_Gmod4G(lo_seq, tcp_conn->tc_RCV_NXT))
-		return;		/* Not yet */
-
-	tcp_data= tcp_conn->tc_adv_data;
-	tcp_conn->tc_adv_data= NULL;
-
-	data_len= bf_bufsize(tcp_data);
-	if (tcp_Lmod4G(lo_seq, tcp_conn->tc_RCV_NXT))
-	{
-		offset= tcp_conn->tc_RCV_NXT-lo_seq;
-		if (offset >= data_len)
-		{
-			bf_afree(tcp_data);
-			return;
-		}
-		tcp_data= bf_delhead(tcp_data, offset);
-		lo_seq += offset;
-		data_len -= offset;
-	}
-	assert (lo_seq == tcp_conn->tc_RCV_NXT);
-
-	hi_seq= lo_seq+data_len;
-	assert (tcp_LEmod4G (hi_seq, tcp_conn->tc_RCV_HI));
-
-	rcvd_data= tcp_conn->tc_rcvd_data;
-	tcp_conn->tc_rcvd_data= 0;
-	tmp_data= bf_append(rcvd_data, tcp_data);
-	tcp_conn->tc_rcvd_data= tmp_data;
-	tcp_conn->tc_RCV_NXT= hi_seq;
-
-	assert (tcp_conn->tc_RCV_LO + bf_bufsize(tcp_conn->tc_rcvd_data) ==
-		tcp_conn->tc_RCV_NXT ||
-		(tcp_print_conn(tcp_conn), printf("\n"), 0));
-
-	if (tcp_conn->tc_fd && (tcp_conn->tc_fd->tf_flags & TFF_READ_IP))
-		tcp_fd_read(tcp_conn, 1);
-
-	adv_data= tcp_conn->tc_adv_data;
-	if (adv_data != NULL)
+	/* Use the out of order data that now follows RCV_NXT. The ranges
+	 * do not touch, so at most one can be appended.
+	 */
+	while (tcp_conn->tc_adv_nr != 0)
 	{
-		/* Try to use advanced data. */
-		adv_seq= tcp_conn->tc_adv_seq;
-		nxt= tcp_conn->tc_RCV_NXT;
-
-		if (tcp_Gmod4G(adv_seq, nxt))
-			return;		/* not yet */
+		lo_seq= tcp_conn->tc_adv_seq[0];
+		if (tcp_Gmod4G(lo_seq, tcp_conn->tc_RCV_NXT))
+			return;		/* Not yet */
 
-		tcp_conn->tc_adv_data= NULL;
-		data_len= bf_bufsize(adv_data);
+		tcp_data= tcp_conn->tc_adv_data[0];
+		del_adv(tcp_conn, 0);
 
-		if (tcp_Lmod4G(adv_seq, nxt))
+		data_len= bf_bufsize(tcp_data);
+		if (tcp_Lmod4G(lo_seq, tcp_conn->tc_RCV_NXT))
 		{
-			if (tcp_LEmod4G(adv_seq+data_len, nxt))
+			offset= tcp_conn->tc_RCV_NXT-lo_seq;
+			if (offset >= data_len)
 			{
-				/* Data is not needed anymore. */
-				bf_afree(adv_data);
-				return;
+				bf_afree(tcp_data);
+				continue;
 			}
-
-			len_diff= nxt-adv_seq;
-			adv_data= bf_delhead(adv_data, len_diff);
-			data_len -= len_diff;
+			tcp_data= bf_delhead(tcp_data, offset);
+			lo_seq += offset;
+			data_len -= offset;
 		}
+		assert (lo_seq == tcp_conn->tc_RCV_NXT);
+
+		hi_seq= lo_seq+data_len;
+		assert (tcp_LEmod4G (hi_seq, tcp_conn->tc_RCV_HI));
 
 		DBLOCK(1, printf("using advanced data\n"));
 
-		/* Append data to the input buffer */
-		if (tcp_conn->tc_rcvd_data == NULL)
-		{
-			tcp_conn->tc_rcvd_data= adv_data;
-		}
-		else
-		{
-			tcp_conn->tc_rcvd_data=
-				bf_append(tcp_conn->tc_rcvd_data, adv_data);
-		}
-		tcp_conn->tc_SND_NXT += data_len;
-		assert(tcp_check_conn(tcp_conn));
+		rcvd_data= tcp_conn->tc_rcvd_data;
+		tcp_conn->tc_rcvd_data= 0;
+		tmp_data= bf_append(rcvd_data, tcp_data);
+		tcp_conn->tc_rcvd_data= tmp_data;
+		tcp_conn->tc_RCV_NXT= hi_seq;
+
+		assert (tcp_conn->tc_RCV_LO + bf_bufsize(tcp_conn->tc_rcvd_data)
+			== tcp_conn->tc_RCV_NXT ||
+			(tcp_print_conn(tcp_conn), printf("\n"), 0));
 
 		if (tcp_conn->tc_fd &&
 			(tcp_conn->tc_fd->tf_flags & TFF_READ_IP))
@@ -941,15 +917,17 @@ tcp_hdr_t *tcp_hdr;
 acc_t *tcp_data;
 int data_len;
 {
-	u32_t seq, adv_seq;
+	u32_t seq, lo, hi, adv_lo, adv_hi;
 	acc_t *adv_data;
+	int i, j;
 
 	assert(tcp_conn->tc_busy);
 
 	/* Note, tcp_data will be freed by the caller. */
 
 	/* Always send an ACK, this allows the sender to do a fast
-	 * retransmit.
+	 * retransmit. The ACK is made later and carries a SACK option
+	 * for the data queued here.
 	 */
 	tcp_conn->tc_flags |= TCF_SEND_ACK;
 	tcp_conn_write(tcp_conn, 1);
@@ -966,36 +944,97 @@ int data_len;
 	if (tcp_Gmod4G(seq+data_len, tcp_conn->tc_RCV_HI))
 		return;
 
-	adv_data= tcp_conn->tc_adv_data;
-	adv_seq= tcp_conn->tc_adv_seq;
-	tcp_conn->tc_adv_data= NULL;
-
+	lo= seq;
+	hi= seq+data_len;
 	tcp_data->acc_linkC++;
-	if (adv_data == NULL)
+	tcp_conn->tc_adv_last= seq;
+
+	/* Merge the new data with the ranges it overlaps or touches. */
+	for (i= 0; i<tcp_conn->tc_adv_nr; )
+	{
+		adv_lo= tcp_conn->tc_adv_seq[i];
+		adv_data= tcp_conn->tc_adv_data[i];
+		adv_hi= adv_lo+bf_bufsize(adv_data);
+		if (tcp_Lmod4G(adv_hi, lo) || tcp_Gmod4G(adv_lo, hi))
+		{
+			i++;
+			continue;
+		}
+		if (tcp_Lmod4G(adv_lo, lo))
+		{
+			tcp_data= bf_append(bf_cut(adv_data, 0,
+				(unsigned)(lo-adv_lo)), tcp_data);
+			lo= adv_lo;
+		}
+		if (tcp_Gmod4G(adv_hi, hi))
+		{
+			tcp_data= bf_append(tcp_data, bf_cut(adv_data,
+				(unsigned)(hi-adv_lo), (unsigned)(adv_hi-hi)));
+			hi= adv_hi;
+		}
+		bf_afree(adv_data);
+		del_adv(tcp_conn, i);
+	}
+
+	for (i= 0; i<tcp_conn->tc_adv_nr; i++)
+	{
+		if (tcp_Lmod4G(lo, tcp_conn->tc_adv_seq[i]))
+			break;
+	}
+	if (tcp_conn->tc_adv_nr == TCP_ADV_NR)
 	{
-		adv_seq= seq;
-		adv_data= tcp_data;
+		/* No room, keep the data closest to RCV_NXT. */
+		if (i == TCP_ADV_NR)
+		{
+			bf_afree(tcp_data);
+			return;
+		}
+		bf_afree(tcp_conn->tc_adv_data[TCP_ADV_NR-1]);
+		del_adv(tcp_conn, TCP_ADV_NR-1);
 	}
-	else if (seq + data_len == adv_seq)
+	for (j= tcp_conn->tc_adv_nr; j>i; j--)
 	{
-		/* New data fits right before exiting data. */
-		adv_data= bf_append(tcp_data, adv_data);
-		adv_seq= seq;
+		tcp_conn->tc_adv_data[j]= tcp_conn->tc_adv_data[j-1];
+		tcp_conn->tc_adv_seq[j]= tcp_conn->tc_adv_seq[j-1];
 	}
-	else if (adv_seq + bf_bufsize(adv_data) == seq)
+	tcp_conn->tc_adv_data[i]= tcp_data;
+	tcp_conn->tc_adv_seq[i]= lo;
+	tcp_conn->tc_adv_nr++;
+}
+
+/*
+del_adv
+
+Take range 'i' out of the out of order queue, without freeing its data.
+*/
+
+PRIVATE void del_adv(tcp_conn, i)
+tcp_conn_t *tcp_conn;
+int i;
+{
+	tcp_conn->tc_adv_nr--;
+	for (; i<tcp_conn->tc_adv_nr; i++)
 	{
-		/* New data fits right after exiting data. */
-		adv_data= bf_append(adv_data, tcp_data);
+		tcp_conn->tc_adv_data[i]= tcp_conn->tc_adv_data[i+1];
+		tcp_conn->tc_adv_seq[i]= tcp_conn->tc_adv_seq[i+1];
 	}
-	else
+	tcp_conn->tc_adv_data[i]= NULL;
+}
+
+/*
+tcp_free_adv
+*/
+
+PUBLIC void tcp_free_adv(tcp_conn)
+tcp_conn_t *tcp_conn;
+{
+	while (tcp_conn->tc_adv_nr != 0)
 	{
-		/* New data doesn't fit. */
-		bf_afree(tcp_data);
+		bf_afree(tcp_conn->tc_adv_data[0]);
+		del_adv(tcp_conn, 0);
 	}
-	tcp_conn->tc_adv_data= adv_data;
-	tcp_conn->tc_adv_seq= adv_seq;
 }
-				
+
 PRIVATE void create_RST(tcp_conn, ip_hdr, tcp_hdr, data_len)
 tcp_conn_t *tcp_conn;
 ip_hdr_t *ip_hdr;
@@ -1043,7 +1082,6 @@ int data_len;
 		tmp_tcpopt->acc_linkC++;
 
 	tcp_extract_ipopt (tcp_conn, ip_hdr);
-	tcp_extract_tcpopt (tcp_conn, tcp_hdr);
 
 	RST_acc= tcp_make_header (tcp_conn, &RST_ip_hdr, &RST_tcp_hdr,
 		(acc_t *)0);
@@ -1079,7 +1117,8 @@ int data_len;
 
 	pack_size= bf_bufsize(RST_acc);
 	RST_ip_hdr->ih_length= htons(pack_size);
-	RST_tcp_hdr->th_window= htons(tcp_conn->tc_rcv_wnd);
+	RST_tcp_hdr->th_window= htons(tcp_adv_window(tcp_conn,
+		tcp_conn->tc_rcv_wnd));
 	RST_tcp_hdr->th_chksum= 0;
 
 	RST_acc->acc_linkC++;
@@ -1231,7 +1270,7 @@ int enq;					/* Enqueue writes. */
 		}
 	}
 	if (tcp_conn->tc_rcvd_data == NULL &&
-		tcp_conn->tc_adv_data == NULL)
+		tcp_conn->tc_adv_nr == 0)
 	{
 		/* Out of data, clear PUSH flag and reply to a read. */
 		tcp_conn->tc_flags &= ~TCF_RCV_PUSH;
@@ -21,6 +21,11 @@ THIS_FILE
 FORWARD acc_t *make_pack ARGS(( tcp_conn_t *tcp_conn ));
 FORWARD void tcp_send_timeout ARGS(( int conn, struct timer *timer ));
 FORWARD void do_snd_event ARGS(( event_t *ev, ev_arg_t arg ));
+FORWARD void set_snd_cwnd ARGS(( tcp_conn_t *tcp_conn, u32_t base,
+	u32_t new_win ));
+FORWARD int sack_hole ARGS(( tcp_conn_t *tcp_conn, u32_t *lop,
+	u32_t *hip ));
+FORWARD void sack_release ARGS(( tcp_conn_t *tcp_conn, u32_t seg_ack ));
 
 PUBLIC void tcp_conn_write (tcp_conn, enq)
 tcp_conn_t *tcp_conn;
@@ -153,12 +158,14 @@ tcp_conn_t *tcp_conn;
 	ip_hdr_t *ip_hdr;
 	int tot_hdr_size, ip_hdr_len;
 	u32_t seg_seq, seg_lo_data, queue_lo_data, seg_hi, seg_hi_data;
+	u32_t rxt_hi;
 	u16_t seg_up;
 	u8_t seg_flags;
 	time_t new_dis;
 	size_t pack_size;
 	time_t curr_time;
 	u8_t *optptr;
+	int shift, fast_rxt, i;
 
 	assert(tcp_conn->tc_busy);
 	curr_time= get_time();
@@ -177,14 +184,45 @@ tcp_conn_t *tcp_conn;
 
 		tcp_conn->tc_flags &= ~TCF_SEND_ACK;
 
-		/* Include a max segment size option. */
+		/* Include a max segment size option, a window scale
+		 * option if the receive window does not fit in 16 bits, and
+		 * offer selective acks.
+		 */
 		assert(tcp_conn->tc_tcpopt == NULL);
-		tcp_conn->tc_tcpopt= bf_memreq(4);
+		i= 4;
+		if (tcp_conn->tc_flags & TCF_WSCALE)
+			i += 4;
+		if (tcp_conn->tc_flags & TCF_SACK)
+			i += 4;
+		tcp_conn->tc_tcpopt= bf_memreq(i);
 		optptr= (u8_t *)ptr2acc_data(tcp_conn->tc_tcpopt);
 		optptr[0]= TCP_OPT_MSS;
 		optptr[1]= 4;
 		optptr[2]= tcp_conn->tc_mss >> 8;
 		optptr[3]= tcp_conn->tc_mss & 0xFF;
+		optptr += 4;
+		if (tcp_conn->tc_flags & TCF_WSCALE)
+		{
+			for (shift= 0; shift < TCP_MAX_WSCALE &&
+				(tcp_conn->tc_rcv_wnd >> shift) > 0xffff;
+				shift++)
+			{
+				/* nothing */
+			}
+			tcp_conn->tc_rcv_wscale= shift;
+			optptr[0]= TCP_OPT_NOP;
+			optptr[1]= TCP_OPT_WSOPT;
+			optptr[2]= 3;
+			optptr[3]= shift;
+			optptr += 4;
+		}
+		if (tcp_conn->tc_flags & TCF_SACK)
+		{
+			optptr[0]= TCP_OPT_NOP;
+			optptr[1]= TCP_OPT_NOP;
+			optptr[2]= TCP_OPT_SACKPERM;
+			optptr[3]= 2;
+		}
 
 		pack2write= tcp_make_header(tcp_conn, &ip_hdr, &tcp_hdr, 
 			(acc_t *)0);
@@ -236,6 +274,30 @@ tcp_conn_t *tcp_conn;
 	case TCS_CLOSING:
 		seg_seq= tcp_conn->tc_SND_TRM;
 
+		/* A fast retransmit resends the segment at SND_UNA, or
+		 * with selective acks the next hole in the scoreboard, and
+		 * leaves SND_TRM where it is.
+		 */
+		fast_rxt= 0;
+		rxt_hi= tcp_conn->tc_SND_NXT;
+		if (tcp_conn->tc_flags & TCF_FAST_RXT)
+		{
+			tcp_conn->tc_flags &= ~TCF_FAST_RXT;
+			if (tcp_conn->tc_SND_TRM != tcp_conn->tc_SND_UNA)
+			{
+				if (tcp_conn->tc_sack_nr == 0)
+				{
+					seg_seq= tcp_conn->tc_SND_UNA;
+					fast_rxt= 1;
+				}
+				else if (sack_hole(tcp_conn, &seg_seq,
+					&rxt_hi))
+				{
+					fast_rxt= 1;
+				}
+			}
+		}
+
 		seg_flags= 0;
 		pack2write= 0;
 		seg_up= 0;
@@ -282,6 +344,14 @@ tcp_conn_t *tcp_conn;
 				seg_hi_data--;
 			}
 
+			if (tcp_Lmod4G(rxt_hi, seg_hi_data))
+			{
+				/* Stop at the data the receiver has. */
+				seg_hi_data= rxt_hi;
+				seg_hi= seg_hi_data;
+				seg_flags &= ~THF_FIN;
+			}
+
 			if (!pack2write)
 			{
 				pack2write= tcp_make_header (tcp_conn,
@@ -316,7 +386,7 @@ tcp_conn_t *tcp_conn;
 				goto after_data;
 			}
 
-			if (seg_seq != tcp_conn->tc_SND_UNA &&
+			if (!fast_rxt && seg_seq != tcp_conn->tc_SND_UNA &&
 				seg_hi_data-seg_lo_data+tot_hdr_size < 
 				tcp_conn->tc_mss)
 			{
@@ -364,11 +434,18 @@ tcp_conn_t *tcp_conn;
 				seg_flags |= THF_PSH;
 			}
 
-			tcp_conn->tc_SND_TRM= seg_hi;
+			if (!fast_rxt ||
+				tcp_Gmod4G(seg_hi, tcp_conn->tc_SND_TRM))
+			{
+				tcp_conn->tc_SND_TRM= seg_hi;
+			}
+			if (fast_rxt)
+				tcp_conn->tc_rxt_nxt= seg_hi;
 
 			assert(tcp_conn->tc_transmit_timer.tim_active ||
 				(tcp_print_conn(tcp_conn), printf("\n"), 0));
-			if (tcp_conn->tc_rt_seq == 0 && 
+			if (!(tcp_conn->tc_flags & TCF_TS) &&
+				tcp_conn->tc_rt_seq == 0 && 
 				tcp_Gmod4G(seg_seq, tcp_conn->tc_rt_threshold))
 			{
 				tcp_conn->tc_rt_time= curr_time;
@@ -414,8 +491,8 @@ after_data:
 		tcp_hdr->th_seq_nr= htonl(seg_seq);
 		tcp_hdr->th_ack_nr= htonl(tcp_conn->tc_RCV_NXT);
 		tcp_hdr->th_flags= seg_flags;
-		tcp_hdr->th_window= htons(tcp_conn->tc_RCV_HI -
-			tcp_conn->tc_RCV_NXT);
+		tcp_hdr->th_window= htons(tcp_adv_window(tcp_conn,
+			tcp_conn->tc_RCV_HI - tcp_conn->tc_RCV_NXT));
 		tcp_hdr->th_urgptr= htons(seg_up);
 
 		pack_size= bf_bufsize(pack2write);
@@ -449,21 +526,34 @@ tcp_release_retrans
 PUBLIC void tcp_release_retrans(tcp_conn, seg_ack, new_win)
 tcp_conn_t *tcp_conn;
 u32_t seg_ack;
-u16_t new_win;
+u32_t new_win;
 {
 	size_t size, offset;
 	acc_t *pack;
 	time_t retrans_time, curr_time, rtt;
 	u32_t queue_lo, queue_hi;
-	u16_t mss, cthresh;
-	unsigned window;
+	u16_t mss;
+	u32_t acked;
 
 	assert(tcp_conn->tc_busy);
 	assert (tcp_GEmod4G(seg_ack, tcp_conn->tc_SND_UNA));
 	assert (tcp_LEmod4G(seg_ack, tcp_conn->tc_SND_NXT));
 
 	curr_time= get_time();
-	if (tcp_conn->tc_rt_seq != 0 && 
+	if (tcp_conn->tc_flags & TCF_TS)
+	{
+		/* The ack echoes the time at which the segment it
+		 * acknowledges was sent; that gives a sample for every ack.
+		 */
+		if (tcp_conn->tc_ts_ecr != 0 &&
+			tcp_LEmod4G(tcp_conn->tc_ts_ecr, curr_time))
+		{
+			tcp_rtt_sample(tcp_conn,
+				curr_time - tcp_conn->tc_ts_ecr);
+		}
+		tcp_conn->tc_ts_ecr= 0;
+	}
+	else if (tcp_conn->tc_rt_seq != 0 && 
 		tcp_Gmod4G(seg_ack, tcp_conn->tc_rt_seq))
 	{
 		assert(curr_time >= tcp_conn->tc_rt_time);
@@ -547,35 +637,40 @@ u16_t new_win;
 		}
 	}
 
-	/* Update the current window. */
-	window= tcp_conn->tc_snd_cwnd-tcp_conn->tc_SND_UNA;
+	/* Update the congestion window. */
 	mss= tcp_conn->tc_mss;
-	assert(seg_ack != tcp_conn->tc_SND_UNA);
+	acked= seg_ack-tcp_conn->tc_SND_UNA;
+	assert(acked != 0);
 
-	/* For every real ACK we try to increase the current window
-	 * with 1 mss.
-	 */
-	window += mss;
-
-	/* If the window becomes larger than the current threshold,
-	 * increment the threshold by a small amount and set the
-	 * window to the threshold.
-	 */
-	cthresh= tcp_conn->tc_snd_cthresh;
-	if (window > cthresh)
+	if (!(tcp_conn->tc_flags & TCF_RECOVERY))
 	{
-		cthresh += tcp_conn->tc_snd_cinc;
-		tcp_conn->tc_snd_cthresh= cthresh;
-		window= cthresh;
+		tcp_conn->tc_dupacks= 0;
+		(*tcp_conn->tc_cc->tcc_ack)(tcp_conn, acked);
+	}
+	else if (tcp_GEmod4G(seg_ack, tcp_conn->tc_recover))
+	{
+		/* Everything sent before the loss has arrived, recovery
+		 * is over. Deflate the window to the threshold.
+		 */
+		tcp_conn->tc_flags &= ~(TCF_RECOVERY|TCF_FAST_RXT);
+		tcp_conn->tc_dupacks= 0;
+		tcp_conn->tc_cwnd= tcp_conn->tc_snd_cthresh;
+	}
+	else
+	{
+		/* A partial ack: the segment after the acked data is lost
+		 * as well. Resend it at once, and take the acked data out
+		 * of the window, except for one mss (RFC 6582).
+		 */
+		tcp_conn->tc_flags |= TCF_FAST_RXT;
+		if (tcp_conn->tc_cwnd > acked)
+			tcp_conn->tc_cwnd -= acked;
+		else
+			tcp_conn->tc_cwnd= 0;
+		tcp_conn->tc_cwnd += mss;
 	}
 
-	/* If the window is larger than the window advertised by the
-	 * receiver, set the window size to the advertisement.
-	 */
-	if (window > new_win)
-		window= new_win;
-
-	tcp_conn->tc_snd_cwnd= seg_ack+window;
+	set_snd_cwnd(tcp_conn, seg_ack, new_win);
 
 	/* Release data queued for retransmissions. */
 	queue_lo= tcp_conn->tc_SND_UNA;
@@ -586,6 +681,7 @@ u16_t new_win;
 	{
 		tcp_conn->tc_SND_TRM= seg_ack;
 	}
+	sack_release(tcp_conn, seg_ack);
 	assert(tcp_GEmod4G(tcp_conn->tc_snd_cwnd, seg_ack));
 
 	if (queue_lo == tcp_conn->tc_ISS)
@@ -650,14 +746,274 @@ u16_t new_win;
 	DIFBLOCK(2, (tcp_conn->tc_snd_cwnd == tcp_conn->tc_SND_TRM),
 		printf("not sending: zero window\n"));
 
-	if (tcp_conn->tc_snd_cwnd != tcp_conn->tc_SND_TRM &&
-		tcp_conn->tc_SND_NXT != tcp_conn->tc_SND_TRM)
+	if ((tcp_conn->tc_snd_cwnd != tcp_conn->tc_SND_TRM &&
+		tcp_conn->tc_SND_NXT != tcp_conn->tc_SND_TRM) ||
+		(tcp_conn->tc_flags & TCF_FAST_RXT))
 	{
 		tcp_conn_write(tcp_conn, 1);
 	}
 
 }
 
+/*
+tcp_dup_ack
+
+An ack that acknowledges nothing new while data is outstanding.  The third
+one in a row starts a fast retransmit and NewReno fast recovery (RFC 6582).
+Every further one means that another segment has left the network, which
+makes room for one more.
+*/
+
+PUBLIC void tcp_dup_ack(tcp_conn, new_win)
+tcp_conn_t *tcp_conn;
+u32_t new_win;
+{
+	u32_t flight;
+
+	assert(tcp_conn->tc_busy);
+
+	tcp_conn->tc_dupacks++;
+	if (tcp_conn->tc_flags & TCF_RECOVERY)
+	{
+		tcp_conn->tc_cwnd += tcp_conn->tc_mss;
+
+		/* With selective acks, every duplicate ack may reveal
+		 * another hole to fill.
+		 */
+		if (tcp_conn->tc_sack_nr != 0)
+			tcp_conn->tc_flags |= TCF_FAST_RXT;
+	}
+	else
+	{
+		if (tcp_conn->tc_dupacks != TCP_DUPACK_THRESH)
+			return;
+
+		/* Acks for data sent before the last recovery or
+		 * timeout do not start another one.
+		 */
+		if (tcp_Lmod4G(tcp_conn->tc_SND_UNA, tcp_conn->tc_recover))
+			return;
+
+		DBLOCK(0x10, printf("conn[%d] fast retransmit at %lu\n",
+			(int)(tcp_conn-tcp_conn_table),
+			(unsigned long)tcp_conn->tc_SND_UNA));
+
+		flight= tcp_conn->tc_SND_TRM-tcp_conn->tc_SND_UNA;
+		tcp_conn->tc_recover= tcp_conn->tc_SND_TRM;
+		tcp_conn->tc_rxt_nxt= tcp_conn->tc_SND_UNA;
+		tcp_conn->tc_snd_cthresh=
+			(*tcp_conn->tc_cc->tcc_ssthresh)(tcp_conn, flight);
+		tcp_conn->tc_cwnd= tcp_conn->tc_snd_cthresh +
+			TCP_DUPACK_THRESH*tcp_conn->tc_mss;
+		tcp_conn->tc_flags |= TCF_RECOVERY | TCF_FAST_RXT;
+
+		/* No round trip sample from retransmitted data. */
+		tcp_conn->tc_rt_seq= 0;
+		if (tcp_Gmod4G(tcp_conn->tc_SND_TRM,
+			tcp_conn->tc_rt_threshold))
+		{
+			tcp_conn->tc_rt_threshold= tcp_conn->tc_SND_TRM;
+		}
+	}
+
+	set_snd_cwnd(tcp_conn, tcp_conn->tc_SND_UNA, new_win);
+	tcp_conn_write(tcp_conn, 1);
+}
+
+/*
+tcp_sack_mark
+
+Add a range the receiver reported in a SACK option to the scoreboard.
+Overlapping ranges are merged; when the scoreboard is full, the highest
+range goes.
+*/
+
+PUBLIC void tcp_sack_mark(tcp_conn, lo, hi)
+tcp_conn_t *tcp_conn;
+u32_t lo;
+u32_t hi;
+{
+	int i, j, nr;
+
+	/* Only data that was sent and not yet acked can be in a block. */
+	if (!tcp_Lmod4G(tcp_conn->tc_SND_UNA, lo) || !tcp_Lmod4G(lo, hi) ||
+		tcp_Gmod4G(hi, tcp_conn->tc_SND_TRM))
+	{
+		return;
+	}
+
+	nr= tcp_conn->tc_sack_nr;
+	for (i= 0; i<nr; )
+	{
+		if (tcp_Lmod4G(tcp_conn->tc_sack_hi[i], lo) ||
+			tcp_Gmod4G(tcp_conn->tc_sack_lo[i], hi))
+		{
+			i++;
+			continue;
+		}
+		if (tcp_Lmod4G(tcp_conn->tc_sack_lo[i], lo))
+			lo= tcp_conn->tc_sack_lo[i];
+		if (tcp_Gmod4G(tcp_conn->tc_sack_hi[i], hi))
+			hi= tcp_conn->tc_sack_hi[i];
+		nr--;
+		for (j= i; j<nr; j++)
+		{
+			tcp_conn->tc_sack_lo[j]= tcp_conn->tc_sack_lo[j+1];
+			tcp_conn->tc_sack_hi[j]= tcp_conn->tc_sack_hi[j+1];
+		}
+	}
+
+	for (i= 0; i<nr; i++)
+	{
+		if (tcp_Lmod4G(lo, tcp_conn->tc_sack_lo[i]))
+			break;
+	}
+	if (nr == TCP_SACK_NR)
+	{
+		if (i == nr)
+			return;
+		nr--;
+	}
+	for (j= nr; j>i; j--)
+	{
+		tcp_conn->tc_sack_lo[j]= tcp_conn->tc_sack_lo[j-1];
+		tcp_conn->tc_sack_hi[j]= tcp_conn->tc_sack_hi[j-1];
+	}
+	tcp_conn->tc_sack_lo[i]= lo;
+	tcp_conn->tc_sack_hi[i]= hi;
+	tcp_conn->tc_sack_nr= nr+1;
+}
+
+/*
+sack_release
+
+Drop the ranges in the scoreboard that the cumulative ack now covers.
+*/
+
+PRIVATE void sack_release(tcp_conn, seg_ack)
+tcp_conn_t *tcp_conn;
+u32_t seg_ack;
+{
+	int i, n;
+
+	for (n= 0; n<tcp_conn->tc_sack_nr; n++)
+	{
+		if (tcp_Gmod4G(tcp_conn->tc_sack_hi[n], seg_ack))
+			break;
+	}
+	tcp_conn->tc_sack_nr -= n;
+	for (i= 0; i<tcp_conn->tc_sack_nr; i++)
+	{
+		tcp_conn->tc_sack_lo[i]= tcp_conn->tc_sack_lo[i+n];
+		tcp_conn->tc_sack_hi[i]= tcp_conn->tc_sack_hi[i+n];
+	}
+	if (tcp_conn->tc_sack_nr != 0 &&
+		tcp_Lmod4G(tcp_conn->tc_sack_lo[0], seg_ack))
+	{
+		tcp_conn->tc_sack_lo[0]= seg_ack;
+	}
+}
+
+/*
+sack_hole
+
+Find the first hole below the highest selectively acked byte that has not
+been resent during this recovery.
+*/
+
+PRIVATE int sack_hole(tcp_conn, lop, hip)
+tcp_conn_t *tcp_conn;
+u32_t *lop;
+u32_t *hip;
+{
+	u32_t seq;
+	int i;
+
+	seq= tcp_conn->tc_SND_UNA;
+	if (tcp_Lmod4G(seq, tcp_conn->tc_rxt_nxt))
+		seq= tcp_conn->tc_rxt_nxt;
+	for (i= 0; i<tcp_conn->tc_sack_nr; i++)
+	{
+		if (tcp_Lmod4G(seq, tcp_conn->tc_sack_lo[i]))
+		{
+			*lop= seq;
+			*hip= tcp_conn->tc_sack_lo[i];
+			return 1;
+		}
+		if (tcp_Lmod4G(seq, tcp_conn->tc_sack_hi[i]))
+			seq= tcp_conn->tc_sack_hi[i];
+	}
+	return 0;
+}
+
+/*
+set_snd_cwnd
+
+Put the edge of the send window at 'base' plus the smaller of the congestion
+window and the window advertised by the receiver. A congestion window that
+shrinks below what has already been sent does not take that data back;
+nothing new is sent until the acks catch up.
+*/
+
+PRIVATE void set_snd_cwnd(tcp_conn, base, new_win)
+tcp_conn_t *tcp_conn;
+u32_t base;
+u32_t new_win;
+{
+	u32_t window;
+
+	window= tcp_conn->tc_cwnd;
+	if (window > new_win)
+		window= new_win;
+	if (tcp_Lmod4G(base+window, tcp_conn->tc_SND_TRM) &&
+		tcp_conn->tc_SND_TRM-base <= new_win)
+	{
+		window= tcp_conn->tc_SND_TRM-base;
+	}
+	tcp_conn->tc_snd_cwnd= base+window;
+}
+
+/*
+tcp_rtt_sample
+
+Fold a round trip time measurement into the smoothed estimates (Jacobson
+and Karels) and derive the retransmission timeout from them.
+*/
+
+PUBLIC void tcp_rtt_sample(tcp_conn, sample)
+tcp_conn_t *tcp_conn;
+time_t sample;
+{
+	time_t delta, rtt;
+
+	if (tcp_conn->tc_srtt == 0)
+	{
+		/* First measurement. */
+		tcp_conn->tc_srtt= sample << 3;
+		tcp_conn->tc_rttvar= sample << 1;
+	}
+	else
+	{
+		delta= sample - (tcp_conn->tc_srtt >> 3);
+		tcp_conn->tc_srtt += delta;
+		if (delta < 0)
+			delta= -delta;
+		tcp_conn->tc_rttvar += delta - (tcp_conn->tc_rttvar >> 2);
+	}
+
+	rtt= (tcp_conn->tc_srtt >> 3) + tcp_conn->tc_rttvar;
+	if (rtt < TCP_RTT_GRAN*CLOCK_GRAN)
+		rtt= TCP_RTT_GRAN*CLOCK_GRAN;
+	if (rtt > TCP_RTT_MAX)
+		rtt= TCP_RTT_MAX;
+	tcp_conn->tc_rtt= rtt;
+
+	DBLOCK(0x20, printf(
+	"tcp_rtt_sample, conn[%d]: sample= %ld ms, rtt= %ld ms\n",
+		(int)(tcp_conn-tcp_conn_table), sample*1000/HZ,
+		tcp_conn->tc_rtt*1000/HZ));
+}
+
 /*
 tcp_send_timeout
 */
@@ -668,6 +1024,7 @@ struct timer *timer;
 {
 	tcp_conn_t *tcp_conn;
 	u16_t mss, mss2;
+	u32_t flight;
 	time_t curr_time, stt, timeout;
 
 	curr_time= get_time();
@@ -763,8 +1120,21 @@ struct timer *timer;
 	if (tcp_Gmod4G(tcp_conn->tc_SND_TRM, tcp_conn->tc_rt_threshold))
 		tcp_conn->tc_rt_threshold= tcp_conn->tc_SND_TRM;
 
+	flight= tcp_conn->tc_SND_TRM-tcp_conn->tc_SND_UNA;
 	tcp_conn->tc_SND_TRM= tcp_conn->tc_SND_UNA;
 
+	/* A timeout ends fast recovery. Duplicate acks for the data that
+	 * was sent before it must not start another one.
+	 */
+	tcp_conn->tc_flags &= ~(TCF_RECOVERY|TCF_FAST_RXT);
+	tcp_conn->tc_dupacks= 0;
+	tcp_conn->tc_recover= tcp_conn->tc_rt_threshold;
+
+	/* The receiver may have thrown away data it acked selectively
+	 * (RFC 2018), start again with an empty scoreboard.
+	 */
+	tcp_conn->tc_sack_nr= 0;
+
 	mss= tcp_conn->tc_mss;
 	mss2= 2*mss;
 
@@ -776,9 +1146,9 @@ struct timer *timer;
 		if (tcp_Gmod4G(tcp_conn->tc_SND_TRM, tcp_conn->tc_snd_cwnd))
 			tcp_conn->tc_SND_TRM= tcp_conn->tc_snd_cwnd;
 
-		tcp_conn->tc_snd_cthresh /= 2;
-		if (tcp_conn->tc_snd_cthresh < mss2)
-			tcp_conn->tc_snd_cthresh= mss2;
+		tcp_conn->tc_snd_cthresh=
+			(*tcp_conn->tc_cc->tcc_ssthresh)(tcp_conn, flight);
+		tcp_conn->tc_cwnd= mss2;
 	}
 
 	stt= tcp_conn->tc_stt;
@@ -802,7 +1172,7 @@ struct timer *timer;
 	clck_timer(&tcp_conn->tc_transmit_timer, timeout,
 		tcp_send_timeout, (int)(tcp_conn-tcp_conn_table));
 
-	if (tcp_conn->tc_rt_seq == 0)
+	if (!(tcp_conn->tc_flags & TCF_TS) && tcp_conn->tc_rt_seq == 0)
 	{
 		tcp_conn->tc_rt_time= curr_time-tcp_conn->tc_rtt;
 		tcp_conn->tc_rt_seq= tcp_conn->tc_SND_UNA;
@@ -1065,11 +1435,7 @@ int error;
 	tcp_conn->tc_flags &= ~TCF_FIN_RECV;
 	tcp_conn->tc_RCV_LO= tcp_conn->tc_RCV_NXT;
 
-	if (tcp_conn->tc_adv_data)
-	{
-		bf_afree(tcp_conn->tc_adv_data);
-		tcp_conn->tc_adv_data= NULL;
-	}
+	tcp_free_adv(tcp_conn);
 
 	if (tcp_conn->tc_send_data)
 	{
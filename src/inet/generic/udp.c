@@ -18,8 +18,7 @@ Copyright 1995 Philip Homburg
 
 THIS_FILE
 
-#define UDP_FD_NR		(4*IP_PORT_MAX)
-#define UDP_PORT_HASH_NR	16		/* Must be a power of 2 */
+#define UDP_PORT_HASH_MIN	16		/* Must be a power of 2 */
 
 typedef struct udp_port
 {
@@ -32,7 +31,7 @@ typedef struct udp_port
 	struct udp_fd *up_next_fd;
 	struct udp_fd *up_write_fd;
 	struct udp_fd *up_port_any;
-	struct udp_fd *up_port_hash[UDP_PORT_HASH_NR];
+	struct udp_fd **up_port_hash;
 } udp_port_t;
 
 #define UPF_EMPTY	0x0
@@ -75,9 +74,7 @@ typedef struct udp_fd
 
 FORWARD void read_ip_packets ARGS(( udp_port_t *udp_port ));
 FORWARD void udp_buffree ARGS(( int priority ));
-#ifdef BUF_CONSISTENCY_CHECK
 FORWARD void udp_bufcheck ARGS(( void ));
-#endif
 FORWARD void udp_main ARGS(( udp_port_t *udp_port ));
 FORWARD acc_t *udp_get_data ARGS(( int fd, size_t offset, size_t count, 
 	int for_ioctl ));
@@ -101,11 +98,25 @@ FORWARD void hash_fd ARGS(( udp_fd_t *udp_fd ));
 FORWARD void unhash_fd ARGS(( udp_fd_t *udp_fd ));
 
 PRIVATE udp_port_t *udp_port_table;
-PRIVATE udp_fd_t udp_fd_table[UDP_FD_NR];
+PRIVATE udp_fd_t *udp_fd_table;
+PRIVATE int udp_port_hash_nr;		/* A power of 2 */
 
 PUBLIC void udp_prep()
 {
+	int i;
+
 	udp_port_table= alloc(ip_conf_nr * sizeof(udp_port_table[0]));
+	udp_fd_table= alloc(udp_fd_nr * sizeof(udp_fd_table[0]));
+
+	/* About one channel per hash chain. */
+	udp_port_hash_nr= UDP_PORT_HASH_MIN;
+	while (udp_port_hash_nr < udp_fd_nr)
+		udp_port_hash_nr <<= 1;
+	for (i= 0; i<ip_conf_nr; i++)
+	{
+		udp_port_table[i].up_port_hash= alloc(udp_port_hash_nr *
+			sizeof(udp_port_table[i].up_port_hash[0]));
+	}
 }
 
 PUBLIC void udp_init()
@@ -123,18 +134,14 @@ PUBLIC void udp_init()
 	assert (UDP_IO_HDR_SIZE == sizeof(udp_io_hdr_t));
 
 #if ZERO
-	for (i= 0, udp_fd= udp_fd_table; i<UDP_FD_NR; i++, udp_fd++)
+	for (i= 0, udp_fd= udp_fd_table; i<udp_fd_nr; i++, udp_fd++)
 	{
 		udp_fd->uf_flags= UFF_EMPTY;
 		udp_fd->uf_rdbuf_head= NULL;
 	}
 #endif
 
-#ifndef BUF_CONSISTENCY_CHECK
-	bf_logon(udp_buffree);
-#else
-	bf_logon(udp_buffree, udp_bufcheck);
-#endif
+	bf_logon("udp", udp_buffree, udp_bufcheck);
 
 	for (i= 0, udp_port= udp_port_table, icp= ip_conf;
 		i<ip_conf_nr; i++, udp_port++, icp++)
@@ -149,7 +156,7 @@ PUBLIC void udp_init()
 #if ZERO
 		udp_port->up_write_fd= NULL;
 		udp_port->up_port_any= NULL;
-		for (j= 0; j<UDP_PORT_HASH_NR; j++)
+		for (j= 0; j<udp_port_hash_nr; j++)
 			udp_port->up_port_hash[j]= NULL;
 #endif
 
@@ -209,7 +216,7 @@ udp_port_t *udp_port;
 	case UPS_MAIN:
 		udp_port->up_flags &= ~UPF_SUSPEND;
 
-		for (i= 0, udp_fd= udp_fd_table; i<UDP_FD_NR; i++, udp_fd++)
+		for (i= 0, udp_fd= udp_fd_table; i<udp_fd_nr; i++, udp_fd++)
 		{
 			if (!(udp_fd->uf_flags & UFF_INUSE))
 				continue;
@@ -239,10 +246,10 @@ put_pkt_t put_pkt;
 	int i;
 	udp_fd_t *udp_fd;
 
-	for (i= 0; i<UDP_FD_NR && (udp_fd_table[i].uf_flags & UFF_INUSE);
+	for (i= 0; i<udp_fd_nr && (udp_fd_table[i].uf_flags & UFF_INUSE);
 		i++);
 
-	if (i>= UDP_FD_NR)
+	if (i>= udp_fd_nr)
 	{
 		DBLOCK(1, printf("out of fds\n"));
 		return EAGAIN;
@@ -611,7 +618,7 @@ assert (data->acc_length == sizeof(nwio_udpopt_t));
 	if ((new_flags & NWUO_LOCPORT_MASK) == NWUO_LP_SEL ||
 		(new_flags & NWUO_LOCPORT_MASK) == NWUO_LP_SET)
 	{
-		for (i= 0, fd_ptr= udp_fd_table; i<UDP_FD_NR; i++, fd_ptr++)
+		for (i= 0, fd_ptr= udp_fd_table; i<udp_fd_nr; i++, fd_ptr++)
 		{
 			if (fd_ptr == udp_fd)
 				continue;
@@ -679,7 +686,7 @@ int fd;
 	if (is_unused_port(nw_port))
 		return nw_port;
 
-	for (port= 0xC000+UDP_FD_NR; port < 0xFFFF; port++)
+	for (port= 0xC000+udp_fd_nr; port < 0xFFFF; port++)
 	{
 		nw_port= htons(port);
 		if (is_unused_port(nw_port))
@@ -728,7 +735,7 @@ udpport_t port;
 	int i;
 	udp_fd_t *udp_fd;
 
-	for (i= 0, udp_fd= udp_fd_table; i<UDP_FD_NR; i++,
+	for (i= 0, udp_fd= udp_fd_table; i<udp_fd_nr; i++,
 		udp_fd++)
 	{
 		if (!(udp_fd->uf_flags & UFF_OPTSET))
@@ -1010,7 +1017,7 @@ size_t pack_size;
 
 	hash= dst_port;
 	hash ^= (hash >> 8);
-	hash &= (UDP_PORT_HASH_NR-1);
+	hash &= (udp_port_hash_nr-1);
 
 	for (i= 0; i<2; i++)
 	{
@@ -1395,10 +1402,10 @@ assert (!(udp_port->up_flags & (UPF_WRITE_IP|UPF_WRITE_SP)));
 	{
 		udp_port->up_flags &= ~UPF_MORE2WRITE;
 
-		for (i= 0, udp_fd= udp_port->up_next_fd; i<UDP_FD_NR;
+		for (i= 0, udp_fd= udp_port->up_next_fd; i<udp_fd_nr;
 			i++, udp_fd++)
 		{
-			if (udp_fd == &udp_fd_table[UDP_FD_NR])
+			if (udp_fd == &udp_fd_table[udp_fd_nr])
 				udp_fd= udp_fd_table;
 
 			if (!(udp_fd->uf_flags & UFF_INUSE))
@@ -1465,7 +1472,7 @@ int priority;
 
 	if (priority ==  UDP_PRI_FDBUFS_EXTRA)
 	{
-		for (i=0, udp_fd= udp_fd_table; i<UDP_FD_NR; i++, udp_fd++)
+		for (i=0, udp_fd= udp_fd_table; i<udp_fd_nr; i++, udp_fd++)
 		{
 			while (udp_fd->uf_rdbuf_head &&
 				udp_fd->uf_rdbuf_head->acc_ext_link)
@@ -1479,7 +1486,7 @@ int priority;
 
 	if (priority  == UDP_PRI_FDBUFS)
 	{
-		for (i=0, udp_fd= udp_fd_table; i<UDP_FD_NR; i++, udp_fd++)
+		for (i=0, udp_fd= udp_fd_table; i<udp_fd_nr; i++, udp_fd++)
 		{
 			while (udp_fd->uf_rdbuf_head)
 			{
@@ -1532,7 +1539,7 @@ udp_fd_t *udp_fd;
 	{
 		hash= udp_fd->uf_udpopt.nwuo_locport;
 		hash ^= (hash >> 8);
-		hash &= (UDP_PORT_HASH_NR-1);
+		hash &= (udp_port_hash_nr-1);
 
 		udp_fd->uf_port_next= udp_port->up_port_hash[hash];
 		udp_port->up_port_hash[hash]= udp_fd;
@@ -1556,7 +1563,7 @@ udp_fd_t *udp_fd;
 	{
 		hash= udp_fd->uf_udpopt.nwuo_locport;
 		hash ^= (hash >> 8);
-		hash &= (UDP_PORT_HASH_NR-1);
+		hash &= (udp_port_hash_nr-1);
 
 		udp_fd_p= &udp_port->up_port_hash[hash];
 	}
@@ -1573,7 +1580,6 @@ udp_fd_t *udp_fd;
 		*udp_fd_p= curr->uf_port_next;
 }
 
-#ifdef BUF_CONSISTENCY_CHECK
 PRIVATE void udp_bufcheck()
 {
 	int i;
@@ -1587,7 +1593,7 @@ PRIVATE void udp_bufcheck()
 			bf_check_acc(udp_port->up_wr_pack);
 	}
 
-	for (i= 0, udp_fd= udp_fd_table; i<UDP_FD_NR; i++, udp_fd++)
+	for (i= 0, udp_fd= udp_fd_table; i<udp_fd_nr; i++, udp_fd++)
 	{
 		for (tmp_acc= udp_fd->uf_rdbuf_head; tmp_acc; 
 			tmp_acc= tmp_acc->acc_ext_link)
@@ -1596,7 +1602,6 @@ PRIVATE void udp_bufcheck()
 		}
 	}
 }
-#endif
 
 /*
  * $PchId: udp.c,v 1.10 1996/08/06 06:48:05 philip Exp $
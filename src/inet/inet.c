@@ -153,6 +153,7 @@ PRIVATE void nw_init()
 
 	/* Read configuration. */
 	read_conf();
+	sr_prep();
 #if ENABLE_ETH
 	eth_prep();
 #endif /* ENABLE_ETH */
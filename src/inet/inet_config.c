@@ -37,6 +37,16 @@ int psip_conf_nr;
 #endif
 int ip_conf_nr;
 
+int sr_fd_nr;
+int tcp_fd_nr;
+int tcp_conn_nr;
+int udp_fd_nr;
+int iroute_nr;
+int oroute_nr;
+int arp_cache_nr;
+int ip_ass_nr;
+int ip_ass_kb;
+
 static u8_t iftype[IP_PORT_MAX];	/* Interface in use as? */
 static int ifdefault= -1;		/* Default network interface. */
 
@@ -217,8 +227,68 @@ void read_conf(void)
 	ecp= eth_conf;
 	pcp= psip_conf;
 	icp= ip_conf;
+	tcp_fd_nr= TCP_FD_NR;
+	tcp_conn_nr= 0;
+	udp_fd_nr= UDP_FD_NR;
+	iroute_nr= IROUTE_NR;
+	oroute_nr= OROUTE_NR;
+	arp_cache_nr= ARP_CACHE_NR;
+	ip_ass_nr= IP_ASS_NR;
+	ip_ass_kb= IP_ASS_KB;
 
 	while (token(0), word[0] != 0) {
+		if (strcmp(word, "tcp") == 0) {
+			/* tcp <channels> [<connections>]; */
+			token(1);
+			tcp_fd_nr= number(word, SR_FD_MAX);
+			token(0);
+			if (word[0] != ';' && word[0] != 0) {
+				tcp_conn_nr= number(word, (unsigned) -1 / 10 - 1);
+				token(0);
+			}
+			if (word[0] != ';' && word[0] != 0) error();
+			continue;
+		}
+		if (strcmp(word, "udp") == 0) {
+			/* udp <channels>; */
+			token(1);
+			udp_fd_nr= number(word, SR_FD_MAX);
+			token(0);
+			if (word[0] != ';' && word[0] != 0) error();
+			continue;
+		}
+		if (strcmp(word, "route") == 0) {
+			/* route <input> [<output>]; */
+			token(1);
+			iroute_nr= number(word, (unsigned) -1 / 10 - 1);
+			token(0);
+			if (word[0] != ';' && word[0] != 0) {
+				oroute_nr= number(word, (unsigned) -1 / 10 - 1);
+				token(0);
+			}
+			if (word[0] != ';' && word[0] != 0) error();
+			continue;
+		}
+		if (strcmp(word, "arp") == 0) {
+			/* arp <entries>; */
+			token(1);
+			arp_cache_nr= number(word, (unsigned) -1 / 10 - 1);
+			token(0);
+			if (word[0] != ';' && word[0] != 0) error();
+			continue;
+		}
+		if (strcmp(word, "reass") == 0) {
+			/* reass <datagrams> [<kilobytes>]; */
+			token(1);
+			ip_ass_nr= number(word, (unsigned) -1 / 10 - 1);
+			token(0);
+			if (word[0] != ';' && word[0] != 0) {
+				ip_ass_kb= number(word, (unsigned) -1 / 10 - 1);
+				token(0);
+			}
+			if (word[0] != ';' && word[0] != 0) error();
+			continue;
+		}
 		if (strncmp(word, "eth", 3) == 0) {
 			ecp->ec_ifno= ifno= number(word+3, IP_PORT_MAX-1);
 			type= NETTYPE_ETH;
@@ -275,6 +345,22 @@ void read_conf(void)
 		exit(1);
 	}
 
+	/* Every channel needs a connection, and the first connection of each
+	 * network is kept for sending resets.  Connections that linger after
+	 * their channel is closed need more.  Extra channels need room in the
+	 * table of open channels.
+	 */
+	if (tcp_conn_nr == 0) tcp_conn_nr= 2*tcp_fd_nr;
+	if (tcp_conn_nr < tcp_fd_nr + ip_conf_nr)
+		tcp_conn_nr= tcp_fd_nr + ip_conf_nr;
+	sr_fd_nr= SR_FD_NR;
+	if (tcp_fd_nr > TCP_FD_NR) sr_fd_nr += tcp_fd_nr - TCP_FD_NR;
+	if (udp_fd_nr > UDP_FD_NR) sr_fd_nr += udp_fd_nr - UDP_FD_NR;
+	if (sr_fd_nr > SR_FD_MAX) sr_fd_nr= SR_FD_MAX;
+
+	/* Reassembly needs at least one entry to work with. */
+	if (ip_ass_nr == 0) ip_ass_nr= 1;
+
 	/* Set umask 0 so we can creat mode 666 devices. */
 	(void) umask(0);
 
@@ -27,6 +27,26 @@ extern int eth_conf_nr;		/* Number of ethernets */
 extern int psip_conf_nr;	/* Number of Pseudo IP networks */
 extern int ip_conf_nr;		/* Number of configured TCP/IP layers */
 
+/* Table sizes, the defaults can be changed in the configuration file. */
+#define SR_FD_NR	(16*IP_PORT_MAX)	/* Open channels, any kind */
+#define SR_FD_MAX	256		/* Open channels are minor devices */
+#define TCP_FD_NR	(10*IP_PORT_MAX)	/* TCP channels */
+#define UDP_FD_NR	(4*IP_PORT_MAX)		/* UDP channels */
+#define IROUTE_NR	(sizeof(int) == 2 ? 64 : 512)	/* Input routes */
+#define OROUTE_NR	32			/* Output routes */
+#define ARP_CACHE_NR	(sizeof(int) == 2 ? 64 : 1024)	/* ARP entries */
+#define IP_ASS_NR	(sizeof(int) == 2 ? 4 : 16)	/* Reassembled datagrams */
+#define IP_ASS_KB	(sizeof(int) == 2 ? 8 : 32)	/* ... and kilobytes */
+extern int sr_fd_nr;		/* Number of open channels */
+extern int tcp_fd_nr;		/* Number of TCP channels */
+extern int tcp_conn_nr;		/* Number of TCP connections */
+extern int udp_fd_nr;		/* Number of UDP channels */
+extern int iroute_nr;		/* Number of input routes */
+extern int oroute_nr;		/* Number of output routes */
+extern int arp_cache_nr;	/* Number of ARP cache entries */
+extern int ip_ass_nr;		/* Number of datagrams in reassembly */
+extern int ip_ass_kb;		/* Kilobytes held for reassembly */
+
 extern dev_t ip_dev;		/* Device number of /dev/ip */
 
 struct eth_conf
@@ -23,7 +23,8 @@ Copyright 1995 Philip Homburg
 THIS_FILE
 
 FORWARD _PROTOTYPE( void setup_read, (eth_port_t *eth_port) );
-FORWARD _PROTOTYPE( void read_int, (eth_port_t *eth_port, int count) );
+FORWARD _PROTOTYPE( void read_int, (eth_port_t *eth_port, message *m) );
+FORWARD _PROTOTYPE( void read_batch, (eth_port_t *eth_port, message *m) );
 FORWARD _PROTOTYPE( void write_int, (eth_port_t *eth_port) );
 FORWARD _PROTOTYPE( void eth_recvev, (event_t *ev, ev_arg_t ev_arg) );
 FORWARD _PROTOTYPE( void eth_sendev, (event_t *ev, ev_arg_t ev_arg) );
@@ -262,7 +263,7 @@ message *m;
 	if (stat & DL_PACK_SEND)
 		write_int(loc_port);
 	if (stat & DL_PACK_RECV)
-		read_int(loc_port, m->DL_COUNT);
+		read_int(loc_port, m);
 }
 
 #ifndef notdef
@@ -384,33 +385,65 @@ eth_port_t *eth_port;
 	eth_restart_write(eth_port);
 }
 
-PRIVATE void read_int(eth_port, count)
+PRIVATE void read_int(eth_port, m)
 eth_port_t *eth_port;
-int count;
+message *m;
+{
+	read_batch(eth_port, m);
+	
+	eth_port->etp_flags &= ~(EPF_READ_IP|EPF_READ_SP);
+	setup_read(eth_port);
+}
+
+PRIVATE void read_batch(eth_port, m)
+eth_port_t *eth_port;
+message *m;
 {
-	acc_t *pack, *cut_pack;
+/* Hand the packets the driver put in the read buffers to eth_arrive().
+ * The buffers were given to the driver, so the data is already in place
+ * and only the accessors are trimmed to the packet length.  A driver that
+ * doesn't do batches fills just the first buffer.
+ */
+	acc_t *pack, *next_pack, *cut_pack;
+	iovec_t *iovec;
+	int i, count;
 
 	pack= eth_port->etp_rd_pack;
 	eth_port->etp_rd_pack= NULL;
+	iovec= eth_port->etp_osdep.etp_rd_iovec;
 
-	cut_pack= bf_cut(pack, 0, count);
-	bf_afree(pack);
+	for (i= 0; pack; i++, pack= next_pack)
+	{
+		next_pack= pack->acc_ext_link;
+		pack->acc_ext_link= NULL;
 
-	eth_arrive(eth_port, cut_pack, count);
-	
-	eth_port->etp_flags &= ~(EPF_READ_IP|EPF_READ_SP);
-	setup_read(eth_port);
+		if (!(m->DL_STAT & DL_PACK_BATCH))
+			count= (i == 0 ? m->DL_COUNT : 0);
+		else if (i < m->DL_COUNT)
+			count= iovec[i*RD_IOVEC].iov_size;
+		else
+			count= 0;
+		if (count == 0)
+		{
+			bf_afree(pack);
+			continue;
+		}
+		cut_pack= bf_cut(pack, 0, count);
+		bf_afree(pack);
+
+		eth_arrive(eth_port, cut_pack, count);
+	}
 }
 
 PRIVATE void setup_read(eth_port)
 eth_port_t *eth_port;
 {
 	eth_port_t *loc_port;
-	acc_t *pack, *pack_ptr;
+	acc_t *pack, *pack_ptr, *last_pack;
 	message mess1, block_msg;
 	iovec_t *iovec;
 	ev_arg_t ev_arg;
-	int i, r;
+	int i, j, n, r;
 
 	assert(!(eth_port->etp_flags & (EPF_READ_IP|EPF_READ_SP)));
 
@@ -418,21 +451,44 @@ eth_port_t *eth_port;
 	{
 		assert (!eth_port->etp_rd_pack);
 
+		/* Post RD_BATCH packet buffers, RD_IOVEC iovecs each, for
+		 * the driver to copy the packets into.
+		 */
 		iovec= eth_port->etp_osdep.etp_rd_iovec;
-		pack= bf_memreq (ETH_MAX_PACK_SIZE);
-
-		for (i=0, pack_ptr= pack; i<RD_IOVEC && pack_ptr;
-			i++, pack_ptr= pack_ptr->acc_next)
+		last_pack= NULL;
+		for (n= 0, i= 0; n<RD_BATCH; n++)
 		{
-			iovec[i].iov_addr= (vir_bytes)ptr2acc_data(pack_ptr);
-			iovec[i].iov_size= (vir_bytes)pack_ptr->acc_length;
+			pack= bf_memreq (ETH_MAX_PACK_SIZE);
+
+			for (j=0, pack_ptr= pack; j<RD_IOVEC && pack_ptr;
+				i++, j++, pack_ptr= pack_ptr->acc_next)
+			{
+				iovec[i].iov_addr=
+					(vir_bytes)ptr2acc_data(pack_ptr);
+				iovec[i].iov_size=
+					(vir_bytes)pack_ptr->acc_length;
+			}
+			assert (!pack_ptr);
+			for (; j<RD_IOVEC; i++, j++)
+			{
+				iovec[i].iov_addr= 0;
+				iovec[i].iov_size= 0;
+			}
+
+			pack->acc_ext_link= NULL;
+			if (last_pack)
+				last_pack->acc_ext_link= pack;
+			else
+				eth_port->etp_rd_pack= pack;
+			last_pack= pack;
 		}
-		assert (!pack_ptr);
 
 		mess1.m_type= DL_READV;
 		mess1.DL_PORT= eth_port->etp_osdep.etp_port;
 		mess1.DL_PROC= this_proc;
 		mess1.DL_COUNT= i;
+		mess1.DL_MODE= DL_BATCH_REQ |
+			((long) RD_IOVEC << DL_STRIDE_SHIFT);
 		mess1.DL_ADDR= (char *)iovec;
 
 		for (;;)
@@ -484,16 +540,12 @@ eth_port_t *eth_port;
 
 		if (mess1.DL_STAT & DL_PACK_RECV)
 		{
-			/* packet received */
-			pack_ptr= bf_cut(pack, 0, mess1.DL_COUNT);
-			bf_afree(pack);
-
-			eth_arrive(eth_port, pack_ptr, mess1.DL_COUNT);
+			/* packets received */
+			read_batch(eth_port, &mess1);
 		}
 		else
 		{
 			/* no packet received */
-			eth_port->etp_rd_pack= pack;
 			eth_port->etp_flags |= EPF_READ_IP;
 		}
 
@@ -524,7 +576,7 @@ ev_arg_t ev_arg;
 	assert(m_ptr->DL_STAT & DL_PACK_RECV);
 	m_ptr->DL_STAT &= ~DL_PACK_RECV;
 
-	read_int(eth_port, m_ptr->DL_COUNT);
+	read_int(eth_port, m_ptr);
 }
 
 PRIVATE void eth_sendev(ev, ev_arg)
@@ -12,7 +12,12 @@ Copyright 1995 Philip Homburg
 #include "generic/event.h"
 
 #define IOVEC_NR	16
-#define RD_IOVEC	((ETH_MAX_PACK_SIZE + BUF_S -1)/BUF_S)
+#define RD_IOVEC	((ETH_MAX_PACK_SIZE + BUF_GRAN -1)/BUF_GRAN)
+#if CRAMPED
+#define RD_BATCH	2	/* packets posted per read request */
+#else
+#define RD_BATCH	4
+#endif
 
 typedef struct osdep_eth_port
 {
@@ -20,7 +25,7 @@ typedef struct osdep_eth_port
 	int etp_port;
 	int etp_recvconf;
 	iovec_t etp_wr_iovec[IOVEC_NR];
-	iovec_t etp_rd_iovec[RD_IOVEC];
+	iovec_t etp_rd_iovec[RD_BATCH * RD_IOVEC];
 	event_t etp_recvev;
 	message etp_sendrepl;
 	message etp_recvrepl;
@@ -53,8 +53,6 @@
 
 THIS_FILE
 
-#define FD_NR			(16*IP_PORT_MAX)
-
 typedef struct sr_fd
 {
 	int srf_flags;
@@ -104,16 +102,21 @@ FORWARD _PROTOTYPE ( int cp_u2b, (int proc, char *src, acc_t **var_acc_ptr,
 								 size_t size) );
 FORWARD _PROTOTYPE ( int cp_b2u, (acc_t *acc_ptr, int proc, char *dest) );
 
-PRIVATE sr_fd_t sr_fd_table[FD_NR];
+PRIVATE sr_fd_t *sr_fd_table;
 PRIVATE mq_t *repl_queue, *repl_queue_tail;
 PRIVATE cpvec_t cpvec[CPVEC_NR];
 
+PUBLIC void sr_prep()
+{
+	sr_fd_table= alloc(sr_fd_nr * sizeof(sr_fd_table[0]));
+}
+
 PUBLIC void sr_init()
 {
 #if ZERO
 	int i;
 
-	for (i=0; i<FD_NR; i++)
+	for (i=0; i<sr_fd_nr; i++)
 		sr_fd_table[i].srf_flags= SFF_FREE;
 	repl_queue= NULL;
 #endif
@@ -195,7 +198,7 @@ sr_cancel_t cancelf;
 {
 	sr_fd_t *sr_fd;
 
-	assert (minor>=0 && minor<FD_NR);
+	assert (minor>=0 && minor<sr_fd_nr);
 
 	sr_fd= &sr_fd_table[minor];
 
@@ -219,7 +222,7 @@ message *m;
 	int minor= m->DEVICE;
 	int i, fd;
 
-	if (minor<0 || minor>FD_NR)
+	if (minor<0 || minor>=sr_fd_nr)
 	{
 		DBLOCK(1, printf("replying EINVAL\n"));
 		return EINVAL;
@@ -229,9 +232,9 @@ message *m;
 		DBLOCK(1, printf("replying ENXIO\n"));
 		return ENXIO;
 	}
-	for (i=0; i<FD_NR && (sr_fd_table[i].srf_flags & SFF_INUSE); i++);
+	for (i=0; i<sr_fd_nr && (sr_fd_table[i].srf_flags & SFF_INUSE); i++);
 
-	if (i>=FD_NR)
+	if (i>=sr_fd_nr)
 	{
 		DBLOCK(1, printf("replying ENFILE\n"));
 		return ENFILE;
@@ -438,7 +441,7 @@ int minor;
 	sr_fd_t *loc_fd;
 
 	compare(minor, >=, 0);
-	compare(minor, <, FD_NR);
+	compare(minor, <, sr_fd_nr);
 
 	loc_fd= &sr_fd_table[minor];
 
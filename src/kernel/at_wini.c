@@ -19,6 +19,10 @@
 
 #if ENABLE_AT_WINI
 
+#if ENABLE_PCI
+#include "pci.h"
+#endif
+
 #define ATAPI_DEBUG	    0	/* To debug ATAPI code. */
 
 /* I/O Ports used by winchester disk controllers. */
@@ -67,6 +71,11 @@
 #define   CMD_SEEK		0x70	/* seek cylinder */
 #define   CMD_DIAG		0x90	/* execute device diagnostics */
 #define   CMD_SPECIFY		0x91	/* specify parameters */
+#define   CMD_READ_MULTIPLE	0xC4	/* read data, several sectors per intr */
+#define   CMD_WRITE_MULTIPLE	0xC5	/* write data, several sectors per intr */
+#define   CMD_SET_MULTIPLE	0xC6	/* set sectors per interrupt */
+#define   CMD_READ_DMA		0xC8	/* read data by bus master DMA */
+#define   CMD_WRITE_DMA		0xCA	/* write data by bus master DMA */
 #define   ATA_IDENTIFY		0xEC	/* identify drive */
 #define REG_CTL		0x206	/* control register */
 #define   CTL_NORETRY		0x80	/* disable access retry */
@@ -118,6 +127,42 @@
 #define CD_SECTOR_SIZE		2048	/* sector size of a CD-ROM */
 #endif /* ATAPI */
 
+#if ENABLE_PCI
+/* PCI IDE controller, and its bus master registers (offsets from the bus
+ * master base of a channel).
+ */
+#define PCI_IDE_BCR	0x01	/* base class: mass storage */
+#define PCI_IDE_SCR	0x01	/* sub class: IDE */
+#define   PIFR_NATIVE0		0x01	/* primary channel in native mode */
+#define   PIFR_NATIVE1		0x04	/* secondary channel in native mode */
+#define   PIFR_MASTER		0x80	/* bus master capable */
+#define PCI_IDE_BMBAR	(PCI_BAR + 16)	/* bus master base address (BAR4) */
+#define   PCI_CR_MASTER		0x0004	/* PCI_CR: bus master enable */
+#define BM_COMMAND	    0	/* command */
+#define   BM_CMD_START		0x01	/* start transfer */
+#define   BM_CMD_READ		0x08	/* transfer to memory (disk read) */
+#define BM_STATUS	    2	/* status */
+#define   BM_ST_ERR		0x02	/* DMA error, write 1 to clear */
+#define   BM_ST_INT		0x04	/* interrupt seen, write 1 to clear */
+#define   BM_ST_DRV0DMA		0x20	/* drive 0 is set up for DMA */
+#define   BM_ST_DRV1DMA		0x40	/* drive 1 is set up for DMA */
+#define BM_PRDTP	    4	/* physical address of the PRD table */
+#define BM_CHANNEL	    8	/* secondary channel registers follow */
+
+/* A Physical Region Descriptor describes one piece of memory taking part in
+ * a DMA transfer.  The list may not cross a 64K boundary, nor may a piece.
+ */
+typedef struct prd {
+  u32_t	prd_addr;	/* physical address, must be even */
+  u16_t	prd_count;	/* byte count, 0 means 64K */
+  u16_t	prd_flags;	/* PRD_EOT on the last descriptor */
+} prd_t;
+#define PRD_EOT		0x8000
+
+/* Every element of an I/O vector may cross one 64K boundary, a big one two. */
+#define NR_PRDS		(2 * NR_IOREQS + 2)
+#endif /* ENABLE_PCI */
+
 /* Interrupt request lines. */
 #define NO_IRQ		 0	/* no IRQ set yet */
 #define AT_IRQ0		14	/* interrupt number for controller 0 */
@@ -163,6 +208,11 @@ struct command {
 #else
 #define ATAPI		   0	/* don't bother with ATAPI; optimise out */
 #endif
+#if ENABLE_PCI
+#define BUSMASTER	0x10	/* drive does bus master DMA */
+#else
+#define BUSMASTER	   0	/* no PCI, no DMA */
+#endif
 
 
 /* Variables. */
@@ -179,6 +229,10 @@ PRIVATE struct wini {		/* main drive struct, one entry per drive */
   unsigned ldhpref;		/* top four bytes of the LDH (head) register */
   unsigned precomp;		/* write precompensation cylinder / 4 */
   unsigned max_count;		/* max request for this drive */
+  unsigned multiple;		/* sectors per interrupt, > 1 if MULTIPLE */
+#if ENABLE_PCI
+  unsigned bm_base;		/* bus master registers, 0 if none */
+#endif
   unsigned open_ct;		/* in-use count */
   irq_hook_t hook;		/* interrupt hook */
   struct device part[DEV_PER_DRIVE];	/* disks and partitions */
@@ -191,6 +245,11 @@ PRIVATE int w_status;			/* status after interrupt */
 PRIVATE int w_drive;			/* selected drive */
 PRIVATE struct device *w_dv;		/* device's base and size */
 PRIVATE timer_t w_tmr_timeout;		/* timer for w_timeout */
+#if ENABLE_PCI
+PRIVATE prd_t prd_buf[2 * NR_PRDS];	/* PRD list, and room to align it */
+PRIVATE prd_t *prd_table;		/* the part not crossing 64K */
+PRIVATE phys_bytes prd_phys;		/* its physical address */
+#endif
 
 FORWARD _PROTOTYPE( void init_params, (void) );
 FORWARD _PROTOTYPE( int w_do_open, (struct driver *dp, message *m_ptr) );
@@ -211,6 +270,11 @@ FORWARD _PROTOTYPE( int at_intr_wait, (void) );
 FORWARD _PROTOTYPE( int w_waitfor, (int mask, int value) );
 FORWARD _PROTOTYPE( int w_handler, (irq_hook_t *hook) );
 FORWARD _PROTOTYPE( void w_geometry, (struct partition *entry) );
+#if ENABLE_PCI
+FORWARD _PROTOTYPE( void w_pci_conf, (void) );
+FORWARD _PROTOTYPE( int w_dma_setup, (phys_bytes user_base, iovec_t *iov,
+					unsigned nbytes) );
+#endif
 #if ENABLE_ATAPI
 FORWARD _PROTOTYPE( int atapi_sendpacket, (u8_t *packet, unsigned cnt) );
 FORWARD _PROTOTYPE( int atapi_intr_wait, (void) );
@@ -284,11 +348,72 @@ PRIVATE void init_params()
 	}
 	wn->ldhpref = ldh_init(drive);
 	wn->max_count = MAX_SECS << SECTOR_SHIFT;
+	wn->multiple = 1;
 
 	/* Base I/O register to address controller. */
 	wn->base = drive < 2 ? REG_BASE0 : REG_BASE1;
   }
+
+#if ENABLE_PCI
+  w_pci_conf();
+#endif
+}
+
+
+#if ENABLE_PCI
+/*============================================================================*
+ *				w_pci_conf				      *
+ *============================================================================*/
+PRIVATE void w_pci_conf()
+{
+/* Look for a PCI IDE controller that can do bus master DMA on the channels
+ * at the standard addresses.  Timing is left as the BIOS has set it up.
+ */
+  int r, devind, drive;
+  u16_t vid, did, cr;
+  u8_t pifr;
+  u32_t bar;
+  char *dname;
+  struct wini *wn;
+
+  pci_init();
+
+  for (r = pci_first_dev(&devind, &vid, &did); r != 0;
+					r = pci_next_dev(&devind, &vid, &did)) {
+	if (pci_attr_r8(devind, PCI_BCR) != PCI_IDE_BCR) continue;
+	if (pci_attr_r8(devind, PCI_SCR) != PCI_IDE_SCR) continue;
+	pifr = pci_attr_r8(devind, PCI_PIFR);
+	if (!(pifr & PIFR_MASTER)) continue;
+	bar = pci_attr_r32(devind, PCI_IDE_BMBAR);
+	if ((bar & 0x0001) && (bar & 0xFFF0) != 0) break;	/* I/O space */
+  }
+  if (r == 0) return;
+
+  /* The PRD list must not cross a 64K boundary, use the half that doesn't. */
+  prd_table = prd_buf;
+  prd_phys = vir2phys(prd_buf);
+  if ((prd_phys & 0xFFFF) + NR_PRDS * sizeof(prd_t) > 0x10000) {
+	prd_table += NR_PRDS;
+	prd_phys += NR_PRDS * sizeof(prd_t);
+  }
+
+  dname = pci_dev_name(vid, did);
+  if (!dname) dname = "unknown device";
+  printf("at_wini: %s (%04x/%04x) at %s\n",
+	dname, vid, did, pci_slot_name(devind));
+  pci_reserve(devind);
+
+  /* Let the controller master the bus. */
+  cr = pci_attr_r16(devind, PCI_CR);
+  if (!(cr & PCI_CR_MASTER)) pci_attr_w16(devind, PCI_CR, cr | PCI_CR_MASTER);
+
+  for (drive = 0, wn = wini; drive < MAX_DRIVES; drive++, wn++) {
+	/* A channel in native mode is not at the addresses we use. */
+	if (pifr & (drive < 2 ? PIFR_NATIVE0 : PIFR_NATIVE1)) continue;
+	wn->bm_base = (bar & 0xFFFC) + (drive < 2 ? 0 : BM_CHANNEL);
+  }
 }
+#endif /* ENABLE_PCI */
 
 
 /*============================================================================*
@@ -404,6 +529,22 @@ PRIVATE int w_identify()
 		size = id_longword(60);
 	}
 
+	/* Sectors per interrupt the drive can do with READ/WRITE MULTIPLE. */
+	wn->multiple = id_byte(47)[0];
+	if (wn->multiple > MAX_SECS) wn->multiple = MAX_SECS;
+	if (wn->multiple == 0) wn->multiple = 1;
+
+#if ENABLE_PCI
+	/* DMA if the drive can, and the BIOS has set the controller up for
+	 * it on this drive.
+	 */
+	if ((id_byte(49)[1] & 0x01) && wn->bm_base != 0
+		&& (inb(wn->bm_base + BM_STATUS)
+			& (w_drive & 1 ? BM_ST_DRV1DMA : BM_ST_DRV0DMA))) {
+		wn->state |= BUSMASTER;
+	}
+#endif
+
 	if (wn->lcylinders == 0) {
 		/* No BIOS parameters?  Then make some up. */
 		wn->lcylinders = wn->pcylinders;
@@ -446,7 +587,7 @@ PRIVATE int w_identify()
 
   printf("%s: ", w_name());
   if (wn->state & (SMART|ATAPI)) {
-	printf("%.40s\n", id_string);
+	printf("%.40s%s\n", id_string, (wn->state & BUSMASTER) ? " (DMA)" : "");
   } else {
 	printf("%ux%ux%u\n", wn->pcylinders, wn->pheads, wn->psectors);
   }
@@ -505,6 +646,15 @@ PRIVATE int w_specify()
 
 		if (com_simple(&cmd) != OK) return(ERR);
 	}
+
+	if ((wn->state & SMART) && wn->multiple > 1) {
+		/* Ask for several sectors per interrupt, or make do with one. */
+		cmd.count   = wn->multiple;
+		cmd.ldh     = w_wn->ldhpref;
+		cmd.command = CMD_SET_MULTIPLE;
+
+		if (com_simple(&cmd) != OK) wn->multiple = 1;
+	}
   }
   wn->state |= INITIALIZED;
   return(OK);
@@ -530,6 +680,10 @@ unsigned nr_req;		/* length of request vector */
   unsigned cylinder, head, sector, nbytes, count, chunk;
   unsigned secspcyl = wn->pheads * wn->psectors;
   phys_bytes user_base = proc_vir2phys(proc_addr(proc_nr), 0);
+#if ENABLE_PCI
+  int dma;
+  unsigned bm, bm_dir;
+#endif
 
 #if ENABLE_ATAPI
   if (w_wn->state & ATAPI) {
@@ -578,14 +732,58 @@ unsigned nr_req;		/* length of request vector */
 		cmd.cyl_hi  = (cylinder >> 8) & BYTE;
 		cmd.ldh     = wn->ldhpref | head;
 	}
-	cmd.command = opcode == DEV_SCATTER ? CMD_WRITE : CMD_READ;
+	if (wn->multiple > 1) {
+		cmd.command = opcode == DEV_SCATTER ?
+				CMD_WRITE_MULTIPLE : CMD_READ_MULTIPLE;
+	} else {
+		cmd.command = opcode == DEV_SCATTER ? CMD_WRITE : CMD_READ;
+	}
 
+#if ENABLE_PCI
+	/* The whole vector in one DMA transfer, unless DMA failed before. */
+	dma = (wn->state & BUSMASTER) && errors == 0
+				&& w_dma_setup(user_base, iov, nbytes);
+	if (dma) {
+		bm = wn->bm_base;
+		bm_dir = opcode == DEV_GATHER ? BM_CMD_READ : 0;
+		cmd.command = opcode == DEV_SCATTER ? CMD_WRITE_DMA : CMD_READ_DMA;
+
+		/* Load the PRD list, give the command, start the engine. */
+		outl(bm + BM_PRDTP, prd_phys);
+		outb(bm + BM_STATUS, BM_ST_ERR | BM_ST_INT);
+		outb(bm + BM_COMMAND, bm_dir);
+		if ((r = com_out(&cmd)) == OK) {
+			outb(bm + BM_COMMAND, bm_dir | BM_CMD_START);
+			r = at_intr_wait();
+			if ((inb(bm + BM_STATUS) & (BM_ST_ERR | BM_ST_INT))
+							!= BM_ST_INT) r = ERR;
+		}
+		outb(bm + BM_COMMAND, 0);
+		outb(bm + BM_STATUS, BM_ST_ERR | BM_ST_INT);
+
+		/* Book the bytes transferred, all or nothing. */
+		if (r == OK) {
+			position += nbytes;
+			while (nbytes > 0) {
+				chunk = nbytes;
+				if (chunk > iov->iov_size) chunk = iov->iov_size;
+				nbytes -= chunk;
+				iov->iov_addr += chunk;
+				if ((iov->iov_size -= chunk) == 0) {
+					iov++;
+					nr_req--;
+				}
+			}
+		}
+	} else
+#endif /* ENABLE_PCI */
 	r = com_out(&cmd);
 
 	while (r == OK && nbytes > 0) {
-		/* For each sector, wait for an interrupt and fetch the data
-		 * (read), or supply data to the controller and wait for an
-		 * interrupt (write).
+		/* For each sector, or each block of sectors with READ/WRITE
+		 * MULTIPLE, wait for an interrupt and fetch the data (read),
+		 * or supply data to the controller and wait for an interrupt
+		 * (write).
 		 */
 
 		if (opcode == DEV_GATHER) {
@@ -604,22 +802,31 @@ unsigned nr_req;		/* length of request vector */
 		if (!w_waitfor(STATUS_DRQ, STATUS_DRQ)) { r = ERR; break; }
 
 		/* Copy bytes to or from the device's buffer. */
-		if (opcode == DEV_GATHER) {
-			phys_insw(w_wn->base + REG_DATA,
-				user_base + iov->iov_addr, SECTOR_SIZE);
-		} else {
-			phys_outsw(w_wn->base + REG_DATA,
-				user_base + iov->iov_addr, SECTOR_SIZE);
+		count = nbytes >> SECTOR_SHIFT;
+		if (count > wn->multiple) count = wn->multiple;
+		do {
+			if (opcode == DEV_GATHER) {
+				phys_insw(w_wn->base + REG_DATA,
+					user_base + iov->iov_addr, SECTOR_SIZE);
+			} else {
+				phys_outsw(w_wn->base + REG_DATA,
+					user_base + iov->iov_addr, SECTOR_SIZE);
+			}
+
+			/* Book the bytes successfully transferred. */
+			nbytes -= SECTOR_SIZE;
+			position += SECTOR_SIZE;
+			iov->iov_addr += SECTOR_SIZE;
+			if ((iov->iov_size -= SECTOR_SIZE) == 0) {
+				iov++;
+				nr_req--;
+			}
+		} while (--count > 0);
 
+		if (opcode == DEV_SCATTER) {
 			/* Data sent, wait for an interrupt. */
 			if ((r = at_intr_wait()) != OK) break;
 		}
-
-		/* Book the bytes successfully transferred. */
-		nbytes -= SECTOR_SIZE;
-		position += SECTOR_SIZE;
-		iov->iov_addr += SECTOR_SIZE;
-		if ((iov->iov_size -= SECTOR_SIZE) == 0) { iov++; nr_req--; }
 	}
 
 	/* Any errors? */
@@ -637,6 +844,48 @@ unsigned nr_req;		/* length of request vector */
 }
 
 
+#if ENABLE_PCI
+/*============================================================================*
+ *				w_dma_setup				      *
+ *============================================================================*/
+PRIVATE int w_dma_setup(user_base, iov, nbytes)
+phys_bytes user_base;		/* base of the user's address space */
+iovec_t *iov;			/* I/O vector to transfer from or to */
+unsigned nbytes;		/* bytes to transfer */
+{
+/* Turn the first nbytes of the I/O vector into a PRD list.  Return false if
+ * a buffer can't be used for DMA.
+ */
+  prd_t *prd = prd_table;
+  phys_bytes addr, chunk;
+  unsigned size;
+
+  while (nbytes > 0) {
+	addr = user_base + iov->iov_addr;
+	if ((addr & 1) != 0) return(FALSE);
+	size = iov->iov_size;
+	if (size > nbytes) size = nbytes;
+	nbytes -= size;
+	iov++;
+
+	while (size > 0) {
+		/* A piece may not cross a 64K boundary. */
+		chunk = 0x10000L - (addr & 0xFFFF);
+		if (chunk > size) chunk = size;
+		prd->prd_addr = addr;
+		prd->prd_count = chunk & 0xFFFF;
+		prd->prd_flags = 0;
+		prd++;
+		addr += chunk;
+		size -= chunk;
+	}
+  }
+  prd[-1].prd_flags = PRD_EOT;
+  return(TRUE);
+}
+#endif /* ENABLE_PCI */
+
+
 /*============================================================================*
  *				com_out					      *
  *============================================================================*/
@@ -735,8 +984,15 @@ timer_t *tp;
   switch (w_command) {
   case CMD_IDLE:
 	break;		/* fine */
+  case CMD_READ_DMA:
+  case CMD_WRITE_DMA:
+	/* No interrupt after DMA; use programmed I/O from now on. */
+	wn->state &= ~BUSMASTER;
+	/*FALL THROUGH*/
   case CMD_READ:
   case CMD_WRITE:
+  case CMD_READ_MULTIPLE:
+  case CMD_WRITE_MULTIPLE:
 	/* Impossible, but not on PC's:  The controller does not respond. */
 
 	/* Limiting multisector I/O seems to help. */
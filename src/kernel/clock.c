@@ -466,6 +466,9 @@ int hook;
  *		references to it to guard conveniently.
  *	lost_ticks:
  *		Clock ticks counted outside the clock task.
+ *	acct_ticks:
+ *		Only written here.  proc.c may read a value that is a tick
+ *		old, which does not matter for the blocked time accounting.
  *	sched_ticks, prev_ptr:
  *		Updating these competes with similar code in do_clocktick().
  *		No lock is necessary, because if bad things happen here
@@ -506,6 +509,7 @@ int hook;
 
   pending_ticks += ticks;
   now = realtime + pending_ticks;
+  acct_ticks = now;
   if (tty_timeout <= now) tty_wakeup(now);	/* possibly wake up TTY */
 #if (CHIP == INTEL) && ENABLE_PRINTER
   pr_restart();					/* possibly restart printer */
@@ -16,7 +16,7 @@
  * |------------|----------|---------|----------|---------|---------|
  * | DL_READ	| port nr  | proc nr | count    |         | address |
  * |------------|----------|---------|----------|---------|---------|
- * | DL_READV	| port nr  | proc nr | count    |         | address |
+ * | DL_READV	| port nr  | proc nr | count    | batch   | address |
  * |------------|----------|---------|----------|---------|---------|
  * | DL_INIT	| port nr  | proc nr | mode     |         | address |
  * |------------|----------|---------|----------|---------|---------|
@@ -32,6 +32,12 @@
  * |DL_TASK_REPL| port nr  | proc nr | rd-count | err|stat| clock   |
  * |------------|----------|---------|----------|---------|---------|
  *
+ * A DL_READV with DL_BATCH_REQ in the mode describes several packet buffers,
+ * each made of the same number of iovecs (DL_MODE >> DL_STRIDE_SHIFT).  All
+ * packets that are in the ring are copied in one go; the length of each is
+ * stored in the iov_size of its first iovec, and the reply has DL_PACK_BATCH
+ * set and the number of packets in DL_COUNT.
+ *
  *   m_type	  m3_i1     m3_i2       m3_ca1
  * |------------+---------+-----------+---------------|
  * |DL_INIT_REPL| port nr | last port | ethernet addr |
@@ -145,6 +151,7 @@ _PROTOTYPE( static void dp_pio8_nic2user, (dpeth_t *dep, int nic_addr,
 _PROTOTYPE( static void dp_pio16_nic2user, (dpeth_t *dep, int nic_addr, 
 		iovec_dat_t *iovp, vir_bytes offset, vir_bytes count)	);
 _PROTOTYPE( static void dp_next_iovec, (iovec_dat_t *iovp)		);
+_PROTOTYPE( static void dp_rdb_load, (dpeth_t *dep)			);
 _PROTOTYPE( static int dp_handler, (irq_hook_t *hook)			);
 _PROTOTYPE( static void conf_hw, (dpeth_t *dep)				);
 _PROTOTYPE( static void update_conf, (dpeth_t *dep, dp_conf_t *dcp)	);
@@ -473,7 +480,26 @@ int vectored;
 	if(dep->de_flags & DEF_READING)
 		panic("dp8390: read already in progress", NO_NUM);
 
-	if (vectored)
+	dep->de_rdb_nr= 0;
+	if (vectored && (mp->DL_MODE & DL_BATCH_REQ))
+	{
+		/* A batch of packet buffers, 'stride' iovecs each. */
+		dep->de_rdb_stride= (int) (mp->DL_MODE >> DL_STRIDE_SHIFT);
+		if (dep->de_rdb_stride <= 0 || dep->de_rdb_stride > IOVEC_NR
+			|| count % dep->de_rdb_stride != 0)
+		{
+			panic("dp8390: bad read batch", count);
+		}
+		dep->de_rdb_nr= count / dep->de_rdb_stride;
+		dep->de_rdb_done= 0;
+		dep->de_read_iovec.iod_proc_nr = mp->DL_PROC;
+		dep->de_read_iovec.iod_iovec_addr = (vir_bytes) mp->DL_ADDR;
+		dp_rdb_load(dep);
+
+		dep->de_tmp_iovec = dep->de_read_iovec;
+		size= calc_iovec_size(&dep->de_tmp_iovec);
+	}
+	else if (vectored)
 	{
 		get_userdata(mp->DL_PROC, (vir_bytes) mp->DL_ADDR,
 			(count > IOVEC_NR ? IOVEC_NR : count) *
@@ -1008,10 +1034,9 @@ dpeth_t *dep;
 	dp_rcvhdr_t header;
 	unsigned pageno, curr, next;
 	vir_bytes length;
-	int packet_processed, r;
+	int r;
 	u16_t eth_type;
 
-	packet_processed = FALSE;
 	pageno = inb_reg0(dep, DP_BNRY) + 1;
 	if (pageno == dep->de_stoppage) pageno = dep->de_startpage;
 
@@ -1075,7 +1100,6 @@ dpeth_t *dep;
 			if (r != OK)
 				return;
 
-			packet_processed = TRUE;
 			dep->de_stat.ets_packetR++;
 		}
 		if (next == dep->de_startpage)
@@ -1085,7 +1109,7 @@ dpeth_t *dep;
 
 		pageno = next;
 	}
-	while (!packet_processed);
+	while (dep->de_flags & DEF_READING);
 }
 
 
@@ -1208,14 +1232,50 @@ int page, length;
 			sizeof(dp_rcvhdr_t), &dep->de_read_iovec, 0, length);
 	}
 
-	dep->de_read_s = length;
 	dep->de_flags |= DEF_PACK_RECV;
-	dep->de_flags &= ~DEF_READING;
+	if (dep->de_rdb_nr == 0)
+	{
+		dep->de_read_s = length;
+		dep->de_flags &= ~DEF_READING;
+		return OK;
+	}
+
+	/* Part of a batch.  Tell the length and go on with the next buffer
+	 * if there is one.
+	 */
+	dep->de_read_iovec.iod_iovec[0].iov_size = length;
+	put_userdata(dep->de_read_iovec.iod_proc_nr,
+		dep->de_read_iovec.iod_iovec_addr, (vir_bytes) sizeof(iovec_t),
+		&dep->de_read_iovec.iod_iovec[0]);
+	dep->de_read_s = ++dep->de_rdb_done;
+	if (dep->de_rdb_done == dep->de_rdb_nr)
+		dep->de_flags &= ~DEF_READING;
+	else
+		dp_rdb_load(dep);
 
 	return OK;
 }
 
 
+/*===========================================================================*
+ *				dp_rdb_load				     *
+ *===========================================================================*/
+static void dp_rdb_load(dep)
+dpeth_t *dep;
+{
+/* Fetch the iovecs of the next packet buffer of a read batch. */
+	iovec_dat_t *iovp;
+
+	iovp= &dep->de_read_iovec;
+	if (dep->de_rdb_done != 0)
+		iovp->iod_iovec_addr += dep->de_rdb_stride * sizeof(iovec_t);
+	get_userdata(iovp->iod_proc_nr, iovp->iod_iovec_addr,
+		(vir_bytes) dep->de_rdb_stride * sizeof(iovec_t),
+		iovp->iod_iovec);
+	iovp->iod_iovec_s = dep->de_rdb_stride;
+}
+
+
 /*===========================================================================*
  *				dp_user2nic				     *
  *===========================================================================*/
@@ -1784,7 +1844,11 @@ int may_block;
 	if (dep->de_flags & DEF_PACK_SEND)
 		status |= DL_PACK_SEND;
 	if (dep->de_flags & DEF_PACK_RECV)
+	{
 		status |= DL_PACK_RECV;
+		if (dep->de_rdb_nr != 0)
+			status |= DL_PACK_BATCH;
+	}
 
 	reply.m_type = DL_TASK_REPLY;
 	reply.DL_PORT = dep - de_table;
@@ -1805,6 +1869,12 @@ int may_block;
 	if (r < 0)
 		panic("dp8390: send failed:", r);
 	
+	if ((dep->de_flags & DEF_PACK_RECV) && dep->de_rdb_nr != 0)
+	{
+		/* The client has what arrived so far; that ends the batch. */
+		dep->de_flags &= ~DEF_READING;
+		dep->de_rdb_nr = 0;
+	}
 	dep->de_read_s = 0;
 	dep->de_flags &= ~(DEF_PACK_SEND | DEF_PACK_RECV);
 }
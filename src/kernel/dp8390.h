@@ -264,6 +264,9 @@ typedef struct dpeth
 	iovec_dat_t de_write_iovec;
 	iovec_dat_t de_tmp_iovec;
 	vir_bytes de_read_s;
+	int de_rdb_nr;			/* packets in the read batch, or 0 */
+	int de_rdb_done;		/* packets of it filled */
+	int de_rdb_stride;		/* iovecs per packet */
 	int de_client;
 	message de_sendmsg;
 	dp_user2nicf_t de_user2nicf; 
@@ -30,6 +30,7 @@ EXTERN phys_clicks tot_mem_size;	/* total system memory size */
 extern struct tasktab tasktab[];/* initialized in table.c, so extern here */
 extern char *t_stack[];		/* initialized in table.c, so extern here */
 EXTERN unsigned lost_ticks;	/* clock ticks counted outside the clock task */
+EXTERN clock_t acct_ticks;	/* uptime as last seen by the clock handler */
 EXTERN clock_t tty_timeout;	/* time to wake up the TTY task */
 EXTERN int current;		/* currently visible console */
 
@@ -35,6 +35,24 @@ FORWARD _PROTOTYPE( void cp_mess, (int src, struct proc *src_p, message *src_m,
 		struct proc *dst_p, message *dst_m) );
 #endif
 
+/* Reason for a process to block on 'n', for the SYSGETPROC accounting. */
+#define blk_reason(n)	((n) == FS_PROC_NR ? BLK_FS : \
+			 (n) == MM_PROC_NR ? BLK_MM : \
+			 (n) < 0 ? BLK_TASK : BLK_OTHER)
+
+/* Note that 'rp' blocks on 'n'.  The time is charged when it is readied. */
+#define blk_start(rp, n) \
+	((rp)->p_blkwhy = 1 + blk_reason(n), (rp)->p_blkstart = acct_ticks, \
+	 (rp)->p_nvcsw++)
+
+/* Charge the time 'rp' has been blocked to the reason it blocked for. */
+#define blk_stop(rp) \
+	if ((rp)->p_blkwhy != 0) { \
+		(rp)->p_blktime[(rp)->p_blkwhy - 1] += \
+					acct_ticks - (rp)->p_blkstart; \
+		(rp)->p_blkwhy = 0; \
+	}
+
 #if (CHIP == INTEL)
 #define CopyMess(s,sp,sm,dp,dm) \
 	cp_mess(s, (sp)->p_map[D].mem_phys, (vir_bytes)sm, (dp)->p_map[D].mem_phys, (vir_bytes)dm)
@@ -106,6 +124,7 @@ int task;			/* number of task to be started */
   rp->p_messbuf->m_type = HARD_INT;
   rp->p_flags &= ~RECEIVING;
   rp->p_int_blocked = FALSE;
+  blk_stop(rp);
 
 #if 1
    /* Make rp ready and run it unless a task is already running.  This is
@@ -222,12 +241,16 @@ message *m_ptr;			/* pointer to message buffer */
 	/* Destination is indeed waiting for this message. */
 	CopyMess(proc_number(caller_ptr), caller_ptr, m_ptr, dest_ptr,
 		 dest_ptr->p_messbuf);
+	dest_ptr->p_nmsgrecv++;
 	dest_ptr->p_flags &= ~RECEIVING;	/* deblock destination */
 	if (dest_ptr->p_flags == 0) ready(dest_ptr);
   } else {
 	/* Destination is not waiting.  Block and queue caller. */
 	caller_ptr->p_messbuf = m_ptr;
-	if (caller_ptr->p_flags == 0) unready(caller_ptr);
+	if (caller_ptr->p_flags == 0) {
+		unready(caller_ptr);
+		blk_start(caller_ptr, dest);
+	}
 	caller_ptr->p_flags |= SENDING;
 	caller_ptr->p_sendto= dest;
 
@@ -241,6 +264,7 @@ message *m_ptr;			/* pointer to message buffer */
 	}
 	caller_ptr->p_sendlink = NIL_PROC;
   }
+  caller_ptr->p_nmsgsent++;
   return(OK);
 }
 
@@ -271,6 +295,7 @@ message *m_ptr;			/* pointer to message buffer */
 		/* An acceptable message has been found. */
 		CopyMess(proc_number(sender_ptr), sender_ptr,
 			 sender_ptr->p_messbuf, caller_ptr, m_ptr);
+		caller_ptr->p_nmsgrecv++;
 		if (sender_ptr == caller_ptr->p_callerq)
 			caller_ptr->p_callerq = sender_ptr->p_sendlink;
 		else
@@ -293,7 +318,10 @@ message *m_ptr;			/* pointer to message buffer */
   /* No suitable message is available.  Block the process trying to receive. */
   caller_ptr->p_getfrom = src;
   caller_ptr->p_messbuf = m_ptr;
-  if (caller_ptr->p_flags == 0) unready(caller_ptr);
+  if (caller_ptr->p_flags == 0) {
+	unready(caller_ptr);
+	blk_start(caller_ptr, src);
+  }
   caller_ptr->p_flags |= RECEIVING;
 
   /* If MM has just blocked and there are kernel signals pending, now is the
@@ -348,6 +376,8 @@ register struct proc *rp;	/* this process is now runnable */
  *   USER_Q   - (lowest priority) for user processes
  */
 
+  blk_stop(rp);
+
   if (istaskp(rp)) {
 	if (rdy_head[TASK_Q] != NIL_PROC)
 		/* Add to tail of nonempty queue. */
@@ -474,6 +504,7 @@ PRIVATE void sched()
   if (rdy_head[USER_Q] == NIL_PROC) return;
 
   /* One or more user processes queued. */
+  rdy_head[USER_Q]->p_nivcsw++;
   rdy_tail[USER_Q]->p_nextready = rdy_head[USER_Q];
   rdy_tail[USER_Q] = rdy_head[USER_Q];
   rdy_head[USER_Q] = rdy_head[USER_Q]->p_nextready;
@@ -1,6 +1,8 @@
 #ifndef PROC_H
 #define PROC_H
 
+#include <sys/svrctl.h>		/* for NR_BLK */
+
 /* Here is the declaration of the process table.  It contains the process'
  * registers, memory map, accounting, and message send/receive information.
  * Many assembly code routines reference fields in it.  The offsets to these
@@ -42,6 +44,7 @@ struct proc {
 
   char p_int_blocked;		/* nonzero if int msg blocked by busy task */
   char p_int_held;		/* nonzero if int msg held by busy syscall */
+  char p_blkwhy;		/* 1 + BLK_* reason while blocked, else 0 */
   struct proc *p_nextheld;	/* next in chain of held-up int processes */
 
   int p_flags;			/* SENDING, RECEIVING, etc. */
@@ -54,6 +57,13 @@ struct proc {
   clock_t child_utime;		/* cumulative user time of children */
   clock_t child_stime;		/* cumulative sys time of children */
 
+  u32_t p_nmsgsent;		/* number of messages sent */
+  u32_t p_nmsgrecv;		/* number of messages received */
+  u32_t p_nvcsw;		/* times blocked on a message */
+  u32_t p_nivcsw;		/* times preempted by the scheduler */
+  clock_t p_blkstart;		/* uptime when last blocked */
+  clock_t p_blktime[NR_BLK];	/* ticks spent blocked, by reason */
+
   timer_t *p_exptimers;		/* list of expired timers */
 
   struct proc *p_callerq;	/* head of list of procs wishing to send */
@@ -318,8 +318,10 @@ _PROTOTYPE( void dump, (void)						);
 _PROTOTYPE( void putk, (int c)						);
 
 /* stdma.c */
-_PROTOTYPE( void dmagrab, (int p, dmaint_t func)			);
+_PROTOTYPE( void dmagrab, (int p, dmaint_t func, unsigned long bytes)	);
 _PROTOTYPE( void dmafree, (int p)					);
+_PROTOTYPE( int dmabusy, (int p)					);
+_PROTOTYPE( void dma_dmp, (void)					);
 _PROTOTYPE( void dmaint, (void)						);
 _PROTOTYPE( void dmaaddr, (phys_bytes ad)				);
 _PROTOTYPE( int dmardat, (int mode, int delay)				);
@@ -372,6 +374,7 @@ _PROTOTYPE( int acsi_cmd, (int drive,  unsigned char *cmd, int cmdlen,
 _PROTOTYPE( void scsi_task, (void)					);
 _PROTOTYPE( void scsidmaint, (void)					);
 _PROTOTYPE( void scsiint, (void)					);
+_PROTOTYPE( void scsi_dmp, (void)					);
 _PROTOTYPE( int scsi_cmd, (int drive,  unsigned char *cmd, int cmdlen,
 		phys_bytes address, phys_bytes data_len,  int rw)	);
 
@@ -24,7 +24,7 @@
 #endif
 #endif /* MACHINE == ATARI */
 
-#if (MACHINE == IBM_PC)		/* PC/AT 8250/16450 chip combination */
+#if (MACHINE == IBM_PC)		/* PC/AT 8250/16450/16550A chip combination */
 
 /* 8250 constants. */
 #define UART_FREQ         115200L	/* timer frequency */
@@ -40,6 +40,16 @@
 #define IS_TRANSMITTER_READY    2
 #define IS_RECEIVER_READY       4
 #define IS_LINE_STATUS_CHANGE   6
+#define IS_CHAR_TIMEOUT      0x0C	/* 16550A: chars left below trigger */
+#define IS_ID_MASK           0x0F	/* mask out the FIFO status bits */
+#define IS_FIFOS_ENABLED     0xC0	/* 16550A with working FIFOs */
+
+/* FIFO control bits (16550A). */
+#define FC_ENABLE               1
+#define FC_RCV_RESET            2
+#define FC_XMIT_RESET           4
+#define FC_TRIGGER_8         0x80	/* interrupt at 8 received bytes */
+#define UART_FIFO_SIZE         16	/* bytes in the transmitter FIFO */
 
 /* Line control bits. */
 #define LC_2STOP_BITS        0x04
@@ -49,6 +59,7 @@
 #define LC_ADDRESS_DIVISOR   0x80
 
 /* Line status bits. */
+#define LS_DATA_READY           1
 #define LS_OVERRUN_ERR          2
 #define LS_PARITY_ERR           4
 #define LS_FRAMING_ERR          8
@@ -219,10 +230,12 @@ typedef struct rs232 {
   port_t div_hi_port;
   port_t int_enab_port;
   port_t int_id_port;
+  port_t fifo_ctl_port;
   port_t line_ctl_port;
   port_t modem_ctl_port;
   port_t line_status_port;
   port_t modem_status_port;
+  int fifo_size;		/* 1 for a plain 8250, more with a FIFO */
 #endif
 
   unsigned char lstatus;	/* last line status */
@@ -540,6 +553,7 @@ tty_t *tp;			/* which TTY */
   rs->div_hi_port = this_8250 + 1;
   rs->int_enab_port = this_8250 + 1;
   rs->int_id_port = this_8250 + 2;
+  rs->fifo_ctl_port = this_8250 + 2;
   rs->line_ctl_port = this_8250 + 3;
   rs->modem_ctl_port = this_8250 + 4;
   rs->line_status_port = this_8250 + 5;
@@ -563,6 +577,20 @@ tty_t *tp;			/* which TTY */
   rs_config(rs);
 #if (MACHINE == IBM_PC)
   outb(rs->int_enab_port, 0);
+
+  /* Turn on the FIFOs if this is a 16550A.  The receiver then interrupts
+   * only every 8 bytes, or when input stops, and the transmitter takes a
+   * FIFO load at a time.  The FIFOs of a plain 16550 are broken, so it is
+   * treated as a 16450.
+   */
+  outb(rs->fifo_ctl_port, FC_ENABLE | FC_RCV_RESET | FC_XMIT_RESET
+							| FC_TRIGGER_8);
+  if ((inb(rs->int_id_port) & IS_FIFOS_ENABLED) == IS_FIFOS_ENABLED) {
+	rs->fifo_size = UART_FIFO_SIZE;
+  } else {
+	outb(rs->fifo_ctl_port, 0);
+	rs->fifo_size = 1;
+  }
 #endif
 
   /* Clear any harmful leftover interrupts.  An output interrupt is harmless
@@ -755,9 +783,14 @@ irq_hook_t *hook;
 	 * (and then we have to worry about being stuck in the loop too long).
 	 * Unfortunately, some serial cards lock up without this.
 	 */
-	switch (inb(rs->int_id_port)) {
+	switch (inb(rs->int_id_port) & IS_ID_MASK) {
 	case IS_RECEIVER_READY:
-		in_int(rs);
+	case IS_CHAR_TIMEOUT:
+		/* Empty the receiver FIFO, not just one byte of it. */
+		do {
+			in_int(rs);
+		} while (rs->fifo_size > 1
+			&& (inb(rs->line_status_port) & LS_DATA_READY));
 		continue;
 	case IS_TRANSMITTER_READY:
 		out_int(rs);
@@ -943,6 +976,17 @@ register rs232_t *rs;		/* line with output interrupt */
   if (rs->ostate >= (ODEVREADY | OQUEUED | OSWREADY)) {
 	/* Bit test allows ORAW and requires the others. */
 #if (MACHINE == IBM_PC)
+	/* Fill the transmitter FIFO, the last byte is sent below. */
+	int n = rs->fifo_size;
+
+	while (--n > 0 && rs->ocount > 1) {
+		outb(rs->xmit_port, *rs->otail);
+		if (++rs->otail == bufend(rs->obuf)) rs->otail = rs->obuf;
+		if (--rs->ocount == RS_OLOWWATER) {
+			rs->tty->tty_events = 1;
+			force_timeout();
+		}
+	}
 	outb(rs->xmit_port, *rs->otail);
 #else /* MACHINE == ATARI */
 	MFP->mf_udr = *rs->otail;
@@ -12,11 +12,11 @@
  * |------------|----------|---------|----------|---------|---------|
  * | DL_WRITE	| port nr  | proc nr | count    | mode    | address |
  * |------------|----------|---------|----------|---------|---------|
- * | DL_WRITEV	| port nr  | proc nr | count    | mode    | address |
+ * | DL_WRITEV	| port nr  | proc nr | count    | batch   | address |
  * |------------|----------|---------|----------|---------|---------|
  * | DL_READ	| port nr  | proc nr | count    |         | address |
  * |------------|----------|---------|----------|---------|---------|
- * | DL_READV	| port nr  | proc nr | count    |         | address |
+ * | DL_READV	| port nr  | proc nr | count    | batch   | address |
  * |------------|----------|---------|----------|---------|---------|
  * | DL_INIT	| port nr  | proc nr | mode     |         | address |
  * |------------|----------|---------|----------|---------|---------|
@@ -32,6 +32,14 @@
  * |DL_TASK_REPL| port nr  | proc nr | rd-count | err|stat| clock   |
  * |------------|----------|---------|----------|---------|---------|
  *
+ * With DL_BATCH_REQ in DL_MODE, the iovec of a DL_WRITEV or DL_READV holds
+ * several packets of (DL_MODE >> DL_STRIDE_SHIFT) iovecs each; unused
+ * iovecs have size 0.  A write batch is spread over the free transmit
+ * descriptors and DL_PACK_SEND is reported when all of it is queued.  A
+ * read batch is filled with the packets that are in the receive ring, the
+ * length of each is put in the iov_size of its first iovec, and the reply
+ * has DL_PACK_BATCH set and the number of packets in DL_COUNT.
+ *
  *   m_type	  m3_i1     m3_i2       m3_ca1
  * |------------+---------+-----------+---------------|
  * |DL_INIT_REPL| port nr | last port | ethernet addr |
@@ -87,6 +95,16 @@ INIT_ASSERT
 /* I/O vectors are handled IOVEC_NR entries at a time. */
 #define IOVEC_NR	16
 
+/* After a receive interrupt, receive interrupts are masked for this many
+ * PCI clocks (about 100 us at 33 MHz).  What arrives meanwhile is taken
+ * from the ring in one go when the card's timer expires.
+ */
+#define RX_MITIGATE	3300
+
+#define RL_IMR_ALL	(RL_IMR_SERR | RL_IMR_TIMEOUT | RL_IMR_LENCHG | \
+			RL_IMR_FOVW | RL_IMR_PUN | RL_IMR_RXOVW | \
+			RL_IMR_RER | RL_IMR_ROK | RL_IMR_TER | RL_IMR_TOK)
+
 /* Configuration */
 #define RL_ENVVAR	"RTLETH"
 
@@ -142,10 +160,12 @@ typedef struct re
 	/* Rx */
 	phys_bytes re_rx_buf;
 	vir_bytes re_read_s;
+	int re_rx_batch;		/* re_read_s is a number of packets */
 
 	/* Tx */
 	int re_tx_head;
 	int re_tx_tail;
+	int re_tx_done;			/* packets of a batch queued */
 	struct
 	{
 		int ret_busy;
@@ -808,6 +828,9 @@ re_t *rep;
 
 	t= rl_inl(port, RL_TCR);
 	rl_outl(port, RL_TCR, t | RL_TCR_IFG_STD);
+
+	/* The timer is only used for receive interrupt mitigation. */
+	rl_outl(port, RL_TIMERINT, 0);
 }
 
 /*===========================================================================*
@@ -892,13 +915,14 @@ int from_int;
 int vectored;
 {
 	int i, j, n, o, s, s1, dl_port, re_client, count, size;
+	int k, stride, npack, batch;
 	port_t port;
 	unsigned amount, totlen, packlen;
-	phys_bytes src_phys, dst_phys, iov_src;
+	phys_bytes src_phys, dst_phys, iov_src, iov_base;
 	u16_t d_start, d_end;
 	u32_t l, rxstat;
 	re_t *rep;
-	iovec_t *iovp;
+	iovec_t *iovp, first;
 
 	dl_port = mp->DL_PORT;
 	count = mp->DL_COUNT;
@@ -924,91 +948,126 @@ int vectored;
 		goto suspend;
 	}
 
-	d_start= rl_inw(port, RL_CAPR) + RL_CAPR_DATA_OFF;
-	d_end= rl_inw(port, RL_CBR) % RX_BUFSIZE;
+	if (!vectored)
+	{  
+		assert(0);
+#if 0
+		size= mp->DL_COUNT;
+		if (size < ETH_MIN_PACK_SIZE || size > ETH_MAX_PACK_SIZE_TAGGED)
+			panic("rtl8139: invalid packet size", size);
+		phys_user = numap(re_client, (vir_bytes)mp->DL_ADDR, size);
+		if (!phys_user)
+			panic("rtl8139: umap failed\n", NO_NUM);
 
-	if (d_start >= RX_BUFSIZE)
-	{
-		printf("rl_readv: strange value in RL_CAPR: 0x%x\n",
-			rl_inw(port, RL_CAPR));
-		d_start %= RX_BUFSIZE;
+		p= rep->re_tx[tx_head].ret_buf;
+		phys_copy(phys_user, p, size);
+#endif
 	}
 
-	if (d_end > d_start)
-		amount= d_end-d_start;
-	else
-		amount= d_end+RX_BUFSIZE - d_start;
-
-	src_phys= rep->re_rx_buf + d_start;
-	dst_phys= vir2phys(&rxstat);
-	phys_copy(src_phys, dst_phys, sizeof(rxstat));
+	/* A batch has 'stride' iovecs for each packet buffer.  As many of
+	 * them are filled as there are packets in the ring.
+	 */
+	batch= (mp->DL_MODE & DL_BATCH_REQ) != 0;
+	stride= count;
+	npack= 1;
+	if (batch)
+	{
+		stride= (int) (mp->DL_MODE >> DL_STRIDE_SHIFT);
+		if (stride <= 0 || count % stride != 0)
+			panic("rtl8139: bad read batch", count);
+		npack= count / stride;
+	}
+	iov_base = numap(re_client, (vir_bytes)mp->DL_ADDR,
+		count * sizeof(rep->re_iovec[0]));
+	if (!iov_base)
+		panic("rtl8139: umap failed", NO_NUM);
 
-	if (rep->re_clear_rx)
+	for (k= 0; k<npack; k++)
 	{
+		if (k > 0 && (rl_inb(port, RL_CR) & RL_CR_BUFE))
+			break;
+
+		d_start= rl_inw(port, RL_CAPR) + RL_CAPR_DATA_OFF;
+		d_end= rl_inw(port, RL_CBR) % RX_BUFSIZE;
+
+		if (d_start >= RX_BUFSIZE)
+		{
+			printf("rl_readv: strange value in RL_CAPR: 0x%x\n",
+				rl_inw(port, RL_CAPR));
+			d_start %= RX_BUFSIZE;
+		}
+
+		if (d_end > d_start)
+			amount= d_end-d_start;
+		else
+			amount= d_end+RX_BUFSIZE - d_start;
+
+		src_phys= rep->re_rx_buf + d_start;
+		dst_phys= vir2phys(&rxstat);
+		phys_copy(src_phys, dst_phys, sizeof(rxstat));
+
+		if (rep->re_clear_rx)
+		{
 #if 0
-		printf("rl_readv: late buffer overflow\n");
+			printf("rl_readv: late buffer overflow\n");
 #endif
-		goto suspend;	/* Buffer overflow */
-	}
+			break;	/* Buffer overflow */
+		}
 
-	/* Should convert from little endian to host byte order */
+		/* Should convert from little endian to host byte order */
 
-	if (!(rxstat & RL_RXS_ROK))
-	{
-		printf("rxstat = 0x%08lx\n", rxstat);
-		printf("d_start: 0x%x, d_end: 0x%x, rxstat: 0x%lx\n",
-			d_start, d_end, rxstat);
-		panic("rtl8139: received packet not OK", NO_NUM);
-	}
-	totlen= (rxstat >> RL_RXS_LEN_S);
-	if (totlen < 8 || totlen > 2*ETH_MAX_PACK_SIZE)
-	{
-		/* Someting went wrong */
-		printf(
+		if (!(rxstat & RL_RXS_ROK))
+		{
+			printf("rxstat = 0x%08lx\n", rxstat);
+			printf("d_start: 0x%x, d_end: 0x%x, rxstat: 0x%lx\n",
+				d_start, d_end, rxstat);
+			panic("rtl8139: received packet not OK", NO_NUM);
+		}
+		totlen= (rxstat >> RL_RXS_LEN_S);
+		if (totlen < 8 || totlen > 2*ETH_MAX_PACK_SIZE)
+		{
+			/* Someting went wrong */
+			printf(
 		"rl_readv: bad length (%u) in status 0x%08lx at offset 0x%x\n",
-			totlen, rxstat, d_start);
-		printf(
+				totlen, rxstat, d_start);
+			printf(
 		"d_start: 0x%x, d_end: 0x%x, totlen: %d, rxstat: 0x%lx\n",
-			d_start, d_end, totlen, rxstat);
-		panic("", NO_NUM);
-	}
+				d_start, d_end, totlen, rxstat);
+			panic("", NO_NUM);
+		}
 
 #if 0
-	printf("d_start: 0x%x, d_end: 0x%x, totlen: %d, rxstat: 0x%x\n",
-		d_start, d_end, totlen, rxstat);
+		printf("d_start: 0x%x, d_end: 0x%x, totlen: %d, rxstat: 0x%x\n",
+			d_start, d_end, totlen, rxstat);
 #endif
 
-	if (totlen+4 > amount)
-	{
-		printf("rl_readv: packet not yet ready\n");
-		goto suspend;
-	}
-
-	/* Should subtract the CRC */
-	packlen= totlen - ETH_CRC_SIZE;
+		if (totlen+4 > amount)
+		{
+			printf("rl_readv: packet not yet ready\n");
+			break;
+		}
 
-	if (vectored)
-	{
-		iov_src = numap(re_client, (vir_bytes)mp->DL_ADDR,
-			count * sizeof(rep->re_iovec[0]));
-		if (!iov_src)
-			panic("rtl8139: umap failed", NO_NUM);
+		/* Should subtract the CRC */
+		packlen= totlen - ETH_CRC_SIZE;
 
+		iov_src= iov_base + k * stride * sizeof(rep->re_iovec[0]);
 		size= 0;
 		o= d_start+4;
 		src_phys= rep->re_rx_buf;
-		for (i= 0; i<count; i += IOVEC_NR,
+		for (i= 0; i<stride; i += IOVEC_NR,
 			iov_src += IOVEC_NR * sizeof(rep->re_iovec[0]))
 		{
 			n= IOVEC_NR;
-			if (i+n > count)
-				n= count-i;
+			if (i+n > stride)
+				n= stride-i;
 			phys_copy(iov_src, vir2phys(rep->re_iovec), 
 				n * sizeof(rep->re_iovec[0]));
 
 			for (j= 0, iovp= rep->re_iovec; j<n; j++, iovp++)
 			{
 				s= iovp->iov_size;
+				if (s == 0)
+					continue;
 				if (size + s > packlen)
 				{
 					assert(packlen > size);
@@ -1050,49 +1109,46 @@ int vectored;
 		{
 			assert(0);
 		}
-	}
-	else
-	{  
-		assert(0);
-#if 0
-		size= mp->DL_COUNT;
-		if (size < ETH_MIN_PACK_SIZE || size > ETH_MAX_PACK_SIZE_TAGGED)
-			panic("rtl8139: invalid packet size", size);
-		phys_user = numap(re_client, (vir_bytes)mp->DL_ADDR, size);
-		if (!phys_user)
-			panic("rtl8139: umap failed\n", NO_NUM);
-
-		p= rep->re_tx[tx_head].ret_buf;
-		phys_copy(phys_user, p, size);
-#endif
-	}
 
-	if (rep->re_clear_rx)
-	{
-		/* For some reason the receiver FIFO is not stopped when
-		 * the buffer is full.
-		 */
+		if (rep->re_clear_rx)
+		{
+			/* For some reason the receiver FIFO is not stopped
+			 * when the buffer is full.
+			 */
 #if 0
-		printf("rl_readv: later buffer overflow\n");
+			printf("rl_readv: later buffer overflow\n");
 #endif
-		goto suspend;	/* Buffer overflow */
-	}
+			break;	/* Buffer overflow */
+		}
 
+		if (batch)
+		{
+			/* Tell the length in the first iovec of the buffer. */
+			iov_src= iov_base + k * stride * sizeof(first);
+			phys_copy(iov_src, vir2phys(&first), sizeof(first));
+			first.iov_size= packlen;
+			phys_copy(vir2phys(&first), iov_src, sizeof(first));
+		}
 
-	rep->re_stat.ets_packetR++;
-	rep->re_read_s= packlen;
-	rep->re_flags= (rep->re_flags & ~REF_READING) | REF_PACK_RECV;
+		rep->re_stat.ets_packetR++;
+		rep->re_read_s= batch ? k+1 : packlen;
 
-	/* Avoid overflow in 16-bit computations */
-	l= d_start;
-	l += totlen+4;
-	l= (l+3) & ~3;	/* align */
-	if (l >= RX_BUFSIZE)
-	{
-		l -= RX_BUFSIZE;
-		assert(l < RX_BUFSIZE);
+		/* Avoid overflow in 16-bit computations */
+		l= d_start;
+		l += totlen+4;
+		l= (l+3) & ~3;	/* align */
+		if (l >= RX_BUFSIZE)
+		{
+			l -= RX_BUFSIZE;
+			assert(l < RX_BUFSIZE);
+		}
+		rl_outw(port, RL_CAPR, l-RL_CAPR_DATA_OFF);
 	}
-	rl_outw(port, RL_CAPR, l-RL_CAPR_DATA_OFF);
+	if (k == 0)
+		goto suspend;
+
+	rep->re_rx_batch= batch;
+	rep->re_flags= (rep->re_flags & ~REF_READING) | REF_PACK_RECV;
 
 	if (!from_int)
 		reply(rep, OK, FALSE);
@@ -1123,8 +1179,9 @@ message *mp;
 int from_int;
 int vectored;
 {
-	phys_bytes p, iov_src, phys_user;
+	phys_bytes p, iov_src, iov_base, phys_user;
 	int i, j, n, s, port, count, size;
+	int k, stride, npack, tx_done;
 	int tx_head, re_client;
 	re_t *rep;
 	iovec_t *iovp;
@@ -1147,89 +1204,123 @@ int vectored;
 		rep->re_send_int= FALSE;
 		rep->re_tx_alive= TRUE;
 	}
+	else
+		rep->re_tx_done= 0;
 
-	tx_head= rep->re_tx_head;
-	if (rep->re_tx[tx_head].ret_busy)
+	/* A batch has 'stride' iovecs for each packet, and goes out on as
+	 * many descriptors as are free.  The rest waits for the next
+	 * transmit interrupt.
+	 */
+	stride= count;
+	npack= 1;
+	if (vectored && (mp->DL_MODE & DL_BATCH_REQ))
 	{
-		assert(!(rep->re_flags & REF_SEND_AVAIL));
-		rep->re_flags |= REF_SEND_AVAIL;
-		if (rep->re_tx[tx_head].ret_busy)
-			goto suspend;
-
-		/* Race condition, the interrupt handler may clear re_busy
-		 * before we got a chance to set REF_SEND_AVAIL. Checking
-		 * ret_busy twice should be sufficient.
-		 */
-#if 0
-		printf("rl_writev: race detected\n");
-#endif
-		rep->re_flags &= ~REF_SEND_AVAIL;
-		rep->re_send_int= FALSE;
+		stride= (int) (mp->DL_MODE >> DL_STRIDE_SHIFT);
+		if (stride <= 0 || count % stride != 0)
+			panic("rtl8139: bad write batch", count);
+		npack= count / stride;
 	}
-
-	assert(!(rep->re_flags & REF_SEND_AVAIL));
-	assert(!(rep->re_flags & REF_PACK_SENT));
-
 	if (vectored)
 	{
-
-		iov_src = numap(re_client, (vir_bytes)mp->DL_ADDR,
+		iov_base = numap(re_client, (vir_bytes)mp->DL_ADDR,
 			count * sizeof(rep->re_iovec[0]));
-		if (!iov_src)
+		if (!iov_base)
 			panic("rtl8139: umap failed", NO_NUM);
+	}
 
-		size= 0;
-		p= rep->re_tx[tx_head].ret_buf;
-		for (i= 0; i<count; i += IOVEC_NR,
-			iov_src += IOVEC_NR * sizeof(rep->re_iovec[0]))
+	tx_done= rep->re_tx_done;
+	for (k= tx_done; k<npack; k++)
+	{
+		tx_head= rep->re_tx_head;
+		if (rep->re_tx[tx_head].ret_busy)
 		{
-			n= IOVEC_NR;
-			if (i+n > count)
-				n= count-i;
-			phys_copy(iov_src, vir2phys(rep->re_iovec), 
-				n * sizeof(rep->re_iovec[0]));
+			assert(!(rep->re_flags & REF_SEND_AVAIL));
+			rep->re_flags |= REF_SEND_AVAIL;
+			if (rep->re_tx[tx_head].ret_busy)
+				goto suspend;
+
+			/* Race condition, the interrupt handler may clear
+			 * re_busy before we got a chance to set
+			 * REF_SEND_AVAIL. Checking ret_busy twice should be
+			 * sufficient.
+			 */
+#if 0
+			printf("rl_writev: race detected\n");
+#endif
+			rep->re_flags &= ~REF_SEND_AVAIL;
+			rep->re_send_int= FALSE;
+		}
 
-			for (j= 0, iovp= rep->re_iovec; j<n; j++, iovp++)
+		assert(!(rep->re_flags & REF_SEND_AVAIL));
+		assert(!(rep->re_flags & REF_PACK_SENT));
+
+		if (vectored)
+		{
+			iov_src= iov_base + k * stride *
+				sizeof(rep->re_iovec[0]);
+			size= 0;
+			p= rep->re_tx[tx_head].ret_buf;
+			for (i= 0; i<stride; i += IOVEC_NR,
+				iov_src += IOVEC_NR * sizeof(rep->re_iovec[0]))
 			{
-				s= iovp->iov_size;
-				if (size + s > ETH_MAX_PACK_SIZE_TAGGED)
+				n= IOVEC_NR;
+				if (i+n > stride)
+					n= stride-i;
+				phys_copy(iov_src, vir2phys(rep->re_iovec), 
+					n * sizeof(rep->re_iovec[0]));
+
+				for (j= 0, iovp= rep->re_iovec; j<n;
+					j++, iovp++)
 				{
+					s= iovp->iov_size;
+					if (s == 0)
+						continue;
+					if (size + s > ETH_MAX_PACK_SIZE_TAGGED)
+					{
 					panic("rtl8139: invalid packet size",
-						NO_NUM);
-				}
+							NO_NUM);
+					}
 
-				phys_user = numap(re_client, iovp->iov_addr, s);
-				if (!phys_user)
+					phys_user = numap(re_client,
+						iovp->iov_addr, s);
+					if (!phys_user)
 					panic("rtl8139: umap failed\n", NO_NUM);
-				phys_copy(phys_user, p, s);
-				size += s;
-				p += s;
+					phys_copy(phys_user, p, s);
+					size += s;
+					p += s;
+				}
 			}
+			if (size < ETH_MIN_PACK_SIZE)
+				panic("rtl8139: invalid packet size", size);
 		}
-		if (size < ETH_MIN_PACK_SIZE)
-			panic("rtl8139: invalid packet size", size);
-	}
-	else
-	{  
-		size= mp->DL_COUNT;
-		if (size < ETH_MIN_PACK_SIZE || size > ETH_MAX_PACK_SIZE_TAGGED)
-			panic("rtl8139: invalid packet size", size);
-		phys_user = numap(re_client, (vir_bytes)mp->DL_ADDR, size);
-		if (!phys_user)
-			panic("rtl8139: umap failed\n", NO_NUM);
+		else
+		{  
+			size= mp->DL_COUNT;
+			if (size < ETH_MIN_PACK_SIZE ||
+				size > ETH_MAX_PACK_SIZE_TAGGED)
+			{
+				panic("rtl8139: invalid packet size", size);
+			}
+			phys_user = numap(re_client, (vir_bytes)mp->DL_ADDR,
+				size);
+			if (!phys_user)
+				panic("rtl8139: umap failed\n", NO_NUM);
 
-		p= rep->re_tx[tx_head].ret_buf;
-		phys_copy(phys_user, p, size);
-	}
+			p= rep->re_tx[tx_head].ret_buf;
+			phys_copy(phys_user, p, size);
+		}
 
-	rl_outl(rep->re_base_port, RL_TSD0+tx_head*4, 
-		rep->re_ertxth | size);
-	rep->re_tx[tx_head].ret_busy= TRUE;
+		rl_outl(rep->re_base_port, RL_TSD0+tx_head*4, 
+			rep->re_ertxth | size);
+		rep->re_tx[tx_head].ret_busy= TRUE;
 
-	if (++tx_head == N_TX_BUF)
-		tx_head= 0;
-	assert(tx_head < RL_N_TX);
-	rep->re_tx_head= tx_head;
+		if (++tx_head == N_TX_BUF)
+			tx_head= 0;
+		assert(tx_head < RL_N_TX);
+		rep->re_tx_head= tx_head;
+		rep->re_tx_done= k+1;
+	}
+	rep->re_tx_done= 0;
 
 	rep->re_flags |= REF_PACK_SENT;
 
@@ -1255,7 +1346,14 @@ suspend:
 #endif
 
 	if (from_int)
-		panic("rtl8139: should not be sending\n", NO_NUM);
+	{
+		/* Part of a batch went out; the rest goes when another
+		 * descriptor is done.
+		 */
+		if (rep->re_tx_done == tx_done)
+			panic("rtl8139: should not be sending\n", NO_NUM);
+		return;
+	}
 
 	rep->re_tx_mess= *mp;
 	reply(rep, OK, FALSE);
@@ -1752,7 +1850,11 @@ int may_block;
 	if (rep->re_flags & REF_PACK_SENT)
 		status |= DL_PACK_SEND;
 	if (rep->re_flags & REF_PACK_RECV)
+	{
 		status |= DL_PACK_RECV;
+		if (rep->re_rx_batch)
+			status |= DL_PACK_BATCH;
+	}
 
 	reply.m_type = DL_TASK_REPLY;
 	reply.DL_PORT = rep - re_table;
@@ -1965,12 +2067,31 @@ irq_hook_t *hookp;
 	{
 		isr &= ~(RL_ISR_RER | RL_ISR_ROK);
 
+		/* Mask receive interrupts until the timer expires. */
+		rl_outw(port, RL_IMR, RL_IMR_ALL & ~(RL_IMR_RER | RL_IMR_ROK));
+		rl_outl(port, RL_TIMERINT, RX_MITIGATE);
+		rl_outl(port, RL_TCTR, 0);
+
 		if (!rep->re_got_int && (rep->re_flags & REF_READING))
 		{
 			rep->re_got_int= TRUE;
 			interrupt(rl_tasknr);
 		}
 	}
+	if (isr & RL_ISR_TIMEOUT)
+	{
+		isr &= ~RL_ISR_TIMEOUT;
+
+		/* End of the mitigation period, pick up what arrived. */
+		rl_outl(port, RL_TIMERINT, 0);
+		rl_outw(port, RL_IMR, RL_IMR_ALL);
+		if (!rep->re_got_int && (rep->re_flags & REF_READING) &&
+			!(rl_inb(port, RL_CR) & RL_CR_BUFE))
+		{
+			rep->re_got_int= TRUE;
+			interrupt(rl_tasknr);
+		}
+	}
 #if 0
 	if ((isr & (RL_ISR_TER | RL_ISR_TOK)) &&
 		(rep->re_flags & REF_SEND_AVAIL) &&
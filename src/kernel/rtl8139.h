@@ -172,6 +172,7 @@ Created:	Aug 2003 by Philip Homburg <philip@cs.vu.nl>
 #define		RL_RCR_AM	0x00000004 /* Accept Multicast Packets */
 #define		RL_RCR_APM	0x00000002 /* Accept Physical Match Packets */
 #define		RL_RCR_AAP	0x00000001 /* Accept All Packets */
+#define	RL_TCTR		0x48	/* Timer Count Register, write resets */
 #define	RL_MPC		0x4c	/* Missed Packet Counter */
 #define	RL_9346CR	0x50	/* 93C46 Command Register */
 #define		RL_9346CR_EEM_M	0xC0	/* Operating Mode */
@@ -186,6 +187,7 @@ Created:	Aug 2003 by Philip Homburg <philip@cs.vu.nl>
 #define		RL_9346CR_EEDO	0x01	/* EEDO Pin */
 #define RL_CONFIG0	0x51	/* Configuration Register 0 */
 #define RL_CONFIG1	0x52	/* Configuration Register 1 */
+#define	RL_TIMERINT	0x54	/* Timer Interrupt Register, 0 is off */
 #define RL_MSR		0x58	/* Media Status Register */
 #define		RL_MSR_TXFCE	0x80	/* Tx Flow Control Enable */
 #define		RL_MSR_RXFCE	0x40	/* Rx Flow Control Enable */
@@ -295,7 +295,7 @@ message *m_ptr;
 #if ENABLE_SHIPPING
   if ((m_ptr->DEVICE & 15) == 15) {
 	int i;
-	dmagrab(WINCHESTER, hdcint);
+	dmagrab(WINCHESTER, hdcint, 0L);
 	r = cmd_xfer(HD_SHP, 0);
 	if (r != OK) {
 		TRACE(
@@ -363,7 +363,7 @@ unsigned nr_req;                /* length of request vector */
 	acsi_proc = proc_addr(proc_nr);
 	acsi_opcode = opcode;
 	acsi_proc->p_physio = 1;		/* disable (un)shadowing */
-	dmagrab(WINCHESTER, hdcint);
+	dmagrab(WINCHESTER, hdcint, (unsigned long) nbytes);
 
         if (!USE_BUF) {
 		/* To/from this user address */
@@ -480,7 +480,7 @@ PRIVATE int do_open()
   minor = dev << MINOR_SHIFT;
   maxminor = minor + NPARTS + ADDPARTS;
   /* read sector 0 of the drive */
-  dmagrab(WINCHESTER, hdcint);
+  dmagrab(WINCHESTER, hdcint, 0L);
 #if ENABLE_SHIPPING
   for (errors = 0; errors < MAX_SEC0_ERRORS; errors++) {
 	r = cmd_xfer(HD_TUR, 0);
@@ -539,7 +539,7 @@ PRIVATE int do_open()
           {
 	    offset = hi.hd_pi[r].pi_start + hiext.hd_pi[ext].pi_start;
 	    ext = -1;
-	    dmagrab(WINCHESTER, hdcint);
+	    dmagrab(WINCHESTER, hdcint, 0L);
 	    /* retry a number of times */
 	    for (errors = 0; errors < MAX_SEC0_ERRORS; errors++) {
 	        s = do_xfer((phys_bytes)&hiext, offset, 1, DEV_GATHER);
@@ -1065,7 +1065,7 @@ register message *mp;
 	  drive = mp->DEVICE >> MINOR_SHIFT;
 	  buf[0] = TARGET(drive) | buf[0];
 	  buf[1] = LUN(drive) | buf[1];
-	  dmagrab(WINCHESTER, hdcint);
+	  dmagrab(WINCHESTER, hdcint, 0L);
 	  dmaaddr(kaddress);		/* DMA address setup */
 printf("about to ioctl cmd %x %x %x %x %x %x\n", buf[0], buf[1], buf[2], buf[3], buf[4], buf[5]);
 	  r = do_cmd((unsigned char *) buf, kcmd.cmd_cnt,
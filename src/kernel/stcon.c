@@ -60,6 +60,12 @@ PUBLIC void func_key()
   case 8:	/* PF8: dump Amoeba statistics */
   	amdump(); break;
 #endif
+  case 9:	/* PF9: dump DMA and SCSI target statistics */
+	dma_dmp();
+#if (NR_SCSI_DRIVES > 0)
+	scsi_dmp();
+#endif
+	break;
   case 10:	/* PF10: issue SIGKILL */
 	for (i = 0; i < NR_CONS; i++)
 	{
@@ -9,10 +9,17 @@
  * access and can follow some standard pattern which will be
  * provided in this file.
  *
+ * When several tasks wait for the DMA the one with the smallest request
+ * goes first, so that a floppy access need not wait behind a stream of
+ * big hard disk transfers.  A task that has waited for a time slice goes
+ * before any request that hasn't, so big requests are not starved either.
+ *
  * The file contains the following entry points:
  *
  *	dmagrab:	ensure exclusive access to the DMA circuitry
  *	dmafree:	free exclusive access to the DMA circuitry
+ *	dmabusy:	tell if other tasks are using or waiting for the DMA
+ *	dma_dmp:	print the DMA wait statistics per task
  *	dmaint:		DMA interrupt routine, switches to the current driver
  *	dmaaddr:	specify 24 bit RAM address
  *	dmardat:	set dma_mode and read word from dma_data
@@ -31,33 +38,59 @@
 
 #define	ASSERT(x)	if (!(x)) panic("dma: ASSERT(x) failed",NO_NUM);
 
-PRIVATE	int	qhead;
-PRIVATE	int	qlink[NR_TASKS];
+#define	DMA_SLICE	(HZ/5)	/* waiting longer than this beats size */
+
+PRIVATE	int	qhead;		/* task holding the DMA, 0 if none */
+PRIVATE	int	nwait;		/* number of tasks waiting for it */
 
-#define	QNEXT(p)	qlink[(p) + NR_TASKS]
+PRIVATE struct dmatask {
+  int		d_waiting;	/* true if waiting for the DMA */
+  unsigned long	d_bytes;	/* size of the request waiting */
+  clock_t	d_since;	/* waiting or holding since */
+  unsigned long	d_grabs;	/* times the DMA was granted */
+  unsigned long	d_waits;	/* times we had to wait for it */
+  clock_t	d_waitticks;	/* total time waited */
+  clock_t	d_maxwait;	/* longest wait */
+  clock_t	d_holdticks;	/* total time held */
+} dmatask[NR_TASKS];
+
+#define	DTASK(p)	(&dmatask[(p) + NR_TASKS])
 
 PRIVATE	dmaint_t xxxint;
 
 /*===========================================================================*
  *				dmagrab					     *
  *===========================================================================*/
-PUBLIC void dmagrab(p, func)
+PUBLIC void dmagrab(p, func, bytes)
 int p;
 dmaint_t func;
+unsigned long bytes;		/* size of the transfer, 0 if just a command */
 {
   message	m;
-  register int	q;
+  register struct dmatask *dp;
+  clock_t	wait;
 
   ASSERT(p >= -NR_TASKS && p < HARDWARE);
-  ASSERT(QNEXT(p) == 0);
-  if (q = qhead) {
-	while (QNEXT(q))
-		q = QNEXT(q);
-	QNEXT(q) = p;
-	receive(q, &m);
-	ASSERT(qhead == p);
+  dp = DTASK(p);
+  ASSERT(qhead != p && !dp->d_waiting);
+  dp->d_since = get_uptime();
+  if (qhead != 0) {
+	/* Wait until dmafree() picks us. */
+	dp->d_waiting = TRUE;
+	dp->d_bytes = bytes;
+	nwait++;
+	do
+		receive(HARDWARE, &m);
+	while (qhead != p);
+
+	wait = get_uptime() - dp->d_since;
+	dp->d_waits++;
+	dp->d_waitticks += wait;
+	if (wait > dp->d_maxwait) dp->d_maxwait = wait;
+	dp->d_since += wait;
   } else
 	qhead = p;
+  dp->d_grabs++;
   xxxint = func;		/* grab DMA interrupts */
 }
 
@@ -67,14 +100,70 @@ dmaint_t func;
 PUBLIC void dmafree(p)
 int	p;
 {
-  message	m;
+  register struct dmatask *dp, *best;
+  clock_t	now, age, best_age;
 
   xxxint = (dmaint_t)0;	/* no more DMA interrupts */
   ASSERT(qhead == p);
-  qhead = QNEXT(p);
-  QNEXT(p) = 0;
-  if (qhead)
-	send(qhead, &m);
+  now = get_uptime();
+  DTASK(p)->d_holdticks += now - DTASK(p)->d_since;
+  qhead = 0;
+  if (nwait == 0)
+	return;
+
+  /* Pick the waiting task that goes next. */
+  best = NULL;
+  best_age = 0;
+  for (dp = &dmatask[0]; dp < &dmatask[NR_TASKS]; dp++) {
+	if (!dp->d_waiting)
+		continue;
+	age = now - dp->d_since;
+	if (best == NULL
+	    || (age >= DMA_SLICE || best_age >= DMA_SLICE ? age > best_age
+	       : dp->d_bytes < best->d_bytes
+	         || (dp->d_bytes == best->d_bytes && age > best_age))) {
+		best = dp;
+		best_age = age;
+	}
+  }
+  best->d_waiting = FALSE;
+  nwait--;
+  qhead = (best - dmatask) - NR_TASKS;
+  interrupt(qhead);
+}
+
+/*===========================================================================*
+ *				dmabusy					     *
+ *===========================================================================*/
+PUBLIC int dmabusy(p)
+int	p;
+{
+/* Tell if another task than p holds the DMA or waits for it.  A task may
+ * use this to keep its own transfer short.
+ */
+  return(nwait > (DTASK(p)->d_waiting ? 1 : 0) || (qhead != 0 && qhead != p));
+}
+
+/*===========================================================================*
+ *				dma_dmp					     *
+ *===========================================================================*/
+PUBLIC void dma_dmp()
+{
+/* Print how long each task had to wait for the DMA. */
+  register struct dmatask *dp;
+
+  printf("\n-task-- --grabs-- --waits-- avg wait ms max wait ms hold ms\n");
+  for (dp = &dmatask[0]; dp < &dmatask[NR_TASKS]; dp++) {
+	if (dp->d_grabs == 0)
+		continue;
+	printf("%-7.7s %9lu %9lu %11lu %11lu %7lu\n",
+		proc_addr((int) (dp - dmatask) - NR_TASKS)->p_name,
+		dp->d_grabs, dp->d_waits,
+		dp->d_waits == 0 ? 0L :
+			(unsigned long) dp->d_waitticks * 1000 / HZ / dp->d_waits,
+		(unsigned long) dp->d_maxwait * 1000 / HZ,
+		(unsigned long) dp->d_holdticks * 1000 / HZ);
+  }
 }
 
 /*===========================================================================*
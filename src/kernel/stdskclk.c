@@ -68,7 +68,7 @@ int		minor; /* 0= bms100 1=bms200 */
   );
   IDISABLE();
 
-  dmagrab(WINCHESTER, dmaint);
+  dmagrab(WINCHESTER, dmaint, 0L);
   if (rw == DEV_GATHER && minor == DC_RBMS100) {
 	DMA->dma_mode = FDC | HDC;
 	DMA->dma_data = CLK_ADR1+CLK_HOLD;
@@ -5,6 +5,12 @@
  * It accepts messages for reading, for writing, for scattered I/O, for
  * control and for opening and closing a device.
  *
+ * Reads are done a whole track at a time into a track cache, so that the
+ * next blocks of the track need no disk access.  The drives share the cache.
+ * Writes go to the disk at once and update the cache.  The ST has no disk
+ * change line, so the cache is dropped on open and when the motor is turned
+ * off.
+ *
  * The ST floppy disk controller shares the access to the DMA circuitry
  * with other devices. For this reason the floppy disk controller makes
  * use of some special DMA accessing code.
@@ -122,6 +128,7 @@ PRIVATE char fl_dmabuf[FL_BUF_SIZE];
 #define	FORMAT_DEV_BIT	0x80	/* bit in minor to turn write into format */
 #define	MAX_SECTORS	21
 #define	NO_CYL		100	/* floppy is uncalibrated */
+#define	NO_TRACK	(-1)	/* track cache is empty */
 
 /*
  * DRIVE returns the select code
@@ -273,8 +280,16 @@ PRIVATE struct floppy {		/* main drive struct, one entry per drive */
   struct fparam *fl_fparam;	/* pointer to according fparam struct */
   struct device fl_geom;	/* Geometry of the drive */
   struct device fl_part[NR_PARTITIONS];  /* partition's base & size */
+  int fl_trkblk;		/* first sector of the cached track */
+  int fl_badtrk;		/* track that could not be read whole */
+  struct fparam *fl_trkparam;	/* format the cached track was read with */
 } floppy[NR_FD_DRIVES], *f_fp;
 
+/* One track cache for all drives.  At most one drive has a valid fl_trkblk,
+ * the one whose track is in the buffer.
+ */
+PRIVATE char fl_trkbuf[MAX_TRACK_LEN];
+
 PRIVATE	short f_drive;		/* selected drive */
 PRIVATE	short f_device;		/* selected minor device */
 PRIVATE	short fl_procnr;	/* process using device */
@@ -300,6 +315,11 @@ FORWARD _PROTOTYPE( int f_do_close, (struct driver *dp, message *m_ptr) );
 FORWARD _PROTOTYPE( void f_geometry, (struct partition *entry)		);
 FORWARD _PROTOTYPE( int f_do_diocntl, (struct driver *dp, message *m_ptr));
 FORWARD	_PROTOTYPE( int chk_id_marks, (int idsec, int *secmin, int *secmax));
+FORWARD _PROTOTYPE( unsigned f_trkread, (int proc_nr, phys_bytes user_base,
+				int block, iovec_t *iov, unsigned nbytes)	);
+FORWARD _PROTOTYPE( void f_trkwrite, (int block, phys_bytes data,
+							unsigned nbytes));
+FORWARD _PROTOTYPE( void f_trkinval, (struct floppy *fp)		);
 PRIVATE	_PROTOTYPE( void iruptdelay, (void)				);
 
 /* Entry points to this driver. */
@@ -328,8 +348,10 @@ PUBLIC void floppy_task()
    */
   TRACE(printf("fd: task started\n"));
 
-  for (fp = &floppy[0]; fp < &floppy[NR_FD_DRIVES]; fp++)
+  for (fp = &floppy[0]; fp < &floppy[NR_FD_DRIVES]; fp++) {
 	fp->fl_curcyl = NO_CYL;	/* uncalibrated */
+	f_trkinval(fp);
+  }
 
   driver_task(&f_dtab);
 }
@@ -385,6 +407,7 @@ unsigned nr_req;                /* length of request vector */
   iovec_t *iop, *iov_end = iov + nr_req;
   struct fparam *f;
   unsigned int nbytes, count, chunk;
+  int block;
   phys_bytes first_dma_phys;
   struct proc *rp;
   phys_bytes user_base = proc_vir2phys(proc_addr(proc_nr), 0);
@@ -434,6 +457,21 @@ unsigned nr_req;                /* length of request vector */
 	printf("FLOPPY %d sec %d: funny nbytes == 0\n", f_device, xp->x_block));
 	if (nbytes == 0) return(OK);
 
+	if (opcode == DEV_GATHER && !open_count[f_drive].formatting) {
+		/* Read the whole track, later reads are memory copies. */
+		count = f_trkread(proc_nr, user_base, xp->x_block, iov,
+									nbytes);
+		if (count > 0) {
+			position += count;
+			while (nr_req > 0 && iov->iov_size == 0) {
+				iov++;
+				nr_req--;
+			}
+			continue;
+		}
+	}
+	block = xp->x_block;
+
 	if (do_use_buf) first_dma_phys = dmabuf;
 	else first_dma_phys = user_base + iov[0].iov_addr;
 
@@ -449,7 +487,7 @@ unsigned nr_req;                /* length of request vector */
 	fl_procnr = proc_nr;
 	rp = proc_addr(fl_procnr);
 	rp->p_physio = 1;			/* disable (un)shadowing */
-	dmagrab(FLOPPY, fdcint);
+	dmagrab(FLOPPY, fdcint, (unsigned long) nbytes);
 
 	if (do_use_buf && opcode == DEV_SCATTER) {
 		/* Copy from user space to the DMA buffer. */
@@ -475,6 +513,7 @@ unsigned nr_req;                /* length of request vector */
 	}
 
 	if (xp->x_errors >= MAX_ERRORS || xp->x_count == nbytes) {
+		if (opcode == DEV_SCATTER) f_trkinval(f_fp);
 		dmafree(FLOPPY);
 		rp->p_physio = 0;		/* enable (un)shadowing */
 		return(EIO);	/* too many errors / nothing transferred */
@@ -493,6 +532,13 @@ unsigned nr_req;                /* length of request vector */
 			count += chunk;
 		}
 	}
+	if (opcode == DEV_SCATTER) {
+		/* Write through the track cache. */
+		if (do_use_buf && !open_count[f_drive].formatting)
+			f_trkwrite(block, first_dma_phys, nbytes);
+		else
+			f_trkinval(f_fp);
+	}
 	dmafree(FLOPPY);
 	rp->p_physio = 0;			/* enable (un)shadowing */
 
@@ -552,7 +598,10 @@ message *mp;
   f_fp->fl_fparam = f;			/* must be set for do_xfer() */
   h = &hparam[f_drive];
 
-  dmagrab(FLOPPY, fdcint);
+  /* There is no disk change line, the diskette may be another one. */
+  f_trkinval(f_fp);
+
+  dmagrab(FLOPPY, fdcint, 0L);
   fd_select(f_drive, 0, DD);
 
   /* This updates the WRI_PRO bit */
@@ -981,6 +1030,7 @@ PUBLIC void fd_timer()
  * 3. Deselect drive(s) when all motors stopped spinning
  */
   register int	pl;
+  register struct floppy *fp;
 
   if (selectic == 0)
 	return;
@@ -1007,6 +1057,10 @@ PUBLIC void fd_timer()
   if (--selectic != 0)
 	return;
   selected = 0;
+
+  /* With the motor off the diskette may be changed unnoticed. */
+  for (fp = &floppy[0]; fp < &floppy[NR_FD_DRIVES]; fp++)
+	fp->fl_trkblk = NO_TRACK;
   pl = lock();
   SOUND->sd_selr = YM_IOA;
   /* It is better to switch back to 8 Mhz
@@ -1327,6 +1381,7 @@ register message *mp;		/* pointer to read or write message */
 				f_drive, open_count[f_drive].o_cnt);
 #endif
 		open_count[f_drive].formatting = 1;
+		f_trkinval(f_fp);
 		break;
 
 	case DIOFMTFREE:
@@ -1368,6 +1423,7 @@ register message *mp;		/* pointer to read or write message */
 			return(EINVAL);
 
 		*f = ufparam;
+		f_trkinval(f_fp);
 		break;
 
 	case DIOGETHP:
@@ -1382,6 +1438,7 @@ register message *mp;		/* pointer to read or write message */
 		if (uhparam.dense == 0)
 			return(EINVAL);
 		*h = uhparam;
+		f_trkinval(f_fp);
 		break;
   }
   return(OK);
@@ -1420,6 +1477,130 @@ int *secmax;	/* bislang groesste Sektornummer */
   return (unchanged);
 }
 
+/*===========================================================================*
+ *				f_trkread				     *
+ *===========================================================================*/
+PRIVATE unsigned f_trkread(proc_nr, user_base, block, iov, nbytes)
+int proc_nr;			/* process doing the request */
+phys_bytes user_base;		/* base of the user's address space */
+int block;			/* first sector to read */
+iovec_t *iov;			/* where to put the data */
+unsigned nbytes;		/* bytes wanted */
+{
+/* Copy data from the track cache, after reading the track into it if it
+ * isn't there yet.  The iovec is updated.  Returns the number of bytes
+ * copied, the rest of the track at most, or 0 if the track can't be read
+ * whole and must be read sector by sector.
+ */
+  register struct xfer *xp = &xfer;
+  register struct fparam *f = f_fp->fl_fparam;
+  register struct proc *rp;
+  struct floppy *fp;
+  phys_bytes trkbuf = (phys_bytes) &fl_trkbuf[0];
+  unsigned trkbytes, offset, count, chunk;
+  int first, old_block;
+
+  trkbytes = f->nr_sectors * f->sector_size;
+  if (trkbytes > MAX_TRACK_LEN) return(0);
+  first = block - block % f->nr_sectors;
+
+  if (f_fp->fl_trkblk != first || f_fp->fl_trkparam != f) {
+	if (first == f_fp->fl_badtrk) return(0);
+
+	/* Don't hold up others with a whole track; just do the sectors. */
+	if (dmabusy(FLOPPY)) return(0);
+
+	/* The buffer is taken from whichever drive has it now. */
+	for (fp = &floppy[0]; fp < &floppy[NR_FD_DRIVES]; fp++)
+		fp->fl_trkblk = NO_TRACK;
+
+	/* Read the track.  The sector by sector path after a failure starts
+	 * at xp->x_block, so it must be put back.
+	 */
+	fl_procnr = proc_nr;
+	rp = proc_addr(fl_procnr);
+	rp->p_physio = 1;			/* disable (un)shadowing */
+	old_block = xp->x_block;
+	xp->x_block = first;
+	xp->x_address = trkbuf;
+	xp->x_count = trkbytes;
+	xp->x_rw = DEV_GATHER;
+	xp->x_errors = 0;
+	dmagrab(FLOPPY, fdcint, (unsigned long) trkbytes);
+	if (do_xfer()) {
+		receive(HARDWARE, &mess);
+		fd_deselect();
+	}
+	dmafree(FLOPPY);
+	xp->x_block = old_block;
+	if (xp->x_errors >= MAX_ERRORS || xp->x_count > 0) {
+		/* A bad sector somewhere; don't try this track again. */
+		f_fp->fl_badtrk = first;
+		rp->p_physio = 0;		/* enable (un)shadowing */
+		return(0);
+	}
+	f_fp->fl_trkblk = first;
+	f_fp->fl_trkparam = f;
+  }
+
+  offset = (block - first) * f->sector_size;
+  if (nbytes > trkbytes - offset) nbytes = trkbytes - offset;
+  for (count = 0; count < nbytes; count += chunk) {
+	chunk = iov->iov_size;
+	if (chunk > nbytes - count) chunk = nbytes - count;
+	phys_copy(trkbuf + offset + count, user_base + iov->iov_addr,
+							(phys_bytes) chunk);
+	iov->iov_addr += chunk;
+	if ((iov->iov_size -= chunk) == 0) iov++;
+  }
+  proc_addr(proc_nr)->p_physio = 0;	/* enable (un)shadowing */
+  return(count);
+}
+
+/*===========================================================================*
+ *				f_trkwrite				     *
+ *===========================================================================*/
+PRIVATE void f_trkwrite(block, data, nbytes)
+int block;			/* first sector written */
+phys_bytes data;		/* the data written */
+unsigned nbytes;		/* and its size */
+{
+/* Sectors have been written, update the part of the cached track they
+ * overlap.
+ */
+  register struct fparam *f = f_fp->fl_fparam;
+  long start, end, trkbytes;
+
+  if (f_fp->fl_trkblk == NO_TRACK) return;
+  if (f_fp->fl_trkparam != f) {
+	f_trkinval(f_fp);
+	return;
+  }
+  trkbytes = (long) f->nr_sectors * f->sector_size;
+  start = (long) (block - f_fp->fl_trkblk) * f->sector_size;
+  end = start + nbytes;
+  if (start < 0) {
+	data -= start;
+	start = 0;
+  }
+  if (end > trkbytes) end = trkbytes;
+  if (start < end) {
+	phys_copy(data, (phys_bytes) &fl_trkbuf[0] + start,
+						(phys_bytes) (end - start));
+  }
+}
+
+/*===========================================================================*
+ *				f_trkinval				     *
+ *===========================================================================*/
+PRIVATE void f_trkinval(fp)
+struct floppy *fp;
+{
+/* Forget the cached track of a drive. */
+  fp->fl_trkblk = NO_TRACK;
+  fp->fl_badtrk = NO_TRACK;
+}
+
 /*===========================================================================*
  *				iruptdelay				     *
  *===========================================================================*/
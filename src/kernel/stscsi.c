@@ -102,6 +102,10 @@ void scsidmaint()
 				
 /* timing constants */
 #define	SCSI_POLL	10000	/* polling of scsi bits */
+#define	SLOW_WARN	(5*HZ)	/* complain if a target is this slow */
+
+/* the count byte of a group 0 command limits the transfer length */
+#define	MAX_SECS	255
 
 /* initiator scsi id bit */
 #define	INITIATOR_ID_BIT	0x80	/* initiator has scsi id 7 */
@@ -111,6 +115,18 @@ PRIVATE message mess;		/* message buffer for in and out */
 
 PRIVATE int open_count[NR_SCSI_DRIVES];
 
+PRIVATE struct target {		/* per target limits and statistics */
+  unsigned t_max_secs;		/* sectors the target takes in one command */
+  unsigned long t_cmds;		/* read/write commands issued */
+  unsigned long t_errors;	/* commands that failed */
+  unsigned long t_rsecs;	/* sectors read */
+  unsigned long t_wsecs;	/* sectors written */
+  clock_t t_ticks;		/* total time spent in commands */
+  clock_t t_maxticks;		/* longest command */
+} target[NR_SCSI_DRIVES];
+
+PRIVATE timer_t scsi_tmr;	/* wakes us while a target is busy */
+
 #if (SCAT_SECTORS != 0)
 _PROTOTYPE( PRIVATE int do_hvrdwt, (message *mp)			);
 #endif
@@ -122,6 +138,8 @@ _PROTOTYPE( PRIVATE int do_transfer, (int rw, int pnr, int minor,
 			long pos, int count, vir_bytes vadr)		);
 _PROTOTYPE( PRIVATE void wait_req, (char *s)				);
 _PROTOTYPE( PRIVATE void wait_req_done, (char *s)			);
+_PROTOTYPE( PRIVATE void wait_req_slow, (char *s)			);
+_PROTOTYPE( PRIVATE void scsi_tick, (timer_t *tp)			);
 _PROTOTYPE( PRIVATE int do_xfer, (int drive, phys_bytes address,
 			long sector, int count, int rw)			);
 _PROTOTYPE( PRIVATE void snd, (int c)					);
@@ -133,15 +151,26 @@ _PROTOTYPE( PRIVATE int rcv, (void)					);
 PUBLIC void scsi_task()
 {
   register int r, caller, procno;
+  register struct target *tp;
 
   TRACE(printf("scsi: task started\n"));
 
+  for (tp = &target[0]; tp < &target[NR_SCSI_DRIVES]; tp++)
+	tp->t_max_secs = MAX_SECS;
+
   /*
    * The main loop of the disk task.
    * It waits for a message, carries it out, and sends a reply.
    */
   while (TRUE) {
+	/* Check if a timer expired. */
+	if (proc_ptr->p_exptimers != NULL) tmr_exptimers();
+
 	receive(ANY, &mess);
+
+	/* A tick that came after the wait for the target ended. */
+	if (mess.m_source == HARDWARE) continue;
+
 	if (mess.m_source < 0)
 		panic("disk task got message from ", mess.m_source);
 	TRACE(printf("hd: received %d from %d\n",mess.m_type,mess.m_source));
@@ -546,9 +575,11 @@ register int count;		/* byte count to transfer */
 vir_bytes vadr;			/* virtual src/dst of user buffer */
 {
   register struct proc	*rp;
+  register struct target	*tp;
   register long		secnum, avail;
   register phys_bytes	address;
-  int			r, errors, drive;
+  int			r, errors, drive, done, n;
+  clock_t		start, ticks;
 
   drive = minor >> MINOR_SHIFT;
   if (drive < 0 || drive >= NR_SCSI_DRIVES)
@@ -575,17 +606,37 @@ vir_bytes vadr;			/* virtual src/dst of user buffer */
   if (count <= 0)
 	return(0);
   secnum += pi[minor].pi_start;
+  tp = &target[drive];
   rp->p_physio = 1;		/* disable (un)shadowing */
-  /* This loop allows a failed operation to be repeated. */
-  for (errors = 0; errors < MAX_ERRORS; errors++) {
-	r = do_xfer(drive, address, secnum, count, rw);
-	if (r == OK)
-		break;		/* if successful, exit loop */
+  /* Transfer in pieces the target can take. */
+  for (done = 0; done < count; done += n) {
+	n = count - done;
+	if (n > tp->t_max_secs) n = tp->t_max_secs;
+
+	/* This loop allows a failed operation to be repeated. */
+	for (errors = 0; errors < MAX_ERRORS; errors++) {
+		start = get_uptime();
+		r = do_xfer(drive, address + (phys_bytes) done * SECTOR_SIZE,
+						secnum + done, n, rw);
+		ticks = get_uptime() - start;
+		tp->t_cmds++;
+		tp->t_ticks += ticks;
+		if (ticks > tp->t_maxticks) tp->t_maxticks = ticks;
+		if (r == OK)
+			break;		/* if successful, exit loop */
+		tp->t_errors++;
+
+		/* Maybe the target can't do that many sectors at once. */
+		if (errors > 0 && n > 1) tp->t_max_secs = n = (n + 1) / 2;
+	}
+	if (r != OK)
+		break;
+	if (rw == DEV_READ) tp->t_rsecs += n; else tp->t_wsecs += n;
   }
   rp->p_physio = 0;		/* enable (un)shadowing */
-  if (r != OK)
+  if (done == 0)
 	return(EIO);
-  return(count * SECTOR_SIZE);
+  return(done * SECTOR_SIZE);
 }
 
 /*===========================================================================*
@@ -624,6 +675,63 @@ printf("wait_req_done: %s\n", s);
     }
 }
 
+/*===========================================================================*
+ *				wait_req_slow				     *
+ *===========================================================================*/
+ 
+PRIVATE void wait_req_slow(s)
+char *s;
+{
+    register int i = SCSI_POLL;
+    clock_t start = 0;
+    message m;
+
+    /* wait for a request, when the target may be busy for a while (seeking
+       or writing). after a short poll check once every clock tick, so that
+       other processes can run meanwhile */
+    while(!(SCSI_HW->CSB & REQ)) {
+	if (i > 0) {
+	    i--;
+	    continue;
+	}
+	if (start == 0) start = get_uptime();
+	if (get_uptime() - start == SLOW_WARN)
+	    printf("wait_req_slow: %s\n", s);
+	tmr_settimer(&scsi_tmr, SCSI, get_uptime() + 1, scsi_tick);
+	receive(HARDWARE, &m);
+    }
+    if (start != 0) tmr_clrtimer(&scsi_tmr);
+}
+
+/*===========================================================================*
+ *				scsi_tick				     *
+ *===========================================================================*/
+PRIVATE void scsi_tick(tp)
+timer_t *tp;
+{
+  interrupt(SCSI);
+}
+
+/*===========================================================================*
+ *				scsi_dmp				     *
+ *===========================================================================*/
+PUBLIC void scsi_dmp()
+{
+/* Print the statistics of the targets. */
+  register struct target *tp;
+  unsigned long avg;
+
+  printf("\ntarget  commands  errors  kB read  kB written  avg ms  max ms  max sec\n");
+  for (tp = &target[0]; tp < &target[NR_SCSI_DRIVES]; tp++) {
+	if (tp->t_cmds == 0) continue;
+	avg = (unsigned long) tp->t_ticks * 1000 / HZ / tp->t_cmds;
+	printf("%6d %9lu %7lu %8lu %11lu %7lu %7lu %8u\n",
+		(int) (tp - target), tp->t_cmds, tp->t_errors,
+		tp->t_rsecs / 2, tp->t_wsecs / 2, avg,
+		(unsigned long) tp->t_maxticks * 1000 / HZ, tp->t_max_secs);
+  }
+}
+
 /*===========================================================================*
  *				do_xfer					     *
  *===========================================================================*/
@@ -727,7 +835,7 @@ int		rw;
     
     if (rw == DEV_READ)
     {
-        wait_req("No request for data in phase");
+        wait_req_slow("No request for data in phase");
 	if ((SCSI_HW->CSB & CSB_PHASE_MASK) != DATA_IN_PHASE)
     	    panic("Data in phase not reached", SCSI_HW->CSB & CSB_PHASE_MASK);
 	TRACE(printf("Data in phase.\n"));
@@ -739,7 +847,7 @@ int		rw;
     }
     else /* rw == DEV_WRITE */
     {
-        wait_req("No request for data out phase");
+        wait_req_slow("No request for data out phase");
 	if ((SCSI_HW->CSB & CSB_PHASE_MASK) != DATA_OUT_PHASE)
     	    panic("Data out phase not reached", SCSI_HW->CSB & CSB_PHASE_MASK);
 	TRACE(printf("Data out phase.\n"));
@@ -751,7 +859,7 @@ int		rw;
 	SCSI_HW->ICR = 0;
     }
     
-    wait_req("No request for status phase");
+    wait_req_slow("No request for status phase");
     
     if ((SCSI_HW->CSB & CSB_PHASE_MASK) != STATUS_PHASE)
     	panic("Status phase not reached", SCSI_HW->CSB & CSB_PHASE_MASK);
@@ -859,7 +967,7 @@ register message *mp;
 
 	  drive = mp->DEVICE >> MINOR_SHIFT;
 	  buf[0] = ((drive>>1)<<5) | buf[0];
-	  dmagrab(WINCHESTER, hdcint);
+	  dmagrab(WINCHESTER, hdcint, 0L);
 	  dmaaddr(uaddress);		/* DMA address setup */
 	  r = do_cmd(buf, kcmd.cmd_cnt, (kcmd.size + 511)/512, wrbit);	/* command parameters */
 	  if (r == OK) {
@@ -225,6 +225,7 @@ register message *m_ptr;	/* pointer to request message */
 #endif
   register struct proc *rpc;
   struct proc *rpp;
+  int i;
 
   rpp = proc_addr(m_ptr->PROC1);
   assert(isuserp(rpp));
@@ -257,6 +258,10 @@ register message *m_ptr;	/* pointer to request message */
   rpc->sys_time = 0;
   rpc->child_utime = 0;
   rpc->child_stime = 0;
+  rpc->p_nmsgsent = rpc->p_nmsgrecv = 0;	/* and the IPC counters */
+  rpc->p_nvcsw = rpc->p_nivcsw = 0;
+  for (i = 0; i < NR_BLK; i++) rpc->p_blktime[i] = 0;
+  rpc->p_blkstart = acct_ticks;		/* blocked on MM, like the parent */
 
 #if (SHADOWING == 1)
   rpc->p_nflips = 0;
@@ -456,6 +461,7 @@ message *m_ptr;			/* pointer to request message */
   sigemptyset(&rc->p_pending);
   rc->p_pendcount = 0;
   rc->p_flags = 0;
+  rc->p_blkwhy = 0;
   rc->p_priority = PPRI_NONE;
   return(OK);
 }
@@ -1098,6 +1104,44 @@ message *m_ptr;			/* pointer to request message */
 	phys_copy(src, dst, len);
 	return(OK); }
 
+  case SYSGETPROC: {
+	/* Report the CPU and IPC accounting of a process or task. */
+	struct sysgetproc getproc;
+	struct proc *rp;
+	int i;
+
+	if (vir_copy(proc_nr, argp, SYSTASK, (vir_bytes) &getproc,
+		sizeof(getproc)) != OK) return(EFAULT);
+
+	if (!isokprocn(getproc.proc_nr)) return(EINVAL);
+	rp = proc_addr(getproc.proc_nr);
+	if (isemptyp(rp)) return(ESRCH);
+
+	lock();			/* halt the volatile counters in rp */
+	getproc.pid = rp->p_pid;
+	getproc.utime = rp->user_time;
+	getproc.stime = rp->sys_time;
+	getproc.msgsent = rp->p_nmsgsent;
+	getproc.msgrecv = rp->p_nmsgrecv;
+	getproc.nvcsw = rp->p_nvcsw;
+	getproc.nivcsw = rp->p_nivcsw;
+	for (i = 0; i < NR_BLK; i++) getproc.blktime[i] = rp->p_blktime[i];
+	if (rp->p_blkwhy != 0) {
+		/* Include the time it has been blocked up to now. */
+		getproc.blktime[rp->p_blkwhy - 1] += acct_ticks - rp->p_blkstart;
+	}
+	unlock();
+#if (CHIP == M68000)
+	getproc.nflips = rp->p_nflips;
+#else
+	getproc.nflips = 0;
+#endif
+	getproc.nswapin = getproc.nswapout = 0;	/* MM fills these in */
+
+	if (vir_copy(SYSTASK, (vir_bytes) &getproc,
+		proc_nr, argp, sizeof(getproc)) != OK) return(EFAULT);
+	return(OK); }
+
   default:
 	return(EINVAL);
   }
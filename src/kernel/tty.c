@@ -105,6 +105,7 @@ FORWARD _PROTOTYPE( void do_close, (tty_t *tp, message *m_ptr)		);
 FORWARD _PROTOTYPE( void do_read, (tty_t *tp, message *m_ptr)		);
 FORWARD _PROTOTYPE( void do_write, (tty_t *tp, message *m_ptr)		);
 FORWARD _PROTOTYPE( void in_transfer, (tty_t *tp)			);
+FORWARD _PROTOTYPE( int in_raw, (tty_t *tp, char *buf, int count)	);
 FORWARD _PROTOTYPE( int echo, (tty_t *tp, int ch)			);
 FORWARD _PROTOTYPE( void rawecho, (tty_t *tp, int ch)			);
 FORWARD _PROTOTYPE( int back_over, (tty_t *tp)				);
@@ -787,6 +788,11 @@ int count;			/* number of input characters */
   int timeset = FALSE;
   static unsigned char csize_mask[] = { 0x1F, 0x3F, 0x7F, 0xFF };
 
+  /* Nothing to interpret on a raw line without echo?  Then bulk copy. */
+  if (!(tp->tty_termios.c_lflag & (ICANON|ECHO|ECHONL|ISIG|IEXTEN))
+	&& !(tp->tty_termios.c_iflag & (ISTRIP|IGNCR|ICRNL|INLCR|IXON)))
+	return(in_raw(tp, buf, count));
+
   for (ct = 0; ct < count; ct++) {
 	/* Take one character. */
 	ch = *buf++ & BYTE;
@@ -935,6 +941,60 @@ int count;			/* number of input characters */
 }
 
 
+/*===========================================================================*
+ *				in_raw					     *
+ *===========================================================================*/
+PRIVATE int in_raw(tp, buf, count)
+register tty_t *tp;		/* terminal on which characters have arrived */
+char *buf;			/* buffer with input characters */
+int count;			/* number of input characters */
+{
+/* The fast path of in_process() for a line that needs no input processing:
+ * characters are stored in the input queue in runs as long as the queue
+ * allows, each one a "line break" as in_process() would make it.  Return the
+ * number of characters stored.
+ */
+
+  register u16_t *hp;
+  register int ch;
+  int n, ct;
+
+  ct = 0;
+  while (ct < count && tp->tty_incount < buflen(tp->tty_inbuf)) {
+	/* Room up to the end of the ring or until the queue is full. */
+	n = bufend(tp->tty_inbuf) - tp->tty_inhead;
+	if (n > buflen(tp->tty_inbuf) - tp->tty_incount)
+		n = buflen(tp->tty_inbuf) - tp->tty_incount;
+	if (n > count - ct) n = count - ct;
+
+	tp->tty_incount += n;
+	tp->tty_eotct += n;
+	ct += n;
+	hp = tp->tty_inhead;
+	while (n > 0) {
+		ch = *buf++ & BYTE;
+		if (ch == _POSIX_VDISABLE) ch |= IN_ESC;
+		*hp++ = ch | IN_EOT;
+		n--;
+	}
+	if (hp == bufend(tp->tty_inbuf)) hp = tp->tty_inbuf;
+	tp->tty_inhead = hp;
+
+	/* Try to finish input if the queue is full. */
+	if (tp->tty_incount == buflen(tp->tty_inbuf)) in_transfer(tp);
+  }
+
+  /* Start an inter-byte timer? */
+  if (ct > 0 && tp->tty_termios.c_cc[VMIN] > 0
+				&& tp->tty_termios.c_cc[VTIME] > 0) {
+	lock();
+	settimer(tp, TRUE);
+	unlock();
+  }
+  return ct;
+}
+
+
 /*===========================================================================*
  *				echo					     *
  *===========================================================================*/
@@ -1,6 +1,10 @@
 /*	tty.h - Terminals	*/
 
+#if (MACHINE == IBM_PC && _WORD_SIZE == 2)
 #define TTY_IN_BYTES     256	/* tty input queue size */
+#else
+#define TTY_IN_BYTES    1024	/* room for a window of a fast serial line */
+#endif
 #define TAB_SIZE           8	/* distance between tab stops */
 #define TAB_MASK           7	/* mask to compute a tab stop position */
 
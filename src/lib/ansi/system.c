@@ -10,7 +10,7 @@
 #include	<stdlib.h>
 #include	<signal.h>
 
-extern pid_t _fork(void);
+extern pid_t _vfork(void);
 extern pid_t _wait(int *);
 extern void _exit(int);
 extern void _execve(const char *path, const char ** argv, const char ** envp);
@@ -32,13 +32,15 @@ system(const char *str)
 	int pid, exitstatus, waitval;
 	int i;
 
-	if ((pid = _fork()) < 0) return str ? -1 : 0;
+	/* Fill in the command before the fork, the child shares our frame. */
+	exec_tab[2] = str ? str : "cd .";	/* "cd ." just tests for a shell */
+
+	/* The child only closes files and execs, so it may borrow our memory. */
+	if ((pid = _vfork()) < 0) return str ? -1 : 0;
 
 	if (pid == 0) {
 		for (i = 3; i <= 20; i++)
 			_close(i);
-		if (!str) str = "cd .";		/* just testing for a shell */
-		exec_tab[2] = str;		/* fill in command */
 		_execve("/bin/sh", exec_tab, *_penviron);
 		/* get here if execve fails ... */
 		_exit(FAIL);	/* see manual page */
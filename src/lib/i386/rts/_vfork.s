@@ -0,0 +1,41 @@
+.sect .text; .sect .rom; .sect .data; .sect .bss
+.define __vfork
+.extern _errno
+
+! See ../h/com.h and ../h/callnr.h for C definitions
+BOTH = 3
+SYSVEC = 33
+MM = 0
+VFORK = 58
+M_TYPE = 4		! offset of m_type in a message
+
+!*========================================================================*
+!                                 _vfork                                  *
+!*========================================================================*
+! The child runs on the stack of the parent until it does an exec or an exit,
+! so the frames below the caller's may be gone when the parent gets its reply.
+! Keep the return address in a register, and the message and saved ebx in
+! static storage, so nothing is needed from the stack after the trap.
+.sect .bss
+vfmsg:	.space	40		! message buffer, larger than any message
+vfebx:	.space	4		! caller's ebx
+
+.sect .text
+__vfork:
+	pop	edx			! edx = return address
+	mov	(vfebx), ebx
+	mov	ebx, vfmsg		! ebx = message pointer
+	mov	(vfmsg+M_TYPE), VFORK
+	mov	eax, MM			! eax = dest-src
+	mov	ecx, BOTH		! _sendrec(MM, &vfmsg)
+	int	SYSVEC			! trap to the kernel; edx survives in both
+	mov	ebx, (vfebx)
+	test	eax, eax
+	jnz	0f			! sendrec failed
+	mov	eax, (vfmsg+M_TYPE)	! result: child's pid, or 0 in the child
+	test	eax, eax
+	jns	1f
+0:	neg	eax
+	mov	(_errno), eax
+	mov	eax, -1
+1:	jmp	edx			! return
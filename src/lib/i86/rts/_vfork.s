@@ -0,0 +1,38 @@
+.sect .text; .sect .rom; .sect .data; .sect .bss
+.define __vfork
+.extern _errno
+
+! See ../h/com.h and ../h/callnr.h for C definitions
+BOTH = 3
+SYSVEC = 32
+MM = 0
+VFORK = 58
+M_TYPE = 2		! offset of m_type in a message
+
+!*========================================================================*
+!                                 _vfork                                  *
+!*========================================================================*
+! The child runs on the stack of the parent until it does an exec or an exit,
+! so the frames below the caller's may be gone when the parent gets its reply.
+! Keep the return address in a register, and the message in static storage,
+! so nothing is needed from the stack after the trap.
+.sect .bss
+vfmsg:	.space	24		! message buffer, larger than any message
+
+.sect .text
+__vfork:
+	pop	dx			! dx = return address
+	mov	bx, #vfmsg		! bx = message pointer
+	mov	vfmsg+M_TYPE, #VFORK
+	mov	ax, *MM			! ax = dest-src
+	mov	cx, *BOTH		! _sendrec(MM, &vfmsg)
+	int	SYSVEC			! trap to the kernel; dx survives in both
+	test	ax, ax
+	jnz	0f			! sendrec failed
+	mov	ax, vfmsg+M_TYPE	! result: child's pid, or 0 in the child
+	test	ax, ax
+	jns	1f
+0:	neg	ax
+	mov	_errno, ax
+	mov	ax, #-1
+1:	jmp	dx			! return
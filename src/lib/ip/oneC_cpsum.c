@@ -0,0 +1,96 @@
+/*	oneC_copysum() - Copy and one complement's checksum
+ *
+ * Copies 'size' bytes from 'src' to 'dst' and returns the checksum of the
+ * data as oneC_sum() would, in one pass over memory.  If the two buffers are
+ * not aligned alike it falls back to memcpy() and oneC_sum().
+ */
+
+#include <sys/types.h>
+#include <string.h>
+#include <net/gen/oneCsum.h>
+
+u16_t oneC_copysum(U16_t prev, void *dst, void *src, size_t size)
+{
+	u8_t *sptr, *dptr;
+	size_t n;
+	u16_t word;
+	u32_t sum, w, carry;
+	int swap= 0;
+
+	if (((size_t) dst ^ (size_t) src) & 3) {
+		memcpy(dst, src, size);
+		return oneC_sum(prev, src, size);
+	}
+
+	sum= prev;
+	sptr= src;
+	dptr= dst;
+	n= size;
+
+	swap= ((size_t) sptr & 1);
+	if (swap) {
+		sum= ((sum & 0xFF) << 8) | ((sum & 0xFF00) >> 8);
+		if (n > 0) {
+			((u8_t *) &word)[0]= 0;
+			((u8_t *) &word)[1]= dptr[0]= sptr[0];
+			sum+= (u32_t) word;
+			sptr+= 1;
+			dptr+= 1;
+			n-= 1;
+		}
+	}
+
+	if (((size_t) sptr & 2) && n >= 2) {
+		sum+= (u32_t) (((u16_t *) dptr)[0]= ((u16_t *) sptr)[0]);
+		sptr+= 2;
+		dptr+= 2;
+		n-= 2;
+	}
+
+	/* Longs, with the carries counted as in oneC_sum(). */
+	carry= 0;
+	while (n >= 16) {
+		((u32_t *) dptr)[0]= w= ((u32_t *) sptr)[0];
+		sum+= w; carry+= (sum < w);
+		((u32_t *) dptr)[1]= w= ((u32_t *) sptr)[1];
+		sum+= w; carry+= (sum < w);
+		((u32_t *) dptr)[2]= w= ((u32_t *) sptr)[2];
+		sum+= w; carry+= (sum < w);
+		((u32_t *) dptr)[3]= w= ((u32_t *) sptr)[3];
+		sum+= w; carry+= (sum < w);
+		sptr+= 16;
+		dptr+= 16;
+		n-= 16;
+	}
+
+	while (n >= 4) {
+		((u32_t *) dptr)[0]= w= ((u32_t *) sptr)[0];
+		sum+= w; carry+= (sum < w);
+		sptr+= 4;
+		dptr+= 4;
+		n-= 4;
+	}
+
+	sum= (sum & 0xFFFF) + (sum >> 16) + (carry & 0xFFFF) + (carry >> 16);
+
+	if (n >= 2) {
+		sum+= (u32_t) (((u16_t *) dptr)[0]= ((u16_t *) sptr)[0]);
+		sptr+= 2;
+		dptr+= 2;
+		n-= 2;
+	}
+
+	if (n > 0) {
+		((u8_t *) &word)[0]= dptr[0]= sptr[0];
+		((u8_t *) &word)[1]= 0;
+		sum+= (u32_t) word;
+	}
+
+	sum= (sum & 0xFFFF) + (sum >> 16);
+	sum= (sum & 0xFFFF) + (sum >> 16);
+
+	if (swap) {
+		sum= ((sum & 0xFF) << 8) | ((sum & 0xFF00) >> 8);
+	}
+	return sum;
+}
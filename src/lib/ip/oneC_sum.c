@@ -11,7 +11,7 @@ u16_t oneC_sum(U16_t prev, void *data, size_t size)
 	u8_t *dptr;
 	size_t n;
 	u16_t word;
-	u32_t sum;
+	u32_t sum, w, carry;
 	int swap= 0;
 
 	sum= prev;
@@ -30,16 +30,35 @@ u16_t oneC_sum(U16_t prev, void *data, size_t size)
 		}
 	}
 
-	while (n >= 8) {
-		sum+= (u32_t) ((u16_t *) dptr)[0]
-		    + (u32_t) ((u16_t *) dptr)[1]
-		    + (u32_t) ((u16_t *) dptr)[2]
-		    + (u32_t) ((u16_t *) dptr)[3];
-		dptr+= 8;
-		n-= 8;
+	if (((size_t) dptr & 2) && n >= 2) {
+		sum+= (u32_t) ((u16_t *) dptr)[0];
+		dptr+= 2;
+		n-= 2;
+	}
+
+	/* Add whole longs.  A long is two words, and 2^32 is 1 modulo 0xFFFF,
+	 * so the carries out of the sum may simply be counted and added back
+	 * at the end.
+	 */
+	carry= 0;
+	while (n >= 16) {
+		w= ((u32_t *) dptr)[0]; sum+= w; carry+= (sum < w);
+		w= ((u32_t *) dptr)[1]; sum+= w; carry+= (sum < w);
+		w= ((u32_t *) dptr)[2]; sum+= w; carry+= (sum < w);
+		w= ((u32_t *) dptr)[3]; sum+= w; carry+= (sum < w);
+		dptr+= 16;
+		n-= 16;
 	}
 
-	while (n >= 2) {
+	while (n >= 4) {
+		w= ((u32_t *) dptr)[0]; sum+= w; carry+= (sum < w);
+		dptr+= 4;
+		n-= 4;
+	}
+
+	sum= (sum & 0xFFFF) + (sum >> 16) + (carry & 0xFFFF) + (carry >> 16);
+
+	if (n >= 2) {
 		sum+= (u32_t) ((u16_t *) dptr)[0];
 		dptr+= 2;
 		n-= 2;
@@ -52,7 +71,7 @@ u16_t oneC_sum(U16_t prev, void *data, size_t size)
 	}
 
 	sum= (sum & 0xFFFF) + (sum >> 16);
-	if (sum > 0xFFFF) sum++;
+	sum= (sum & 0xFFFF) + (sum >> 16);
 
 	if (swap) {
 		sum= ((sum & 0xFF) << 8) | ((sum & 0xFF00) >> 8);
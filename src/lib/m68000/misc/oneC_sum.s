@@ -9,7 +9,7 @@
 
 !	a0 = dptr
 !	d0 = sum
-!	d1 = temp
+!	d1 = loop count
 !	d2 = swap
 !	d3 = temp
 !	d4 = size, n
@@ -27,45 +27,74 @@ _oneC_sum:
 #endif /* __NOLONGS__ */
 
 	move.l	#0,d3		! sweep reg (upper word will remain 0)
-	move.l	#0,d1		! sweep reg
 
 	move.w	a0,d2
 	and.w	#1,d2		! swap = ((size_t) dptr & 1
 
-	beq	I5		! if (swap) {
+	beq	I3		! if (swap) {
 	rol.w	#8,d0	! sum =((sum & 0xff) << 8)|((sum & 0xff00) >> 8)
 	tst.w	d4		! if (n > o) {
 	bls	I9		! statt I5
 	move.b	(a0)+,d3 ! ((u8_t *)&word)[0]=0; ((u8_t *)&word)[1] = *dptr++
 	add.l	d3,d0		!		sum += (u32_t) word;
 	sub.w	#1,d4		!		n-= 1
+
+I3:
+	move.w	d4,d1		! a0 is even now, that is all a long access needs
+	lsr.w	#5,d1		! d1 = n / 32
+	and.w	#31,d4		! n %= 32
+	sub.l	d3,d3		! d3 = 0, X = 0
 	bra	I5
 
 II2:
-	move.w	(a0)+,d3
-	add.l	d3,d1		!               d1 = (u32_t) ((u16_t *) dptr[0]
-	move.w	(a0)+,d3	!		 (u32_t) ((u16_t) *) dptr[1]
-	add.l	d3,d1		!		d1 = +
-	move.w	(a0)+,d3	!	 	 (u32_t) ((u16_t *) dptr)[2]
-	add.l	d3,d1		!		d1 = +
-	move.w	(a0)+,d3	!	 	 (u32_t) ((u16_t *) dptr)[3]
-	add.l	d3,d1		!		d1 = +
-	sub.w	#8,d4		!		n-= 8
+	move.l	(a0)+,d3	! sum += 8 longs, the carries go around through X
+	addx.l	d3,d0
+	move.l	(a0)+,d3
+	addx.l	d3,d0
+	move.l	(a0)+,d3
+	addx.l	d3,d0
+	move.l	(a0)+,d3
+	addx.l	d3,d0
+	move.l	(a0)+,d3
+	addx.l	d3,d0
+	move.l	(a0)+,d3
+	addx.l	d3,d0
+	move.l	(a0)+,d3
+	addx.l	d3,d0
+	move.l	(a0)+,d3
+	addx.l	d3,d0
 I5:
-	cmp.w	#8,d4		! while (n >= 8) {
-	bcc	II2
+	dbra	d1,II2		! while (n >= 32) {
+	move.l	#0,d3		! leaves X alone
+	addx.l	d3,d0		! add the last carry back in,
+	addx.l	d3,d0		! and the one that may give
 
-	add.l	d1,d0		!		sum += ...
-	bra	I7
+	move.w	d4,d1
+	lsr.w	#2,d1		! d1 = n / 4
+	and.w	#3,d4		! n %= 4
+	sub.l	d3,d3		! X = 0
+	bra	I6
 
 II3:
-	move.w	(a0)+,d3	!	 d0 = (u32_t) ((u16_t *) dptr)[0]
-	add.l	d3,d0		!	sum+=
+	move.l	(a0)+,d3
+	addx.l	d3,d0
+I6:
+	dbra	d1,II3		! while (n >= 4) {
+	move.l	#0,d3		! leaves X alone
+	addx.l	d3,d0
+	addx.l	d3,d0
+
+	move.w	d0,d3		! fold to 17 bits before the last word and byte
+	move.w	#0,d0
+	swap	d0
+	add.l	d3,d0
+
+	cmp.w	#2,d4		! if (n >= 2) {
+	bcs	I7
+	move.w	(a0)+,d3
+	add.l	d3,d0		!	sum += (u32_t) ((u16_t *) dptr)[0]
 	sub.w	#2,d4		!	n-= 2
 I7:
-	cmp.w	#2,d4		! while (n >= 2) {
-	bcc	II3
-
 	tst.w	d4		! if (n > 0) {
 	bls	I9
 	move.b	(a0)+,d3	!	(u32_t) word = (*dptr++ << 8) + 0;
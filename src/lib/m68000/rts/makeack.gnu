@@ -12,7 +12,8 @@ OBJSL =	$(LIBRARY)(__longjmperr.o)	\
 	$(LIBRARY)(send.o)		\
 	$(LIBRARY)(sendrec.o)		\
 	$(LIBRARY)(setjmp.o)		\
-	$(LIBRARY)(sndrec.o)
+	$(LIBRARY)(sndrec.o)		\
+	$(LIBRARY)(vfork.o)
 
 OBJS =	$(OBJSL) $(CRT0)
 
@@ -57,3 +58,6 @@ $(LIBRARY)(setjmp.o):	setjmp.s
 $(LIBRARY)(sndrec.o):	sndrec.s
 	../mot2mit.sh $< | $(CPP) $(CFLAGS) - | $(AS) -o sndrec.o -
 
+$(LIBRARY)(vfork.o):	vfork.s
+	../mot2mit.sh $< | $(CPP) $(CFLAGS) - | $(AS) -o vfork.o -
+
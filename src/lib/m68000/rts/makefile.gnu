@@ -16,6 +16,7 @@ OBJSL =	__longjmperr.o	\
 	sendrec.o	\
 	setjmp.o	\
 	sndrec.o	\
+	vfork.o		\
 	__intsize.o
 
 OBJS =	$(OBJSL) $(CRT0)
@@ -61,3 +62,6 @@ setjmp.o:	setjmp.s
 sndrec.o:	sndrec.s
 	../mot2mit.sh $< | $(CPP) $(CPPFLAGS) - | $(AS) -o sndrec.o -
 
+vfork.o:	vfork.s
+	../mot2mit.sh $< | $(CPP) $(CPPFLAGS) - | $(AS) -o vfork.o -
+
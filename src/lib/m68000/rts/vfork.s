@@ -0,0 +1,61 @@
+#
+	.define	__vfork
+	.extern	_errno
+#ifdef __ACK__
+	.sect	.text
+	.sect	.rom
+	.sect	.data
+	.sect	.bss
+#endif	/* __ACK__ */
+! =====================================================================
+!                               vfork                                 =
+! =====================================================================
+! The child runs on the stack of the parent until it does an exec or an
+! exit, so the frames below the caller's may be gone when the parent gets
+! its reply.  Keep the return address in a register, and the message in
+! a static buffer, so neither needs the stack after the trap.
+
+! See ../h/com.h and ../h/callnr.h for C definitions
+BOTH	= 3
+MM	= 0
+VFORK	= 58
+#ifdef __MLONG__
+M_TYPE	= 4		! offset of m_type in a message
+#else
+M_TYPE	= 2
+#endif /* __MLONG__ */
+
+	.sect	.bss
+vfmsg:	.space	40	! message buffer, larger than any message
+
+	.sect	.text
+__vfork:
+	move.l	(sp)+,a1	! a1 = return address
+	lea	vfmsg,a0	! a0 = message pointer
+#ifdef __MLONG__
+	move.l	#VFORK,M_TYPE(a0)
+	move.l	#MM,d1		! d1 = dest-src
+#else
+	move.w	#VFORK,M_TYPE(a0)
+	move.w	#MM,d1		! d1 = dest-src
+#endif /* __MLONG__ */
+	move.w	#BOTH,d0	! sendrec(MM, &vfmsg)
+	trap	#0		! trap to the kernel; a1 survives in both
+#ifdef __MLONG__
+	ext.l	d0
+	bne	L1		! sendrec failed
+	move.l	vfmsg+M_TYPE,d0	! result: child's pid, or 0 in the child
+	bpl	L2
+L1:	neg.l	d0
+	move.l	d0,_errno
+	move.l	#-1,d0
+#else
+	tst.w	d0
+	bne	L1		! sendrec failed
+	move.w	vfmsg+M_TYPE,d0	! result: child's pid, or 0 in the child
+	bpl	L2
+L1:	neg.w	d0
+	move.w	d0,_errno
+	move.w	#-1,d0
+#endif /* __MLONG__ */
+L2:	jmp	(a1)		! return
@@ -24,7 +24,7 @@ typedef int wait_arg;
 int _close(int d);
 int _dup2(int oldd, int newd);		/* not present in System 5 */
 int _execl(const char *name, const char *_arg, ... );
-pid_t _fork(void);
+pid_t _vfork(void);
 int _pipe(int fildes[2]);
 pid_t _wait(wait_arg *status);
 void _exit(int status);
@@ -43,7 +43,7 @@ _CONST char *type;
 
 	if (Xtype == 2 ||
 	    _pipe(piped) < 0 ||
-	    (pid = _fork()) < 0) return 0;
+	    (pid = _vfork()) < 0) return 0;
 	
 	if (pid == 0) {
 		/* child */
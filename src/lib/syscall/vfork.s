@@ -0,0 +1,7 @@
+.sect .text
+.extern	__vfork
+.define	_vfork
+.align 2
+
+_vfork:
+	jmp	__vfork
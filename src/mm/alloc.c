@@ -8,11 +8,28 @@
  * kernel, and MM are "allocated" to mark them as not available and to
  * remove them from the hole list.
  *
+ * Each memory hole is also on one of the size class lists.  Class 'c' holds
+ * the holes of 2^c up to 2^(c+1)-1 clicks, so a best fit is found by looking
+ * at a few holes of one or two classes instead of at the whole list.
+ *
  * The entry points into this file are:
  *   alloc_mem:	allocate a given sized chunk of memory
  *   free_mem:	release a previously allocated chunk of memory
  *   mem_init:	initialize the tables when MM start up
- *   max_hole:	returns the largest hole currently available
+ *
+ * When no hole is big enough, the text segments that exec keeps for reuse
+ * are given up first.  If that is not enough, but all holes together are,
+ * the memory is compacted: process images are slid down into the holes below
+ * them, which moves the free memory up where it can merge into one big hole.
+ * This only works if processes can be moved, so not with shadowing, where a
+ * program is relocated to the absolute address it is loaded at.
+ *
+ * Failing that, a process asleep in MM is swapped out.  The longest sleeper
+ * goes first, with large images preferred among those that have slept about
+ * as long.  The swap area has a hole list of its own, which is allocated from
+ * the lowest address up to keep the swapped out images close together.  The
+ * queue of processes to be swapped in is kept in swap address order, so that
+ * a batch of them is read back in one sweep over the swap area.
  */
 
 #include "mm.h"
@@ -21,36 +38,64 @@
 #include <signal.h>
 #include "mproc.h"
 
-#define NR_HOLES  (2*NR_PROCS)	/* max # entries in hole table */
+/* MM cannot grow its own tables, so the hole table is sized for the worst
+ * case: every process owns at most two blocks (text and data), and each of
+ * them can be separated from the next by a hole.  The rest is for the chunks
+ * of memory reported by the kernel and the swap area.
+ */
+#define NR_HOLES  (2*NR_PROCS + 16)	/* max # entries in hole table */
+#define NR_CLASSES (8 * sizeof(phys_clicks))	/* # of hole size classes */
+#define NO_CLASS  (-1)		/* hole is not on a size class list */
 #define NIL_HOLE (struct hole *) 0
+#define NO_SEG	  (-1)		/* block is not a segment of the process */
 
 PRIVATE struct hole {
   struct hole *h_next;		/* pointer to next entry on the list */
+  struct hole *h_prev;		/* pointer to previous entry on the list */
+  struct hole *h_cnext;		/* next hole in the same size class */
+  struct hole *h_cprev;		/* previous hole in the same size class */
   phys_clicks h_base;		/* where does the hole begin? */
   phys_clicks h_len;		/* how big is the hole? */
+  int h_class;			/* size class, or NO_CLASS */
 } hole[NR_HOLES];
 
 PRIVATE struct hole *hole_head;	/* pointer to first hole */
 PRIVATE struct hole *free_slots;/* ptr to list of unused table slots */
+PRIVATE struct hole *class_head[NR_CLASSES];	/* memory holes by size */
 #if ENABLE_SWAP
 PRIVATE int swap_fd = -1;	/* file descriptor of open swap file/device */
 PRIVATE u32_t swap_offset;	/* offset to start of swap area on swap file */
 PRIVATE phys_clicks swap_base;	/* memory offset chosen as swap base */
 PRIVATE phys_clicks swap_maxsize;/* maximum amount of swap "memory" possible */
+PRIVATE struct hole *swap_head;	/* pointer to first hole in the swap area */
 PRIVATE struct mproc *in_queue;	/* queue of processes wanting to swap in */
-PRIVATE struct mproc *outswap = &mproc[LOW_USER];  /* outswap candidate? */
+#define SWAP_AGE_MAX	1024	/* sleeps longer than this count the same */
+#define list_head(base)	((base) < swap_base ? &hole_head : &swap_head)
 #else /* !SWAP */
 #define swap_base ((phys_clicks) -1)
+#define list_head(base)	(&hole_head)
 #endif /* !SWAP */
 
-FORWARD _PROTOTYPE( void del_slot, (struct hole *prev_ptr, struct hole *hp) );
+FORWARD _PROTOTYPE( void del_slot, (struct hole *hp)			    );
 FORWARD _PROTOTYPE( void merge, (struct hole *hp)			    );
+FORWARD _PROTOTYPE( int size_class, (phys_clicks clicks)		    );
+FORWARD _PROTOTYPE( void class_add, (struct hole *hp)			    );
+FORWARD _PROTOTYPE( void class_del, (struct hole *hp)			    );
+FORWARD _PROTOTYPE( struct hole *best_fit, (phys_clicks clicks)		    );
+FORWARD _PROTOTYPE( void bite, (struct hole *hp, phys_clicks clicks)	    );
+#if (SHADOWING == 0)
+FORWARD _PROTOTYPE( struct hole *compact, (phys_clicks clicks)		    );
+FORWARD _PROTOTYPE( phys_clicks slide, (phys_clicks base, phys_clicks to)  );
+FORWARD _PROTOTYPE( int owner, (struct mproc *rmp, phys_clicks base)	    );
+#else
+#define compact(clicks)	(NIL_HOLE)
+#endif
 #if ENABLE_SWAP
-FORWARD _PROTOTYPE( int swap_out, (void)				    );
+FORWARD _PROTOTYPE( int swap_out, (phys_clicks clicks)			    );
 FORWARD _PROTOTYPE( phys_clicks alloc_mem2, \
 				(phys_clicks base, phys_clicks clicks)	    );
 #else
-#define swap_out()	(0)
+#define swap_out(clicks)	(0)
 #endif
 
 #define	TRACE(x)	x
@@ -61,73 +106,28 @@ FORWARD _PROTOTYPE( phys_clicks alloc_mem2, \
 PUBLIC phys_clicks alloc_mem(clicks)
 phys_clicks clicks;		/* amount of memory requested */
 {
-/* Allocate a block of memory from the free list using first fit. The block
+/* Allocate a block of memory from the free list using best fit.  The block
  * consists of a sequence of contiguous bytes, whose length in clicks is
  * given by 'clicks'.  A pointer to the block is returned.  The block is
  * always on a click boundary.  This procedure is called when memory is
- * needed for FORK or EXEC.  Swap other processes out if needed.
+ * needed for FORK or EXEC.  Free kept text segments, compact memory or swap
+ * other processes out if needed, in that order of cost.
  */
 
-  register struct hole *hp, *prev_ptr;
+  register struct hole *hp;
   phys_clicks old_base;
 
-#if (SHADOWING && ENABLE_SWAP)
-  register struct hole *best_hp = NIL_HOLE, *best_prev;
-
-  /* find the smallest hole that fits */
-  do {
-	hp = hole_head;
-	while (hp != NIL_HOLE && hp->h_base < swap_base) {
-		if (hp->h_len >= clicks) {
-			if (best_hp == NIL_HOLE || hp->h_len < best_hp->h_len) {
-				best_hp = hp;
-				best_prev = prev_ptr;
-			}
-		}
-		prev_ptr = hp;
-		hp = hp->h_next;
-	}
-
-	/* found a hole ? */
-	if (best_hp != NIL_HOLE) {
-		old_base = best_hp->h_base;	/* remember where it started */
-		best_hp->h_base += clicks;	/* bite a piece off */
-		best_hp->h_len -= clicks;	/* ditto */
-
-		/* Delete the hole if used up completely. */
-		if (best_hp->h_len == 0) del_slot(best_prev, best_hp);
-
-		/* Return the start address of the acquired block. */
-		return(old_base);
-	}
-  } while (swap_out());		/* try to swap some other process out */
-
-#else
-
-  do {
-	hp = hole_head;
-	while (hp != NIL_HOLE && hp->h_base < swap_base) {
-		if (hp->h_len >= clicks) {
-			/* We found a hole that is big enough.  Use it. */
-			old_base = hp->h_base;	/* remember where it started */
-			hp->h_base += clicks;	/* bite a piece off */
-			hp->h_len -= clicks;	/* ditto */
-
-			/* Delete the hole if used up completely. */
-			if (hp->h_len == 0) del_slot(prev_ptr, hp);
-
-			/* Return the start address of the acquired block. */
-			return(old_base);
-		}
-
-		prev_ptr = hp;
-		hp = hp->h_next;
-	}
-  } while (swap_out());		/* try to swap some other process out */
-
-#endif /* SHADOWING && ENABLE_SWAP */
+  for (;;) {
+	if ((hp = best_fit(clicks)) != NIL_HOLE) break;
+	if (text_reclaim()) continue;	/* drop a text kept for reuse */
+	if ((hp = compact(clicks)) != NIL_HOLE) break;
+	if (!swap_out(clicks)) return(NO_MEM);
+  }
 
-  return(NO_MEM);
+  /* Bite the block off the smallest hole that is big enough. */
+  old_base = hp->h_base;
+  bite(hp, clicks);
+  return(old_base);
 }
 
 /*===========================================================================*
@@ -139,18 +139,22 @@ phys_clicks clicks;		/* number of clicks to free */
 {
 /* Return a block of free memory to the hole list.  The parameters tell where
  * the block starts in physical memory and how big it is.  The block is added
- * to the hole list.  If it is contiguous with an existing hole on either end,
- * it is merged with the hole or holes.
+ * to the hole list, or to the swap list if it lies in the swap area.  If it
+ * is contiguous with an existing hole on either end, it is merged with the
+ * hole or holes.
  */
 
   register struct hole *hp, *new_ptr, *prev_ptr;
+  struct hole **headp;
 
   if (clicks == 0) return;
   if ( (new_ptr = free_slots) == NIL_HOLE) panic("Hole table full", NO_NUM);
   new_ptr->h_base = base;
   new_ptr->h_len = clicks;
+  new_ptr->h_class = NO_CLASS;
   free_slots = new_ptr->h_next;
-  hp = hole_head;
+  headp = list_head(base);
+  hp = *headp;
 
   /* If this block's address is numerically less than the lowest hole currently
    * available, or if no holes are currently available, put this hole on the
@@ -159,7 +163,9 @@ phys_clicks clicks;		/* number of clicks to free */
   if (hp == NIL_HOLE || base <= hp->h_base) {
 	/* Block to be freed goes on front of the hole list. */
 	new_ptr->h_next = hp;
-	hole_head = new_ptr;
+	new_ptr->h_prev = NIL_HOLE;
+	if (hp != NIL_HOLE) hp->h_prev = new_ptr;
+	*headp = new_ptr;
 	merge(new_ptr);
 	return;
   }
@@ -171,16 +177,17 @@ phys_clicks clicks;		/* number of clicks to free */
   }
 
   /* We found where it goes.  Insert block after 'prev_ptr'. */
-  new_ptr->h_next = prev_ptr->h_next;
+  new_ptr->h_next = hp;
+  new_ptr->h_prev = prev_ptr;
   prev_ptr->h_next = new_ptr;
+  if (hp != NIL_HOLE) hp->h_prev = new_ptr;
   merge(prev_ptr);		/* sequence is 'prev_ptr', 'new_ptr', 'hp' */
 }
 
 /*===========================================================================*
  *				del_slot				     *
  *===========================================================================*/
-PRIVATE void del_slot(prev_ptr, hp)
-register struct hole *prev_ptr;	/* pointer to hole entry just ahead of 'hp' */
+PRIVATE void del_slot(hp)
 register struct hole *hp;	/* pointer to hole entry to be removed */
 {
 /* Remove an entry from the hole list.  This procedure is called when a
@@ -189,10 +196,12 @@ register struct hole *hp;	/* pointer to hole entry to be removed */
  * entry in the hole list.
  */
 
-  if (hp == hole_head)
-	hole_head = hp->h_next;
+  class_del(hp);
+  if (hp->h_prev == NIL_HOLE)
+	*list_head(hp->h_base) = hp->h_next;
   else
-	prev_ptr->h_next = hp->h_next;
+	hp->h_prev->h_next = hp->h_next;
+  if (hp->h_next != NIL_HOLE) hp->h_next->h_prev = hp->h_prev;
 
   hp->h_next = free_slots;
   free_slots = hp;
@@ -207,7 +216,8 @@ register struct hole *hp;	/* ptr to hole to merge with its successors */
 /* Check for contiguous holes and merge any found.  Contiguous holes can occur
  * when a block of memory is freed, and it happens to abut another hole on
  * either or both ends.  The pointer 'hp' points to the first of a series of
- * three holes that can potentially all be merged together.
+ * three holes that can potentially all be merged together.  The holes that
+ * remain are put back on the size class list that fits their new size.
  */
 
   register struct hole *next_ptr;
@@ -215,24 +225,241 @@ register struct hole *hp;	/* ptr to hole to merge with its successors */
   /* If 'hp' points to the last hole, no merging is possible.  If it does not,
    * try to absorb its successor into it and free the successor's table entry.
    */
-  if ( (next_ptr = hp->h_next) == NIL_HOLE) return;
+  class_del(hp);
+  if ( (next_ptr = hp->h_next) == NIL_HOLE) {
+	class_add(hp);
+	return;
+  }
   if (hp->h_base + hp->h_len == next_ptr->h_base) {
 	hp->h_len += next_ptr->h_len;	/* first one gets second one's mem */
-	del_slot(hp, next_ptr);
+	del_slot(next_ptr);
   } else {
+	class_add(hp);
 	hp = next_ptr;
+	class_del(hp);
   }
 
-  /* If 'hp' now points to the last hole, return; otherwise, try to absorb its
-   * successor into it.
+  /* If 'hp' now points to the last hole, we're done; otherwise, try to absorb
+   * its successor into it.
    */
-  if ( (next_ptr = hp->h_next) == NIL_HOLE) return;
-  if (hp->h_base + hp->h_len == next_ptr->h_base) {
+  if ( (next_ptr = hp->h_next) != NIL_HOLE
+				&& hp->h_base + hp->h_len == next_ptr->h_base) {
 	hp->h_len += next_ptr->h_len;
-	del_slot(hp, next_ptr);
+	del_slot(next_ptr);
+  }
+  class_add(hp);
+}
+
+/*===========================================================================*
+ *				size_class				     *
+ *===========================================================================*/
+PRIVATE int size_class(clicks)
+phys_clicks clicks;		/* size of a hole or request */
+{
+/* Return the size class of 'clicks', i.e. the logarithm base 2 rounded down. */
+
+  int c;
+
+  for (c = 0; clicks > 1; c++) clicks >>= 1;
+  return(c);
+}
+
+/*===========================================================================*
+ *				class_add				     *
+ *===========================================================================*/
+PRIVATE void class_add(hp)
+register struct hole *hp;	/* hole to put on its size class list */
+{
+/* Put a memory hole on the front of the list of its size class.  Holes in
+ * the swap area have their own list, so they are left out.
+ */
+
+  int c;
+
+  if (hp->h_base >= swap_base) {
+	hp->h_class = NO_CLASS;
+	return;
+  }
+  c = size_class(hp->h_len);
+  hp->h_class = c;
+  hp->h_cprev = NIL_HOLE;
+  if ((hp->h_cnext = class_head[c]) != NIL_HOLE) hp->h_cnext->h_cprev = hp;
+  class_head[c] = hp;
+}
+
+/*===========================================================================*
+ *				class_del				     *
+ *===========================================================================*/
+PRIVATE void class_del(hp)
+register struct hole *hp;	/* hole to take off its size class list */
+{
+/* Remove a hole from its size class list, if it is on one. */
+
+  if (hp->h_class == NO_CLASS) return;
+  if (hp->h_cprev == NIL_HOLE)
+	class_head[hp->h_class] = hp->h_cnext;
+  else
+	hp->h_cprev->h_cnext = hp->h_cnext;
+  if (hp->h_cnext != NIL_HOLE) hp->h_cnext->h_cprev = hp->h_cprev;
+  hp->h_class = NO_CLASS;
+}
+
+/*===========================================================================*
+ *				best_fit				     *
+ *===========================================================================*/
+PRIVATE struct hole *best_fit(clicks)
+phys_clicks clicks;		/* amount of memory requested */
+{
+/* Find the smallest memory hole of at least 'clicks' clicks.  The holes of a
+ * size class are all bigger than those of the classes below it, so the first
+ * class with a hole that fits holds the best fit.  Of equal holes the lowest
+ * is taken to keep memory use packed at the bottom.
+ */
+
+  register struct hole *hp, *best;
+  int c;
+
+  for (c = size_class(clicks); c < NR_CLASSES; c++) {
+	best = NIL_HOLE;
+	for (hp = class_head[c]; hp != NIL_HOLE; hp = hp->h_cnext) {
+		if (hp->h_len < clicks) continue;
+		if (best == NIL_HOLE || hp->h_len < best->h_len
+			|| (hp->h_len == best->h_len && hp->h_base < best->h_base))
+			best = hp;
+	}
+	if (best != NIL_HOLE) return(best);
+  }
+  return(NIL_HOLE);
+}
+
+/*===========================================================================*
+ *				bite					     *
+ *===========================================================================*/
+PRIVATE void bite(hp, clicks)
+register struct hole *hp;	/* hole to allocate from */
+phys_clicks clicks;		/* amount of memory taken */
+{
+/* Take 'clicks' off the front of a hole.  Delete the hole if used up
+ * completely, otherwise move it to the size class that fits what is left.
+ */
+
+  class_del(hp);
+  hp->h_base += clicks;
+  hp->h_len -= clicks;
+  if (hp->h_len == 0)
+	del_slot(hp);
+  else
+	class_add(hp);
+}
+
+#if (SHADOWING == 0)
+/*===========================================================================*
+ *				compact					     *
+ *===========================================================================*/
+PRIVATE struct hole *compact(clicks)
+phys_clicks clicks;		/* amount of memory requested */
+{
+/* Slide process images down into the holes below them, from the bottom of
+ * memory up, until a hole of at least 'clicks' clicks is made.  Return that
+ * hole, or NIL_HOLE if there is not enough free memory or if images that
+ * cannot be moved are in the way.
+ */
+
+  register struct hole *hp;
+  phys_clicks free, len, moved;
+
+  free = 0;
+  for (hp = hole_head; hp != NIL_HOLE; hp = hp->h_next) free += hp->h_len;
+  if (free < clicks) return(NIL_HOLE);	/* don't bother */
+
+  moved = 0;
+  for (hp = hole_head; hp != NIL_HOLE; hp = hp->h_next) {
+	/* Move the blocks above this hole down until one can't be moved.
+	 * The hole then moves up, and merges with the next hole if it meets
+	 * it.
+	 */
+	while (hp->h_len < clicks
+		&& (len = slide(hp->h_base + hp->h_len, hp->h_base)) != 0) {
+		class_del(hp);
+		hp->h_base += len;
+		merge(hp);
+		moved += len;
+	}
+	if (hp->h_len >= clicks) break;
   }
+  if (moved != 0)
+	TRACE(printf("compacted %d clicks of memory\n", moved));
+  return(hp);
 }
 
+/*===========================================================================*
+ *				slide					     *
+ *===========================================================================*/
+PRIVATE phys_clicks slide(base, to)
+phys_clicks base;		/* where the block starts now */
+phys_clicks to;			/* where it should start, below 'base' */
+{
+/* Move the block of memory at 'base' down to 'to' and return its size, or
+ * return 0 if it can't be moved.  A block is either the data and stack of a
+ * process, or a text segment that may be shared by several processes.  It
+ * can only be moved if all its owners are in MM, i.e. blocked on one of our
+ * calls or being served right now, so that no task is doing I/O to it.
+ */
+
+  register struct mproc *rmp;
+  phys_clicks len;
+  int seg, r;
+
+  len = 0;
+  for (rmp = mproc_addr(LOW_USER); rmp < &mproc[NR_PROCS]; rmp++) {
+	if ((seg = owner(rmp, base)) == NO_SEG) continue;
+	if (rmp->mp_flags & TRACED) return(0);
+	if (rmp != mp && !(rmp->mp_flags & (PAUSED | WAITING | SIGSUSPENDED
+						| ONSWAP))) return(0);
+	len = seg == T ? rmp->mp_seg[T].mem_len : rmp->mp_seg[S].mem_vir
+			+ rmp->mp_seg[S].mem_len - rmp->mp_seg[D].mem_vir;
+  }
+  if (len == 0) return(0);	/* not a process image */
+
+  /* The copy goes down, so it may overlap as long as it copies upwards. */
+  r = sys_copy(ABS, 0, (phys_bytes) base << CLICK_SHIFT,
+		ABS, 0, (phys_bytes) to << CLICK_SHIFT,
+		(phys_bytes) len << CLICK_SHIFT);
+  if (r < 0) panic("slide can't copy", r);
+
+  for (rmp = mproc_addr(LOW_USER); rmp < &mproc[NR_PROCS]; rmp++) {
+	if ((seg = owner(rmp, base)) == NO_SEG) continue;
+	if (seg == T) {
+		rmp->mp_seg[T].mem_phys = to;
+	} else {
+		rmp->mp_seg[D].mem_phys = to;
+		rmp->mp_seg[S].mem_phys = to +
+			(rmp->mp_seg[S].mem_vir - rmp->mp_seg[D].mem_vir);
+	}
+	sys_newmap((int) (rmp - mproc), rmp->mp_seg);
+  }
+  return(len);
+}
+
+/*===========================================================================*
+ *				owner					     *
+ *===========================================================================*/
+PRIVATE int owner(rmp, base)
+register struct mproc *rmp;	/* process to check */
+phys_clicks base;		/* start of a block of memory */
+{
+/* Return the segment (T or D) of 'rmp' that starts at 'base', or NO_SEG.
+ * The memory of a zombie has been freed already, so its map is stale.
+ */
+
+  if ((rmp->mp_flags & (IN_USE | ZOMBIE)) != IN_USE) return(NO_SEG);
+  if (rmp->mp_seg[T].mem_len != 0 && rmp->mp_seg[T].mem_phys == base)
+	return(T);
+  if (rmp->mp_seg[D].mem_phys == base) return(D);
+  return(NO_SEG);
+}
+#endif /* SHADOWING == 0 */
+
 /*===========================================================================*
  *				mem_init				     *
  *===========================================================================*/
@@ -246,7 +473,8 @@ phys_clicks *total, *free;		/* memory size summaries */
  * list links together the remaining table slots.  As memory becomes more
  * fragmented in the course of time (i.e., the initial big holes break up into
  * smaller holes), new table slots are needed to represent them.  These slots
- * are taken from the list headed by 'free_slots'.
+ * are taken from the list headed by 'free_slots'.  The holes in the swap
+ * area are on a third list, 'swap_head', which is empty until "swapon".
  */
 
   register struct hole *hp;
@@ -255,9 +483,15 @@ phys_clicks *total, *free;		/* memory size summaries */
   message mess;
 
   /* Put all holes on the free list. */
-  for (hp = &hole[0]; hp < &hole[NR_HOLES]; hp++) hp->h_next = hp + 1;
+  for (hp = &hole[0]; hp < &hole[NR_HOLES]; hp++) {
+	hp->h_next = hp + 1;
+	hp->h_class = NO_CLASS;
+  }
   hole[NR_HOLES-1].h_next = NIL_HOLE;
   hole_head = NIL_HOLE;
+#if ENABLE_SWAP
+  swap_head = NIL_HOLE;
+#endif
   free_slots = &hole[0];
 
   /* Ask the kernel for chunks of physical memory and allocate a hole for
@@ -272,17 +506,19 @@ phys_clicks *total, *free;		/* memory size summaries */
 	size = mess.m1_i2;
 	if (size == 0) break;		/* no more? */
 
-	free_mem(base, size);
-	*total = mess.m1_i3;
-	*free += size;
 #if ENABLE_SWAP
+	/* Raise the swap base first, or this chunk would count as swap. */
 	if (swap_base < base + size) swap_base = base+size;
 #endif
+	free_mem(base, size);
+	*total = mess.m1_i3;
+	*free += size;
   }
 
 #if ENABLE_SWAP
-  /* The swap area is represented as a hole above and separate of regular
-   * memory.  A hole at the size of the swap file is allocated on "swapon".
+  /* The swap area is represented as addresses above and separate of regular
+   * memory.  A hole at the size of the swap file is put on the swap list on
+   * "swapon".
    */
   swap_base++;				/* make separate */
   swap_maxsize = 0 - swap_base;		/* maximum we can possibly use */
@@ -316,7 +552,7 @@ PUBLIC int swap_off()
 {
 /* Turn swapping off. */
   struct mproc *rmp;
-  struct hole *hp, *prev_ptr;
+  struct hole *hp, *next_ptr;
 
   if (swap_fd == -1) return(OK);	/* can't turn off what isn't on */
 
@@ -332,11 +568,9 @@ PUBLIC int swap_off()
   }
 
   /* Yes.  Remove the swap hole and close the swap file descriptor. */
-  for (hp = hole_head; hp != NIL_HOLE; prev_ptr = hp, hp = hp->h_next) {
-	if (hp->h_base >= swap_base) {
-		del_slot(prev_ptr, hp);
-		hp = hole_head;
-	}
+  for (hp = swap_head; hp != NIL_HOLE; hp = next_ptr) {
+	next_ptr = hp->h_next;
+	del_slot(hp);
   }
   close(swap_fd);
   swap_fd = -1;
@@ -351,16 +585,18 @@ register struct mproc *rmp;		/* process to add to the queue */
 {
 /* Put a swapped out process on the queue of processes to be swapped in.  This
  * happens when such a process gets a signal, or if a reply message must be
- * sent, like when a process doing a wait() has a child that exits.
+ * sent, like when a process doing a wait() has a child that exits.  The queue
+ * is sorted by swap address.
  */
   struct mproc **pmp;
 
   if (rmp->mp_flags & SWAPIN) return;	/* already queued */
 
-  
-  for (pmp = &in_queue; *pmp != NULL; pmp = &(*pmp)->mp_swapq) {}
+  for (pmp = &in_queue; *pmp != NULL; pmp = &(*pmp)->mp_swapq) {
+	if ((*pmp)->mp_seg[D].mem_phys > rmp->mp_seg[D].mem_phys) break;
+  }
+  rmp->mp_swapq = *pmp;
   *pmp = rmp;
-  rmp->mp_swapq = NULL;
   rmp->mp_flags |= SWAPIN;
 }
 
@@ -369,8 +605,9 @@ register struct mproc *rmp;		/* process to add to the queue */
  *===========================================================================*/
 PUBLIC void swap_in()
 {
-/* Try to swap in a process on the inswap queue.  We want to send it a message,
- * interrupt it, or something.
+/* Try to swap in the processes on the inswap queue.  We want to send them a
+ * message, interrupt them, or something.  The queue is in swap address order,
+ * so the swap area is read from front to back.
  */
   struct mproc **pmp, *rmp;
   phys_clicks old_base, new_base, size;
@@ -411,6 +648,7 @@ PUBLIC void swap_in()
 		rw_seg(0, swap_fd, proc_nr, D, (phys_bytes)size << CLICK_SHIFT);
 		free_mem(old_base, size);
 		rmp->mp_flags &= ~(ONSWAP|SWAPIN);
+		rmp->mp_nswapin++;
 		*pmp = rmp->mp_swapq;
 		TRACE(printf("swapped in base %x with %d clicks\n", new_base, size));
 		check_pending(rmp);	/* a signal may have waked this one */
@@ -421,70 +659,98 @@ PUBLIC void swap_in()
 /*===========================================================================*
  *				swap_out				     *
  *===========================================================================*/
-PRIVATE int swap_out()
+PRIVATE int swap_out(clicks)
+phys_clicks clicks;		/* amount of memory wanted */
 {
 /* Try to find a process that can be swapped out.  Candidates are those blocked
- * on a system call that MM handles, like wait(), pause() or sigsuspend().
+ * on a system call that MM handles, like wait(), pause() or sigsuspend().  Of
+ * those, the one with the largest product of sleep age and image size goes,
+ * if there is swap space for it: a long sleeper is unlikely to be needed soon,
+ * and a big one frees more memory for one trip to the disk.  A process whose
+ * memory, together with the holes around it, makes a hole of 'clicks' clicks
+ * is preferred over any that doesn't.
  */
-  struct mproc *rmp;
-  struct hole *hp, *prev_ptr;
-  phys_clicks old_base, new_base, size;
+  struct mproc *rmp, *victim;
+  struct hole *hp, *shp, *vhp = NIL_HOLE;
+  phys_clicks old_base, new_base, size, gain;
+  unsigned long age, weight, vweight;
   off_t off;
-  int proc_nr;
-
-  rmp = outswap;
-  do {
-	if (++rmp == &mproc[NR_PROCS]) rmp = mproc_addr(LOW_USER);
+  int proc_nr, fits, vfits;
 
+  victim = NULL;
+  vweight = 0;
+  vfits = FALSE;
+  for (rmp = mproc_addr(LOW_USER); rmp < &mproc[NR_PROCS]; rmp++) {
 	/* A candidate? */
 	if (!(rmp->mp_flags & (PAUSED | WAITING | SIGSUSPENDED))) continue;
 
 	/* Already on swap or otherwise to be avoided? */
-	if (rmp->mp_flags & (TRACED | REPLY | ONSWAP)) continue;
+	if (rmp->mp_flags & (TRACED | REPLY | ONSWAP | VFORKED)) continue;
 
 #if SHADOWING
 	if (rmp->mp_flags & MM_DONT_SWAP) continue;
 #endif /* SHADOWING */
 
-	/* Got one, find a swap hole and swap it out. */
-	proc_nr = (rmp - mproc);
+	/* Find the lowest swap hole that fits. */
 	size = rmp->mp_seg[S].mem_vir + rmp->mp_seg[S].mem_len
 		- rmp->mp_seg[D].mem_vir;
-
-	prev_ptr = NIL_HOLE;
-	for (hp = hole_head; hp != NIL_HOLE; prev_ptr = hp, hp = hp->h_next) {
-		if (hp->h_base >= swap_base && hp->h_len >= size) break;
+	for (shp = swap_head; shp != NIL_HOLE; shp = shp->h_next) {
+		if (shp->h_len >= size) break;
 	}
-	if (hp == NIL_HOLE) continue;	/* oops, not enough swapspace */
-	new_base = hp->h_base;
-	hp->h_base += size;
-	hp->h_len -= size;
-	if (hp->h_len == 0) del_slot(prev_ptr, hp);
-
-	off = swap_offset + ((off_t) (new_base - swap_base) << CLICK_SHIFT);
-	lseek(swap_fd, off, SEEK_SET);
-	rw_seg(1, swap_fd, proc_nr, D, (phys_bytes)size << CLICK_SHIFT);
+	if (shp == NIL_HOLE) continue;	/* oops, not enough swapspace */
+
+	/* What would it give? */
 	old_base = rmp->mp_seg[D].mem_phys;
+	gain = size;
+	for (hp = hole_head; hp != NIL_HOLE && hp->h_base <= old_base + size;
+							hp = hp->h_next) {
+		if (hp->h_base + hp->h_len == old_base
+				|| hp->h_base == old_base + size)
+			gain += hp->h_len;
+	}
+	fits = (gain >= clicks);
+
+	age = mm_clock - rmp->mp_sleep;
+	if (age > SWAP_AGE_MAX) age = SWAP_AGE_MAX;
+	weight = (age + 1) * size;
+	if ((fits && !vfits) || (fits == vfits && weight > vweight)) {
+		victim = rmp;
+		vhp = shp;
+		vweight = weight;
+		vfits = fits;
+	}
+  }
+  if (victim == NULL) return(FALSE);	/* no candidate found */
+
+  /* Swap the victim out. */
+  rmp = victim;
+  proc_nr = (rmp - mproc);
+  size = rmp->mp_seg[S].mem_vir + rmp->mp_seg[S].mem_len
+	- rmp->mp_seg[D].mem_vir;
+  new_base = vhp->h_base;
+  bite(vhp, size);
+
+  off = swap_offset + ((off_t) (new_base - swap_base) << CLICK_SHIFT);
+  lseek(swap_fd, off, SEEK_SET);
+  rw_seg(1, swap_fd, proc_nr, D, (phys_bytes)size << CLICK_SHIFT);
+  old_base = rmp->mp_seg[D].mem_phys;
 #if SHADOWING
-	rmp->mp_memadr = old_base;
+  rmp->mp_memadr = old_base;
 #endif /* SHADOWING */
-	rmp->mp_seg[D].mem_phys = new_base;
+  rmp->mp_seg[D].mem_phys = new_base;
 #if SHADOWING
-	rmp->mp_seg[S].mem_phys += new_base - old_base;
+  rmp->mp_seg[S].mem_phys += new_base - old_base;
 #else
-	rmp->mp_seg[S].mem_phys = rmp->mp_seg[D].mem_phys + 
-		(rmp->mp_seg[S].mem_vir - rmp->mp_seg[D].mem_vir);
+  rmp->mp_seg[S].mem_phys = rmp->mp_seg[D].mem_phys + 
+	(rmp->mp_seg[S].mem_vir - rmp->mp_seg[D].mem_vir);
 #endif /* SHADOWING */
-	sys_newmap(proc_nr, rmp->mp_seg);
-	free_mem(old_base, size);
-	rmp->mp_flags |= ONSWAP;
+  sys_newmap(proc_nr, rmp->mp_seg);
+  free_mem(old_base, size);
+  rmp->mp_flags |= ONSWAP;
+  rmp->mp_nswapout++;
 
-	outswap = rmp;		/* next time start here */
-	TRACE(printf("swapped out base %x with %d clicks\n", old_base, size));
-	return(TRUE);
-  } while (rmp != outswap);
-
-  return(FALSE);	/* no candidate found */
+  TRACE(printf("swapped out base %x with %d clicks\n", old_base, size));
+  return(TRUE);
 }
 
 #if SHADOWING
@@ -497,48 +763,49 @@ phys_clicks clicks;		/* amount of memory requested */
 {
 /* Try to alloc memory from base with clicks size */
 
-  register struct hole *hp, *new_ptr, *prev_ptr;
+  register struct hole *hp, *new_ptr;
 
   do {
-	hp = hole_head;
-	while (hp != NIL_HOLE && hp->h_base <= base && hp->h_base < swap_base) {
-		if (hp->h_base + hp->h_len >= base + clicks) {
-			/* We found the hole.  Use it. */
-			if (hp->h_base < base) {
-				/* take care of new hole under base */
-  				if ((new_ptr = free_slots) == NIL_HOLE) {
-					printf("Hole table full");
-					return (NO_MEM);
-				}
-				/* fill in new hole slot */
-				new_ptr->h_base = hp->h_base;
-				new_ptr->h_len = base - new_ptr->h_base;
-
-				/* and link it in */
-				if (hp == hole_head)
-					hole_head = new_ptr;
-				else
-					prev_ptr->h_next = new_ptr;
-				new_ptr->h_next = hp;
-				prev_ptr = new_ptr;
-
-				/* adjust our hole */
-				hp->h_base = base;
+	for (hp = hole_head; hp != NIL_HOLE && hp->h_base <= base;
+							hp = hp->h_next) {
+		if (hp->h_base + hp->h_len < base + clicks) continue;
+
+		/* We found the hole.  Use it. */
+		if (hp->h_base < base) {
+			/* take care of new hole under base */
+			if ((new_ptr = free_slots) == NIL_HOLE) {
+				printf("Hole table full");
+				return (NO_MEM);
 			}
-			hp->h_base += clicks;	/* bite a piece off */
-			hp->h_len -= clicks;	/* ditto */
-
-			/* Delete the hole if used up completely. */
-			if (hp->h_len == 0) del_slot(prev_ptr, hp);
-
-			/* Return the start address of the acquired block. */
-			return(base);
+			free_slots = new_ptr->h_next;
+
+			/* fill in new hole slot */
+			new_ptr->h_base = hp->h_base;
+			new_ptr->h_len = base - new_ptr->h_base;
+
+			/* and link it in */
+			new_ptr->h_prev = hp->h_prev;
+			new_ptr->h_next = hp;
+			if (hp->h_prev == NIL_HOLE)
+				hole_head = new_ptr;
+			else
+				hp->h_prev->h_next = new_ptr;
+			hp->h_prev = new_ptr;
+			class_add(new_ptr);
+
+			/* adjust our hole */
+			class_del(hp);
+			hp->h_len -= new_ptr->h_len;
+			hp->h_base = base;
 		}
 
-		prev_ptr = hp;
-		hp = hp->h_next;
+		/* Bite a piece off, this deletes the hole if used up. */
+		bite(hp, clicks);
+
+		/* Return the start address of the acquired block. */
+		return(base);
 	}
-  } while (swap_out());		/* try to swap some other process out */
+  } while (swap_out(clicks));	/* try to swap some other process out */
   return(NO_MEM);
 }
 #endif /* SHADOWING */
@@ -14,6 +14,16 @@
  *   do_exec:	 perform the EXEC system call
  *   rw_seg:	 read or write a segment from or to a file
  *   find_share: find a process whose text segment can be shared
+ *   text_put:	 keep a text segment that is no longer used for later
+ *   text_reclaim: free the least recently used kept text segment
+ *
+ * The text segment of a separate I & D program is not freed when its last
+ * user is gone, but kept in memory for a while, in case the program is run
+ * again.  These texts are known by the file they came from, like shared
+ * texts.  alloc_mem() takes them back when memory runs short.  Only a text
+ * that was read in completely is kept, and an exec that has to read the text
+ * of a file itself drops what is kept of it, because a file rewritten within
+ * the same second keeps its ctime.
  */
 
 #include "mm.h"
@@ -26,7 +36,30 @@
 #include "mproc.h"
 #include "param.h"
 
-FORWARD _PROTOTYPE( int new_mem, (struct mproc *sh_mp, vir_bytes text_bytes,
+#define NIL_SEG	((struct mem_map *) NULL)
+
+#if (SHADOWING == 0)
+#define NR_TEXTS	8	/* number of text segments kept */
+
+PRIVATE struct text {
+  ino_t t_ino;			/* file the text was read from */
+  dev_t t_dev;
+  time_t t_ctime;
+  struct mem_map t_seg;		/* where it is, mem_len is 0 if slot unused */
+  unsigned long t_used;		/* mm_clock when it was last used */
+} text[NR_TEXTS];
+
+FORWARD _PROTOTYPE( int text_get, (Ino_t ino, Dev_t dev, time_t ctime,
+				vir_bytes text_bytes, struct mem_map *seg)	);
+FORWARD _PROTOTYPE( void text_drop, (Ino_t ino, Dev_t dev)		);
+#else
+#define text_get(ino, dev, ctime, text_bytes, seg)	(FALSE)
+#define text_drop(ino, dev)		((void) 0)
+#define text_put(ino, dev, ctime, seg)	((void) 0)
+#endif /* SHADOWING == 0 */
+
+FORWARD _PROTOTYPE( int new_mem, (struct mproc *sh_mp,
+		struct mem_map *kept_seg, vir_bytes text_bytes,
 		vir_bytes data_bytes, vir_bytes bss_bytes,
 		vir_bytes stk_bytes, phys_bytes tot_bytes)		);
 FORWARD _PROTOTYPE( void patch_ptr, (char stack[ARG_MAX], vir_bytes base) );
@@ -57,7 +90,8 @@ PUBLIC int do_exec()
 
   register struct mproc *rmp;
   struct mproc *sh_mp;
-  int m, r, fd, ft, sn;
+  struct mem_map kept_seg;	/* kept text segment to use, if 'shared' */
+  int m, r, fd, ft, sn, shared;
 #if (MACHINE == ATARI)		/* buf has to be aligned for relo calculation */
   static int aligned_buf[ARG_MAX/2];	/* buffer for stack and zeroes */
 #define	mbuf	(aligned_buf)
@@ -114,12 +148,27 @@ PUBLIC int do_exec()
 	return(stk_bytes > ARG_MAX ? ENOMEM : ENOEXEC);
   }
 
-  /* Can the process' text be shared with that of one already running? */
+  /* Can the process' text be shared with that of one already running, or is
+   * it still in memory from an earlier run?
+   */
   sh_mp = find_share(rmp, s_p->st_ino, s_p->st_dev, s_p->st_ctime);
+  if (sh_mp != NULL) {
+	shared = TRUE;
+  } else {
+	shared = text_get(s_p->st_ino, s_p->st_dev, s_p->st_ctime,
+						text_bytes, &kept_seg);
+
+	/* The text is read anew, so what is kept of this file is stale. */
+	if (!shared) text_drop(s_p->st_ino, s_p->st_dev);
+  }
 
   /* Allocate new memory and release old memory.  Fix map and tell kernel. */
-  r = new_mem(sh_mp, text_bytes, data_bytes, bss_bytes, stk_bytes, tot_bytes);
+  r = new_mem(sh_mp, shared && sh_mp == NULL ? &kept_seg : NIL_SEG,
+			text_bytes, data_bytes, bss_bytes, stk_bytes, tot_bytes);
   if (r != OK) {
+	/* Put back a kept text that was to be used. */
+	if (shared && sh_mp == NULL)
+		text_put(s_p->st_ino, s_p->st_dev, s_p->st_ctime, &kept_seg);
 	close(fd);		/* insufficient core or program too big */
 	return(r);
   }
@@ -139,11 +188,14 @@ PUBLIC int do_exec()
   			who, D, (phys_bytes) vsp, (phys_bytes)stk_bytes);
   if (r != OK) panic("do_exec stack copy err on", who);
 
-  /* Read in text and data segments. */
-  if (sh_mp != NULL) {
+  /* Read in text and data segments.  Note if the text is complete. */
+  rmp->mp_flags &= ~TEXTOK;
+  if (shared) {
 	lseek(fd, (off_t) text_bytes, SEEK_CUR);  /* shared: skip text */
+	if (sh_mp == NULL || (sh_mp->mp_flags & TEXTOK))
+		rmp->mp_flags |= TEXTOK;
   } else {
-	rw_seg(0, fd, who, T, text_bytes);
+	if (rw_seg(0, fd, who, T, text_bytes) == OK) rmp->mp_flags |= TEXTOK;
   }
   rw_seg(0, fd, who, D, data_bytes);
 
@@ -315,8 +367,10 @@ vir_bytes *pc;			/* program entry point (initial PC) */
 /*===========================================================================*
  *				new_mem					     *
  *===========================================================================*/
-PRIVATE int new_mem(sh_mp, text_bytes, data_bytes,bss_bytes,stk_bytes,tot_bytes)
+PRIVATE int new_mem(sh_mp, kept_seg, text_bytes, data_bytes, bss_bytes,
+							stk_bytes, tot_bytes)
 struct mproc *sh_mp;		/* text can be shared with this process */
+struct mem_map *kept_seg;	/* kept text segment to use, or NIL_SEG */
 vir_bytes text_bytes;		/* text segment size in bytes */
 vir_bytes data_bytes;		/* size of initialized data in bytes */
 vir_bytes bss_bytes;		/* size of bss in bytes */
@@ -334,11 +388,14 @@ phys_bytes tot_bytes;		/* total memory to allocate, including gap */
   phys_clicks base, size;
 #else
   static char zero[1024];		/* used to zero bss */
-  phys_bytes bytes, base, count, bss_offset;
+  phys_bytes bytes, base, count, done, bss_offset;
+  int r;
 #endif /* SHADOWING */
 
   /* No need to allocate text if it can be shared. */
-  if (sh_mp != NULL) text_bytes = 0;
+  if (sh_mp != NULL || kept_seg != NIL_SEG) text_bytes = 0;
+
+  rmp = mp;
 
   /* Allow the old data to be swapped out to make room.  (Which is really a
    * waste of time, because we are going to throw it away anyway.)
@@ -361,16 +418,25 @@ phys_bytes tot_bytes;		/* total memory to allocate, including gap */
   if (new_base == NO_MEM) return(ENOMEM);
 
   /* We've got memory for the new core image.  Release the old one. */
-  rmp = mp;
 
 #if (SHADOWING == 0)
-  if (find_share(rmp, rmp->mp_ino, rmp->mp_dev, rmp->mp_ctime) == NULL) {
-	/* No other process shares the text segment, so free it. */
-	free_mem(rmp->mp_seg[T].mem_phys, rmp->mp_seg[T].mem_len);
+  /* After a vfork the old core image is the parent's, it gets it back below. */
+  if ((rmp->mp_flags & VFORKED) == 0) {
+	if (find_share(rmp, rmp->mp_ino, rmp->mp_dev, rmp->mp_ctime) == NULL) {
+		/* No other process shares the text segment, so keep it if
+		 * it is good, or free it.
+		 */
+		if (rmp->mp_flags & TEXTOK)
+			text_put(rmp->mp_ino, rmp->mp_dev, rmp->mp_ctime,
+							&rmp->mp_seg[T]);
+		else
+			free_mem(rmp->mp_seg[T].mem_phys,
+						rmp->mp_seg[T].mem_len);
+	}
+	/* Free the data and stack segments. */
+	free_mem(rmp->mp_seg[D].mem_phys, rmp->mp_seg[S].mem_vir
+			+ rmp->mp_seg[S].mem_len - rmp->mp_seg[D].mem_vir);
   }
-  /* Free the data and stack segments. */
-  free_mem(rmp->mp_seg[D].mem_phys,
-      rmp->mp_seg[S].mem_vir + rmp->mp_seg[S].mem_len - rmp->mp_seg[D].mem_vir);
 #endif /* SHADOWING */
 
   /* We have now passed the point of no return.  The old core image has been
@@ -378,8 +444,13 @@ phys_bytes tot_bytes;		/* total memory to allocate, including gap */
    * and report new map.
    */
   if (sh_mp != NULL) {
-	/* Share the text segment. */
+	/* Share the text segment.  Look it up only now, because alloc_mem()
+	 * may have moved it.
+	 */
 	rmp->mp_seg[T] = sh_mp->mp_seg[T];
+  } else if (kept_seg != NIL_SEG) {
+	/* Use the kept text segment. */
+	rmp->mp_seg[T] = *kept_seg;
   } else {
 	rmp->mp_seg[T].mem_phys = new_base;
 	rmp->mp_seg[T].mem_vir = 0;
@@ -406,6 +477,7 @@ phys_bytes tot_bytes;		/* total memory to allocate, including gap */
 
 #if (SHADOWING == 0)
   sys_newmap(who, rmp->mp_seg);   /* report new map to the kernel */
+  vfork_done(rmp);		  /* a vforked child lets its parent go */
 
   /* The old memory may have been swapped out, but the new memory is real. */
   rmp->mp_flags &= ~(WAITING|ONSWAP|SWAPIN);
@@ -417,14 +489,19 @@ phys_bytes tot_bytes;		/* total memory to allocate, including gap */
   base += bss_offset;
   bytes -= bss_offset;
 
-  while (bytes > 0) {
-	count = MIN(bytes, (phys_bytes) sizeof(zero));
-	if (sys_copy(MM_PROC_NR, D, (phys_bytes) zero,
-						ABS, 0, base, count) != OK) {
-		panic("new_mem can't zero", NO_NUM);
+  /* Zero the first piece from our buffer, then double the zeroed area by
+   * copying it onto what follows, so that a big gap takes few kernel calls.
+   */
+  for (done = 0; done < bytes; done += count) {
+	if (done == 0) {
+		count = MIN(bytes, (phys_bytes) sizeof(zero));
+		r = sys_copy(MM_PROC_NR, D, (phys_bytes) zero,
+						ABS, 0, base, count);
+	} else {
+		count = MIN(bytes - done, done);
+		r = sys_copy(ABS, 0, base, ABS, 0, base + done, count);
 	}
-	base += count;
-	bytes -= count;
+	if (r != OK) panic("new_mem can't zero", NO_NUM);
   }
 #else
   /* The old memory may have been swapped out, but the new memory is real. */
@@ -584,7 +661,7 @@ char *script;			/* name of script to interpret */
 /*===========================================================================*
  *				rw_seg					     *
  *===========================================================================*/
-PUBLIC void rw_seg(rw, fd, proc, seg, seg_bytes0)
+PUBLIC int rw_seg(rw, fd, proc, seg, seg_bytes0)
 int rw;				/* 0 = read, 1 = write */
 int fd;				/* file descriptor to read from / write to */
 int proc;			/* process number */
@@ -604,7 +681,7 @@ phys_bytes seg_bytes0;		/* how much is to be transferred? */
  *
  * The byte count on read is usually smaller than the segment count, because
  * a segment is padded out to a click multiple, and the data segment is only
- * partially initialized.
+ * partially initialized.  OK is returned if the whole segment was transferred.
  */
 
   int new_fd, bytes, r;
@@ -622,10 +699,11 @@ phys_bytes seg_bytes0;		/* how much is to be transferred? */
 	} else {
 		r = write(new_fd, ubuf_ptr, bytes);
 	}
-	if (r != bytes) break;
+	if (r != bytes) return(r < 0 ? r : EIO);
 	ubuf_ptr += bytes;
 	seg_bytes -= bytes;
   }
+  return(OK);
 }
 
 
@@ -655,6 +733,112 @@ time_t ctime;
   return(NULL);
 }
 
+#if (SHADOWING == 0)
+/*===========================================================================*
+ *				text_get				     *
+ *===========================================================================*/
+PRIVATE int text_get(ino, dev, ctime, text_bytes, seg)
+ino_t ino;			/* file whose text is wanted */
+dev_t dev;
+time_t ctime;
+vir_bytes text_bytes;		/* text size in the file's header */
+struct mem_map *seg;		/* the text segment is returned here */
+{
+/* Look for a kept text segment of file <ino, dev, ctime>.  If found, it is
+ * taken out of the cache and returned in 'seg', the caller owns it now.  The
+ * size must match too, ctime only changes once a second.
+ */
+  struct text *tp;
+  vir_clicks text_clicks;
+
+  text_clicks = ((unsigned long) text_bytes + CLICK_SIZE - 1) >> CLICK_SHIFT;
+  for (tp = &text[0]; tp < &text[NR_TEXTS]; tp++) {
+	if (tp->t_seg.mem_len != text_clicks || text_clicks == 0) continue;
+	if (tp->t_ino != ino) continue;
+	if (tp->t_dev != dev) continue;
+	if (tp->t_ctime != ctime) continue;
+	*seg = tp->t_seg;
+	tp->t_seg.mem_len = 0;
+	return(TRUE);
+  }
+  return(FALSE);
+}
+
+/*===========================================================================*
+ *				text_drop				     *
+ *===========================================================================*/
+PRIVATE void text_drop(ino, dev)
+ino_t ino;			/* file whose kept texts are stale */
+dev_t dev;
+{
+/* Free the kept text segments of file <ino, dev>, whatever their ctime. */
+  struct text *tp;
+
+  for (tp = &text[0]; tp < &text[NR_TEXTS]; tp++) {
+	if (tp->t_seg.mem_len == 0) continue;
+	if (tp->t_ino != ino) continue;
+	if (tp->t_dev != dev) continue;
+	free_mem(tp->t_seg.mem_phys, tp->t_seg.mem_len);
+	tp->t_seg.mem_len = 0;
+  }
+}
+
+/*===========================================================================*
+ *				text_put				     *
+ *===========================================================================*/
+PUBLIC void text_put(ino, dev, ctime, seg)
+ino_t ino;			/* file the text was read from */
+dev_t dev;
+time_t ctime;
+struct mem_map *seg;		/* text segment nobody uses any more */
+{
+/* Keep a text segment that is no longer used, in place of the least recently
+ * used one if the cache is full.
+ */
+  struct text *tp, *lru;
+
+  if (seg->mem_len == 0) return;	/* common I & D, nothing to keep */
+
+  lru = &text[0];
+  for (tp = &text[0]; tp < &text[NR_TEXTS]; tp++) {
+	if (tp->t_seg.mem_len == 0) {
+		lru = tp;
+		break;
+	}
+	if (tp->t_used < lru->t_used) lru = tp;
+  }
+  if (lru->t_seg.mem_len != 0)
+	free_mem(lru->t_seg.mem_phys, lru->t_seg.mem_len);
+
+  lru->t_ino = ino;
+  lru->t_dev = dev;
+  lru->t_ctime = ctime;
+  lru->t_seg = *seg;
+  lru->t_used = mm_clock;
+}
+
+/*===========================================================================*
+ *				text_reclaim				     *
+ *===========================================================================*/
+PUBLIC int text_reclaim()
+{
+/* Free the least recently used kept text segment.  Return FALSE if there is
+ * none.
+ */
+  struct text *tp, *lru;
+
+  lru = NULL;
+  for (tp = &text[0]; tp < &text[NR_TEXTS]; tp++) {
+	if (tp->t_seg.mem_len == 0) continue;
+	if (lru == NULL || tp->t_used < lru->t_used) lru = tp;
+  }
+  if (lru == NULL) return(FALSE);
+  free_mem(lru->t_seg.mem_phys, lru->t_seg.mem_len);
+  lru->t_seg.mem_len = 0;
+  return(TRUE);
+}
+#endif /* SHADOWING == 0 */
+
 #if (SHADOWING == 1)
 /*===========================================================================*
  *				relocate				     *
@@ -6,8 +6,14 @@
  * been killed by a signal, and (2) the parent has done a WAIT.  If the process
  * exits first, it continues to occupy a slot until the parent does a WAIT.
  *
+ * A child made by VFORK gets no copy, but runs in the memory of its parent
+ * until it does an EXEC or EXIT.  The parent is suspended until then.  With
+ * shadowing the child's image is at the same addresses as the parent's, so
+ * it needs a shadow anyway and VFORK is the same as FORK.
+ *
  * The entry points into this file are:
- *   do_fork:	 perform the FORK system call
+ *   do_fork:	 perform the FORK and VFORK system calls
+ *   vfork_done: a vforked child returns the memory to its parent
  *   do_mm_exit: perform the EXIT system call (by calling mm_exit())
  *   mm_exit:	 actually do the exiting
  *   do_wait:	 perform the WAITPID or WAIT system call
@@ -37,7 +43,7 @@ PUBLIC int do_fork()
 
   register struct mproc *rmp;	/* pointer to parent */
   register struct mproc *rmc;	/* pointer to child */
-  int i, child_nr, t;
+  int i, child_nr, t, vfork;
   phys_clicks prog_clicks, child_base;
   phys_bytes prog_bytes, parent_abs, child_abs;	/* Intel only */
 
@@ -55,15 +61,24 @@ PUBLIC int do_fork()
   prog_clicks += (rmp->mp_seg[S].mem_vir - rmp->mp_seg[D].mem_vir);
 #if (SHADOWING == 0)
   prog_bytes = (phys_bytes) prog_clicks << CLICK_SHIFT;
+  vfork = (mm_call == VFORK);
+#else
+  vfork = FALSE;
 #endif /* SHADOWING */
+  if (vfork) {
+	/* The child borrows the parent's core image. */
+	child_base = rmp->mp_seg[D].mem_phys;
+  } else
   if ( (child_base = alloc_mem(prog_clicks)) == NO_MEM) return(ENOMEM);
 
 #if (SHADOWING == 0)
-  /* Create a copy of the parent's core image for the child. */
-  child_abs = (phys_bytes) child_base << CLICK_SHIFT;
-  parent_abs = (phys_bytes) rmp->mp_seg[D].mem_phys << CLICK_SHIFT;
-  i = sys_copy(ABS, 0, parent_abs, ABS, 0, child_abs, prog_bytes);
-  if (i < 0) panic("do_fork can't copy", i);
+  if (!vfork) {
+	/* Create a copy of the parent's core image for the child. */
+	child_abs = (phys_bytes) child_base << CLICK_SHIFT;
+	parent_abs = (phys_bytes) rmp->mp_seg[D].mem_phys << CLICK_SHIFT;
+	i = sys_copy(ABS, 0, parent_abs, ABS, 0, child_abs, prog_bytes);
+	if (i < 0) panic("do_fork can't copy", i);
+  }
 #endif /* SHADOWING */
 
   /* Find a slot in 'mproc' for the child process.  A slot must exist. */
@@ -76,7 +91,7 @@ PUBLIC int do_fork()
   *rmc = *rmp;			/* copy parent's process slot to child's */
 
   rmc->mp_parent = who;			/* record child's parent */
-  rmc->mp_flags &= (IN_USE|SEPARATE);	/* inherit only these flags */
+  rmc->mp_flags &= (IN_USE|SEPARATE|TEXTOK);	/* inherit only these flags */
 #if (SHADOWING == 0)
   /* A separate I&D child keeps the parents text segment.  The data and stack
    * segments must refer to the new copy.
@@ -94,6 +109,11 @@ PUBLIC int do_fork()
 #endif /* SHADOWING */
   rmc->mp_exitstatus = 0;
   rmc->mp_sigstatus = 0;
+  rmc->mp_nswapin = rmc->mp_nswapout = 0;
+  if (vfork) {
+	rmc->mp_flags |= VFORKED;
+	rmp->mp_flags |= VFWAIT;
+  }
 
   /* Find a free pid for the child and put it in the table. */
   do {
@@ -120,9 +140,33 @@ PUBLIC int do_fork()
   sys_newmap(child_nr, rmc->mp_seg);
 #endif /* SHADOWING */
 
-  /* Reply to child to wake it up. */
+  /* Reply to child to wake it up.  A vforking parent sleeps until the child
+   * is done with its memory.
+   */
   setreply(child_nr, 0);
-  return(next_pid);		 /* child's pid */
+  return(vfork ? SUSPEND : next_pid);	 /* child's pid */
+}
+
+
+/*===========================================================================*
+ *				vfork_done				     *
+ *===========================================================================*/
+PUBLIC void vfork_done(rmp)
+register struct mproc *rmp;	/* child that may have been vforked */
+{
+/* A vforked child has done an EXEC or EXIT, so it no longer runs in the
+ * memory of its parent.  Let the parent continue, and deliver the signals
+ * that were held up while its memory was lent out.
+ */
+
+  register struct mproc *p_mp;
+
+  if (!(rmp->mp_flags & VFORKED)) return;
+  rmp->mp_flags &= ~VFORKED;
+  p_mp = mproc_addr(rmp->mp_parent);
+  p_mp->mp_flags &= ~VFWAIT;
+  setreply(rmp->mp_parent, rmp->mp_pid);
+  check_pending(p_mp);
 }
 
 
@@ -173,14 +217,26 @@ int exit_status;		/* the process' exit status (for parent) */
 #if (SHADOWING == 0)
   sys_xit(rmp->mp_parent, proc_nr);
 
-  /* Release the memory occupied by the child. */
-  if (find_share(rmp, rmp->mp_ino, rmp->mp_dev, rmp->mp_ctime) == NULL) {
-	/* No other process shares the text segment, so free it. */
-	free_mem(rmp->mp_seg[T].mem_phys, rmp->mp_seg[T].mem_len);
+  if (rmp->mp_flags & VFORKED) {
+	/* The memory is the parent's, give it back. */
+	vfork_done(rmp);
+  } else {
+	/* Release the memory occupied by the child. */
+	if (find_share(rmp, rmp->mp_ino, rmp->mp_dev, rmp->mp_ctime) == NULL) {
+		/* No other process shares the text segment, so keep it if
+		 * it is good, or free it.
+		 */
+		if (rmp->mp_flags & TEXTOK)
+			text_put(rmp->mp_ino, rmp->mp_dev, rmp->mp_ctime,
+							&rmp->mp_seg[T]);
+		else
+			free_mem(rmp->mp_seg[T].mem_phys,
+						rmp->mp_seg[T].mem_len);
+	}
+	/* Free the data and stack segments. */
+	free_mem(rmp->mp_seg[D].mem_phys, rmp->mp_seg[S].mem_vir
+			+ rmp->mp_seg[S].mem_len - rmp->mp_seg[D].mem_vir);
   }
-  /* Free the data and stack segments. */
-  free_mem(rmp->mp_seg[D].mem_phys,
-      rmp->mp_seg[S].mem_vir + rmp->mp_seg[S].mem_len - rmp->mp_seg[D].mem_vir);
 #else
   sys_xit(rmp->mp_parent, proc_nr, &base, &size);
   free_mem(base, size);
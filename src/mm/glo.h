@@ -7,6 +7,7 @@
 /* Global variables. */
 EXTERN struct mproc *mp;	/* ptr to 'mproc' slot of current process */
 EXTERN int procs_in_use;	/* how many processes are marked as IN_USE */
+EXTERN unsigned long mm_clock;	/* number of calls done, to age sleepers */
 
 /* The parameters of the call are kept here. */
 EXTERN message mm_in;		/* the incoming message itself is kept here. */
@@ -48,8 +48,12 @@ PUBLIC void main()
 		result = (*call_vec[mm_call])();
 	}
 
-	/* Send the results back to the user to indicate completion. */
+	/* Send the results back to the user to indicate completion.  Note
+	 * when a process blocks, swap_out() prefers those asleep for long.
+	 */
+	mm_clock++;
 	if (result != SUSPEND) setreply(who, result);
+	else mp->mp_sleep = mm_clock;
 
 	swap_in();		/* maybe a process can be swapped in? */
 
@@ -13,6 +13,8 @@
 #include "mproc.h"
 #include "param.h"
 
+FORWARD _PROTOTYPE( int getproc_swap, (vir_bytes ptr)			);
+
 /*=====================================================================*
  *			    do_reboot				       *
  *=====================================================================*/
@@ -54,7 +56,7 @@ PUBLIC int do_reboot()
  *=====================================================================*/
 PUBLIC int do_svrctl()
 {
-  int req;
+  int req, r;
   vir_bytes ptr;
 
   req = svrctl_req;
@@ -62,7 +64,11 @@ PUBLIC int do_svrctl()
 
   /* Is the request for the kernel? */
   if (((req >> 8) & 0xFF) == 'S') {
-	return(sys_sysctl(who, req, mp->mp_effuid == SUPER_USER, ptr));
+	r = sys_sysctl(who, req, mp->mp_effuid == SUPER_USER, ptr);
+
+	/* The kernel does not know about swapping, we add that. */
+	if (r == OK && req == SYSGETPROC) r = getproc_swap(ptr);
+	return(r);
   }
 
   switch(req) {
@@ -122,3 +128,28 @@ PUBLIC int do_svrctl()
 	return(EINVAL);
   }
 }
+
+/*=====================================================================*
+ *			    getproc_swap			       *
+ *=====================================================================*/
+PRIVATE int getproc_swap(ptr)
+vir_bytes ptr;			/* struct sysgetproc in the caller */
+{
+/* Add MM's swap counters to the accounting the kernel has reported. */
+  struct sysgetproc getproc;
+  struct mproc *rmp;
+
+  if (sys_copy(who, D, (phys_bytes) ptr,
+	MM_PROC_NR, D, (phys_bytes) &getproc,
+	(phys_bytes) sizeof(getproc)) != OK) return(EFAULT);
+
+  if (getproc.proc_nr < 0) return(OK);		/* a task */
+  rmp = &mproc[getproc.proc_nr];
+  getproc.nswapin = rmp->mp_nswapin;
+  getproc.nswapout = rmp->mp_nswapout;
+
+  if (sys_copy(MM_PROC_NR, D, (phys_bytes) &getproc,
+	who, D, (phys_bytes) ptr,
+	(phys_bytes) sizeof(getproc)) != OK) return(EFAULT);
+  return(OK);
+}
@@ -40,6 +40,9 @@ EXTERN struct mproc {
   unsigned mp_flags;		/* flag bits */
   vir_bytes mp_procargs;        /* ptr to proc's initial stack arguments */
   struct mproc *mp_swapq;	/* queue of procs waiting to be swapped in */
+  unsigned long mp_nswapin;	/* number of times swapped in */
+  unsigned long mp_nswapout;	/* number of times swapped out */
+  unsigned long mp_sleep;	/* mm_clock when it last blocked in MM */
   message mp_reply;		/* reply message to be sent to one */
 #if (MACHINE == ATARI && SHADOWING && ENABLE_SWAP)
   phys_clicks mp_memadr;	/* physical address in RAM of swapped mem */
@@ -62,5 +65,8 @@ EXTERN struct mproc {
 #if (SHADOWING && ENABLE_SWAP)
 #define	MM_DONT_SWAP	0x1000	/* don't swap out shadowed processes */
 #endif /* SHADOWING && ENABLE_SWAP */
+#define VFORKED		0x2000	/* set if running in the parent's memory */
+#define VFWAIT		0x4000	/* set if waiting for a vforked child */
+#define TEXTOK		0x8000	/* set if the text was read in completely */
 
 #define NIL_MPROC ((struct mproc *) 0)
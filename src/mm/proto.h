@@ -30,16 +30,24 @@ _PROTOTYPE( int adjust, (struct mproc *rmp,
 
 /* exec.c */
 _PROTOTYPE( int do_exec, (void)						);
-_PROTOTYPE( void rw_seg, (int rw, int fd, int proc, int seg,
+_PROTOTYPE( int rw_seg, (int rw, int fd, int proc, int seg,
 						phys_bytes seg_bytes)	);
 _PROTOTYPE( struct mproc *find_share, (struct mproc *mp_ign, Ino_t ino,
 			Dev_t dev, time_t ctime)			);
+#if (SHADOWING == 0)
+_PROTOTYPE( void text_put, (Ino_t ino, Dev_t dev, time_t ctime,
+						struct mem_map *seg)	);
+_PROTOTYPE( int text_reclaim, (void)					);
+#else
+#define text_reclaim()			(FALSE)
+#endif
 
 /* forkexit.c */
 _PROTOTYPE( int do_fork, (void)						);
 _PROTOTYPE( int do_mm_exit, (void)					);
 _PROTOTYPE( int do_waitpid, (void)					);
 _PROTOTYPE( void mm_exit, (struct mproc *rmp, int exit_status)		);
+_PROTOTYPE( void vfork_done, (struct mproc *rmp)			);
 #if (MACHINE == ATARI)
 _PROTOTYPE( void stack_fault, (int proc_nr)				);
 #endif /* MACHINE == ATARI */
@@ -435,6 +435,11 @@ int signo;			/* signal to send to process (1 to _NSIG) */
 	sigaddset(&rmp->mp_sigpending, signo);
 	return;
   }
+  if (rmp->mp_flags & VFWAIT) {
+	/* Its memory is lent to a vforked child, wait until it is back. */
+	sigaddset(&rmp->mp_sigpending, signo);
+	return;
+  }
   sigflags = rmp->mp_sigact[signo].sa_flags;
   if (sigismember(&rmp->mp_catch, signo)) {
 	if (rmp->mp_flags & ONSWAP) {
@@ -76,7 +76,7 @@ _PROTOTYPE (int (*call_vec[NCALLS]), (void) ) = {
 	no_sys,		/* 55 = fcntl	*/
 	no_sys,		/* 56 = (mpx)	*/
 	no_sys,		/* 57 = unused	*/
-	no_sys,		/* 58 = unused	*/
+	do_fork,	/* 58 = vfork	*/
 	do_exec,	/* 59 = execve	*/
 	no_sys,		/* 60 = umask	*/
 	no_sys,		/* 61 = chroot	*/
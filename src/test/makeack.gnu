@@ -7,10 +7,11 @@ OBJ=	test1  test2  test3  test4  test5  test6  test7  test8  test9  \
 	test10        test12 test13 test14 test15 test16 test17 test18 test19 \
 	       test21 test22 test23        test25 test26 test27 test28 test29 \
 	test30 test31 test32        test34 test35 test36 test37 test38 test39 \
-	test40 t10a t11a t11b
+	test40 test41 test42 test43 test44 test45 test46               test49 \
+	test50 t10a t11a t11b t41a t43a t44a
 
 BIGOBJ=  test20 test24
-ROOTOBJ= test11 test33
+ROOTOBJ= test11 test33 test47 test48 test51 test52 test53
 
 all:	$(OBJ) $(BIGOBJ) $(ROOTOBJ)
 
@@ -28,7 +29,7 @@ $(ROOTOBJ):
 	#rm a.out
 
 clean:	
-	@rm -f *.o *.s *.bak test? test?? t10a t11a t11b DIR*
+	@rm -f *.o *.s *.bak test? test?? t10a t11a t11b t41a t43a t44a DIR*
 
 test1:	test1.c
 test2:	test2.c
@@ -73,3 +74,19 @@ test37:	test37.c
 test38:	test38.c
 test39:	test39.c
 test40:	test40.c
+test41:	test41.c
+t41a:	t41a.c
+test42:	test42.c
+test43:	test43.c
+t43a:	t43a.c
+test44:	test44.c
+t44a:	t44a.c
+test45:	test45.c
+test46:	test46.c
+test47:	test47.c
+test48:	test48.c
+test49:	test49.c
+test50:	test50.c
+test51:	test51.c
+test52:	test52.c
+test53:	test53.c
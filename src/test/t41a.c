@@ -0,0 +1,13 @@
+#include <stdlib.h>
+#include <unistd.h>
+
+_PROTOTYPE(int main, (void));
+
+int main()
+{
+  char c;
+
+  /* Hold on to our memory until test41 closes the pipe on stdin. */
+  while (read(0, &c, 1) > 0) {}
+  exit(0);
+}
@@ -0,0 +1,20 @@
+#include <stdlib.h>
+#include <unistd.h>
+
+#define BSS_SIZE	20000
+
+_PROTOTYPE(int main, (void));
+
+char data[] = "t43a initialized data";
+char bss[BSS_SIZE];
+
+int main()
+{
+  int i;
+
+  /* Exit 0 only if exec gave us our data and a clean bss. */
+  if (data[0] != 't' || data[sizeof(data) - 2] != 'a') exit(1);
+  for (i = 0; i < BSS_SIZE; i++)
+	if (bss[i] != 0) exit(2);
+  exit(0);
+}
@@ -0,0 +1,36 @@
+#include <signal.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+_PROTOTYPE(int main, (int argc, char *argv[]));
+_PROTOTYPE(void wakeup, (int sig));
+
+int main(argc, argv)
+int argc;
+char *argv[];
+{
+  sigset_t set;
+  char c;
+
+  /* With an argument just exit, as a program that needs memory for a moment.
+   * Else sleep in MM until test44 sends SIGUSR1, and say so on stdout.
+   */
+  if (argc > 1) exit(0);
+  signal(SIGUSR1, wakeup);
+  sigemptyset(&set);
+  sigaddset(&set, SIGUSR1);
+  sigprocmask(SIG_BLOCK, &set, (sigset_t *) NULL);
+  if (write(1, "r", 1) != 1) exit(1);
+  sigemptyset(&set);
+  sigsuspend(&set);
+  if (write(1, "w", 1) != 1) exit(1);
+
+  /* Hold on to our memory until test44 closes the pipe on stdin. */
+  while (read(0, &c, 1) > 0) {}
+  exit(0);
+}
+
+void wakeup(sig)
+int sig;
+{
+}
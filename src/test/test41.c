@@ -0,0 +1,211 @@
+/* test41: memory fragmentation under fork and exec */
+
+/* A number of "holder" processes of mixed sizes is kept alive, and one of
+ * them is replaced by a new one of random size every round.  This chops the
+ * free memory into holes of all sizes.  Every few rounds a big program is
+ * started, which must not fail for lack of a hole that fits.  The default
+ * run is short; give a number of rounds as argument to let it run for hours.
+ */
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <a.out.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdio.h>
+
+#define MAX_ERROR	4
+#define ROUNDS	      200	/* default number of rounds */
+#define NHOLD		6	/* number of holder processes */
+#define BIG_EVERY      16	/* start the big program every so many rounds */
+#define PROG_MAX    16384	/* t41a must fit in this */
+
+char *name[] = { "t41b", "t41c", "t41d", "t41e", "t41f", "t41g" };
+long size[] = { 6000L, 10000L, 16000L, 24000L, 36000L, 48000L };
+#define NSIZES		(sizeof(size) / sizeof(size[0]))
+#define BIG_NAME	"t41h"
+#define BIG_SIZE	96000L
+
+struct holder {
+  pid_t pid;			/* holder process, 0 if none */
+  int fd;			/* write end of its stdin pipe */
+} hold[NHOLD];
+
+int errct = 0;
+int subtest = 1;
+char prog[PROG_MAX];
+int psize;
+
+_PROTOTYPE(int main, (int argc, char *argv[]));
+_PROTOTYPE(void mkfiles, (void));
+_PROTOTYPE(void cr_file, (char *name, long total));
+_PROTOTYPE(void spawn, (struct holder *hp, char *prog));
+_PROTOTYPE(void release, (struct holder *hp));
+_PROTOTYPE(void runbig, (void));
+_PROTOTYPE(void rmfiles, (void));
+_PROTOTYPE(void e, (int n));
+_PROTOTYPE(void quit, (void));
+
+int main(argc, argv)
+int argc;
+char *argv[];
+{
+  long i, rounds = ROUNDS;
+  struct holder *hp;
+
+  if (argc == 2) rounds = atol(argv[1]);
+  printf("Test 41 ");
+  fflush(stdout);		/* have to flush for child's benefit */
+
+  system("rm -rf DIR_41; mkdir DIR_41; cp t41a DIR_41");
+  chdir("DIR_41");
+  mkfiles();
+
+  srand(41);
+  for (i = 1; i <= rounds; i++) {
+	subtest = 1;
+	hp = &hold[rand() % NHOLD];
+	if (hp->pid != 0) release(hp);
+	spawn(hp, name[rand() % NSIZES]);
+
+	if (i % BIG_EVERY == 0) {
+		subtest = 2;
+		runbig();
+	}
+  }
+
+  subtest = 3;
+  for (hp = hold; hp < &hold[NHOLD]; hp++)
+	if (hp->pid != 0) release(hp);
+  runbig();
+
+  rmfiles();
+  quit();
+  return(-1);			/* impossible */
+}
+
+void mkfiles()
+{
+  int fd, i;
+
+  if ((fd = open("t41a", O_RDONLY)) < 0) {
+	printf("Can't open t41a\n");
+	exit(1);
+  }
+  psize = read(fd, prog, sizeof(prog));
+  close(fd);
+  if (psize < sizeof(struct exec) || psize == sizeof(prog)) {
+	printf("t41a is not usable\n");
+	exit(1);
+  }
+  for (i = 0; i < NSIZES; i++) cr_file(name[i], size[i]);
+  cr_file(BIG_NAME, BIG_SIZE);
+}
+
+void cr_file(name, total)
+char *name;
+long total;
+{
+/* Make a copy of t41a that asks for 'total' bytes of memory. */
+  int fd;
+
+  ((struct exec *) prog)->a_total = total;
+  if ((fd = creat(name, 0755)) < 0) e(1);
+  if (write(fd, prog, psize) != psize) e(2);
+  close(fd);
+}
+
+void spawn(hp, prog)
+struct holder *hp;
+char *prog;
+{
+/* Start a holder that waits on a pipe for us to let it go. */
+  int fds[2];
+
+  if (pipe(fds) != 0) {
+	e(3);
+	return;
+  }
+  switch (hp->pid = fork()) {
+  case -1:
+	hp->pid = 0;
+	e(4);
+	break;
+  case 0:
+	dup2(fds[0], 0);
+	close(fds[0]);
+	close(fds[1]);
+	execl(prog, prog, (char *) 0);
+	exit(errno == ENOMEM ? 2 : 3);
+  default:
+	close(fds[0]);
+	hp->fd = fds[1];
+	fcntl(hp->fd, F_SETFD, FD_CLOEXEC);	/* later holders must not keep it */
+  }
+}
+
+void release(hp)
+struct holder *hp;
+{
+/* Let a holder exit and check that it ran. */
+  int status;
+
+  close(hp->fd);
+  if (waitpid(hp->pid, &status, 0) != hp->pid) e(5);
+  if (!WIFEXITED(status)) e(6);
+  else if (WEXITSTATUS(status) == 2) e(7);	/* exec: no memory */
+  else if (WEXITSTATUS(status) != 0) e(8);
+  hp->pid = 0;
+}
+
+void runbig()
+{
+/* Run the big program to completion; it must find a hole. */
+  struct holder big;
+
+  spawn(&big, BIG_NAME);
+  if (big.pid != 0) release(&big);
+}
+
+void rmfiles()
+{
+  int i;
+
+  for (i = 0; i < NSIZES; i++) unlink(name[i]);
+  unlink(BIG_NAME);
+  unlink("t41a");
+}
+
+void e(n)
+int n;
+{
+  int err_num = errno;		/* Save in case printf clobbers it. */
+
+  printf("Subtest %d,  error %d  errno=%d: ", subtest, n, errno);
+  errno = err_num;
+  perror("");
+  if (errct++ > MAX_ERROR) {
+	printf("Too many errors; test aborted\n");
+	chdir("..");
+	system("rm -rf DIR*");
+	exit(1);
+  }
+  errno = 0;
+}
+
+void quit()
+{
+  chdir("..");
+  system("rm -rf DIR*");
+
+  if (errct == 0) {
+	printf("ok\n");
+	exit(0);
+  } else {
+	printf("%d errors\n", errct);
+	exit(1);
+  }
+}
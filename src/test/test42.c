@@ -0,0 +1,132 @@
+/* test42: vfork() */
+
+/* The child of vfork() may only exec or _exit.  Whether it shares the
+ * parent's memory depends on the machine, so that is not tested; only that
+ * the parent gets the right pid back after the child is done with it.
+ */
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdio.h>
+
+#define MAX_ERROR	4
+#define ITERATIONS     10
+
+int errct = 0;
+int subtest = 1;
+
+_PROTOTYPE(int main, (int argc, char *argv[]));
+_PROTOTYPE(void test42a, (void));
+_PROTOTYPE(void test42b, (void));
+_PROTOTYPE(void test42c, (void));
+_PROTOTYPE(int child_status, (pid_t pid));
+_PROTOTYPE(void e, (int n));
+_PROTOTYPE(void quit, (void));
+
+int main(argc, argv)
+int argc;
+char *argv[];
+{
+  int i, m = 0xFFFF;
+
+  if (argc == 2) m = atoi(argv[1]);
+  printf("Test 42 ");
+  fflush(stdout);		/* have to flush for child's benefit */
+
+  for (i = 0; i < ITERATIONS; i++) {
+	if (m & 0001) test42a();
+	if (m & 0002) test42b();
+	if (m & 0004) test42c();
+  }
+  quit();
+  return(-1);			/* impossible */
+}
+
+void test42a()
+{
+/* The child exits at once. */
+  pid_t pid;
+
+  subtest = 1;
+  if ((pid = vfork()) < 0) e(1);
+  if (pid == 0) _exit(5);
+  if (child_status(pid) != 5) e(2);
+}
+
+void test42b()
+{
+/* The child execs, or fails to. */
+  pid_t pid;
+
+  subtest = 2;
+  if ((pid = vfork()) < 0) e(1);
+  if (pid == 0) {
+	execl("/bin/sh", "sh", "-c", "exit 3", (char *) 0);
+	_exit(99);
+  }
+  if (child_status(pid) != 3) e(2);
+
+  if ((pid = vfork()) < 0) e(3);
+  if (pid == 0) {
+	execl("/nonexistent", "nonexistent", (char *) 0);
+	_exit(errno == ENOENT ? 7 : 99);
+  }
+  if (child_status(pid) != 7) e(4);
+}
+
+void test42c()
+{
+/* system() and popen() use vfork(). */
+  FILE *fp;
+  char buf[16];
+
+  subtest = 3;
+  if (system("exit 4") != (4 << 8)) e(1);
+  if ((fp = popen("echo hi", "r")) == NULL) {
+	e(2);
+	return;
+  }
+  if (fgets(buf, sizeof(buf), fp) == NULL || strcmp(buf, "hi\n") != 0) e(3);
+  if (pclose(fp) != 0) e(4);
+}
+
+int child_status(pid)
+pid_t pid;
+{
+/* Wait for a child and return its exit status, or -1. */
+  int status;
+
+  if (waitpid(pid, &status, 0) != pid) return(-1);
+  if (!WIFEXITED(status)) return(-1);
+  return(WEXITSTATUS(status));
+}
+
+void e(n)
+int n;
+{
+  int err_num = errno;		/* Save in case printf clobbers it. */
+
+  printf("Subtest %d,  error %d  errno=%d: ", subtest, n, errno);
+  errno = err_num;
+  perror("");
+  if (errct++ > MAX_ERROR) {
+	printf("Too many errors; test aborted\n");
+	exit(1);
+  }
+  errno = 0;
+}
+
+void quit()
+{
+  if (errct == 0) {
+	printf("ok\n");
+	exit(0);
+  } else {
+	printf("%d errors\n", errct);
+	exit(1);
+  }
+}
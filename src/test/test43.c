@@ -0,0 +1,241 @@
+/* test43: exec latency for small and large programs */
+
+/* Copies of t43a are made that differ in how much of them exec has to read
+ * from the file (data padded with zeroes) and how much it has to clear (a
+ * big gap).  Each is run a number of times; the child checks its own data
+ * and bss.  With -t the time per exec is printed, so that changes to exec
+ * can be measured on a quiet system.  Last, a program is overwritten by
+ * another one, which must then be run and not the text MM kept of the old.
+ */
+
+#include <sys/types.h>
+#include <sys/times.h>
+#include <sys/wait.h>
+#include <a.out.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <stdio.h>
+
+#define MAX_ERROR	4
+#define ITERATIONS     20
+#define PROG_MAX    16384	/* t43a must fit in this */
+#define PAD_CHUNK    1024
+
+struct prog {
+  char *name;			/* name of the copy */
+  long pad;			/* zeroes added to the data segment */
+  long gap;			/* extra memory asked for */
+} progs[] = {
+  { "t43b",	0L,		0L },		/* as compiled */
+  { "t43c",	0L,		200000L },	/* much to clear */
+  { "t43d",	100000L,	0L },		/* much to read */
+  { "t43e",	100000L,	200000L },	/* both */
+};
+#define NPROGS		(sizeof(progs) / sizeof(progs[0]))
+
+int errct = 0;
+int subtest = 1;
+int timing = 0;
+char prog[PROG_MAX];
+char zeroes[PAD_CHUNK];
+int psize;
+
+_PROTOTYPE(int main, (int argc, char *argv[]));
+_PROTOTYPE(void mkfiles, (void));
+_PROTOTYPE(void cr_file, (struct prog *pp));
+_PROTOTYPE(void run, (struct prog *pp, int n));
+_PROTOTYPE(void replace, (void));
+_PROTOTYPE(int status, (char *name));
+_PROTOTYPE(void e, (int n));
+_PROTOTYPE(void quit, (void));
+
+int main(argc, argv)
+int argc;
+char *argv[];
+{
+  int i, n = ITERATIONS;
+
+  if (argc > 1 && strcmp(argv[1], "-t") == 0) {
+	timing = 1;
+	argc--;
+	argv++;
+  }
+  if (argc == 2) n = atoi(argv[1]);
+  printf("Test 43 ");
+  fflush(stdout);		/* have to flush for child's benefit */
+
+  system("rm -rf DIR_43; mkdir DIR_43; cp t43a DIR_43");
+  chdir("DIR_43");
+  mkfiles();
+
+  for (i = 0; i < NPROGS; i++) {
+	subtest = i + 1;
+	run(&progs[i], n);
+  }
+
+  subtest = NPROGS + 1;
+  replace();
+
+  for (i = 0; i < NPROGS; i++) unlink(progs[i].name);
+  unlink("t43a");
+  quit();
+  return(-1);			/* impossible */
+}
+
+void mkfiles()
+{
+  int fd, i;
+
+  if ((fd = open("t43a", O_RDONLY)) < 0) {
+	printf("Can't open t43a\n");
+	exit(1);
+  }
+  psize = read(fd, prog, sizeof(prog));
+  close(fd);
+  if (psize < sizeof(struct exec) || psize == sizeof(prog)) {
+	printf("t43a is not usable\n");
+	exit(1);
+  }
+  for (i = 0; i < NPROGS; i++) cr_file(&progs[i]);
+}
+
+void cr_file(pp)
+struct prog *pp;
+{
+/* Make a copy of t43a with zeroes added to the end of its data segment,
+ * and room for them and the extra gap.  What follows the data (symbols
+ * and relocation information) is moved along.
+ */
+  struct exec hdr;
+  int fd, split;
+  long left;
+
+  memcpy((char *) &hdr, prog, sizeof(hdr));
+  split = hdr.a_hdrlen + hdr.a_text + hdr.a_data;
+  hdr.a_data += pp->pad;
+  hdr.a_total += pp->pad + pp->gap;
+
+  if ((fd = creat(pp->name, 0755)) < 0) {
+	e(1);
+	return;
+  }
+  if (write(fd, (char *) &hdr, sizeof(hdr)) != sizeof(hdr)) e(2);
+  if (write(fd, prog + sizeof(hdr), split - sizeof(hdr))
+					!= split - sizeof(hdr)) e(3);
+  for (left = pp->pad; left > 0; left -= PAD_CHUNK) {
+	if (write(fd, zeroes, PAD_CHUNK) != PAD_CHUNK) {
+		e(4);
+		break;
+	}
+  }
+  if (write(fd, prog + split, psize - split) != psize - split) e(5);
+  close(fd);
+}
+
+void run(pp, n)
+struct prog *pp;
+int n;
+{
+/* Run a copy n times and report the time taken by each run if asked. */
+  struct tms tms;
+  clock_t start;
+  pid_t pid;
+  int i, status;
+
+  start = times(&tms);
+  for (i = 0; i < n; i++) {
+	if ((pid = fork()) < 0) {
+		e(1);
+		return;
+	}
+	if (pid == 0) {
+		execl(pp->name, pp->name, (char *) 0);
+		exit(errno == ENOMEM ? 8 : 9);
+	}
+	if (waitpid(pid, &status, 0) != pid) e(2);
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) e(3);
+  }
+  if (timing && n > 0) {
+	printf("\n  %s: pad %ld gap %ld: %ld ms per exec", pp->name,
+		pp->pad, pp->gap,
+		(long) (times(&tms) - start) * 1000L / CLK_TCK / n);
+  }
+}
+
+void replace()
+{
+/* Run t43a as "t43f", then write the shell over it and run that. */
+  int fd, in;
+
+  if (system("cp t43a t43f") != 0) e(1);
+  if (status("t43f") != 0) e(2);
+  if (status("t43f") != 0) e(3);
+  if ((fd = open("t43f", O_WRONLY | O_TRUNC)) < 0) {
+	e(4);
+	return;
+  }
+  if ((in = open("/bin/sh", O_RDONLY)) < 0) {
+	e(5);
+	close(fd);
+	return;
+  }
+  while ((psize = read(in, prog, sizeof(prog))) > 0) {
+	if (write(fd, prog, psize) != psize) e(6);
+  }
+  close(in);
+  close(fd);
+  if (status("t43f") != 7) e(7);
+  unlink("t43f");
+}
+
+int status(name)
+char *name;
+{
+/* Run 'name' as "name -c 'exit 7'" and return its exit status, or -1. */
+  pid_t pid;
+  int st;
+
+  if ((pid = fork()) < 0) return(-1);
+  if (pid == 0) {
+	execl(name, name, "-c", "exit 7", (char *) 0);
+	exit(99);
+  }
+  if (waitpid(pid, &st, 0) != pid || !WIFEXITED(st)) return(-1);
+  return(WEXITSTATUS(st));
+}
+
+void e(n)
+int n;
+{
+  int err_num = errno;		/* Save in case printf clobbers it. */
+
+  printf("Subtest %d,  error %d  errno=%d: ", subtest, n, errno);
+  errno = err_num;
+  perror("");
+  if (errct++ > MAX_ERROR) {
+	printf("Too many errors; test aborted\n");
+	chdir("..");
+	system("rm -rf DIR*");
+	exit(1);
+  }
+  errno = 0;
+}
+
+void quit()
+{
+  chdir("..");
+  system("rm -rf DIR*");
+
+  if (timing) printf("\n");
+  if (errct == 0) {
+	printf("ok\n");
+	exit(0);
+  } else {
+	printf("%d errors\n", errct);
+	exit(1);
+  }
+}
@@ -0,0 +1,278 @@
+/* test44: swapping under memory pressure */
+
+/* A number of big processes go to sleep in sigsuspend(), and then a bigger
+ * program is run a few times, which needs the memory of some of them.  With
+ * swapping on they are swapped out; the sleepers are then woken one by one
+ * and each must answer.  Without swap the big program may fail for lack of
+ * memory, which is not an error.  With -t the swap traffic of the sleepers
+ * and the time from signal to answer are printed.
+ */
+
+#include <sys/types.h>
+#include <sys/svrctl.h>
+#include <sys/times.h>
+#include <sys/wait.h>
+#include <a.out.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <stdio.h>
+
+#define MAX_ERROR	4
+#define NSLEEP		6	/* number of sleepers */
+#define NPUSH		4	/* times the big program is run */
+#define PROG_MAX    16384	/* t44a must fit in this */
+#define SLEEP_NAME	"t44b"
+#define SLEEP_SIZE 200000L
+#define PUSH_NAME	"t44c"
+#define PUSH_SIZE  600000L
+
+struct sleeper {
+  pid_t pid;			/* sleeping process, 0 if none */
+  int in;			/* write end of its stdin pipe */
+  int out;			/* read end of its stdout pipe */
+} sleeper[NSLEEP];
+
+int errct = 0;
+int subtest = 1;
+int timing = 0;
+char prog[PROG_MAX];
+int psize;
+
+_PROTOTYPE(int main, (int argc, char *argv[]));
+_PROTOTYPE(void cr_file, (char *name, long total));
+_PROTOTYPE(void start, (struct sleeper *sp));
+_PROTOTYPE(int push, (void));
+_PROTOTYPE(long wake, (struct sleeper *sp));
+_PROTOTYPE(void swapcount, (pid_t pid, unsigned long *in,
+						unsigned long *out));
+_PROTOTYPE(void release, (struct sleeper *sp));
+_PROTOTYPE(void e, (int n));
+_PROTOTYPE(void quit, (void));
+
+int main(argc, argv)
+int argc;
+char *argv[];
+{
+  struct sleeper *sp;
+  int fd, i, nomem, nwoken;
+  long lat, maxlat, sumlat;
+  unsigned long in, out, swapin, swapout;
+
+  if (argc > 1 && strcmp(argv[1], "-t") == 0) timing = 1;
+  printf("Test 44 ");
+  fflush(stdout);		/* have to flush for child's benefit */
+
+  system("rm -rf DIR_44; mkdir DIR_44; cp t44a DIR_44");
+  chdir("DIR_44");
+  if ((fd = open("t44a", O_RDONLY)) < 0) {
+	printf("Can't open t44a\n");
+	exit(1);
+  }
+  psize = read(fd, prog, sizeof(prog));
+  close(fd);
+  if (psize < sizeof(struct exec) || psize == sizeof(prog)) {
+	printf("t44a is not usable\n");
+	exit(1);
+  }
+  cr_file(SLEEP_NAME, SLEEP_SIZE);
+  cr_file(PUSH_NAME, PUSH_SIZE);
+
+  /* Put the sleepers to sleep. */
+  subtest = 1;
+  for (sp = sleeper; sp < &sleeper[NSLEEP]; sp++) start(sp);
+
+  /* Make them go to swap. */
+  subtest = 2;
+  nomem = 0;
+  for (i = 0; i < NPUSH; i++) nomem += push();
+
+  /* Wake them up and see how fast they answer. */
+  subtest = 3;
+  maxlat = sumlat = 0;
+  swapin = swapout = 0;
+  nwoken = 0;
+  for (sp = sleeper; sp < &sleeper[NSLEEP]; sp++) {
+	if (sp->pid == 0) continue;
+	lat = wake(sp);
+	if (lat > maxlat) maxlat = lat;
+	sumlat += lat;
+	nwoken++;
+	swapcount(sp->pid, &in, &out);
+	swapin += in;
+	swapout += out;
+  }
+  for (sp = sleeper; sp < &sleeper[NSLEEP]; sp++)
+	if (sp->pid != 0) release(sp);
+
+  if (timing) {
+	printf("\n  big program ran %d of %d times", NPUSH - nomem, NPUSH);
+	printf("\n  sleepers swapped out %lu, in %lu times", swapout, swapin);
+	if (nwoken > 0) {
+		printf("\n  wakeup: %ld ms average, %ld ms max",
+			sumlat * 1000L / CLK_TCK / nwoken,
+			maxlat * 1000L / CLK_TCK);
+	}
+  }
+  unlink(SLEEP_NAME);
+  unlink(PUSH_NAME);
+  unlink("t44a");
+  quit();
+  return(-1);			/* impossible */
+}
+
+void cr_file(name, total)
+char *name;
+long total;
+{
+/* Make a copy of t44a that asks for 'total' bytes of memory. */
+  int fd;
+
+  ((struct exec *) prog)->a_total = total;
+  if ((fd = creat(name, 0755)) < 0) e(1);
+  if (write(fd, prog, psize) != psize) e(2);
+  close(fd);
+}
+
+void start(sp)
+struct sleeper *sp;
+{
+/* Start a sleeper and wait until it is about to sleep. */
+  int in[2], out[2];
+  char c;
+
+  if (pipe(in) != 0 || pipe(out) != 0) {
+	e(1);
+	return;
+  }
+  switch (sp->pid = fork()) {
+  case -1:
+	sp->pid = 0;
+	e(2);
+	return;
+  case 0:
+	dup2(in[0], 0);
+	dup2(out[1], 1);
+	close(in[0]);
+	close(in[1]);
+	close(out[0]);
+	close(out[1]);
+	execl(SLEEP_NAME, SLEEP_NAME, (char *) 0);
+	exit(errno == ENOMEM ? 2 : 3);
+  default:
+	/* Keep our ends out of the other children. */
+	close(in[0]);
+	close(out[1]);
+	sp->in = in[1];
+	sp->out = out[0];
+	fcntl(sp->in, F_SETFD, FD_CLOEXEC);
+	fcntl(sp->out, F_SETFD, FD_CLOEXEC);
+  }
+  if (read(sp->out, &c, 1) != 1 || c != 'r') {
+	/* It didn't make it, probably no memory. */
+	release(sp);
+  }
+}
+
+int push()
+{
+/* Run the big program, return 1 if there was no memory for it. */
+  pid_t pid;
+  int status;
+
+  if ((pid = fork()) < 0) {
+	e(1);
+	return(0);
+  }
+  if (pid == 0) {
+	execl(PUSH_NAME, PUSH_NAME, "x", (char *) 0);
+	exit(errno == ENOMEM ? 2 : 3);
+  }
+  if (waitpid(pid, &status, 0) != pid) e(2);
+  if (!WIFEXITED(status)) e(3);
+  else if (WEXITSTATUS(status) == 2) return(1);
+  else if (WEXITSTATUS(status) != 0) e(4);
+  return(0);
+}
+
+long wake(sp)
+struct sleeper *sp;
+{
+/* Wake a sleeper and return the ticks it took to answer. */
+  struct tms tms;
+  clock_t t0;
+  char c;
+
+  t0 = times(&tms);
+  if (kill(sp->pid, SIGUSR1) != 0) e(1);
+  if (read(sp->out, &c, 1) != 1 || c != 'w') e(2);
+  return((long) (times(&tms) - t0));
+}
+
+void swapcount(pid, in, out)
+pid_t pid;
+unsigned long *in, *out;
+{
+/* Find the swap counters of a process. */
+  struct sysgetproc acct;
+
+  *in = *out = 0;
+  for (acct.proc_nr = 0; svrctl(SYSGETPROC, (void *) &acct) == 0
+		|| errno == ESRCH; acct.proc_nr++) {
+	if (acct.pid == pid) {
+		*in = acct.nswapin;
+		*out = acct.nswapout;
+		return;
+	}
+  }
+}
+
+void release(sp)
+struct sleeper *sp;
+{
+/* Let a sleeper exit. */
+  int status;
+
+  close(sp->in);
+  close(sp->out);
+  if (waitpid(sp->pid, &status, 0) != sp->pid) e(1);
+  else if (!WIFEXITED(status)) e(2);
+  else if (WEXITSTATUS(status) == 3) e(3);	/* exec failed, not ENOMEM */
+  sp->pid = 0;
+}
+
+void e(n)
+int n;
+{
+  int err_num = errno;		/* Save in case printf clobbers it. */
+
+  printf("Subtest %d,  error %d  errno=%d: ", subtest, n, errno);
+  errno = err_num;
+  perror("");
+  if (errct++ > MAX_ERROR) {
+	printf("Too many errors; test aborted\n");
+	chdir("..");
+	system("rm -rf DIR*");
+	exit(1);
+  }
+  errno = 0;
+}
+
+void quit()
+{
+  chdir("..");
+  system("rm -rf DIR*");
+
+  if (timing) printf("\n");
+  if (errct == 0) {
+	printf("ok\n");
+	exit(0);
+  } else {
+	printf("%d errors\n", errct);
+	exit(1);
+  }
+}
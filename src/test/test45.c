@@ -0,0 +1,161 @@
+/* test45: scattered writes through the block cache */
+
+/* Blocks of a file are written in a scrambled order, as a trace of small
+ * random writes would, and flushed with sync().  FS sorts the dirty blocks
+ * and writes them in elevator order; what is read back must be what was
+ * written, wherever the disk head happened to be.  With -t the time taken
+ * by each round of writes and sync is printed.
+ */
+
+#include <sys/types.h>
+#include <sys/times.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <stdio.h>
+
+#define MAX_ERROR	4
+#define ROUNDS		4
+#define NBLK	      200	/* blocks in the file */
+#define BLK	     1024	/* bytes in a block */
+#define FILENAME	"T45"
+
+int errct = 0;
+int subtest = 1;
+int timing = 0;
+char buf[BLK];
+
+_PROTOTYPE(int main, (int argc, char *argv[]));
+_PROTOTYPE(void fill, (int round, int blk));
+_PROTOTYPE(void trace, (int fd, int round));
+_PROTOTYPE(void check, (int fd, int round));
+_PROTOTYPE(void e, (int n));
+_PROTOTYPE(void quit, (void));
+
+int main(argc, argv)
+int argc;
+char *argv[];
+{
+  struct tms tms;
+  clock_t t0;
+  int fd, round;
+
+  if (argc > 1 && strcmp(argv[1], "-t") == 0) timing = 1;
+  printf("Test 45 ");
+  fflush(stdout);
+
+  system("rm -rf DIR_45; mkdir DIR_45");
+  chdir("DIR_45");
+
+  if ((fd = open(FILENAME, O_RDWR | O_CREAT | O_TRUNC, 0644)) < 0) {
+	e(1);
+	quit();
+  }
+  srand(45);
+  for (round = 0; round < ROUNDS; round++) {
+	subtest = round + 1;
+	t0 = times(&tms);
+	trace(fd, round);
+	sync();
+	if (timing) {
+		printf("\n  round %d: %ld ms", round,
+			(long) (times(&tms) - t0) * 1000L / CLK_TCK);
+	}
+	check(fd, round);
+  }
+  close(fd);
+  unlink(FILENAME);
+  quit();
+  return(-1);			/* impossible */
+}
+
+void fill(round, blk)
+int round, blk;
+{
+/* Fill the buffer with what block 'blk' holds after round 'round'. */
+  int i;
+
+  for (i = 0; i < BLK; i++) buf[i] = (char) (round * 31 + blk * 7 + i);
+}
+
+void trace(fd, round)
+int fd, round;
+{
+/* Write all blocks once, in a random order.  The first round writes them
+ * in order, so that the file exists in full.
+ */
+  static int order[NBLK];
+  int i, j, t;
+
+  for (i = 0; i < NBLK; i++) order[i] = i;
+  if (round > 0) {
+	for (i = NBLK - 1; i > 0; i--) {
+		j = rand() % (i + 1);
+		t = order[i];
+		order[i] = order[j];
+		order[j] = t;
+	}
+  }
+  for (i = 0; i < NBLK; i++) {
+	fill(round, order[i]);
+	if (lseek(fd, (off_t) order[i] * BLK, SEEK_SET) < 0) e(1);
+	if (write(fd, buf, BLK) != BLK) e(2);
+  }
+}
+
+void check(fd, round)
+int fd, round;
+{
+/* Read the file back and compare. */
+  static char want[BLK];
+  int blk;
+
+  if (lseek(fd, (off_t) 0, SEEK_SET) != 0) e(3);
+  for (blk = 0; blk < NBLK; blk++) {
+	fill(round, blk);
+	memcpy(want, buf, BLK);
+	if (read(fd, buf, BLK) != BLK) {
+		e(4);
+		return;
+	}
+	if (memcmp(buf, want, BLK) != 0) {
+		e(5);
+		return;
+	}
+  }
+}
+
+void e(n)
+int n;
+{
+  int err_num = errno;		/* Save in case printf clobbers it. */
+
+  printf("Subtest %d,  error %d  errno=%d: ", subtest, n, errno);
+  errno = err_num;
+  perror("");
+  if (errct++ > MAX_ERROR) {
+	printf("Too many errors; test aborted\n");
+	chdir("..");
+	system("rm -rf DIR*");
+	exit(1);
+  }
+  errno = 0;
+}
+
+void quit()
+{
+  chdir("..");
+  system("rm -rf DIR*");
+
+  if (timing) printf("\n");
+  if (errct == 0) {
+	printf("ok\n");
+	exit(0);
+  } else {
+	printf("%d errors\n", errct);
+	exit(1);
+  }
+}
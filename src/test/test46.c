@@ -0,0 +1,223 @@
+/* test46: data through a pty pair */
+
+/* A child pumps a pattern into one side of a pty, the parent reads it back
+ * from the other side and checks it.  In raw mode TTY moves the data in
+ * bulk, in canonical mode it looks at every character; both must deliver
+ * exactly what was sent.  With -t the throughput of each run is printed.
+ */
+
+#include <sys/types.h>
+#include <sys/times.h>
+#include <sys/wait.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <stdio.h>
+
+#define MAX_ERROR	4
+#define NBYTES	    32768L	/* bytes sent in each run */
+#define CHUNK	      512	/* bytes per write */
+#define LINE	       64	/* line length in canonical mode */
+
+int errct = 0;
+int subtest = 1;
+int timing = 0;
+int master, slave;
+
+_PROTOTYPE(int main, (int argc, char *argv[]));
+_PROTOTYPE(int openpty46, (void));
+_PROTOTYPE(void setmode, (int raw));
+_PROTOTYPE(void test46a, (void));
+_PROTOTYPE(void test46b, (void));
+_PROTOTYPE(void test46c, (void));
+_PROTOTYPE(int pattern, (long i, int canon));
+_PROTOTYPE(void pump, (int wfd, int rfd, int canon, char *what));
+_PROTOTYPE(void e, (int n));
+_PROTOTYPE(void quit, (void));
+
+int main(argc, argv)
+int argc;
+char *argv[];
+{
+  int m = 0xFFFF;
+
+  if (argc > 1 && strcmp(argv[1], "-t") == 0) {
+	timing = 1;
+	argc--;
+	argv++;
+  }
+  if (argc == 2) m = atoi(argv[1]);
+  printf("Test 46 ");
+  fflush(stdout);		/* have to flush for child's benefit */
+
+  if (!openpty46()) {
+	printf("(no free pty) ");
+	quit();
+  }
+  if (m & 0001) test46a();
+  if (m & 0002) test46b();
+  if (m & 0004) test46c();
+  close(slave);
+  close(master);
+  quit();
+  return(-1);			/* impossible */
+}
+
+int openpty46()
+{
+/* Find a free pty and open both sides. */
+  static char ptyname[] = "/dev/ptyp?";
+  static char ttyname[] = "/dev/ttyp?";
+  char *p;
+
+  for (p = "0123456789abcdef"; *p != 0; p++) {
+	ptyname[9] = ttyname[9] = *p;
+	if ((master = open(ptyname, O_RDWR)) < 0) continue;
+	if ((slave = open(ttyname, O_RDWR)) >= 0) return(1);
+	close(master);
+  }
+  return(0);
+}
+
+void setmode(raw)
+int raw;
+{
+/* Put the slave side in raw or canonical mode, without echo or signals. */
+  struct termios tc;
+
+  if (tcgetattr(slave, &tc) < 0) e(90);
+  tc.c_iflag &= ~(ISTRIP | IGNCR | ICRNL | INLCR | IXON | IXOFF);
+  tc.c_oflag &= ~OPOST;
+  tc.c_lflag &= ~(ECHO | ECHONL | ISIG | IEXTEN);
+  if (raw) {
+	tc.c_lflag &= ~ICANON;
+	tc.c_cc[VMIN] = 1;
+	tc.c_cc[VTIME] = 0;
+  } else {
+	tc.c_lflag |= ICANON;
+  }
+  if (tcsetattr(slave, TCSAFLUSH, &tc) < 0) e(91);
+}
+
+void test46a()
+{
+/* Raw mode, master to slave: the bulk input path. */
+  subtest = 1;
+  setmode(1);
+  pump(master, slave, 0, "raw in");
+}
+
+void test46b()
+{
+/* Raw mode, slave to master: the output side. */
+  subtest = 2;
+  setmode(1);
+  pump(slave, master, 0, "raw out");
+}
+
+void test46c()
+{
+/* Canonical mode, master to slave: lines, character by character. */
+  subtest = 3;
+  setmode(0);
+  pump(master, slave, 1, "canon in");
+}
+
+int pattern(i, canon)
+long i;
+int canon;
+{
+/* Byte number 'i' of the data sent.  Lines end in a newline in canonical
+ * mode, and avoid the special characters.
+ */
+  if (canon) {
+	if (i % LINE == LINE - 1) return('\n');
+	return(' ' + (int) ((i * 7 + i / LINE) % 95));
+  }
+  return((int) ((i * 7 + i / 251) & 0xFF));
+}
+
+void pump(wfd, rfd, canon, what)
+int wfd, rfd, canon;
+char *what;
+{
+/* Write NBYTES of the pattern to 'wfd' in a child, read them from 'rfd'. */
+  static char buf[CHUNK];
+  struct tms tms;
+  clock_t t0, t;
+  pid_t pid;
+  long i, got;
+  int n, k, status, bad;
+
+  t0 = times(&tms);
+  switch (pid = fork()) {
+  case -1:
+	e(1);
+	return;
+  case 0:
+	for (i = 0; i < NBYTES; i += n) {
+		n = NBYTES - i < CHUNK ? (int) (NBYTES - i) : CHUNK;
+		for (k = 0; k < n; k++) buf[k] = pattern(i + k, canon);
+		if (write(wfd, buf, n) != n) exit(1);
+	}
+	exit(0);
+  }
+
+  bad = 0;
+  for (got = 0; got < NBYTES && !bad; got += n) {
+	if ((n = read(rfd, buf, CHUNK)) <= 0) {
+		e(2);
+		bad = 1;
+		break;
+	}
+	if (canon && buf[n - 1] != '\n') e(3);	/* a whole line each time */
+	for (k = 0; k < n; k++) {
+		if ((buf[k] & 0xFF) != pattern(got + k, canon)) {
+			e(4);
+			bad = 1;
+			break;
+		}
+	}
+  }
+  if (!bad && got != NBYTES) e(5);	/* more than was sent */
+  if (bad) kill(pid, SIGKILL);
+  if (waitpid(pid, &status, 0) != pid) e(6);
+  if (!bad && (!WIFEXITED(status) || WEXITSTATUS(status) != 0)) e(7);
+
+  t = times(&tms) - t0;
+  if (timing && t > 0) {
+	printf("\n  %-8s %ld bytes/s", what, NBYTES * CLK_TCK / (long) t);
+  }
+}
+
+void e(n)
+int n;
+{
+  int err_num = errno;		/* Save in case printf clobbers it. */
+
+  printf("Subtest %d,  error %d  errno=%d: ", subtest, n, errno);
+  errno = err_num;
+  perror("");
+  if (errct++ > MAX_ERROR) {
+	printf("Too many errors; test aborted\n");
+	exit(1);
+  }
+  errno = 0;
+}
+
+void quit()
+{
+  if (timing) printf("\n");
+  if (errct == 0) {
+	printf("ok\n");
+	exit(0);
+  } else {
+	printf("%d errors\n", errct);
+	exit(1);
+  }
+}
@@ -0,0 +1,394 @@
+/* test48: TCP over a lossy pseudo IP link */
+
+/* As in test47, a child reflects every packet that inet sends out of a psip
+ * interface back to it, so a connection to a made-up host on the psip
+ * network ends up talking to a listener on this machine.  Here the psip
+ * device also loses some of the packets written to it, in both directions.
+ * The data must still arrive intact; duplicate acks and fast retransmits
+ * keep it moving without waiting for the retransmission timer every time.
+ * With -t the time each run takes is printed.  The test is skipped if there
+ * is no psip interface with an address; it needs to run as root.
+ */
+
+#include <sys/types.h>
+#include <sys/ioctl.h>
+#include <sys/times.h>
+#include <sys/wait.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <net/hton.h>
+#include <net/gen/in.h>
+#include <net/gen/ip_hdr.h>
+#include <net/gen/ip_io.h>
+#include <net/gen/psip_io.h>
+#include <net/gen/tcp.h>
+#include <net/gen/tcp_io.h>
+
+#define MAX_ERROR	4
+#define NBYTES	    65536L	/* bytes sent in each run */
+#define CHUNK	     4096	/* bytes per read or write */
+#define PACKMAX	     8192	/* largest packet the reflector handles */
+#define PORT	     4800	/* first TCP port used */
+#define DELAY	(CLK_TCK / 20)	/* a round trip of about 100 ms */
+
+int errct = 0;
+int subtest = 1;
+int timing = 0;
+int psipfd = -1;
+pid_t reflector;
+ipaddr_t peer;
+char tcpdev[sizeof("/dev/tcp99")];
+tcpport_t port = PORT;
+char buf[CHUNK];
+
+_PROTOTYPE(int main, (int argc, char *argv[]));
+_PROTOTYPE(int findpsip, (void));
+_PROTOTYPE(void catch, (int sig));
+_PROTOTYPE(void reflect, (void));
+_PROTOTYPE(void setlink, (long ticks, long drop));
+_PROTOTYPE(void test48a, (void));
+_PROTOTYPE(void test48b, (void));
+_PROTOTYPE(void test48c, (void));
+_PROTOTYPE(void test48d, (void));
+_PROTOTYPE(int tcpopen, (unsigned long flags, long sndbuf, long rcvbuf));
+_PROTOTYPE(int pattern, (long i));
+_PROTOTYPE(void transfer, (long sndbuf, long rcvbuf, char *what));
+_PROTOTYPE(void receive, (long rcvbuf));
+_PROTOTYPE(void e, (int n));
+_PROTOTYPE(void quit, (void));
+
+int main(argc, argv)
+int argc;
+char *argv[];
+{
+  int m = 0xFFFF;
+
+  if (argc > 1 && strcmp(argv[1], "-t") == 0) {
+	timing = 1;
+	argc--;
+	argv++;
+  }
+  if (argc == 2) m = atoi(argv[1]);
+  printf("Test 48 ");
+  fflush(stdout);		/* have to flush for child's benefit */
+
+  if (!findpsip()) {
+	printf("(no psip interface) ");
+	quit();
+  }
+  switch (reflector = fork()) {
+  case -1:
+	e(1);
+	quit();
+  case 0:
+	reflect();
+	exit(0);
+  }
+
+  if (m & 0001) test48a();
+  if (m & 0002) test48b();
+  if (m & 0004) test48c();
+  if (m & 0010) test48d();
+  setlink(0L, 0L);
+  quit();
+  return(-1);			/* impossible */
+}
+
+int findpsip()
+{
+/* Find a psip interface with an address, and pick a peer address on its
+ * network.
+ */
+  struct nwio_ipconf ipconf;
+  char ipdev[sizeof("/dev/ip99")];
+  ipaddr_t host;
+  int i, fd, r;
+
+  signal(SIGALRM, catch);
+  for (i = 0; i < 16; i++) {
+	sprintf(ipdev, "/dev/psip%d", i);
+	if ((psipfd = open(ipdev, O_RDWR)) < 0) continue;
+	sprintf(ipdev, "/dev/ip%d", i);
+	if ((fd = open(ipdev, O_RDWR)) >= 0) {
+		alarm(2);	/* NWIOGIPCONF waits for an address */
+		r = ioctl(fd, NWIOGIPCONF, &ipconf);
+		alarm(0);
+		close(fd);
+		if (r == 0) {
+			host = ntohl(ipconf.nwic_ipaddr & ~ipconf.nwic_netmask);
+			host = (host == 1) ? 2 : 1;
+			peer = (ipconf.nwic_ipaddr & ipconf.nwic_netmask)
+							| htonl(host);
+			if (peer != ipconf.nwic_ipaddr
+				&& (peer | ipconf.nwic_netmask) != (ipaddr_t) -1) {
+				sprintf(tcpdev, "/dev/tcp%d", i);
+				return(1);
+			}
+		}
+	}
+	close(psipfd);
+  }
+  return(0);
+}
+
+void catch(sig)
+int sig;
+{
+  signal(sig, catch);
+}
+
+void reflect()
+{
+/* Send every packet back to where it came from, as if from the peer. */
+  static char pack[PACKMAX];
+  ip_hdr_t *ip_hdr;
+  ipaddr_t addr;
+  int n;
+
+  ip_hdr = (ip_hdr_t *) pack;
+  while ((n = read(psipfd, pack, sizeof(pack))) >= 0) {
+	if (n < sizeof(*ip_hdr)) continue;
+	addr = ip_hdr->ih_src;
+	ip_hdr->ih_src = ip_hdr->ih_dst;
+	ip_hdr->ih_dst = addr;
+	if (write(psipfd, pack, n) != n) exit(1);
+  }
+  exit(errno == EINTR ? 0 : 1);
+}
+
+void setlink(ticks, drop)
+long ticks, drop;
+{
+/* Let the psip device hold packets for 'ticks' clock ticks and lose 'drop'
+ * in 1000 of them.
+ */
+  struct nwio_psipopt psipopt;
+
+  psipopt.nwpo_flags = ticks != 0 ? NWPO_EN_DELAY : NWPO_DI_DELAY;
+  psipopt.nwpo_flags |= drop != 0 ? NWPO_EN_DROP : NWPO_DI_DROP;
+  psipopt.nwpo_delay = ticks;
+  psipopt.nwpo_drop = drop;
+  if (ioctl(psipfd, NWIOSPSIPOPT, &psipopt) < 0) e(90);
+  if (ioctl(psipfd, NWIOGPSIPOPT, &psipopt) < 0) e(91);
+  if (psipopt.nwpo_delay != ticks) e(92);
+  if (psipopt.nwpo_drop != drop) e(93);
+}
+
+void test48a()
+{
+/* One packet in a hundred is lost. */
+  subtest = 1;
+  setlink((long) DELAY, 10L);
+  transfer(0L, 0L, "1% loss");
+}
+
+void test48b()
+{
+/* One in twenty. */
+  subtest = 2;
+  setlink((long) DELAY, 50L);
+  transfer(0L, 0L, "5% loss");
+}
+
+void test48c()
+{
+/* One in twenty, with more data in flight, so a loss is followed by
+ * enough segments to produce duplicate acks.
+ */
+  subtest = 3;
+  setlink((long) DELAY, 50L);
+  transfer(32768L, 32768L, "5%,big");
+}
+
+void test48d()
+{
+/* Loss rates that are not allowed, and switching loss off. */
+  struct nwio_psipopt psipopt;
+
+  subtest = 4;
+  psipopt.nwpo_flags = NWPO_EN_DROP;
+  psipopt.nwpo_drop = 1001;
+  if (ioctl(psipfd, NWIOSPSIPOPT, &psipopt) != -1 || errno != EBADMODE)
+	e(1);
+  psipopt.nwpo_flags = NWPO_EN_DROP | NWPO_DI_DROP;
+  psipopt.nwpo_drop = 0;
+  if (ioctl(psipfd, NWIOSPSIPOPT, &psipopt) != -1 || errno != EBADMODE)
+	e(2);
+  psipopt.nwpo_flags = NWPO_EN_DROP;
+  psipopt.nwpo_drop = 1000;
+  if (ioctl(psipfd, NWIOSPSIPOPT, &psipopt) < 0) e(3);
+
+  /* Other options leave the loss rate alone. */
+  psipopt.nwpo_flags = NWPO_DI_DELAY;
+  psipopt.nwpo_drop = 0;
+  if (ioctl(psipfd, NWIOSPSIPOPT, &psipopt) < 0) e(4);
+  if (ioctl(psipfd, NWIOGPSIPOPT, &psipopt) < 0) e(5);
+  if (!(psipopt.nwpo_flags & NWPO_EN_DROP) || psipopt.nwpo_drop != 1000)
+	e(6);
+
+  psipopt.nwpo_flags = NWPO_DI_DROP;
+  if (ioctl(psipfd, NWIOSPSIPOPT, &psipopt) < 0) e(7);
+  if (ioctl(psipfd, NWIOGPSIPOPT, &psipopt) < 0) e(8);
+  if ((psipopt.nwpo_flags & NWPO_EN_DROP) || psipopt.nwpo_drop != 0) e(9);
+}
+
+int tcpopen(flags, sndbuf, rcvbuf)
+unsigned long flags;
+long sndbuf, rcvbuf;
+{
+/* Open and configure a TCP channel on the psip network. */
+  struct nwio_tcpconf tcpconf;
+  int fd;
+
+  if ((fd = open(tcpdev, O_RDWR)) < 0) {
+	e(80);
+	return(-1);
+  }
+  tcpconf.nwtc_flags = flags | NWTC_EXCL;
+  tcpconf.nwtc_flags |= (sndbuf | rcvbuf) != 0 ? NWTC_SET_BUFSIZ
+							: NWTC_UNSET_BUFSIZ;
+  tcpconf.nwtc_locport = htons(port);
+  tcpconf.nwtc_remaddr = peer;
+  tcpconf.nwtc_remport = htons(port);
+  tcpconf.nwtc_sndbuf = sndbuf;
+  tcpconf.nwtc_rcvbuf = rcvbuf;
+  if (ioctl(fd, NWIOSTCPCONF, &tcpconf) < 0) {
+	e(81);
+	close(fd);
+	return(-1);
+  }
+  return(fd);
+}
+
+int pattern(i)
+long i;
+{
+/* Byte number 'i' of the data sent. */
+  return((int) ((i * 13 + i / 509) & 0xFF));
+}
+
+void transfer(sndbuf, rcvbuf, what)
+long sndbuf, rcvbuf;
+char *what;
+{
+/* Connect to a listening child through the reflector and send it NBYTES
+ * of the pattern.
+ */
+  struct nwio_tcpcl tcpcl;
+  struct tms tms;
+  clock_t t0, t;
+  pid_t pid;
+  long i;
+  int fd, n, k, tries, status;
+
+  port++;
+  switch (pid = fork()) {
+  case -1:
+	e(1);
+	return;
+  case 0:
+	receive(rcvbuf);
+	exit(1);			/* impossible */
+  }
+
+  /* The listener may not be listening yet. */
+  fd = -1;
+  for (tries = 0; tries < 10; tries++) {
+	fd = tcpopen(NWTC_LP_SEL | NWTC_SET_RA | NWTC_SET_RP, sndbuf, rcvbuf);
+	if (fd < 0) break;
+	tcpcl.nwtcl_flags = 0;
+	if (ioctl(fd, NWIOTCPCONN, &tcpcl) == 0) break;
+	if (errno != ECONNREFUSED) e(2);
+	close(fd);
+	fd = -1;
+	sleep(1);
+  }
+  if (fd < 0) {
+	e(3);
+	kill(pid, SIGKILL);
+	(void) waitpid(pid, &status, 0);
+	return;
+  }
+
+  t0 = times(&tms);
+  for (i = 0; i < NBYTES; i += n) {
+	n = NBYTES - i < CHUNK ? (int) (NBYTES - i) : CHUNK;
+	for (k = 0; k < n; k++) buf[k] = pattern(i + k);
+	if (write(fd, buf, n) != n) {
+		e(4);
+		break;
+	}
+  }
+  if (ioctl(fd, NWIOTCPSHUTDOWN, (void *) 0) < 0) e(5);
+  if (waitpid(pid, &status, 0) != pid) e(6);
+  t = times(&tms) - t0;
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+	e(10 + (WIFEXITED(status) ? WEXITSTATUS(status) : 9));
+  close(fd);
+
+  if (timing && t > 0) {
+	printf("\n  %-9s %ld ms", what, t * 1000L / CLK_TCK);
+  }
+}
+
+void receive(rcvbuf)
+long rcvbuf;
+{
+/* The listening child: accept the connection, read and check the data. */
+  struct nwio_tcpcl tcpcl;
+  long got;
+  int fd, n, k;
+
+  fd = tcpopen(NWTC_LP_SET | NWTC_UNSET_RA | NWTC_UNSET_RP, 0L, rcvbuf);
+  if (fd < 0) exit(1);
+  tcpcl.nwtcl_flags = 0;
+  if (ioctl(fd, NWIOTCPLISTEN, &tcpcl) < 0) exit(2);
+
+  got = 0;
+  while ((n = read(fd, buf, CHUNK)) > 0) {
+	for (k = 0; k < n; k++)
+		if ((buf[k] & 0xFF) != pattern(got + k)) exit(3);
+	got += n;
+  }
+  if (n < 0) exit(4);
+  if (got != NBYTES) exit(5);
+  exit(0);
+}
+
+void e(n)
+int n;
+{
+  int err_num = errno;		/* Save in case printf clobbers it. */
+
+  printf("Subtest %d,  error %d  errno=%d: ", subtest, n, errno);
+  errno = err_num;
+  perror("");
+  if (errct++ > MAX_ERROR) {
+	printf("Too many errors; test aborted\n");
+	if (reflector > 0) kill(reflector, SIGKILL);
+	exit(1);
+  }
+  errno = 0;
+}
+
+void quit()
+{
+  if (reflector > 0) {
+	kill(reflector, SIGKILL);
+	(void) waitpid(reflector, (int *) 0, 0);
+  }
+  if (timing) printf("\n");
+  if (errct == 0) {
+	printf("ok\n");
+	exit(0);
+  } else {
+	printf("%d errors\n", errct);
+	exit(1);
+  }
+}
@@ -0,0 +1,233 @@
+/* test49: oneC_sum() and oneC_copysum() */
+
+/* The Internet checksum routines are checked against a simple byte at a time
+ * version, at every alignment of source and destination and for all lengths
+ * up to a full ethernet packet.  With -t the speed of both routines is
+ * measured for packet sizes from 64 to 1500 bytes, next to memcpy() followed
+ * by oneC_sum().
+ */
+
+#include <sys/types.h>
+#include <sys/times.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <net/gen/oneCsum.h>
+
+#define MAX_ERROR	4
+#define MAXLEN	     1500	/* longest packet checked */
+#define ALIGN		4	/* alignments tried */
+#define GUARD	     0x5A	/* fill byte around the copy */
+#define LOOPS	     2000	/* packets summed in each timing run */
+
+int errct = 0;
+int subtest = 1;
+int timing = 0;
+
+union {
+  u32_t align;
+  u8_t b[MAXLEN + 2 * ALIGN];
+} src, dst;
+
+int sizes[] = { 64, 128, 256, 512, 576, 1024, 1500 };
+#define NSIZES		(sizeof(sizes) / sizeof(sizes[0]))
+
+_PROTOTYPE(int main, (int argc, char *argv[]));
+_PROTOTYPE(void test49a, (void));
+_PROTOTYPE(void test49b, (void));
+_PROTOTYPE(void test49c, (void));
+_PROTOTYPE(unsigned slowsum, (unsigned prev, u8_t *data, int len));
+_PROTOTYPE(int same, (unsigned a, unsigned b));
+_PROTOTYPE(void e, (int n));
+_PROTOTYPE(void quit, (void));
+
+int main(argc, argv)
+int argc;
+char *argv[];
+{
+  int i, m = 0xFFFF;
+
+  if (argc > 1 && strcmp(argv[1], "-t") == 0) {
+	timing = 1;
+	argc--;
+	argv++;
+  }
+  if (argc == 2) m = atoi(argv[1]);
+  printf("Test 49 ");
+  fflush(stdout);
+
+  srand(49);
+  for (i = 0; i < sizeof(src.b); i++) src.b[i] = rand() >> 3;
+
+  if (m & 0001) test49a();
+  if (m & 0002) test49b();
+  if (m & 0004) test49c();
+  quit();
+  return(-1);			/* impossible */
+}
+
+void test49a()
+{
+/* oneC_sum() at all alignments and lengths, and with all-ones data. */
+  int a, len, i;
+  unsigned prev;
+
+  subtest = 1;
+  for (a = 0; a < ALIGN; a++) {
+	for (len = 0; len <= MAXLEN; len += (len < 64 ? 1 : 7)) {
+		for (i = 0; i < 3; i++) {
+			prev = i == 0 ? 0 : i == 1 ? 0xFFFF : rand() & 0xFFFF;
+			if (!same(oneC_sum(prev, src.b + a, (size_t) len),
+					slowsum(prev, src.b + a, len))) {
+				e(1);
+				return;
+			}
+		}
+	}
+  }
+
+  /* Many carries out of the accumulator. */
+  memset(dst.b, 0xFF, sizeof(dst.b));
+  for (a = 0; a < ALIGN; a++) {
+	if (oneC_sum(0xFFFF, dst.b + a, (size_t) MAXLEN) != 0xFFFF) e(2);
+	if (oneC_sum(0, dst.b + a, (size_t) 0) != 0) e(3);
+  }
+}
+
+void test49b()
+{
+/* oneC_copysum() at all combinations of source and destination alignment.
+ * It must copy exactly 'len' bytes and return what oneC_sum() does.
+ */
+  int sa, da, len, i;
+  unsigned prev, sum;
+
+  subtest = 2;
+  for (sa = 0; sa < ALIGN; sa++) {
+	for (da = 0; da < ALIGN; da++) {
+		for (len = 0; len <= MAXLEN; len += (len < 64 ? 1 : 13)) {
+			memset(dst.b, GUARD, sizeof(dst.b));
+			prev = rand() & 0xFFFF;
+			sum = oneC_copysum(prev, dst.b + da, src.b + sa,
+								(size_t) len);
+			if (sum != oneC_sum(prev, src.b + sa, (size_t) len)) {
+				e(1);
+				return;
+			}
+			if (memcmp(dst.b + da, src.b + sa, (size_t) len) != 0) {
+				e(2);
+				return;
+			}
+			for (i = 0; i < da; i++)
+				if (dst.b[i] != GUARD) e(3);
+			for (i = da + len; i < sizeof(dst.b); i++)
+				if (dst.b[i] != GUARD) e(4);
+		}
+	}
+  }
+}
+
+void test49c()
+{
+/* Speed over the usual packet sizes.  Without -t only one round is done,
+ * as another check that the three ways agree.
+ */
+  struct tms tms;
+  clock_t t0, t1, t2, t3;
+  int i, n, loops;
+  unsigned s1, s2, s3;
+
+  subtest = 3;
+  loops = timing ? LOOPS : 1;
+  if (timing) printf("\n  size     sum KB/s  copysum KB/s  cpy+sum KB/s");
+  for (i = 0; i < NSIZES; i++) {
+	s1 = s2 = s3 = 0;
+	t0 = times(&tms);
+	for (n = 0; n < loops; n++)
+		s1 = oneC_sum(0, src.b, (size_t) sizes[i]);
+	t1 = times(&tms);
+	for (n = 0; n < loops; n++)
+		s2 = oneC_copysum(0, dst.b, src.b, (size_t) sizes[i]);
+	t2 = times(&tms);
+	for (n = 0; n < loops; n++) {
+		memcpy(dst.b, src.b, (size_t) sizes[i]);
+		s3 = oneC_sum(0, dst.b, (size_t) sizes[i]);
+	}
+	t3 = times(&tms);
+	if (s1 != s2 || s1 != s3) e(1);
+
+	if (timing) {
+		printf("\n  %4d", sizes[i]);
+		printf(" %12ld", t1 > t0 ? (long) sizes[i] * loops / 1024
+					* CLK_TCK / (long) (t1 - t0) : 0L);
+		printf(" %13ld", t2 > t1 ? (long) sizes[i] * loops / 1024
+					* CLK_TCK / (long) (t2 - t1) : 0L);
+		printf(" %13ld", t3 > t2 ? (long) sizes[i] * loops / 1024
+					* CLK_TCK / (long) (t3 - t2) : 0L);
+	}
+  }
+}
+
+unsigned slowsum(prev, data, len)
+unsigned prev;
+u8_t *data;
+int len;
+{
+/* The checksum one byte at a time.  The data is taken to start on a word
+ * boundary whatever its address, as oneC_sum() does.
+ */
+  union {
+	u16_t w;
+	u8_t b[2];
+  } word;
+  u32_t sum;
+  int i;
+
+  sum = prev;
+  for (i = 0; i < len; i += 2) {
+	word.b[0] = data[i];
+	word.b[1] = i + 1 < len ? data[i + 1] : 0;
+	sum += word.w;
+  }
+  while (sum > 0xFFFF) sum = (sum & 0xFFFF) + (sum >> 16);
+  return((unsigned) sum);
+}
+
+int same(a, b)
+unsigned a, b;
+{
+/* Equal as one's complement numbers; 0 and 0xFFFF are both zero. */
+  if (a == 0xFFFF) a = 0;
+  if (b == 0xFFFF) b = 0;
+  return(a == b);
+}
+
+void e(n)
+int n;
+{
+  int err_num = errno;		/* Save in case printf clobbers it. */
+
+  printf("Subtest %d,  error %d  errno=%d: ", subtest, n, errno);
+  errno = err_num;
+  perror("");
+  if (errct++ > MAX_ERROR) {
+	printf("Too many errors; test aborted\n");
+	exit(1);
+  }
+  errno = 0;
+}
+
+void quit()
+{
+  if (timing) printf("\n");
+  if (errct == 0) {
+	printf("ok\n");
+	exit(0);
+  } else {
+	printf("%d errors\n", errct);
+	exit(1);
+  }
+}
@@ -0,0 +1,265 @@
+/* test50: many TCP connections on the loopback */
+
+/* A few children listen on a TCP port of this machine and echo what they
+ * get.  A connection is used to bounce single bytes back and forth, then
+ * a long series of connections is opened and closed, each of which stays
+ * behind in the connection table for a while, and the bouncing is done
+ * again.  Finding the connection for a packet should not get slower when
+ * the table is full.  With -t 5000 connections are made and the time per
+ * round trip is printed, otherwise the run is short.  Making connections
+ * stops without complaint when inet runs out of table entries; see the
+ * "tcp" line in /etc/inet.conf.
+ */
+
+#include <sys/types.h>
+#include <sys/ioctl.h>
+#include <sys/times.h>
+#include <sys/wait.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <net/hton.h>
+#include <net/gen/in.h>
+#include <net/gen/tcp.h>
+#include <net/gen/tcp_io.h>
+
+#define MAX_ERROR	4
+#define PORT	     4800	/* TCP port listened on */
+#define NSERVER		4	/* listening children */
+#define NCONN	      200	/* connections made, 5000 with -t */
+#define NROUND	      100	/* round trips timed, 1000 with -t */
+#define MINCONN	       10	/* connections that must always work */
+
+int errct = 0;
+int subtest = 1;
+int timing = 0;
+int nconn = NCONN;
+int nround = NROUND;
+ipaddr_t myaddr;
+pid_t server[NSERVER];
+
+_PROTOTYPE(int main, (int argc, char *argv[]));
+_PROTOTYPE(int getaddr, (void));
+_PROTOTYPE(void serve, (void));
+_PROTOTYPE(int tcpconnect, (void));
+_PROTOTYPE(void test50a, (void));
+_PROTOTYPE(void test50b, (void));
+_PROTOTYPE(void test50c, (void));
+_PROTOTYPE(void bounce, (char *what));
+_PROTOTYPE(void e, (int n));
+_PROTOTYPE(void quit, (void));
+
+int main(argc, argv)
+int argc;
+char *argv[];
+{
+  int i, m = 0xFFFF;
+
+  if (argc > 1 && strcmp(argv[1], "-t") == 0) {
+	timing = 1;
+	nconn = 5000;
+	nround = 1000;
+	argc--;
+	argv++;
+  }
+  if (argc == 2) m = atoi(argv[1]);
+  printf("Test 50 ");
+  fflush(stdout);		/* have to flush for child's benefit */
+
+  if (!getaddr()) {
+	printf("(no network) ");
+	quit();
+  }
+  for (i = 0; i < NSERVER; i++) {
+	switch (server[i] = fork()) {
+	case -1:
+		e(1);
+		quit();
+	case 0:
+		serve();
+		exit(1);		/* impossible */
+	}
+  }
+
+  if (m & 0001) test50a();
+  if (m & 0002) test50b();
+  if (m & 0004) test50c();
+  quit();
+  return(-1);			/* impossible */
+}
+
+int getaddr()
+{
+/* Find the address of this machine on the default network. */
+  struct nwio_tcpconf tcpconf;
+  int fd, r;
+
+  if ((fd = open("/dev/tcp", O_RDWR)) < 0) return(0);
+  r = ioctl(fd, NWIOGTCPCONF, &tcpconf);
+  close(fd);
+  if (r < 0) return(0);
+  myaddr = tcpconf.nwtc_locaddr;
+  return(1);
+}
+
+void serve()
+{
+/* Accept a connection, echo everything, and do it again. */
+  struct nwio_tcpconf tcpconf;
+  struct nwio_tcpcl tcpcl;
+  char buf[64];
+  int fd, n;
+
+  for (;;) {
+	if ((fd = open("/dev/tcp", O_RDWR)) < 0) exit(1);
+	tcpconf.nwtc_flags = NWTC_SHARED | NWTC_LP_SET | NWTC_UNSET_RA
+							| NWTC_UNSET_RP;
+	tcpconf.nwtc_locport = htons(PORT);
+	if (ioctl(fd, NWIOSTCPCONF, &tcpconf) < 0) exit(2);
+	tcpcl.nwtcl_flags = 0;
+	if (ioctl(fd, NWIOTCPLISTEN, &tcpcl) < 0) exit(3);
+	while ((n = read(fd, buf, sizeof(buf))) > 0) {
+		if (write(fd, buf, n) != n) break;
+	}
+	close(fd);
+  }
+}
+
+int tcpconnect()
+{
+/* Connect to one of the servers.  Return the channel, -1 if inet has no
+ * room for another connection, or -2 on error.
+ */
+  struct nwio_tcpconf tcpconf;
+  struct nwio_tcpcl tcpcl;
+  int fd, tries;
+
+  for (tries = 0; tries < 10; tries++) {
+	if ((fd = open("/dev/tcp", O_RDWR)) < 0)
+		return(errno == EAGAIN || errno == ENFILE ? -1 : -2);
+	tcpconf.nwtc_flags = NWTC_EXCL | NWTC_LP_SEL | NWTC_SET_RA
+							| NWTC_SET_RP;
+	tcpconf.nwtc_remaddr = myaddr;
+	tcpconf.nwtc_remport = htons(PORT);
+	if (ioctl(fd, NWIOSTCPCONF, &tcpconf) < 0) {
+		close(fd);
+		return(-2);
+	}
+	tcpcl.nwtcl_flags = 0;
+	if (ioctl(fd, NWIOTCPCONN, &tcpcl) == 0) return(fd);
+	close(fd);
+	if (errno == EAGAIN) return(-1);
+	if (errno != ECONNREFUSED) return(-2);
+	sleep(1);		/* no server listening yet */
+  }
+  return(-2);
+}
+
+void test50a()
+{
+/* Round trips with next to nothing in the connection table. */
+  subtest = 1;
+  bounce("empty");
+}
+
+void test50b()
+{
+/* Make lots of short connections. */
+  char c;
+  int i, fd;
+
+  subtest = 2;
+  for (i = 0; i < nconn; i++) {
+	if ((fd = tcpconnect()) < 0) {
+		if (fd == -2 || i < MINCONN) e(1);
+		break;
+	}
+	c = i;
+	if (write(fd, &c, 1) != 1) e(2);
+	if (read(fd, &c, 1) != 1 || c != (char) i) e(3);
+	close(fd);
+	if (errct > 0) break;
+  }
+  if (timing) printf("\n  %d connections made", i);
+}
+
+void test50c()
+{
+/* Round trips with the old connections still in the table. */
+  subtest = 3;
+  bounce("full");
+}
+
+void bounce(what)
+char *what;
+{
+/* Send single bytes back and forth over one connection. */
+  struct tms tms;
+  clock_t t0, t;
+  char c;
+  int i, fd;
+
+  if ((fd = tcpconnect()) < 0) {
+	e(1);
+	return;
+  }
+  t0 = times(&tms);
+  for (i = 0; i < nround; i++) {
+	c = i;
+	if (write(fd, &c, 1) != 1) {
+		e(2);
+		break;
+	}
+	if (read(fd, &c, 1) != 1 || c != (char) i) {
+		e(3);
+		break;
+	}
+  }
+  t = times(&tms) - t0;
+  close(fd);
+
+  if (timing) {
+	printf("\n  %-6s %ld us per round trip", what,
+		(long) t * (1000000L / CLK_TCK) / nround);
+  }
+}
+
+void e(n)
+int n;
+{
+  int err_num = errno;		/* Save in case printf clobbers it. */
+
+  printf("Subtest %d,  error %d  errno=%d: ", subtest, n, errno);
+  errno = err_num;
+  perror("");
+  if (errct++ > MAX_ERROR) {
+	printf("Too many errors; test aborted\n");
+	quit();
+  }
+  errno = 0;
+}
+
+void quit()
+{
+  int i;
+
+  for (i = 0; i < NSERVER; i++) {
+	if (server[i] > 0) {
+		kill(server[i], SIGKILL);
+		(void) waitpid(server[i], (int *) 0, 0);
+	}
+  }
+  if (timing) printf("\n");
+  if (errct == 0) {
+	printf("ok\n");
+	exit(0);
+  } else {
+	printf("%d errors\n", errct);
+	exit(1);
+  }
+}
@@ -0,0 +1,339 @@
+/* test51: input routes and forwarding through a pseudo IP link */
+
+/* Packets are written into a psip interface as if they came from a host on
+ * the psip network, addressed to networks that only have input routes
+ * pointing back at that host.  Inet forwards them out of the same
+ * interface, where they are read back; a destination without a usable
+ * route gets an ICMP unreachable instead.  Nested routes, some of them
+ * unreachable, check that the longest prefix wins and that adding and
+ * deleting routes is noticed at once.  Then a long series of routes is
+ * added and packets are forwarded to all of them.  With -t 10000 routes
+ * are used and the time per forwarded packet is printed, once with a
+ * single route and once with the full table.  Adding routes stops without
+ * complaint when inet runs out of table entries; see the "route" line in
+ * /etc/inet.conf.  The test is skipped if there is no psip interface with
+ * an address; it needs to run as root.
+ */
+
+#include <sys/types.h>
+#include <sys/ioctl.h>
+#include <sys/times.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <net/hton.h>
+#include <net/gen/in.h>
+#include <net/gen/ip_hdr.h>
+#include <net/gen/ip_io.h>
+#include <net/gen/oneCsum.h>
+#include <net/gen/route.h>
+
+#define MAX_ERROR	4
+#define NROUTE	      200	/* routes added, 10000 with -t */
+#define MINROUTE       50	/* routes that must always fit */
+#define NPACK	      200	/* packets timed, 2000 with -t */
+#define PACKMAX	     1024	/* largest packet read back */
+#define TTL		16	/* ttl of the packets sent */
+
+#define FWD		1	/* packet came back forwarded */
+#define UNRCH		2	/* an ICMP unreachable came back */
+#define NONE		3	/* nothing came back */
+
+int errct = 0;
+int subtest = 1;
+int timing = 0;
+int nroute = NROUTE;
+int npack = NPACK;
+int psipfd = -1;
+int ipfd = -1;
+ipaddr_t myaddr, peer;
+u32_t base;			/* network the routes are made up in */
+u16_t pack_id;
+
+_PROTOTYPE(int main, (int argc, char *argv[]));
+_PROTOTYPE(int findpsip, (void));
+_PROTOTYPE(void catch, (int sig));
+_PROTOTYPE(int route, (int request, u32_t dest, int len, int unrch));
+_PROTOTYPE(int probe, (u32_t dest));
+_PROTOTYPE(void test51a, (void));
+_PROTOTYPE(void test51b, (void));
+_PROTOTYPE(long forward, (int n, int nroutes));
+_PROTOTYPE(void e, (int n));
+_PROTOTYPE(void quit, (void));
+
+int main(argc, argv)
+int argc;
+char *argv[];
+{
+  int m = 0xFFFF;
+
+  if (argc > 1 && strcmp(argv[1], "-t") == 0) {
+	timing = 1;
+	nroute = 10000;
+	npack = 2000;
+	argc--;
+	argv++;
+  }
+  if (argc == 2) m = atoi(argv[1]);
+  printf("Test 51 ");
+  fflush(stdout);
+
+  if (!findpsip()) {
+	printf("(no psip interface) ");
+	quit();
+  }
+
+  if (m & 0001) test51a();
+  if (m & 0002) test51b();
+  quit();
+  return(-1);			/* impossible */
+}
+
+int findpsip()
+{
+/* Find a psip interface with an address, pick a host on its network to
+ * send from, and a class A network elsewhere to make up routes in.
+ */
+  struct nwio_ipconf ipconf;
+  char ipdev[sizeof("/dev/ip99")];
+  ipaddr_t host;
+  int i, r;
+
+  signal(SIGALRM, catch);
+  for (i = 0; i < 16; i++) {
+	sprintf(ipdev, "/dev/psip%d", i);
+	if ((psipfd = open(ipdev, O_RDWR)) < 0) continue;
+	sprintf(ipdev, "/dev/ip%d", i);
+	if ((ipfd = open(ipdev, O_RDWR)) >= 0) {
+		alarm(2);	/* NWIOGIPCONF waits for an address */
+		r = ioctl(ipfd, NWIOGIPCONF, &ipconf);
+		alarm(0);
+		if (r == 0) {
+			myaddr = ipconf.nwic_ipaddr;
+			host = ntohl(myaddr & ~ipconf.nwic_netmask);
+			host = (host == 1) ? 2 : 1;
+			peer = (myaddr & ipconf.nwic_netmask) | htonl(host);
+			base = (ntohl(myaddr) >> 24) == 10 ? 0x0B000000L
+							: 0x0A000000L;
+			if (peer != myaddr
+				&& (peer | ipconf.nwic_netmask) != (ipaddr_t) -1)
+				return(1);
+		}
+		close(ipfd);
+	}
+	close(psipfd);
+  }
+  return(0);
+}
+
+void catch(sig)
+int sig;
+{
+  signal(sig, catch);
+}
+
+int route(request, dest, len, unrch)
+int request;
+u32_t dest;
+int len, unrch;
+{
+/* Add or delete an input route to 'dest'/'len' through the peer. */
+  nwio_route_t route;
+
+  route.nwr_dest = htonl(dest);
+  route.nwr_netmask = htonl(len == 0 ? 0L : 0xFFFFFFFFL << (32 - len));
+  route.nwr_gateway = peer;
+  route.nwr_dist = 1;
+  route.nwr_flags = NWRF_STATIC | (unrch ? NWRF_UNREACHABLE : 0);
+  route.nwr_pref = 0;
+  return(ioctl(ipfd, request, &route));
+}
+
+int probe(dest)
+u32_t dest;
+{
+/* Send a packet from the peer to 'dest', and see what comes back. */
+  static union {
+	u32_t align;
+	char b[PACKMAX];
+  } pack;
+  ip_hdr_t *ip_hdr, *old_hdr;
+  int n;
+
+  ip_hdr = (ip_hdr_t *) pack.b;
+  memset(pack.b, 0, sizeof(ip_hdr_t) + 8);
+  ip_hdr->ih_vers_ihl = 0x45;
+  ip_hdr->ih_length = htons(sizeof(ip_hdr_t) + 8);
+  ip_hdr->ih_id = htons(pack_id++);
+  ip_hdr->ih_ttl = TTL;
+  ip_hdr->ih_proto = 17;
+  ip_hdr->ih_src = peer;
+  ip_hdr->ih_dst = htonl(dest);
+  ip_hdr->ih_hdr_chk = ~oneC_sum(0, (u16_t *) ip_hdr, sizeof(ip_hdr_t));
+  if (write(psipfd, pack.b, sizeof(ip_hdr_t) + 8) < 0) {
+	e(90);
+	return(NONE);
+  }
+
+  /* Skip anything else, like the redirects sent to the peer. */
+  for (;;) {
+	alarm(2);
+	n = read(psipfd, pack.b, sizeof(pack.b));
+	alarm(0);
+	if (n < 0) return(NONE);
+	if (n < sizeof(ip_hdr_t)) continue;
+	if (ip_hdr->ih_proto == 17 && ip_hdr->ih_dst == htonl(dest)) {
+		if (ip_hdr->ih_ttl != TTL - 1) e(91);
+		return(FWD);
+	}
+	if (ip_hdr->ih_proto == 1 && ip_hdr->ih_dst == peer
+				&& n >= 2 * sizeof(ip_hdr_t) + 8
+				&& (pack.b[sizeof(ip_hdr_t)] & 0xFF) == 3) {
+		old_hdr = (ip_hdr_t *) (pack.b + sizeof(ip_hdr_t) + 8);
+		if (old_hdr->ih_dst == htonl(dest)) return(UNRCH);
+	}
+  }
+}
+
+void test51a()
+{
+/* Nested routes, the most specific one decides. */
+  nwio_route_t badroute;
+
+  subtest = 1;
+  if (route(NWIOSIPIROUTE, base, 8, 0) < 0) e(1);
+  if (route(NWIOSIPIROUTE, base | 0x050000L, 16, 1) < 0) e(2);
+  if (route(NWIOSIPIROUTE, base | 0x050700L, 24, 0) < 0) e(3);
+  if (route(NWIOSIPIROUTE, base | 0x050780L, 25, 1) < 0) e(4);
+  if (route(NWIOSIPIROUTE, base | 0x0507C8L, 32, 0) < 0) e(5);
+
+  if (probe(base | 0x010101L) != FWD) e(6);
+  if (probe(base | 0x050101L) != UNRCH) e(7);
+  if (probe(base | 0x050701L) != FWD) e(8);
+  if (probe(base | 0x050782L) != UNRCH) e(9);
+  if (probe(base | 0x0507C8L) != FWD) e(10);
+  if (probe(base | 0x0507C9L) != UNRCH) e(11);
+
+  /* Take routes away, the next shorter one takes over. */
+  if (route(NWIODIPIROUTE, base | 0x050700L, 24, 0) < 0) e(12);
+  if (probe(base | 0x050701L) != UNRCH) e(13);
+  if (probe(base | 0x0507C8L) != FWD) e(14);
+  if (route(NWIODIPIROUTE, base | 0x050000L, 16, 1) < 0) e(15);
+  if (probe(base | 0x050701L) != FWD) e(16);
+  if (probe(base | 0x050101L) != FWD) e(17);
+
+  /* Routes that are not there, and netmasks that make no prefix. */
+  if (route(NWIODIPIROUTE, base | 0x050000L, 16, 1) != -1 || errno != ESRCH)
+	e(18);
+  badroute.nwr_dest = htonl(base);
+  badroute.nwr_netmask = htonl(0xFF00FF00L);
+  badroute.nwr_gateway = peer;
+  badroute.nwr_dist = 1;
+  badroute.nwr_flags = NWRF_STATIC;
+  badroute.nwr_pref = 0;
+  if (ioctl(ipfd, NWIOSIPIROUTE, &badroute) != -1 || errno != EINVAL) e(19);
+
+  if (route(NWIODIPIROUTE, base | 0x050780L, 25, 1) < 0) e(20);
+  if (route(NWIODIPIROUTE, base | 0x0507C8L, 32, 0) < 0) e(21);
+  if (route(NWIODIPIROUTE, base, 8, 0) < 0) e(22);
+  if (probe(base | 0x010101L) != UNRCH) e(23);
+}
+
+void test51b()
+{
+/* Many routes, and forwarding to every one of them. */
+  struct tms tms;
+  clock_t t0, t;
+  long t1, tn;
+  int i, n;
+
+  subtest = 2;
+  if (route(NWIOSIPIROUTE, base, 8, 0) < 0) e(1);
+  t1 = forward(npack, 1);
+  if (route(NWIODIPIROUTE, base, 8, 0) < 0) e(2);
+
+  t0 = times(&tms);
+  for (n = 0; n < nroute; n++) {
+	if (route(NWIOSIPIROUTE, base | ((u32_t) n << 8), 24, 0) < 0) {
+		if (errno != ENOMEM || n < MINROUTE) e(3);
+		break;
+	}
+  }
+  t = times(&tms) - t0;
+  if (timing) {
+	printf("\n  %d routes added in %ld ms", n,
+		(long) t * 1000 / CLK_TCK);
+  }
+
+  /* Just past the last route there is nothing. */
+  if (probe(base | ((u32_t) n << 8) | 1) != UNRCH) e(4);
+  tn = n > 0 ? forward(npack, n) : 0L;
+
+  for (i = 0; i < n; i++) {
+	if (route(NWIODIPIROUTE, base | ((u32_t) i << 8), 24, 0) < 0) {
+		e(5);
+		break;
+	}
+  }
+  if (probe(base | 1) != UNRCH) e(6);
+
+  if (timing) {
+	printf("\n  %-12s %ld us per packet", "one route", t1);
+	printf("\n  %-12s %ld us per packet", "full table", tn);
+  }
+}
+
+long forward(n, nroutes)
+int n, nroutes;
+{
+/* Send 'n' packets spread over the first 'nroutes' /24 networks, so the
+ * route caches rarely help.  Return the time per packet in microseconds.
+ */
+  struct tms tms;
+  clock_t t0, t;
+  u32_t dest;
+  int i;
+
+  t0 = times(&tms);
+  for (i = 0; i < n; i++) {
+	dest = base | ((u32_t) ((i * 7L) % nroutes) << 8) | (i % 254 + 1);
+	if (probe(dest) != FWD) {
+		e(80);
+		break;
+	}
+  }
+  t = times(&tms) - t0;
+  return((long) t * (1000000L / CLK_TCK) / n);
+}
+
+void e(n)
+int n;
+{
+  int err_num = errno;		/* Save in case printf clobbers it. */
+
+  printf("Subtest %d,  error %d  errno=%d: ", subtest, n, errno);
+  errno = err_num;
+  perror("");
+  if (errct++ > MAX_ERROR) {
+	printf("Too many errors; test aborted\n");
+	exit(1);
+  }
+  errno = 0;
+}
+
+void quit()
+{
+  if (timing) printf("\n");
+  if (errct == 0) {
+	printf("ok\n");
+	exit(0);
+  } else {
+	printf("%d errors\n", errct);
+	exit(1);
+  }
+}
@@ -0,0 +1,377 @@
+/* test52: the ARP cache with many hosts on an ethernet */
+
+/* The hosts are made up.  Their ARP packets are written to the ethernet
+ * channel with this machine's own ethernet address as destination, so
+ * the ethernet layer loops them back in as if they came from the wire,
+ * and everything inet sends to the hosts comes back the same way, as
+ * they all have this machine's ethernet address.  To keep clear of real
+ * hosts, the netmask is widened for the duration of the test and the
+ * hosts are given addresses that used to be off the network.
+ *
+ * 1000 hosts announce themselves with an ARP request, which must be
+ * answered.  Then an IP packet is sent to each, most recent host first,
+ * and must come back without another ARP request.  Only as many as the
+ * cache holds can make it, see the "arp" line in /etc/inet.conf.  Last a
+ * number of addresses that are not known yet get several packets each,
+ * and the replies are given out of order; every packet must come out.
+ * With -t the time per packet is printed.  Refreshing entries before they
+ * expire takes too long to check here.  The test is skipped if there is
+ * no ethernet with an address; it needs to run as root.
+ */
+
+#include <sys/types.h>
+#include <sys/ioctl.h>
+#include <sys/times.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <net/hton.h>
+#include <net/gen/in.h>
+#include <net/gen/ether.h>
+#include <net/gen/eth_hdr.h>
+#include <net/gen/eth_io.h>
+#include <net/gen/ip_hdr.h>
+#include <net/gen/ip_io.h>
+
+#define MAX_ERROR	4
+#define NHOST	     1000	/* hosts that announce themselves */
+#define MINHOST	       50	/* hosts that must always fit */
+#define BATCH	       50	/* packets sent before reading back */
+#define NWAIT	       16	/* addresses looked up at the same time */
+#define NQUEUE		4	/* packets sent to each of them */
+
+#define A_OP		(ETH_HDR_SIZE + 6)	/* offsets in an ARP packet */
+#define A_SHA		(ETH_HDR_SIZE + 8)
+#define A_SPA		(ETH_HDR_SIZE + 14)
+#define A_THA		(ETH_HDR_SIZE + 18)
+#define A_TPA		(ETH_HDR_SIZE + 24)
+
+int errct = 0;
+int subtest = 1;
+int timing = 0;
+int ethfd = -1;
+int ipfd = -1;
+int widened = 0;
+ipaddr_t myaddr, mynetmask;
+ether_addr_t myeth;
+u32_t hostbase;			/* host i is hostbase + i */
+char seen[NHOST + NWAIT + 1];
+
+union {
+  u32_t align;
+  u8_t b[ETH_MAX_PACK_SIZE];
+} frame;
+
+_PROTOTYPE(int main, (int argc, char *argv[]));
+_PROTOTYPE(int findeth, (void));
+_PROTOTYPE(int widen, (void));
+_PROTOTYPE(void catch, (int sig));
+_PROTOTYPE(ipaddr_t host, (int i));
+_PROTOTYPE(int sendarp, (int op, int i));
+_PROTOTYPE(int sendip, (int i));
+_PROTOTYPE(int readback, (int first, int n, int per, int secs));
+_PROTOTYPE(void test52a, (void));
+_PROTOTYPE(void test52b, (void));
+_PROTOTYPE(void test52c, (void));
+_PROTOTYPE(void e, (int n));
+_PROTOTYPE(void quit, (void));
+
+int main(argc, argv)
+int argc;
+char *argv[];
+{
+  int m = 0xFFFF;
+
+  if (argc > 1 && strcmp(argv[1], "-t") == 0) {
+	timing = 1;
+	argc--;
+	argv++;
+  }
+  if (argc == 2) m = atoi(argv[1]);
+  printf("Test 52 ");
+  fflush(stdout);
+
+  if (!findeth()) {
+	printf("(no ethernet) ");
+	quit();
+  }
+  if (!widen()) {
+	e(1);
+	quit();
+  }
+
+  if (m & 0001) test52a();
+  if (m & 0002) test52b();
+  if (m & 0004) test52c();
+  quit();
+  return(-1);			/* impossible */
+}
+
+int findeth()
+{
+/* Find an ethernet with an IP address, and set up a channel that sees
+ * every packet sent to this machine's ethernet address.
+ */
+  struct nwio_ethstat ethstat;
+  struct nwio_ethopt ethopt;
+  struct nwio_ipconf ipconf;
+  struct nwio_ipopt ipopt;
+  char dev[sizeof("/dev/eth99")];
+  int i, r;
+
+  signal(SIGALRM, catch);
+  for (i = 0; i < 16; i++) {
+	sprintf(dev, "/dev/eth%d", i);
+	if ((ethfd = open(dev, O_RDWR)) < 0) continue;
+	sprintf(dev, "/dev/ip%d", i);
+	if (ioctl(ethfd, NWIOGETHSTAT, &ethstat) == 0
+			&& (ipfd = open(dev, O_RDWR)) >= 0) {
+		alarm(2);	/* NWIOGIPCONF waits for an address */
+		r = ioctl(ipfd, NWIOGIPCONF, &ipconf);
+		alarm(0);
+		if (r == 0) break;
+		close(ipfd);
+	}
+	close(ethfd);
+  }
+  if (i == 16) return(0);
+  myaddr = ipconf.nwic_ipaddr;
+  mynetmask = ipconf.nwic_netmask;
+  myeth = ethstat.nwes_addr;
+
+  ethopt.nweo_flags = NWEO_COPY | NWEO_EN_LOC | NWEO_DI_BROAD
+		| NWEO_DI_MULTI | NWEO_DI_PROMISC | NWEO_REMANY
+		| NWEO_TYPEANY | NWEO_RWDATALL;
+  if (ioctl(ethfd, NWIOSETHOPT, &ethopt) < 0) return(0);
+
+  ipopt.nwio_flags = NWIO_COPY | NWIO_EN_LOC | NWIO_DI_BROAD
+		| NWIO_REMANY | NWIO_PROTOSPEC | NWIO_HDR_O_SPEC
+		| NWIO_RWDATALL;
+  ipopt.nwio_tos = 0;
+  ipopt.nwio_ttl = 1;		/* no further than the first hop */
+  ipopt.nwio_df = 0;
+  ipopt.nwio_hdropt.iho_opt_siz = 0;
+  ipopt.nwio_proto = IPPROTO_ICMP;
+  if (ioctl(ipfd, NWIOSIPOPT, &ipopt) < 0) return(0);
+  return(1);
+}
+
+int widen()
+{
+/* Make the network twice as large as it is, but at least 4096 addresses,
+ * and put the hosts in the new half.
+ */
+  struct nwio_ipconf ipconf;
+  u32_t mask, half;
+
+  mask = ntohl(mynetmask);
+  if ((mask & 0xC0000000L) != 0xC0000000L) return(0);
+  mask = (mask << 1) & 0xFFFFF000L;
+  half = (~mask + 1) >> 1;
+  hostbase = ((ntohl(myaddr) & mask) | ((ntohl(myaddr) & half) ^ half));
+
+  ipconf.nwic_flags = NWIC_NETMASK_SET;
+  ipconf.nwic_netmask = htonl(mask);
+  if (ioctl(ipfd, NWIOSIPCONF, &ipconf) < 0) return(0);
+  widened = 1;
+  return(1);
+}
+
+void catch(sig)
+int sig;
+{
+  signal(sig, catch);
+}
+
+ipaddr_t host(i)
+int i;
+{
+  return(htonl(hostbase + i));
+}
+
+int sendarp(op, i)
+int op, i;
+{
+/* Let host 'i' send an ARP packet to this machine. */
+  eth_hdr_t *eth_hdr;
+  ipaddr_t spa;
+
+  memset(frame.b, 0, ETH_MIN_PACK_SIZE);
+  eth_hdr = (eth_hdr_t *) frame.b;
+  eth_hdr->eh_dst = myeth;
+  eth_hdr->eh_src = myeth;
+  eth_hdr->eh_proto = htons(ETH_ARP_PROTO);
+  frame.b[ETH_HDR_SIZE + 1] = 1;		/* ethernet */
+  frame.b[ETH_HDR_SIZE + 2] = ETH_IP_PROTO >> 8;
+  frame.b[ETH_HDR_SIZE + 3] = ETH_IP_PROTO & 0xFF;
+  frame.b[ETH_HDR_SIZE + 4] = 6;
+  frame.b[ETH_HDR_SIZE + 5] = 4;
+  frame.b[A_OP + 1] = op;
+  memcpy(frame.b + A_SHA, &myeth, 6);
+  spa = host(i);
+  memcpy(frame.b + A_SPA, &spa, 4);
+  if (op == 2) memcpy(frame.b + A_THA, &myeth, 6);
+  memcpy(frame.b + A_TPA, &myaddr, 4);
+  return(write(ethfd, frame.b, ETH_MIN_PACK_SIZE) == ETH_MIN_PACK_SIZE);
+}
+
+int sendip(i)
+int i;
+{
+/* Send an IP packet to host 'i'. */
+  static union {
+	u32_t align;
+	u8_t b[sizeof(ip_hdr_t) + 8];
+  } pack;
+  ip_hdr_t *ip_hdr;
+
+  memset(pack.b, 0, sizeof(pack.b));
+  ip_hdr = (ip_hdr_t *) pack.b;
+  ip_hdr->ih_dst = host(i);
+  pack.b[sizeof(ip_hdr_t)] = 8;		/* an ICMP echo request */
+  return(write(ipfd, pack.b, sizeof(pack.b)) == sizeof(pack.b));
+}
+
+int readback(first, n, per, secs)
+int first, n, per, secs;
+{
+/* Read what comes back to hosts 'first' up to 'first + n', until each got
+ * 'per' packets or nothing comes for 'secs' seconds.  Return how many
+ * packets came.
+ */
+  eth_hdr_t *eth_hdr;
+  ipaddr_t dst;
+  u32_t d;
+  int r, i, got;
+
+  for (i = first; i < first + n; i++) seen[i] = 0;
+  eth_hdr = (eth_hdr_t *) frame.b;
+  got = 0;
+  while (got < n * per) {
+	alarm(secs);
+	r = read(ethfd, frame.b, sizeof(frame.b));
+	alarm(0);
+	if (r < 0) break;
+	if (eth_hdr->eh_proto == htons(ETH_ARP_PROTO)) {
+		if (r < A_TPA + 4 || frame.b[A_OP + 1] != 2) continue;
+		memcpy(&dst, frame.b + A_TPA, 4);
+	} else
+	if (eth_hdr->eh_proto == htons(ETH_IP_PROTO)) {
+		if (r < ETH_HDR_SIZE + sizeof(ip_hdr_t)) continue;
+		dst = ((ip_hdr_t *) (frame.b + ETH_HDR_SIZE))->ih_dst;
+	} else
+		continue;
+	d = ntohl(dst) - hostbase;
+	if (d < first || d >= first + n) continue;
+	i = (int) d;
+	if (seen[i] == per) continue;
+	seen[i]++;
+	got++;
+  }
+  return(got);
+}
+
+void test52a()
+{
+/* Hosts announce themselves, each gets an answer. */
+  int i;
+
+  subtest = 1;
+  for (i = 1; i <= NHOST; i++) {
+	if (!sendarp(1, i)) {
+		e(1);
+		return;
+	}
+	if (readback(i, 1, 1, 2) != 1) {
+		e(2);
+		return;
+	}
+  }
+}
+
+void test52b()
+{
+/* Packets for hosts in the cache go straight out. */
+  struct tms tms;
+  clock_t t0, t;
+  int i, j, n, r, got, timed;
+
+  subtest = 2;
+  got = timed = 0;
+  t = 0;
+  for (i = NHOST; i > 0; i -= n) {
+	n = i < BATCH ? i : BATCH;
+	t0 = times(&tms);
+	for (j = i; j > i - n; j--) {
+		if (!sendip(j)) e(1);
+	}
+	r = readback(i - n + 1, n, 1, 1);
+	got += r;
+	if (r < n) break;		/* past what the cache holds */
+	t += times(&tms) - t0;
+	timed += n;
+  }
+  if (got < MINHOST) e(2);
+
+  if (timing) {
+	printf("\n  %d of %d hosts cached, %ld us per packet", got, NHOST,
+		timed > 0 ? (long) t * (1000000L / CLK_TCK) / timed : 0L);
+  }
+}
+
+void test52c()
+{
+/* Several addresses looked up at once, each with packets waiting. */
+  int i, j;
+
+  subtest = 3;
+  for (i = 1; i <= NWAIT; i++) {
+	for (j = 0; j < NQUEUE; j++) {
+		if (!sendip(NHOST + i)) e(1);
+	}
+  }
+  for (i = NWAIT; i > 0; i--) {
+	if (!sendarp(2, NHOST + i)) e(2);
+  }
+  if (readback(NHOST + 1, NWAIT, NQUEUE, 2) != NWAIT * NQUEUE) e(3);
+}
+
+void e(n)
+int n;
+{
+  int err_num = errno;		/* Save in case printf clobbers it. */
+
+  printf("Subtest %d,  error %d  errno=%d: ", subtest, n, errno);
+  errno = err_num;
+  perror("");
+  if (errct++ > MAX_ERROR) {
+	printf("Too many errors; test aborted\n");
+	quit();
+  }
+  errno = 0;
+}
+
+void quit()
+{
+  struct nwio_ipconf ipconf;
+
+  if (widened) {
+	widened = 0;
+	ipconf.nwic_flags = NWIC_NETMASK_SET;
+	ipconf.nwic_netmask = mynetmask;
+	if (ioctl(ipfd, NWIOSIPCONF, &ipconf) < 0) e(99);
+  }
+  if (timing) printf("\n");
+  if (errct == 0) {
+	printf("ok\n");
+	exit(0);
+  } else {
+	printf("%d errors\n", errct);
+	exit(1);
+  }
+}
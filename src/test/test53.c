@@ -0,0 +1,368 @@
+/* test53: IP reassembly */
+
+/* Fragments are written to the ethernet channel with this machine's own
+ * ethernet and IP address as destination, so the ethernet layer loops
+ * them back in as if they came from the wire.  The datagrams are read
+ * from an IP channel for a protocol nobody else uses, and the reassembly
+ * statistics of NWIOGIPSTAT are checked against what was sent.
+ *
+ * Several 8000 byte datagrams are sent at once, their fragments mixed up;
+ * as many as inet is configured to reassemble at the same time must come
+ * out, see the "reass" line in /etc/inet.conf.  Then a datagram is sent
+ * as overlapping fragments and duplicates.  Last more datagrams are begun
+ * than the table holds, which gives up on the oldest.  Those left over
+ * time out after a minute, that is not waited for.  The test is skipped
+ * if there is no ethernet with an address; it needs to run as root.
+ */
+
+#include <sys/types.h>
+#include <sys/ioctl.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <net/hton.h>
+#include <net/gen/in.h>
+#include <net/gen/ether.h>
+#include <net/gen/eth_hdr.h>
+#include <net/gen/eth_io.h>
+#include <net/gen/ip_hdr.h>
+#include <net/gen/ip_io.h>
+
+#define MAX_ERROR	4
+#define PROTO	      253	/* IP protocol used */
+#define DSIZE	     8000	/* datagram size, the NFS kind */
+#define FSIZE	     1480	/* fragment size, fills an ethernet packet */
+#define NFRAG	((DSIZE + FSIZE - 1) / FSIZE)
+#define NDGRAM		16	/* datagrams at once, at most */
+#define NEXTRA		4	/* datagrams more than the table holds */
+#define SSIZE		64	/* small datagram fragment size */
+
+int errct = 0;
+int subtest = 1;
+int ethfd = -1;
+int ipfd = -1;
+ipaddr_t myaddr, srcaddr;
+ether_addr_t myeth;
+u16_t nextid;
+nwio_ipstat_t ipstat0, ipstat;
+
+union {
+  u32_t align;
+  u8_t b[ETH_MAX_PACK_SIZE];
+} frame;
+
+union {
+  u32_t align;
+  u8_t b[IP_MAX_HDR_SIZE + DSIZE];
+} dgram;
+
+_PROTOTYPE(int main, (int argc, char *argv[]));
+_PROTOTYPE(int findeth, (void));
+_PROTOTYPE(void catch, (int sig));
+_PROTOTYPE(int getstat, (nwio_ipstat_t *stat));
+_PROTOTYPE(unsigned cksum, (u8_t *data, int len));
+_PROTOTYPE(int data, (int id, int off));
+_PROTOTYPE(int sendfrag, (int id, int off, int len, int more));
+_PROTOTYPE(int recvdgram, (int *idp));
+_PROTOTYPE(void test53a, (void));
+_PROTOTYPE(void test53b, (void));
+_PROTOTYPE(void test53c, (void));
+_PROTOTYPE(void e, (int n));
+_PROTOTYPE(void quit, (void));
+
+int main(argc, argv)
+int argc;
+char *argv[];
+{
+  int m = 0xFFFF;
+
+  if (argc == 2) m = atoi(argv[1]);
+  printf("Test 53 ");
+  fflush(stdout);
+
+  if (!findeth()) {
+	printf("(no ethernet) ");
+	quit();
+  }
+  if (!getstat(&ipstat0)) {
+	e(1);
+	quit();
+  }
+  srcaddr = htonl(0xC0000201L);	/* 192.0.2.1, a documentation address */
+  nextid = getpid();
+
+  if (m & 0001) test53a();
+  if (m & 0002) test53b();
+  if (m & 0004) test53c();
+  quit();
+  return(-1);			/* impossible */
+}
+
+int findeth()
+{
+/* Find an ethernet with an IP address, a channel to write fragments to it,
+ * and one to read the datagrams.
+ */
+  struct nwio_ethstat ethstat;
+  struct nwio_ethopt ethopt;
+  struct nwio_ipconf ipconf;
+  struct nwio_ipopt ipopt;
+  char dev[sizeof("/dev/eth99")];
+  int i, r;
+
+  signal(SIGALRM, catch);
+  for (i = 0; i < 16; i++) {
+	sprintf(dev, "/dev/eth%d", i);
+	if ((ethfd = open(dev, O_RDWR)) < 0) continue;
+	sprintf(dev, "/dev/ip%d", i);
+	if (ioctl(ethfd, NWIOGETHSTAT, &ethstat) == 0
+			&& (ipfd = open(dev, O_RDWR)) >= 0) {
+		alarm(2);	/* NWIOGIPCONF waits for an address */
+		r = ioctl(ipfd, NWIOGIPCONF, &ipconf);
+		alarm(0);
+		if (r == 0) break;
+		close(ipfd);
+	}
+	close(ethfd);
+  }
+  if (i == 16) return(0);
+  myaddr = ipconf.nwic_ipaddr;
+  myeth = ethstat.nwes_addr;
+
+  ethopt.nweo_flags = NWEO_COPY | NWEO_EN_LOC | NWEO_DI_BROAD
+		| NWEO_DI_MULTI | NWEO_DI_PROMISC | NWEO_REMANY
+		| NWEO_TYPESPEC | NWEO_RWDATALL;
+  ethopt.nweo_type = htons(ETH_IP_PROTO);
+  if (ioctl(ethfd, NWIOSETHOPT, &ethopt) < 0) return(0);
+
+  ipopt.nwio_flags = NWIO_COPY | NWIO_EN_LOC | NWIO_DI_BROAD
+		| NWIO_REMANY | NWIO_PROTOSPEC | NWIO_HDR_O_SPEC
+		| NWIO_RWDATALL;
+  ipopt.nwio_tos = 0;
+  ipopt.nwio_ttl = 1;
+  ipopt.nwio_df = 0;
+  ipopt.nwio_hdropt.iho_opt_siz = 0;
+  ipopt.nwio_proto = PROTO;
+  if (ioctl(ipfd, NWIOSIPOPT, &ipopt) < 0) return(0);
+  return(1);
+}
+
+void catch(sig)
+int sig;
+{
+  signal(sig, catch);
+}
+
+int getstat(stat)
+nwio_ipstat_t *stat;
+{
+  return(ioctl(ipfd, NWIOGIPSTAT, stat) == 0);
+}
+
+unsigned cksum(data, len)
+u8_t *data;
+int len;
+{
+/* The Internet checksum of an IP header. */
+  u32_t sum;
+  int i;
+
+  sum = 0;
+  for (i = 0; i < len; i += 2) sum += (data[i] << 8) | data[i + 1];
+  while (sum > 0xFFFF) sum = (sum & 0xFFFF) + (sum >> 16);
+  return((unsigned) ~sum & 0xFFFF);
+}
+
+int data(id, off)
+int id, off;
+{
+/* The byte at offset 'off' of datagram 'id'. */
+  return((id * 7 + off + (off >> 8)) & 0xFF);
+}
+
+int sendfrag(id, off, len, more)
+int id, off, len, more;
+{
+/* Send the fragment of datagram 'id' at offset 'off'. */
+  eth_hdr_t *eth_hdr;
+  ip_hdr_t *ip_hdr;
+  u8_t *p;
+  unsigned sum;
+  int i, size;
+
+  eth_hdr = (eth_hdr_t *) frame.b;
+  eth_hdr->eh_dst = myeth;
+  eth_hdr->eh_src = myeth;
+  eth_hdr->eh_proto = htons(ETH_IP_PROTO);
+
+  ip_hdr = (ip_hdr_t *) (frame.b + ETH_HDR_SIZE);
+  memset(ip_hdr, 0, IP_MIN_HDR_SIZE);
+  ip_hdr->ih_vers_ihl = (IP_VERSION << 4) | (IP_MIN_HDR_SIZE / 4);
+  ip_hdr->ih_length = htons(IP_MIN_HDR_SIZE + len);
+  ip_hdr->ih_id = htons((u16_t) id);
+  ip_hdr->ih_flags_fragoff = htons((off / 8) | (more ? IH_MORE_FRAGS : 0));
+  ip_hdr->ih_ttl = 64;
+  ip_hdr->ih_proto = PROTO;
+  ip_hdr->ih_src = srcaddr;
+  ip_hdr->ih_dst = myaddr;
+  sum = cksum((u8_t *) ip_hdr, IP_MIN_HDR_SIZE);
+  p = (u8_t *) &ip_hdr->ih_hdr_chk;
+  p[0] = sum >> 8;
+  p[1] = sum & 0xFF;
+
+  p = frame.b + ETH_HDR_SIZE + IP_MIN_HDR_SIZE;
+  for (i = 0; i < len; i++) p[i] = data(id, off + i);
+  size = ETH_HDR_SIZE + IP_MIN_HDR_SIZE + len;
+  if (size < ETH_MIN_PACK_SIZE) size = ETH_MIN_PACK_SIZE;
+  return(write(ethfd, frame.b, size) == size);
+}
+
+int recvdgram(idp)
+int *idp;
+{
+/* Read a datagram and check its contents.  Return its size, 0 if it is
+ * wrong, or -1 if nothing comes.
+ */
+  ip_hdr_t *ip_hdr;
+  int r, i, hlen, id;
+
+  alarm(2);
+  r = read(ipfd, dgram.b, sizeof(dgram.b));
+  alarm(0);
+  if (r < 0) return(-1);
+  ip_hdr = (ip_hdr_t *) dgram.b;
+  hlen = (ip_hdr->ih_vers_ihl & IH_IHL_MASK) * 4;
+  if (r < hlen || ntohs(ip_hdr->ih_length) != r) return(0);
+  if (ntohs(ip_hdr->ih_flags_fragoff) & (IH_FRAGOFF_MASK | IH_MORE_FRAGS))
+	return(0);
+  if (ip_hdr->ih_src != srcaddr) return(0);
+  id = ntohs(ip_hdr->ih_id);
+  for (i = 0; i < r - hlen; i++)
+	if (dgram.b[hlen + i] != data(id, i)) return(0);
+  *idp = id;
+  return(r - hlen);
+}
+
+void test53a()
+{
+/* Datagrams sent at the same time, fragments in a mixed up order. */
+  int n, i, j, k, id, first, got;
+  u32_t size;
+  char seen[NDGRAM];
+
+  subtest = 1;
+  size = DSIZE + NFRAG * IP_MIN_HDR_SIZE;
+  n = ipstat0.nwis_ass_max / size;
+  if (n > ipstat0.nwis_ass_nr) n = ipstat0.nwis_ass_nr;
+  if (n > NDGRAM) n = NDGRAM;
+  if (n == 0) return;			/* reassembly too small */
+
+  first = nextid;
+  nextid += n;
+  for (i = 0; i < NFRAG; i++) {
+	for (j = 0; j < n; j++) {
+		k = (NFRAG - 1 - i + j) % NFRAG;	/* backwards, from
+							 * a different place */
+		if (!sendfrag(first + j, k * FSIZE, k < NFRAG - 1 ? FSIZE
+				: DSIZE - k * FSIZE, k < NFRAG - 1)) e(1);
+	}
+  }
+  for (j = 0; j < n; j++) seen[j] = 0;
+  for (got = 0; got < n; got++) {
+	if ((i = recvdgram(&id)) <= 0) break;
+	if (i != DSIZE || (u16_t) (id - first) >= n
+			|| seen[(u16_t) (id - first)]++) e(2);
+  }
+  if (got != n) e(3);
+
+  if (!getstat(&ipstat)) e(4);
+  if (ipstat.nwis_ass_ok - ipstat0.nwis_ass_ok < n) e(5);
+  if (ipstat.nwis_ass_frags - ipstat0.nwis_ass_frags < n * NFRAG) e(6);
+  ipstat0 = ipstat;
+}
+
+void test53b()
+{
+/* Overlapping and duplicate fragments. */
+  int id, r;
+
+  subtest = 2;
+  id = nextid++;
+  if (!sendfrag(id, 0, 8 * SSIZE, 1)) e(1);
+  if (!sendfrag(id, 0, 8 * SSIZE, 1)) e(2);		/* duplicate */
+  if (!sendfrag(id, 10 * SSIZE, 2 * SSIZE, 1)) e(3);
+  if (!sendfrag(id, 12 * SSIZE, 4 * SSIZE, 0)) e(4);
+  if (!sendfrag(id, 4 * SSIZE, 8 * SSIZE, 1)) e(5);	/* both sides */
+
+  if ((r = recvdgram(&id)) != 16 * SSIZE) e(6);
+  if (!getstat(&ipstat)) e(7);
+  if (ipstat.nwis_ass_overlap - ipstat0.nwis_ass_overlap < 2) e(8);
+  if (ipstat.nwis_ass_ok - ipstat0.nwis_ass_ok < 1) e(9);
+  if (r > 0 && recvdgram(&id) != -1) e(10);		/* only once */
+  ipstat0 = ipstat;
+}
+
+void test53c()
+{
+/* More datagrams than the table holds; the oldest are given up. */
+  int n, i, id, first, got;
+
+  subtest = 3;
+  n = ipstat0.nwis_ass_nr;
+  if (n > 64) n = 64;
+  if ((n + NEXTRA) * 2 * (SSIZE + IP_MIN_HDR_SIZE) > ipstat0.nwis_ass_max)
+	return;				/* reassembly too small */
+
+  first = nextid;
+  nextid += n + NEXTRA;
+  for (i = 0; i < n + NEXTRA; i++)
+	if (!sendfrag(first + i, 0, SSIZE, 1)) e(1);
+
+  /* Newest first, so that the last halves of the oldest datagrams don't
+   * push out what is left of the others.
+   */
+  for (i = n + NEXTRA - 1; i >= 0; i--)
+	if (!sendfrag(first + i, SSIZE, SSIZE, 0)) e(2);
+
+  got = 0;
+  while ((i = recvdgram(&id)) > 0) {
+	if (i != 2 * SSIZE || (u16_t) (id - first) < NEXTRA) e(3);
+	got++;
+  }
+  if (i == 0) e(4);
+  if (got != n) e(5);
+
+  if (!getstat(&ipstat)) e(6);
+  if (ipstat.nwis_ass_evict - ipstat0.nwis_ass_evict < NEXTRA) e(7);
+  ipstat0 = ipstat;
+}
+
+void e(n)
+int n;
+{
+  int err_num = errno;		/* Save in case printf clobbers it. */
+
+  printf("Subtest %d,  error %d  errno=%d: ", subtest, n, errno);
+  errno = err_num;
+  perror("");
+  if (errct++ > MAX_ERROR) {
+	printf("Too many errors; test aborted\n");
+	quit();
+  }
+  errno = 0;
+}
+
+void quit()
+{
+  if (errct == 0) {
+	printf("ok\n");
+	exit(0);
+  } else {
+	printf("%d errors\n", errct);
+	exit(1);
+  }
+}
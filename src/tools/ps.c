@@ -7,9 +7,12 @@
  * If you want to compile this for non-IBM PC architectures, the header files
  * require that you have your CHIP, MACHINE etc. defined.
  * Full syntax:
- *	ps [-][alx]
+ *	ps [-][alxi] [-s[secs]]
  * Option `a' gives all processes, `l' for detailed info, `x' includes even
- * processes without a terminal.
+ * processes without a terminal.  Option `i' shows the IPC and blocking
+ * accounting of each process instead.  Option `s' samples the accounting
+ * every `secs' seconds (default 2) and shows the busiest processes first,
+ * like top(1).
  *
  * VERY IMPORTANT NOTE:
  *	To compile ps, the kernel/, fs/ and mm/ source directories must be in
@@ -44,6 +47,9 @@
  *	  If sleeping, mm's mp_flags, or fs's fp_task are used for more info.
  * TTY	- fs controlling tty device field, fp_tty.
  * TIME	- kernel user + system times fields, user_time + sys_time
+ * SENT, RECV, CSW, FS, MM, TASK, OTHER, SWAP, FLIP
+ *	- message, context switch, blocked time, swap and shadow flip counters
+ *	  obtained with svrctl(SYSGETPROC); the blocked times are in seconds.
  * CMD	- system process index (converted to mnemonic name by using the p_name
  *	  field), or user process argument list (obtained by reading the stack
  *	  frame; the resulting address is used to get the argument vector from
@@ -66,6 +72,7 @@
 #include <dirent.h>
 #include <sys/stat.h>
 #include <sys/ioctl.h>
+#include <sys/svrctl.h>
 #include <signal.h>
 #include <stdio.h>
 #include <ttyent.h>
@@ -118,6 +125,8 @@ int init_proc_nr;
 
 int kmemfd, memfd;		/* file descriptors of [k]mem */
 
+struct psinfo ps_psinfo;	/* where the kernel keeps the tables */
+
 /* Short and long listing formats:
  *
  *   PID TTY  TIME CMD
@@ -131,6 +140,32 @@ int kmemfd, memfd;		/* file descriptors of [k]mem */
 #define L_HEADER "  F S UID   PID  PPID  PGRP   SZ       RECV TTY  TIME CMD\n"
 #define L_FORMAT "%3o %c %3d %5s %5d %5d %4d %10s %3s %s %s\n"
 
+/* Accounting (-i) and sampling (-s) formats:
+ *
+ *   PID   SENT   RECV   CSW    FS    MM  TASK OTHER SWAP FLIP  TIME CMD
+ * ppppp ssssss rrrrrr ccccc fffff mmmmm ttttt ooooo wwww llll  tttmmm:ss cc...
+ *
+ *   PID CPU% SENT/s RECV/s CSW/s  FS%  MM% TSK% OTH% SWAP CMD
+ * ppppp cccc ssssss rrrrrr ccccc ffff mmmm tttt oooo wwww cccccccc...
+ */
+#define I_HEADER \
+  "  PID   SENT   RECV   CSW    FS    MM  TASK OTHER SWAP FLIP  TIME CMD\n"
+#define I_FORMAT "%5s %6lu %6lu %5lu %5lu %5lu %5lu %5lu %4lu %4lu %s %s\n"
+#define T_HEADER \
+  "  PID CPU%% SENT/s RECV/s CSW/s  FS%%  MM%% TSK%% OTH%% SWAP CMD\n"
+#define T_FORMAT "%5s %4lu %6lu %6lu %5lu %4lu %4lu %4lu %4lu %4lu %s\n"
+
+#define DEF_INTERVAL	2	/* default seconds between samples */
+
+/* One line of the sampling display. */
+struct sample {
+  int sa_slot;			/* process slot */
+  struct sysgetproc sa_now;	/* counters at this sample */
+  unsigned long sa_cpu;		/* ticks used since the last sample */
+  unsigned long sa_msgs;	/* messages since the last sample */
+  char sa_cmd[32];		/* command name */
+};
+
 struct pstat {			/* structure filled by pstat() */
   dev_t ps_dev;			/* major/minor of controlling tty */
   uid_t ps_ruid;		/* real uid */
@@ -169,6 +204,11 @@ _PROTOTYPE(char *tname, (Dev_t dev_nr ));
 _PROTOTYPE(char *taskname, (int p_nr ));
 _PROTOTYPE(char *prrecv, (struct pstat *bufp ));
 _PROTOTYPE(void disaster, (int sig ));
+_PROTOTYPE(void gettables, (void));
+_PROTOTYPE(char *cmdname, (int p_nr, struct pstat *bufp ));
+_PROTOTYPE(char *pidname, (int p_nr, struct pstat *bufp ));
+_PROTOTYPE(int cmpsample, (_CONST void *sa1, _CONST void *sa2 ));
+_PROTOTYPE(void sample, (int interval, int opt_all, int opt_notty, int uid));
 _PROTOTYPE(int main, (int argc, char *argv []));
 _PROTOTYPE(char *get_args, (struct pstat *bufp ));
 _PROTOTYPE(int pstat, (int p_nr, struct pstat *bufp ));
@@ -268,13 +308,15 @@ char *argv[];
   int opt_all = FALSE;		/* -a */
   int opt_long = FALSE;		/* -l */
   int opt_notty = FALSE;	/* -x */
+  int opt_acct = FALSE;		/* -i */
+  int opt_sample = 0;		/* -s: seconds between samples */
   char *ke_path;		/* paths of kernel, */
   char *mm_path;		/* mm, */
   char *fs_path;		/* and fs used in ps -U */
   struct psinfo psinfo;
-  char pid[2 + sizeof(pid_t) * 3];
   unsigned long ustime;
   char cpu[sizeof(clock_t) * 3 + 1 + 2];
+  struct sysgetproc acct;
 
   (void) signal(SIGSEGV, disaster);	/* catch a common crash */
 
@@ -288,6 +330,13 @@ char *argv[];
 		case 'f':
 		case 'l':	opt_long = TRUE;		break;
 		case 'x':	opt_notty = TRUE;		break;
+		case 'i':	opt_acct = TRUE;		break;
+		case 's':
+			opt_sample = 0;
+			while (*opt >= '0' && *opt <= '9')
+				opt_sample = opt_sample * 10 + (*opt++ - '0');
+			if (opt_sample == 0) opt_sample = DEF_INTERVAL;
+			break;
 		default:	usage(argv[0]);
 	}
   }
@@ -300,6 +349,7 @@ char *argv[];
 	err("can't get PS info from kernel");
   nr_tasks = psinfo.nr_tasks;
   nr_procs = psinfo.nr_procs;
+  ps_psinfo = psinfo;
 
   /* Allocate memory for process tables */
   ps_proc = (struct proc *) malloc((nr_tasks + nr_procs) * sizeof(ps_proc[0]));
@@ -308,43 +358,16 @@ char *argv[];
   if (ps_proc == NULL || ps_mproc == NULL || ps_fproc == NULL)
 	err("Out of memory");
 
-  /* Get kernel process table */
-  if (addrread(kmemfd, (phys_clicks) 0,
-		psinfo.proc, (char *) ps_proc,
-		(nr_tasks + nr_procs) * sizeof(ps_proc[0]))
-			!= (nr_tasks + nr_procs) * sizeof(ps_proc[0]))
-	err("Can't get kernel proc table from /dev/kmem");
+  gettables();
 
-  /* Get mm/fs process tables */
-  if (addrread(memfd, ps_proc[nr_tasks + MM_PROC_NR].p_map[D].mem_phys,
-		psinfo.mproc, (char *) ps_mproc,
-		nr_procs * sizeof(ps_mproc[0]))
-			!= nr_procs * sizeof(ps_mproc[0]))
-	err("Can't get mm proc table from /dev/mem");
-  if (addrread(memfd, ps_proc[nr_tasks + FS_PROC_NR].p_map[D].mem_phys,
-		psinfo.fproc, (char *) ps_fproc,
-		nr_procs * sizeof(ps_fproc[0]))
-			!= nr_procs * sizeof(ps_fproc[0]))
-	err("Can't get fs proc table from /dev/mem");
-
-  /* We need to know where INIT hangs out. */
-  for (i = FS_PROC_NR; i < nr_procs; i++) {
-	if (strcmp(ps_proc[nr_tasks + i].p_name, "INIT") == 0) break;
-  }
-  init_proc_nr = i;
+  if (opt_sample != 0) sample(opt_sample, opt_all, opt_notty, uid);
 
   /* Now loop through process table and handle each entry */
-  printf("%s", opt_long ? L_HEADER : S_HEADER);
+  printf("%s", opt_acct ? I_HEADER : opt_long ? L_HEADER : S_HEADER);
   for (i = -nr_tasks; i < nr_procs; i++) {
 	if (pstat(i, &buf) != -1 &&
 	    (opt_all || buf.ps_euid == uid || buf.ps_ruid == uid) &&
 	    (opt_notty || majdev(buf.ps_dev) == TTY_MAJ)) {
-		if (buf.ps_pid == 0) {
-			sprintf(pid, "(%d)", i);
-		} else {
-			sprintf(pid, "%d", buf.ps_pid);
-		}
-
 		ustime = (buf.ps_utime + buf.ps_stime) / HZ;
 		if (ustime < 60 * 60) {
 			sprintf(cpu, "%2lu:%02lu", ustime / 60, ustime % 60);
@@ -356,9 +379,25 @@ char *argv[];
 			sprintf(cpu, "%4luh", ustime / 3600);
 		}
 
+		if (opt_acct) {
+			acct.proc_nr = i;
+			if (svrctl(SYSGETPROC, (void *) &acct) == -1)
+				continue;
+			printf(I_FORMAT, pidname(i, &buf),
+			       (unsigned long) acct.msgsent,
+			       (unsigned long) acct.msgrecv,
+			       (unsigned long) (acct.nvcsw + acct.nivcsw),
+			       (unsigned long) acct.blktime[BLK_FS] / HZ,
+			       (unsigned long) acct.blktime[BLK_MM] / HZ,
+			       (unsigned long) acct.blktime[BLK_TASK] / HZ,
+			       (unsigned long) acct.blktime[BLK_OTHER] / HZ,
+			       (unsigned long) (acct.nswapin + acct.nswapout),
+			       (unsigned long) acct.nflips,
+			       cpu, cmdname(i, &buf));
+		} else
 		if (opt_long) printf(L_FORMAT,
 			       buf.ps_flags, buf.ps_state,
-			       buf.ps_euid, pid, buf.ps_ppid,
+			       buf.ps_euid, pidname(i, &buf), buf.ps_ppid,
 			       buf.ps_pgrp,
 			       off_to_k((buf.ps_tsize
 					 + buf.ps_stack - buf.ps_data
@@ -367,20 +406,171 @@ char *argv[];
 				prrecv(&buf) :
 				""),
 			       tname((Dev_t) buf.ps_dev),
-			       cpu,
-			       i <= init_proc_nr || buf.ps_args == NULL
-				       ? taskname(i) : buf.ps_args);
+			       cpu, cmdname(i, &buf));
 		else
 			printf(S_FORMAT,
-			       pid, tname((Dev_t) buf.ps_dev),
-			       cpu,
-			       i <= init_proc_nr || buf.ps_args == NULL
-				       ? taskname(i) : buf.ps_args);
+			       pidname(i, &buf), tname((Dev_t) buf.ps_dev),
+			       cpu, cmdname(i, &buf));
 	}
   }
   return(0);
 }
 
+/* Gettables reads the process tables of the kernel, MM and FS. */
+void gettables()
+{
+  int i;
+
+  /* Get kernel process table */
+  if (addrread(kmemfd, (phys_clicks) 0,
+		ps_psinfo.proc, (char *) ps_proc,
+		(nr_tasks + nr_procs) * sizeof(ps_proc[0]))
+			!= (nr_tasks + nr_procs) * sizeof(ps_proc[0]))
+	err("Can't get kernel proc table from /dev/kmem");
+
+  /* Get mm/fs process tables */
+  if (addrread(memfd, ps_proc[nr_tasks + MM_PROC_NR].p_map[D].mem_phys,
+		ps_psinfo.mproc, (char *) ps_mproc,
+		nr_procs * sizeof(ps_mproc[0]))
+			!= nr_procs * sizeof(ps_mproc[0]))
+	err("Can't get mm proc table from /dev/mem");
+  if (addrread(memfd, ps_proc[nr_tasks + FS_PROC_NR].p_map[D].mem_phys,
+		ps_psinfo.fproc, (char *) ps_fproc,
+		nr_procs * sizeof(ps_fproc[0]))
+			!= nr_procs * sizeof(ps_fproc[0]))
+	err("Can't get fs proc table from /dev/mem");
+
+  /* We need to know where INIT hangs out. */
+  for (i = FS_PROC_NR; i < nr_procs; i++) {
+	if (strcmp(ps_proc[nr_tasks + i].p_name, "INIT") == 0) break;
+  }
+  init_proc_nr = i;
+}
+
+/* Pidname returns the pid of process p_nr, or its slot number in parentheses
+ * if it has none; overwritten on each call.
+ */
+char *pidname(p_nr, bufp)
+int p_nr;
+struct pstat *bufp;
+{
+  static char pid[2 + sizeof(pid_t) * 3];
+
+  if (bufp->ps_pid == 0) {
+	sprintf(pid, "(%d)", p_nr);
+  } else {
+	sprintf(pid, "%d", bufp->ps_pid);
+  }
+  return pid;
+}
+
+/* Cmdname returns the argument list of process p_nr, or the task name. */
+char *cmdname(p_nr, bufp)
+int p_nr;
+struct pstat *bufp;
+{
+  return p_nr <= init_proc_nr || bufp->ps_args == NULL
+	? taskname(p_nr) : bufp->ps_args;
+}
+
+/* Cmpsample orders samples by CPU use, then by message traffic. */
+int cmpsample(sa1, sa2)
+_CONST void *sa1;
+_CONST void *sa2;
+{
+  _CONST struct sample *s1 = sa1, *s2 = sa2;
+
+  if (s1->sa_cpu != s2->sa_cpu) return s1->sa_cpu < s2->sa_cpu ? 1 : -1;
+  if (s1->sa_msgs != s2->sa_msgs) return s1->sa_msgs < s2->sa_msgs ? 1 : -1;
+  return s1->sa_slot - s2->sa_slot;
+}
+
+/* Sample shows the accounting of the selected processes every 'interval'
+ * seconds, busiest first.  The numbers are per second, or a percentage of
+ * the interval for the CPU and blocked times.  It never returns.
+ */
+void sample(interval, opt_all, opt_notty, uid)
+int interval;
+int opt_all;
+int opt_notty;
+int uid;
+{
+  struct sysgetproc *prev;
+  struct sample *samples, *sp;
+  struct pstat buf;
+  struct sysgetproc *op;
+  int i, n, first;
+  unsigned long ticks, pct[NR_BLK], d;
+
+  prev = (struct sysgetproc *) calloc(nr_tasks + nr_procs, sizeof(prev[0]));
+  samples = (struct sample *) malloc((nr_tasks + nr_procs) * sizeof(samples[0]));
+  if (prev == NULL || samples == NULL) err("Out of memory");
+  ticks = (unsigned long) interval * HZ;
+
+  for (first = 1; ; first = 0) {
+	n = 0;
+	for (i = -nr_tasks; i < nr_procs; i++) {
+		if (pstat(i, &buf) == -1) continue;
+		if (!(opt_all || buf.ps_euid == uid || buf.ps_ruid == uid) ||
+			!(opt_notty || majdev(buf.ps_dev) == TTY_MAJ)) continue;
+
+		sp = &samples[n];
+		sp->sa_now.proc_nr = i;
+		if (svrctl(SYSGETPROC, (void *) &sp->sa_now) == -1) continue;
+		op = &prev[i + nr_tasks];
+		if (op->pid != sp->sa_now.pid || op->proc_nr != i) {
+			/* New process in this slot, count from zero. */
+			memset((void *) op, 0, sizeof(*op));
+		}
+		sp->sa_slot = i;
+		sp->sa_cpu = (sp->sa_now.utime + sp->sa_now.stime)
+						- (op->utime + op->stime);
+		sp->sa_msgs = (sp->sa_now.msgsent + sp->sa_now.msgrecv)
+						- (op->msgsent + op->msgrecv);
+		strncpy(sp->sa_cmd, cmdname(i, &buf), sizeof(sp->sa_cmd) - 1);
+		sp->sa_cmd[sizeof(sp->sa_cmd) - 1] = '\0';
+		n++;
+	}
+	qsort((void *) samples, n, sizeof(samples[0]), cmpsample);
+
+	if (!first) {
+		printf("\033[H\033[J");	/* home and clear screen */
+		printf("ps: sampled every %d second%s\n\n",
+					interval, interval == 1 ? "" : "s");
+		printf(T_HEADER);
+		for (sp = samples; sp < &samples[n]; sp++) {
+			op = &prev[sp->sa_slot + nr_tasks];
+			for (i = 0; i < NR_BLK; i++) {
+				d = sp->sa_now.blktime[i] - op->blktime[i];
+				pct[i] = d * 100 / ticks;
+			}
+			buf.ps_pid = sp->sa_now.pid;
+			printf(T_FORMAT, pidname(sp->sa_slot, &buf),
+				sp->sa_cpu * 100 / ticks,
+				(unsigned long) (sp->sa_now.msgsent
+						- op->msgsent) / interval,
+				(unsigned long) (sp->sa_now.msgrecv
+						- op->msgrecv) / interval,
+				(unsigned long) ((sp->sa_now.nvcsw
+					+ sp->sa_now.nivcsw) - (op->nvcsw
+					+ op->nivcsw)) / interval,
+				pct[BLK_FS], pct[BLK_MM],
+				pct[BLK_TASK], pct[BLK_OTHER],
+				(unsigned long) ((sp->sa_now.nswapin
+					+ sp->sa_now.nswapout) - (op->nswapin
+					+ op->nswapout)),
+				sp->sa_cmd);
+		}
+		fflush(stdout);
+	}
+	for (sp = samples; sp < &samples[n]; sp++)
+		prev[sp->sa_slot + nr_tasks] = sp->sa_now;
+
+	sleep(interval);
+	gettables();
+  }
+}
+
 char *get_args(bufp)
 struct pstat *bufp;
 {
@@ -541,7 +731,7 @@ int nbytes;
 void usage(pname)
 char *pname;
 {
-  fprintf(stderr, "Usage: %s [-][alx]\n", pname);
+  fprintf(stderr, "Usage: %s [-][alxi] [-s[secs]]\n", pname);
   exit(1);
 }
 